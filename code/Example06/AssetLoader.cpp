@@ -0,0 +1,135 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "AssetLoader.h"
+
+#include <QCoreApplication>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOffscreenSurface>
+#include <QElapsedTimer>
+#include <QDebug>
+
+
+AssetLoader::AssetLoader(QOpenGLContext * shareContext) :
+	m_pendingCount(0),
+	m_stop(false)
+{
+	m_context = new QOpenGLContext;
+	m_context->setFormat(shareContext->format());
+	m_context->setShareContext(shareContext);
+	m_context->create();
+	if (!m_context->shareContext())
+		qWarning() << "AssetLoader: context sharing not supported";
+
+	m_surface = new QOffscreenSurface;
+	m_surface->setFormat(m_context->format());
+	m_surface->create();
+
+	m_context->moveToThread(this);
+	start();
+}
+
+
+AssetLoader::~AssetLoader() {
+	{
+		QMutexLocker lock(&m_mutex);
+		m_stop = true;
+		m_condition.wakeOne();
+	}
+	wait();
+
+	QOpenGLContext * ctx = QOpenGLContext::currentContext();
+	if (ctx != nullptr && QOpenGLContext::areSharing(ctx, m_context)) {
+		for (const Job & job : m_uploaded)
+			ctx->extraFunctions()->glDeleteSync(job.m_fence);
+	}
+	delete m_context;
+	delete m_surface;
+}
+
+
+void AssetLoader::enqueue(const std::function<void()> & upload, const std::function<void()> & resident) {
+	QMutexLocker lock(&m_mutex);
+	Job job;
+	job.m_upload = upload;
+	job.m_resident = resident;
+	job.m_fence = nullptr;
+	m_queue.push_back(job);
+	++m_pendingCount;
+	m_condition.wakeOne();
+}
+
+
+void AssetLoader::processCompleted() {
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	std::vector<Job> completed;
+	{
+		QMutexLocker lock(&m_mutex);
+		for (unsigned int i=0; i<m_uploaded.size();) {
+			// timeout 0 -> only query state, never wait
+			GLenum res = f->glClientWaitSync(m_uploaded[i].m_fence, 0, 0);
+			if (res == GL_ALREADY_SIGNALED || res == GL_CONDITION_SATISFIED) {
+				f->glDeleteSync(m_uploaded[i].m_fence);
+				completed.push_back(m_uploaded[i]);
+				m_uploaded.erase(m_uploaded.begin() + i);
+			}
+			else {
+				++i;
+			}
+		}
+	}
+	// call resident functions without holding the lock
+	for (const Job & job : completed)
+		job.m_resident();
+	if (!completed.empty()) {
+		QMutexLocker lock(&m_mutex);
+		m_pendingCount -= completed.size();
+	}
+}
+
+
+unsigned int AssetLoader::pendingCount() const {
+	QMutexLocker lock(&m_mutex);
+	return m_pendingCount;
+}
+
+
+void AssetLoader::run() {
+	m_context->makeCurrent(m_surface);
+	QOpenGLExtraFunctions * f = m_context->extraFunctions();
+	for (;;) {
+		Job job;
+		{
+			QMutexLocker lock(&m_mutex);
+			while (m_queue.empty() && !m_stop)
+				m_condition.wait(&m_mutex);
+			if (m_stop)
+				break;
+			job = m_queue.front();
+			m_queue.pop_front();
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+		job.m_upload();
+		job.m_fence = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		// flush, so that the fence is guaranteed to be signaled eventually
+		f->glFlush();
+		qDebug() << "AssetLoader - upload submitted in" << timer.elapsed() << "ms";
+
+		QMutexLocker lock(&m_mutex);
+		m_uploaded.push_back(job);
+	}
+	// hand the context back to the GUI thread, where it is deleted
+	m_context->doneCurrent();
+	m_context->moveToThread(QCoreApplication::instance()->thread());
+}
@@ -0,0 +1,99 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtGui/qopengl.h>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+class QOpenGLContext;
+class QOffscreenSurface;
+QT_END_NAMESPACE
+
+/*! Uploads buffer and texture data in a background thread.
+
+	The loader thread owns an OpenGL context that shares objects with the rendering context. Each job
+	consists of an upload function, executed in the loader thread with the loader context current, and
+	a resident function, executed in the rendering context once the upload has completed on the GPU.
+	Completion is detected with a fence (glFenceSync) inserted after each upload, which is polled
+	without blocking in processCompleted().
+
+	Container objects (vertex array objects, framebuffer objects) are not shared between contexts, so
+	these must be created or bound in the rendering context. Buffer and texture names should also be created
+	(and arena ranges allocated, see BufferArena) in the rendering context, only the data is uploaded in
+	the loader thread.
+
+	\code
+	// in initializeGL(), rendering context is current
+	m_boxObject.createBuffers(m_bufferArena);
+	m_assetLoader->enqueue([this](){ m_boxObject.upload(); },
+						   [this](){ m_boxObject.makeResident(); });
+
+	// in paintGL(), rendering context is current
+	m_assetLoader->processCompleted();
+	if (m_boxObject.m_resident)
+		m_boxObject.render();
+	\endcode
+*/
+class AssetLoader : public QThread {
+public:
+	/*! Creates the loader context, sharing objects with shareContext, and starts the loader thread.
+		Must be called in the GUI thread (offscreen surfaces can only be created there).
+		shareContext must be created, but need not be current.
+	*/
+	explicit AssetLoader(QOpenGLContext * shareContext);
+	/*! Stops the loader thread. Pending fences are deleted, if an OpenGL context of the share group is current. */
+	~AssetLoader() override;
+
+	/*! Queues a job, the functions are described in the class documentation. Can be called from any thread. */
+	void enqueue(const std::function<void()> & upload, const std::function<void()> & resident);
+
+	/*! Calls the resident functions of all jobs, whose uploads have been completed by the GPU.
+		Must be called with the rendering context current, never blocks.
+	*/
+	void processCompleted();
+
+	/*! Number of jobs whose resident function has not been called yet. Can be called from any thread. */
+	unsigned int pendingCount() const;
+
+protected:
+	void run() override;
+
+private:
+	struct Job {
+		std::function<void()>	m_upload;
+		std::function<void()>	m_resident;
+		/*! Fence inserted after the upload. */
+		GLsync					m_fence;
+	};
+
+	QOpenGLContext				*m_context;
+	QOffscreenSurface			*m_surface;
+
+	mutable QMutex				m_mutex;
+	QWaitCondition				m_condition;
+	/*! Jobs waiting for upload. */
+	std::deque<Job>				m_queue;
+	/*! Uploaded jobs waiting for their fence to be signaled. */
+	std::vector<Job>			m_uploaded;
+	unsigned int				m_pendingCount;
+	bool						m_stop;
+};
+
+#endif // ASSETLOADER_H
@@ -0,0 +1,228 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "AsyncLogger.h"
+
+#include <QDateTime>
+#include <QString>
+
+#include <chrono>
+
+std::atomic<AsyncLogger*> AsyncLogger::m_instance(nullptr);
+std::atomic<int> AsyncLogger::m_activeProducers(0);
+
+
+AsyncLogger::AsyncLogger(FILE * out) :
+	m_out(out),
+	m_previousHandler(nullptr),
+	m_rateLimit(1000),
+	m_tail(&m_stub),
+	m_pushedCount(0),
+	m_writtenCount(0),
+	m_stop(false)
+{
+	Q_ASSERT(m_instance.load() == nullptr);
+	m_stub.m_next.store(nullptr);
+	m_head.store(&m_stub);
+	for (CategorySlot & slot : m_categories) {
+		slot.m_category.store(nullptr);
+		slot.m_second.store(-1);
+		slot.m_count.store(0);
+		slot.m_dropped.store(0);
+	}
+
+	m_timer.start();
+	QByteArray header = "[Log started " + QDateTime::currentDateTime().toString().toUtf8() + "]\n";
+	std::fwrite(header.constData(), 1, header.size(), m_out);
+	std::fflush(m_out);
+
+	m_writer = std::thread(&AsyncLogger::writerLoop, this);
+	m_instance.store(this);
+	m_previousHandler = qInstallMessageHandler(&AsyncLogger::messageHandler);
+}
+
+
+AsyncLogger::~AsyncLogger() {
+	qInstallMessageHandler(m_previousHandler);
+	// threads that entered the handler before it was uninstalled may still hold a pointer to this logger;
+	// after m_instance is cleared, new calls return immediately, so wait for the remaining ones
+	// (both sides use sequentially consistent operations, see messageHandler())
+	m_instance.store(nullptr);
+	while (m_activeProducers.load() != 0)
+		std::this_thread::yield();
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_stop = true;
+	}
+	m_wakeCondition.notify_one();
+	m_writer.join();
+	// writer has written all pushed records, only the last (dummy) node may be left
+	Q_ASSERT(m_tail->m_next.load() == nullptr);
+	if (m_tail != &m_stub)
+		delete m_tail;
+}
+
+
+void AsyncLogger::flush() {
+	quint64 target = m_pushedCount.load();
+	std::unique_lock<std::mutex> lock(m_wakeMutex);
+	m_wakeCondition.notify_one();
+	m_flushedCondition.wait(lock, [this, target]() { return m_writtenCount.load() >= target || m_stop.load(); });
+}
+
+
+void AsyncLogger::messageHandler(QtMsgType type, const QMessageLogContext & context, const QString & msg) {
+	// register as producer before reading the instance: either the destructor sees the count and waits,
+	// or this thread sees the cleared instance
+	m_activeProducers.fetch_add(1);
+	AsyncLogger * logger = m_instance.load();
+	if (logger != nullptr)
+		logger->log(type, context, msg);
+	m_activeProducers.fetch_sub(1);
+}
+
+
+void AsyncLogger::log(QtMsgType type, const QMessageLogContext & context, const QString & msg) {
+	qint64 timestampNs = m_timer.nsecsElapsed();
+	if (type != QtCriticalMsg && type != QtFatalMsg &&
+		!acceptMessage(context.category != nullptr ? context.category : "default", timestampNs))
+	{
+		return;
+	}
+
+	Record * r = new Record;
+	r->m_timestampNs = timestampNs;
+	r->m_type = type;
+	r->m_text = msg.toUtf8();
+	push(r);
+
+	// Qt aborts after a fatal message, so make sure it has been written
+	if (type == QtFatalMsg)
+		flush();
+}
+
+
+bool AsyncLogger::acceptMessage(const char * category, qint64 timestampNs) {
+	unsigned int limit = m_rateLimit.load(std::memory_order_relaxed);
+	if (limit == 0)
+		return true;
+	// category names are string literals of the QLoggingCategory objects, so the pointer identifies the category
+	size_t hash = (reinterpret_cast<quintptr>(category) >> 3) % CategorySlotCount;
+	for (unsigned int i=0; i<CategorySlotCount; ++i) {
+		CategorySlot & slot = m_categories[(hash + i) % CategorySlotCount];
+		const char * slotCategory = slot.m_category.load(std::memory_order_acquire);
+		if (slotCategory == nullptr) {
+			// claim empty slot; if another thread was faster, check whether it claimed it for the same category
+			if (!slot.m_category.compare_exchange_strong(slotCategory, category))
+				if (slotCategory != category)
+					continue;
+		}
+		else if (slotCategory != category) {
+			continue;
+		}
+
+		// counting window of one second; concurrent resets may lose a few counts, which is fine for rate limiting
+		qint64 second = timestampNs/1000000000;
+		qint64 slotSecond = slot.m_second.load(std::memory_order_relaxed);
+		if (slotSecond != second && slot.m_second.compare_exchange_strong(slotSecond, second))
+			slot.m_count.store(0, std::memory_order_relaxed);
+		if (slot.m_count.fetch_add(1, std::memory_order_relaxed) < limit)
+			return true;
+		slot.m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return true; // too many categories, don't limit
+}
+
+
+void AsyncLogger::push(Record * r) {
+	// Vyukov's intrusive MPSC queue: a single atomic exchange per push
+	r->m_next.store(nullptr, std::memory_order_relaxed);
+	Record * prev = m_head.exchange(r, std::memory_order_acq_rel);
+	prev->m_next.store(r, std::memory_order_release);
+	m_pushedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+AsyncLogger::Record * AsyncLogger::pop() {
+	Record * tail = m_tail;
+	Record * next = tail->m_next.load(std::memory_order_acquire);
+	if (next == nullptr)
+		return nullptr; // empty, or a producer has not yet linked its record (picked up in a later call)
+	// next becomes the new (dummy) tail, its payload is moved into the old tail node which is returned
+	m_tail = next;
+	// the stub node is not heap allocated, so its successor's payload is returned in a new record (first pop only)
+	if (tail == &m_stub)
+		tail = new Record;
+	tail->m_timestampNs = next->m_timestampNs;
+	tail->m_type = next->m_type;
+	tail->m_text.swap(next->m_text);
+	return tail;
+}
+
+
+void AsyncLogger::writerLoop() {
+	QByteArray buffer;
+	for (;;) {
+		bool stop = m_stop.load();
+		writePending(buffer);
+		// pop() stops at a record whose producer has exchanged m_head, but not yet linked it; when stopping,
+		// all producers have left the handler, so keep draining until every pushed record has been written
+		while (stop && m_writtenCount.load() != m_pushedCount.load()) {
+			std::this_thread::yield();
+			writePending(buffer);
+		}
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_flushedCondition.notify_all();
+			if (stop)
+				break;
+			// batch all records arriving within a few milliseconds into one write
+			m_wakeCondition.wait_for(lock, std::chrono::milliseconds(5));
+		}
+	}
+}
+
+
+unsigned int AsyncLogger::writePending(QByteArray & buffer) {
+	buffer.clear();
+	unsigned int count = 0;
+	Record * r;
+	while ((r = pop()) != nullptr) {
+		const char * prefix = "";
+		switch (r->m_type) {
+			case QtDebugMsg		: prefix = "Debug:    "; break;
+			case QtWarningMsg	: prefix = "Warning:  "; break;
+			case QtCriticalMsg	: prefix = "Critical: "; break;
+			case QtFatalMsg		: prefix = "Fatal:    "; break;
+			case QtInfoMsg		: prefix = "Info:     "; break;
+		}
+		QByteArray timestamp = "[" + QByteArray::number(r->m_timestampNs*1e-9, 'f', 6).rightJustified(11) + "] ";
+		for (const QByteArray & line : r->m_text.split('\n'))
+			buffer += timestamp + prefix + line + '\n';
+		delete r;
+		++count;
+	}
+
+	for (CategorySlot & slot : m_categories) {
+		unsigned int dropped = slot.m_dropped.exchange(0, std::memory_order_relaxed);
+		if (dropped != 0)
+			buffer += "Warning:  " + QByteArray::number(dropped) + " messages of category '" +
+					  slot.m_category.load() + "' dropped (rate limit)\n";
+	}
+
+	if (!buffer.isEmpty()) {
+		std::fwrite(buffer.constData(), 1, buffer.size(), m_out);
+		std::fflush(m_out);
+	}
+	m_writtenCount.fetch_add(count);
+	return count;
+}
@@ -0,0 +1,129 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+/*! Qt message handler, that never blocks the calling thread on I/O.
+
+	The message handler only takes a monotonic timestamp, converts the message to UTF-8 and appends
+	the record to a lock-free multiple-producer/single-consumer queue. A background writer thread
+	drains the queue every few milliseconds, formats all pending records into one buffer and writes
+	it with a single write/flush.
+
+	Each message category (QLoggingCategory, qDebug() etc. use "default") is limited to a number of
+	messages per second; excess debug/info/warning messages are dropped and the number of dropped messages
+	is reported by the writer. Critical and fatal messages are never dropped, fatal messages are flushed
+	before the handler returns (Qt aborts afterwards).
+
+	Timestamps are seconds since the logger was created, the wall clock time of creation is written once.
+
+	On destruction, the previous handler is restored and the destructor waits until no thread is inside
+	the message handler any longer (threads of the pool or the render thread may still be logging). Only
+	then the writer is stopped, after it has written every record pushed so far.
+
+	\code
+	int main(int argc, char **argv) {
+		AsyncLogger logger; // installs itself as message handler, flushes and uninstalls in destructor
+		...
+	}
+	\endcode
+*/
+class AsyncLogger {
+public:
+	/*! Creates the writer thread and installs the message handler. Only one instance may exist. */
+	explicit AsyncLogger(FILE * out = stdout);
+	/*! Restores the previous message handler, writes all pending records and stops the writer thread. */
+	~AsyncLogger();
+
+	/*! Sets maximum number of messages per second and category (0 = no limit). */
+	void setRateLimit(unsigned int messagesPerSecond) { m_rateLimit = messagesPerSecond; }
+
+	/*! Blocks until all records queued so far have been written. */
+	void flush();
+
+private:
+	/*! A log record, also the node of the intrusive queue. */
+	struct Record {
+		std::atomic<Record*>	m_next;
+		qint64					m_timestampNs;
+		QtMsgType				m_type;
+		QByteArray				m_text;
+	};
+
+	/*! Rate limit counter for a category, identified by pointer to the category name. */
+	struct CategorySlot {
+		std::atomic<const char*>	m_category;
+		/*! Second (since logger start) the counter refers to. */
+		std::atomic<qint64>			m_second;
+		std::atomic<unsigned int>	m_count;
+		std::atomic<unsigned int>	m_dropped;
+	};
+
+	static void messageHandler(QtMsgType type, const QMessageLogContext & context, const QString & msg);
+	/*! Timestamps, rate-limits and queues a message (called by messageHandler()). */
+	void log(QtMsgType type, const QMessageLogContext & context, const QString & msg);
+
+	/*! Returns false if the message exceeds the rate limit of its category (and counts it as dropped). */
+	bool acceptMessage(const char * category, qint64 timestampNs);
+
+	/*! Lock-free push (any thread). */
+	void push(Record * r);
+	/*! Pop oldest record, returns nullptr if queue is empty (writer thread only). */
+	Record * pop();
+
+	/*! Writer thread function. */
+	void writerLoop();
+	/*! Writes all queued records, returns number of records written (writer thread only). */
+	unsigned int writePending(QByteArray & buffer);
+
+	/*! The installed logger, cleared by the destructor before it waits for the producers. */
+	static std::atomic<AsyncLogger*>	m_instance;
+	/*! Number of threads currently inside messageHandler(), incremented before m_instance is read. */
+	static std::atomic<int>				m_activeProducers;
+
+	static const unsigned int	CategorySlotCount = 32;
+
+	FILE						*m_out;
+	QtMessageHandler			m_previousHandler;
+	QElapsedTimer				m_timer;
+	std::atomic<unsigned int>	m_rateLimit;
+
+	/*! Queue: producers exchange m_head, the writer consumes from m_tail (starts with stub node). */
+	std::atomic<Record*>		m_head;
+	Record						*m_tail;
+	Record						m_stub;
+
+	/*! Number of records pushed/written, used by flush(). */
+	std::atomic<quint64>		m_pushedCount;
+	std::atomic<quint64>		m_writtenCount;
+
+	CategorySlot				m_categories[CategorySlotCount];
+
+	std::atomic<bool>			m_stop;
+	/*! Used by flush() and the destructor to wake up the writer, never locked by the message handler. */
+	std::mutex					m_wakeMutex;
+	std::condition_variable		m_wakeCondition;
+	std::condition_variable		m_flushedCondition;
+	std::thread					m_writer;
+};
+
+#endif // ASYNCLOGGER_H
@@ -0,0 +1,340 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BoxCuller.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include "BoxObject.h"
+#include "BufferArena.h"
+#include "Frustum.h"
+#include "GLStateCache.h"
+#include "OcclusionCuller.h"
+#include "OpenGLException.h"
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+#ifndef GL_MAX_SHADER_STORAGE_BLOCK_SIZE
+#define GL_MAX_SHADER_STORAGE_BLOCK_SIZE 0x90DE
+#endif
+#ifndef GL_MAX_COMPUTE_WORK_GROUP_COUNT
+#define GL_MAX_COMPUTE_WORK_GROUP_COUNT 0x91BE
+#endif
+
+bool BoxCuller::m_enabled = true;
+
+/*! Work group size of the compute shaders (local_size_x). */
+static const unsigned int WORK_GROUP_SIZE = 64;
+
+// binding points of the shader storage buffers, see the compute and vertex shaders
+static const GLuint VERTEX_BINDING = 0;
+static const GLuint BOUNDS_BINDING = 1;
+static const GLuint COMMAND_BINDING = 2;
+static const GLuint INSTANCE_BINDING = 3;
+static const GLuint CHUNK_BINDING = 4;
+
+/*! Layout of the indirect draw command, as expected by glDrawElementsIndirect(). */
+struct DrawElementsIndirectCommand {
+	GLuint	m_count;
+	GLuint	m_instanceCount;
+	GLuint	m_firstIndex;
+	GLint	m_baseVertex;
+	GLuint	m_baseInstance;
+};
+
+
+BoxCuller::BoxCuller() :
+	m_drawProgram(":/shaders/VertexNormalColorCulled.vert", ":/shaders/diffuse.frag"),
+	m_depthProgram(":/shaders/VertexPositionCulled.vert", ":/shaders/depthOnly.frag"),
+	m_boundsProgram(nullptr),
+	m_cullProgram(nullptr),
+	m_boundsBuffer(0),
+	m_commandBuffer(0),
+	m_instanceBuffer(0),
+	m_chunkBuffer(0),
+	m_capacity(0),
+	m_boundsRevision(0),
+	m_boxCount(0),
+	m_maxStorageBlockSize(0),
+	m_maxWorkGroupCount(0),
+	m_limitsExceeded(false)
+{
+	m_drawProgram.m_uniformNames.append("worldToView");
+	m_drawProgram.m_uniformNames.append("lightPos");
+	m_drawProgram.m_uniformNames.append("lightColor");
+	m_depthProgram.m_uniformNames.append("worldToView");
+}
+
+
+bool BoxCuller::isSupported() {
+	if (!m_enabled)
+		return false;
+	QOpenGLContext * ctx = QOpenGLContext::currentContext();
+	return ctx != nullptr && !ctx->isOpenGLES() && ctx->format().version() >= qMakePair(4,3);
+}
+
+
+void BoxCuller::create() {
+	FUNCID(BoxCuller::create);
+	Q_ASSERT(m_cullProgram == nullptr);
+	try {
+		m_drawProgram.create();
+		m_depthProgram.create();
+		m_boundsProgram = createComputeProgram(":/shaders/boxBounds.comp");
+		m_cullProgram = createComputeProgram(":/shaders/cullBoxes.comp");
+	}
+	catch (OpenGLException & ex) {
+		throw OpenGLException(ex, QString("Error creating GPU culling programs"), FUNC_ID);
+	}
+
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	f->glGenBuffers(1, &m_boundsBuffer);
+	f->glGenBuffers(1, &m_instanceBuffer);
+	f->glGenBuffers(1, &m_chunkBuffer);
+	f->glGenBuffers(1, &m_commandBuffer);
+	f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	f->glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+	f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	m_capacity = 0;
+
+	GLint64 maxBlockSize = 0;
+	f->glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize);
+	GLint maxGroupCount = 0;
+	f->glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxGroupCount);
+	m_maxStorageBlockSize = maxBlockSize;
+	m_maxWorkGroupCount = (unsigned int)std::max(maxGroupCount, 0);
+	m_limitsExceeded = false;
+	qDebug() << "BoxCuller - boxes are culled on the GPU (max. shader storage block size ="
+			 << m_maxStorageBlockSize/(1024*1024) << "MByte)";
+}
+
+
+void BoxCuller::destroy() {
+	delete m_boundsProgram;
+	m_boundsProgram = nullptr;
+	delete m_cullProgram;
+	m_cullProgram = nullptr;
+	m_drawProgram.destroy();
+	m_depthProgram.destroy();
+	if (m_commandBuffer != 0) {
+		QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+		f->glDeleteBuffers(1, &m_boundsBuffer);
+		f->glDeleteBuffers(1, &m_instanceBuffer);
+		f->glDeleteBuffers(1, &m_chunkBuffer);
+		f->glDeleteBuffers(1, &m_commandBuffer);
+	}
+	m_boundsBuffer = 0;
+	m_instanceBuffer = 0;
+	m_chunkBuffer = 0;
+	m_commandBuffer = 0;
+	m_capacity = 0;
+	m_boxCount = 0;
+}
+
+
+bool BoxCuller::cull(const BoxObject & boxes, const Frustum & frustum, const OcclusionCuller * occlusion,
+					 BufferArena & arena, GLStateCache & stateCache)
+{
+	Q_ASSERT(m_cullProgram != nullptr);
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	const BufferArena::Allocation & a = boxes.m_allocation;
+	m_boxCount = boxes.m_indexCount/BoxStore::IndexCount;
+	if (m_boxCount == 0)
+		return true;
+
+	// the shaders see the whole vertex buffer as one storage block, and use one invocation per box; beyond the
+	// limits the shaders would silently read nothing, so let the caller cull on the CPU instead
+	const qint64 vertexBufferSize = qint64(arena.vertexCapacity(BufferArena::VNC))*BufferArena::vertexSize(BufferArena::VNC);
+	const GLuint groupCount = (m_boxCount + WORK_GROUP_SIZE - 1)/WORK_GROUP_SIZE;
+	if (vertexBufferSize > m_maxStorageBlockSize || groupCount > m_maxWorkGroupCount) {
+		if (!m_limitsExceeded)
+			qWarning() << "BoxCuller - vertex buffer of" << vertexBufferSize/(1024*1024) << "MByte or" << m_boxCount
+					   << "boxes exceed the limits of the implementation, boxes are culled on the CPU";
+		m_limitsExceeded = true;
+		m_boxCount = 0;
+		return false;
+	}
+	m_limitsExceeded = false;
+
+	// grow bounds and instance buffers by 50%, the bounds are recomputed below
+	bool boundsValid = (m_boundsRevision == boxes.m_geometryRevision);
+	if (m_boxCount > m_capacity) {
+		m_capacity = std::max(m_boxCount, m_capacity + m_capacity/2);
+		f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundsBuffer);
+		f->glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(m_capacity)*2*4*sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+		f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+		f->glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(m_capacity)*sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+		f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		boundsValid = false;
+	}
+
+	f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BOUNDS_BINDING, m_boundsBuffer);
+
+	// the bounding boxes only change with the box geometry (edits, uploads)
+	if (!boundsValid) {
+		f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VERTEX_BINDING, arena.vertexBuffer(BufferArena::VNC));
+		stateCache.useProgram(m_boundsProgram->programId());
+		m_boundsProgram->setUniformValue("firstVertex", GLuint(a.m_firstVertex));
+		m_boundsProgram->setUniformValue("boxCount", GLuint(m_boxCount));
+		f->glDispatchCompute(groupCount, 1, 1);
+		f->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		m_boundsRevision = boxes.m_geometryRevision;
+	}
+
+	// reset the draw command, the cull shader counts the visible boxes in the instance count
+	DrawElementsIndirectCommand cmd;
+	cmd.m_count = BoxStore::IndexCount;
+	cmd.m_instanceCount = 0;
+	cmd.m_firstIndex = a.m_firstElement; // the elements of box slot 0
+	cmd.m_baseVertex = GLint(a.m_firstVertex);
+	cmd.m_baseInstance = 0;
+	f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	f->glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(cmd), &cmd);
+	f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	// occlusion query results of the last frames, only a few bytes per frame
+	const unsigned int chunkCount = (m_boxCount + BoxObject::BoxesPerChunk - 1)/BoxObject::BoxesPerChunk;
+	m_chunkVisibility.resize(chunkCount);
+	for (unsigned int i=0; i<chunkCount; ++i)
+		m_chunkVisibility[i] = (occlusion != nullptr && occlusion->isOccluded(i)) ? 0 : 1;
+	f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_chunkBuffer);
+	f->glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(chunkCount*sizeof(GLuint)), m_chunkVisibility.data(), GL_STREAM_DRAW);
+	f->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, m_commandBuffer);
+	f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, m_instanceBuffer);
+	f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CHUNK_BINDING, m_chunkBuffer);
+	stateCache.useProgram(m_cullProgram->programId());
+	m_cullProgram->setUniformValueArray("planes", frustum.m_planes, 6);
+	m_cullProgram->setUniformValue("boxCount", GLuint(m_boxCount));
+	m_cullProgram->setUniformValue("boxesPerChunk", GLuint(BoxObject::BoxesPerChunk));
+	f->glDispatchCompute(groupCount, 1, 1);
+	// the draw reads the command and the instance buffer written by the shader
+	f->glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	return true;
+}
+
+
+void BoxCuller::render(BufferArena & arena) {
+	if (m_boxCount == 0)
+		return;
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	arena.bind(BufferArena::VNC);
+	f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VERTEX_BINDING, arena.vertexBuffer(BufferArena::VNC));
+	f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, m_instanceBuffer);
+	f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	f->glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr);
+	f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+
+unsigned int BoxCuller::visibleCount() const {
+	if (m_boxCount == 0)
+		return 0;
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	f->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	const GLuint * instanceCount = reinterpret_cast<const GLuint *>(
+				f->glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, offsetof(DrawElementsIndirectCommand, m_instanceCount),
+									sizeof(GLuint), GL_MAP_READ_BIT));
+	unsigned int count = instanceCount != nullptr ? *instanceCount : 0;
+	f->glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
+	f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	return count;
+}
+
+
+bool BoxCuller::verify(const BoxObject & boxes, const Frustum & frustum) const {
+	// range of CPU counts: boxes surely inside all planes, and boxes not surely outside one of them
+	unsigned int minCount = 0;
+	unsigned int maxCount = 0;
+	VertexVNC boxVertexes[BoxStore::VertexCount];
+	GLuint boxElements[BoxStore::IndexCount];
+	for (unsigned int i=0; i<m_boxCount; ++i) {
+		// the same vertexes as in the vertex buffer, so the bounds equal those of boxBounds.comp
+		VertexVNC * vertexBuffer = boxVertexes;
+		GLuint * elementBuffer = boxElements;
+		unsigned int vertexCount = 0;
+		boxes.m_boxes.copy2Buffer(i, vertexBuffer, elementBuffer, vertexCount);
+		float bmin[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float bmax[3] = { -bmin[0], -bmin[1], -bmin[2] };
+		for (const VertexVNC & v : boxVertexes) {
+			bmin[0] = std::min(bmin[0], v.x);	bmax[0] = std::max(bmax[0], v.x);
+			bmin[1] = std::min(bmin[1], v.y);	bmax[1] = std::max(bmax[1], v.y);
+			bmin[2] = std::min(bmin[2], v.z);	bmax[2] = std::max(bmax[2], v.z);
+		}
+		// same test as in cullBoxes.comp (and Frustum::intersectsBox()), with a margin for rounding differences
+		bool outside = false;
+		bool inside = true;
+		for (const QVector4D & p : frustum.m_planes) {
+			const float x = p.x() >= 0 ? bmax[0] : bmin[0];
+			const float y = p.y() >= 0 ? bmax[1] : bmin[1];
+			const float z = p.z() >= 0 ? bmax[2] : bmin[2];
+			const float d = p.x()*x + p.y()*y + p.z()*z + p.w();
+			const float margin = 1e-5f*(std::fabs(p.x()*x) + std::fabs(p.y()*y) + std::fabs(p.z()*z) + std::fabs(p.w()));
+			if (d < -margin)
+				outside = true;
+			else if (d < margin)
+				inside = false;
+		}
+		if (!outside) {
+			++maxCount;
+			if (inside)
+				++minCount;
+		}
+	}
+
+	const unsigned int gpuCount = visibleCount();
+	if (gpuCount < minCount || gpuCount > maxCount) {
+		qWarning() << "BoxCuller - GPU culling found" << gpuCount << "of" << m_boxCount << "boxes visible, CPU culling"
+				   << minCount << "to" << maxCount;
+		return false;
+	}
+	return true;
+}
+
+
+QOpenGLShaderProgram * BoxCuller::createComputeProgram(const QString & filePath) {
+	FUNCID(BoxCuller::createComputeProgram);
+	QOpenGLShaderProgram * program = new QOpenGLShaderProgram();
+	if (!program->addShaderFromSourceFile(QOpenGLShader::Compute, filePath)) {
+		QString log = program->log();
+		delete program;
+		throw OpenGLException(QString("Error compiling compute shader %1:\n%2").arg(filePath).arg(log), FUNC_ID);
+	}
+	if (!program->link()) {
+		QString log = program->log();
+		delete program;
+		throw OpenGLException(QString("Error linking compute shader %1:\n%2").arg(filePath).arg(log), FUNC_ID);
+	}
+	return program;
+}
@@ -0,0 +1,131 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BOXCULLER_H
+#define BOXCULLER_H
+
+#include <QtGui/qopengl.h>
+
+#include <vector>
+
+#include "ShaderProgram.h"
+
+QT_BEGIN_NAMESPACE
+class QOpenGLShaderProgram;
+QT_END_NAMESPACE
+
+class BoxObject;
+class BufferArena;
+class Frustum;
+class GLStateCache;
+class OcclusionCuller;
+
+/*! Frustum culling of individual boxes on the GPU (OpenGL 4.3 compute shaders).
+
+	The bounding boxes of all boxes are computed from the vertex buffer by a compute shader (boxBounds.comp)
+	and kept in a shader storage buffer; they are only recomputed when the box geometry changes (see
+	BoxObject::m_geometryRevision). Each frame, a second compute shader (cullBoxes.comp) tests them against
+	the frustum planes and stream-compacts the indexes of the visible boxes into an instance buffer, counting
+	them with an atomic counter in the instance count of an indirect draw command. All visible boxes are then
+	drawn by a single glDrawElementsIndirect() call with the elements of one box, one instance per box;
+	the vertex shader (VertexNormalColorCulled.vert) fetches the vertexes of its box from the vertex buffer.
+	The CPU never reads the visible count, so culling does not stall the pipeline.
+
+	Only usable if isSupported() returns true, otherwise BoxObject::cull() (chunk culling on the CPU) is used.
+	The whole vertex buffer of the arena is bound as shader storage buffer and there is one shader invocation
+	per box, so cull() also returns false (and the chunks are culled on the CPU), when the vertex buffer exceeds
+	GL_MAX_SHADER_STORAGE_BLOCK_SIZE (128 MByte with llvmpipe, about 150000 boxes) or the work groups exceed
+	GL_MAX_COMPUTE_WORK_GROUP_COUNT.
+
+	Also runs with software rendering (e.g. LIBGL_ALWAYS_SOFTWARE=1 with Mesa llvmpipe, which implements
+	compute shaders). verify() compares the result with frustum culling on the CPU:
+
+	\code
+	QT_QPA_PLATFORM=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./Example06 --gpu-culling-selftest --frames=60
+	\endcode
+*/
+class BoxCuller {
+public:
+	BoxCuller();
+
+	/*! Returns true, if the current context supports compute shaders (OpenGL 4.3) and m_enabled is set. */
+	static bool isSupported();
+
+	/*! Compiles the compute shaders and the draw program, creates the buffers and queries the limits of the
+		implementation. Throws an OpenGLException on error.
+	*/
+	void create();
+	/*! Releases all OpenGL resources, rendering context must be current. */
+	void destroy();
+
+	/*! Tests all boxes of the box object against the frustum, recomputes the bounding boxes first, if the box
+		geometry has changed since the last call. If occlusion is given, the boxes of chunks found occluded
+		are skipped.
+		Returns false, if the boxes exceed the limits of the implementation (nothing is culled or drawn then,
+		the boxes must be culled on the CPU).
+	*/
+	bool cull(const BoxObject & boxes, const Frustum & frustum, const OcclusionCuller * occlusion,
+			  BufferArena & arena, GLStateCache & stateCache);
+	/*! Draws the boxes found visible in the last call to cull(), the draw or depth program must be bound. */
+	void render(BufferArena & arena);
+	/*! Reads back the number of visible boxes of the last call to cull(), waits for the GPU (only for statistics). */
+	unsigned int visibleCount() const;
+	/*! Compares visibleCount() with frustum culling of the same bounding boxes on the CPU, the last call to cull()
+		must have been done without occlusion. Boxes touching a frustum plane within rounding precision may be
+		classified either way (the GPU may use fused multiply-adds), so the GPU count must lie in the range
+		of possible CPU counts. Returns false and prints a warning on mismatch. Waits for the GPU.
+	*/
+	bool verify(const BoxObject & boxes, const Frustum & frustum) const;
+
+	/*! Draw program for the visible boxes, same uniforms as the lighted geometry program (worldToView, lightPos,
+		lightColor).
+	*/
+	ShaderProgram			m_drawProgram;
+	/*! Depth-only program for the depth prepass of the visible boxes, uniform worldToView. */
+	ShaderProgram			m_depthProgram;
+
+	/*! If false, boxes are always culled on the CPU (for comparison). */
+	static bool				m_enabled;
+
+private:
+	/*! Compiles and links a compute shader from a resource file. */
+	static QOpenGLShaderProgram * createComputeProgram(const QString & filePath);
+
+	QOpenGLShaderProgram	*m_boundsProgram;
+	QOpenGLShaderProgram	*m_cullProgram;
+
+	/*! Min and max corners (vec4 each) of the boxes. */
+	GLuint					m_boundsBuffer;
+	/*! Indirect draw command, the instance count is written by the cull shader. */
+	GLuint					m_commandBuffer;
+	/*! Indexes of the visible boxes. */
+	GLuint					m_instanceBuffer;
+	/*! Per chunk 0 (occluded) or 1, uploaded each frame. */
+	GLuint					m_chunkBuffer;
+	/*! Client-side copy of the chunk buffer data, kept to avoid allocations per frame. */
+	std::vector<GLuint>		m_chunkVisibility;
+	/*! Number of boxes the bounds and instance buffers can hold. */
+	unsigned int			m_capacity;
+
+	/*! Geometry revision of the box object the bounds were computed for. */
+	unsigned int			m_boundsRevision;
+	/*! Number of boxes tested in the last call to cull(), 0 if nothing to draw. */
+	unsigned int			m_boxCount;
+
+	/*! GL_MAX_SHADER_STORAGE_BLOCK_SIZE, queried in create(). */
+	qint64					m_maxStorageBlockSize;
+	/*! GL_MAX_COMPUTE_WORK_GROUP_COUNT (x dimension), queried in create(). */
+	unsigned int			m_maxWorkGroupCount;
+	/*! True, if the last call to cull() found the limits exceeded (the fallback is only reported once). */
+	bool					m_limitsExceeded;
+};
+
+#endif // BOXCULLER_H
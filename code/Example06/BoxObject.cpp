@@ -12,206 +12,438 @@ License    : BSD License,
 #include "BoxObject.h"
 
 #include <QVector3D>
-#include <QOpenGLShaderProgram>
 #include <QElapsedTimer>
+#include <QDebug>
 
-#include "PickObject.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
 
-BoxObject::BoxObject() :
-	m_vbo(QOpenGLBuffer::VertexBuffer), // actually the default, so default constructor would have been enough
-	m_ebo(QOpenGLBuffer::IndexBuffer) // make this an Index Buffer
+#include "PickObject.h"
+#include "BoxSceneBuilder.h"
+#include "SceneFile.h"
+#include "Frustum.h"
+#include "OcclusionCuller.h"
+
+BoxObject::BoxObject(const BoxSceneBuilder::Parameters & params) :
+	m_releaseBufferData(false),
+	m_indexCount(0),
+	m_resident(false),
+	m_visibleChunkCount(0),
+	m_geometryRevision(0),
+	m_arena(nullptr),
+	m_slotCapacity(0),
+	m_liveBoxCount(0)
 {
-	Transform3D trans;
+	m_boxes.reserve(4 + params.m_boxCount);
+
 #if 1
 	// create coordinate system boxes
-	BoxMesh b(10,1,1);
-//	b.setFaceColors({Qt::blue, Qt::red, Qt::yellow, Qt::green, Qt::magenta, Qt::darkCyan});
-	b.setColor(Qt::red);
-	trans.setTranslation(5,0,0); // DISCUSS
-	b.transform(trans.toMatrix()); // inplace-modification
-	m_boxes.push_back( b);
-
-	BoxMesh by(1,10,1);
-//	b.setFaceColors({Qt::blue, Qt::red, Qt::yellow, Qt::green, Qt::magenta, Qt::darkCyan});
-	by.setColor(Qt::green);
-	trans.setTranslation(0,5,0); // DISCUSS
-	by.transform(trans.toMatrix()); // inplace-modification
-	m_boxes.push_back( by );
-
-	BoxMesh bz(1,1,10);
-//	b.setFaceColors({Qt::blue, Qt::red, Qt::yellow, Qt::green, Qt::magenta, Qt::darkCyan});
-	bz.setColor(Qt::blue);
-	trans.setTranslation(0,0,5); // DISCUSS
-	bz.transform(trans.toMatrix()); // inplace-modification
-	m_boxes.push_back( bz );
-
+	m_boxes.addBox(QVector3D(5,0,0), QVector3D(5,0.5f,0.5f), QQuaternion(), m_boxes.addPalette(Qt::red));
+	m_boxes.addBox(QVector3D(0,5,0), QVector3D(0.5f,5,0.5f), QQuaternion(), m_boxes.addPalette(Qt::green));
+	m_boxes.addBox(QVector3D(0,0,5), QVector3D(0.5f,0.5f,5), QQuaternion(), m_boxes.addPalette(Qt::blue));
 
 	// create labeled box
-	BoxMesh bLabels(10,10,10);
-	bLabels.setFaceColors({Qt::blue, Qt::red, Qt::yellow, Qt::green, Qt::magenta, Qt::darkCyan});
-	trans.setTranslation(0,-50,0); // box spans now -5,-55,-5....5,45,5
-	bLabels.transform(trans.toMatrix()); // inplace-modification
-	m_boxes.push_back(bLabels);
+	const QColor labelColors[6] = {Qt::blue, Qt::red, Qt::yellow, Qt::green, Qt::magenta, Qt::darkCyan};
+	// box spans -5,-55,-5....5,45,5
+	m_boxes.addBox(QVector3D(0,-50,0), QVector3D(5,5,5), QQuaternion(), m_boxes.addPalette(labelColors));
 
 #endif
-	// create 'some' other boxes
-
-	const int BoxGenCount = 10000; // DISCUSS
-	const int BoxGridSize = 5;
-	const int GridDim = 100; // must be an int, or you have to use a cast below
-
-	// initialize grid (block count)
-	int boxPerCells[GridDim][GridDim];
-	for (unsigned int i=0; i<GridDim; ++i)
-		for (unsigned int j=0; j<GridDim; ++j)
-			boxPerCells[i][j] = 0;
-	for (unsigned int i=0; i<BoxGenCount; ++i) {
-		// create other boxes in randomize grid, x and z dimensions fixed, height varies discretely
-		// x and z translation in a grid that has dimension 'GridDim' with 5 space units as grid (line) spacing
-		int xGrid = qrand()*double(GridDim)/RAND_MAX;
-		int zGrid = qrand()*double(GridDim)/RAND_MAX;
-		int boxCount = boxPerCells[xGrid][zGrid]++;
-		float boxHeight = 4.5;
-		BoxMesh b(4,boxHeight,3);
-//		b.setFaceColors({Qt::blue, Qt::red, Qt::yellow, Qt::green, Qt::magenta, Qt::darkCyan});
-//		b.setColor(QColor("#ffffe6"));
-		std::vector<QColor> c = {QColor("#ffffe6"), QColor("#ffffe6"), QColor("#ffffe6"), QColor("#ffffe6"), QColor("#000040"), QColor("#800000")};
-//		c.push_back(QColor("#ffffe6"));
-//		c.push_back(QColor("#ffffe6"));
-//		c.push_back(QColor("#ffffe6"));
-//		c.push_back(QColor("#ffffe6"));
-//		c.push_back(QColor("#080000"));
-//		c.push_back(QColor("#080000"));
-		b.setFaceColors(c);
-		trans.setTranslation((-GridDim/2+xGrid)*BoxGridSize, boxCount*BoxGridSize + 0.5*boxHeight, (-GridDim/2 + zGrid)*BoxGridSize);
-		b.transform(trans.toMatrix());
-		m_boxes.push_back(b);
-	}
+	addHighlightPalettes();
 
-	unsigned int NBoxes = m_boxes.size();
+	// create 'some' other boxes, the buffers are populated in upload() (or taken from the geometry cache)
+	BoxSceneBuilder::generate(params, m_boxes);
+}
 
-	// resize storage arrays
-	m_vertexBufferData.resize(NBoxes*BoxMesh::VertexCount);
-	m_elementBufferData.resize(NBoxes*BoxMesh::IndexCount);
 
-	// update the buffers
-	VertexVNC * vertexBuffer = m_vertexBufferData.data();
-	unsigned int vertexCount = 0;
-	GLuint * elementBuffer = m_elementBufferData.data();
-	for (const BoxMesh & b : m_boxes)
-		b.copy2Buffer(vertexBuffer, elementBuffer, vertexCount);
+void BoxObject::loadScene(const SceneFile & scene) {
+	QElapsedTimer timer;
+	timer.start();
+	scene.readBoxes(m_boxes);
+	addHighlightPalettes();
+	m_basePaletteIdx.clear();
+	m_freeSlots.clear();
+	m_changedBoxes.clear();
+	// buffer data no longer matches the boxes
+	std::vector<VertexVNC>().swap(m_vertexBufferData);
+	std::vector<GLuint>().swap(m_elementBufferData);
+	qDebug() << "BoxObject - loaded" << m_boxes.size() << "boxes in" << timer.elapsed() << "ms";
 }
 
 
-void BoxObject::create(QOpenGLShaderProgram * shaderProgramm) {
-	// create and bind Vertex Array Object
-	m_vao.create();
-	m_vao.bind();
+void BoxObject::create(BufferArena & arena) {
+	createBuffers(arena);
+	upload();
+	makeResident();
+}
+
+
+void BoxObject::createBuffers(BufferArena & arena) {
+	// reserve spare slots for boxes added at runtime (see addBox())
+	const unsigned int boxCount = m_boxes.size();
+	m_slotCapacity = boxCount + std::max(1024u, boxCount/4);
+	m_arena = &arena;
+	m_allocation = arena.allocate("BoxObject", BufferArena::VNC,
+								  m_slotCapacity*BoxStore::VertexCount, m_slotCapacity*BoxStore::IndexCount);
+}
+
+
+void BoxObject::upload() {
+	QElapsedTimer timer;
+	timer.start();
+	QMutexLocker lock(&m_editMutex);
+
+	// buffer data is not yet generated or has been released in a previous call to upload(), so
+	// either map it from the geometry cache or generate it
+	GeometryCache cache;
+	bool fromCache = false;
+	if (m_vertexBufferData.empty()) {
+		quint64 contentHash = 0;
+		QString cacheFile;
+		if (GeometryCache::m_cacheEnabled) {
+			contentHash = m_boxes.contentHash();
+			cacheFile = GeometryCache::cacheFilePath("boxes", contentHash);
+			fromCache = cache.open(cacheFile, contentHash, VertexFormatVersion, sizeof(VertexVNC));
+			// a hash collision or corrupted file must not make us read beyond the mapped data
+			if (fromCache && (cache.vertexCount() != quint64(m_boxes.size())*BoxStore::VertexCount ||
+							  cache.elementCount() != quint64(m_boxes.size())*BoxStore::IndexCount))
+			{
+				qWarning() << "Geometry cache does not match box count, regenerating" << cacheFile;
+				cache.close();
+				fromCache = false;
+			}
+		}
+		if (!fromCache) {
+			BoxSceneBuilder::fillBuffers(m_boxes, m_vertexBufferData, m_elementBufferData);
+			BoxSceneBuilder::computeChunks(m_boxes.size(), BoxesPerChunk, m_vertexBufferData, m_chunks);
+			if (!cacheFile.isEmpty())
+				GeometryCache::write(cacheFile, contentHash, VertexFormatVersion,
+									 m_vertexBufferData.data(), sizeof(VertexVNC), m_vertexBufferData.size(),
+									 m_elementBufferData.data(), m_elementBufferData.size(), m_chunks);
+		}
+	}
+	else if (m_chunks.empty()) {
+		BoxSceneBuilder::computeChunks(m_boxes.size(), BoxesPerChunk, m_vertexBufferData, m_chunks);
+	}
+
+	// buffers are allocated either from CPU-side buffer data or directly from the mapped cache file
+	const void * vertexData = m_vertexBufferData.data();
+	const GLuint * elementData = m_elementBufferData.data();
+	GLsizeiptr vertexMemSize = m_vertexBufferData.size()*sizeof(VertexVNC);
+	GLsizeiptr elementMemSize = m_elementBufferData.size()*sizeof(GLuint);
+	if (fromCache) {
+		vertexData = cache.vertexData();
+		elementData = cache.elementData();
+		vertexMemSize = cache.vertexCount()*sizeof(VertexVNC);
+		elementMemSize = cache.elementCount()*sizeof(GLuint);
+		m_chunks.assign(cache.chunks(), cache.chunks() + cache.chunkCount());
+	}
+
+	// the ranges were allocated in createBuffers(), the spare slots only get their elements; boxes added
+	// in the meantime beyond the allocated slots are uploaded by uploadChanges() after growing the ranges
+	const unsigned int boxCount = std::min(m_boxes.size(), m_slotCapacity);
+	m_liveBoxCount = m_boxes.size();
+	trimRemovedBoxes();
 
-	// create and bind vertex buffer
-	m_vbo.create();
-	m_vbo.bind();
-	m_vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	int vertexMemSize = m_vertexBufferData.size()*sizeof(VertexVNC);
 	qDebug() << "BoxObject - VertexBuffer size =" << vertexMemSize/1024.0 << "kByte";
-	m_vbo.allocate(m_vertexBufferData.data(), vertexMemSize);
+	m_arena->writeVertexes(m_allocation, 0, boxCount*BoxStore::VertexCount, vertexData);
 
-	// create and bind element buffer
-	m_ebo.create();
-	m_ebo.bind();
-	m_ebo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	int elementMemSize = m_elementBufferData.size()*sizeof(GLuint);
 	qDebug() << "BoxObject - ElementBuffer size =" << elementMemSize/1024.0 << "kByte";
-	m_ebo.allocate(m_elementBufferData.data(), elementMemSize);
-
-	// set shader attributes
-	// tell shader program we have two data arrays to be used as input to the shaders
+	m_arena->writeElements(m_allocation, 0, boxCount*BoxStore::IndexCount, elementData);
+	writeElements(boxCount, m_slotCapacity);
+	m_indexCount = std::min(m_liveBoxCount, m_slotCapacity)*BoxStore::IndexCount;
+	++m_geometryRevision;
+
+	qDebug() << "BoxObject - buffers" << (fromCache ? "mapped from geometry cache" : "generated")
+			 << "and uploaded in" << timer.elapsed() << "ms";
+
+	if (m_releaseBufferData) {
+		// swap with empty vectors, since clear() would keep the memory allocated
+		std::vector<VertexVNC>().swap(m_vertexBufferData);
+		std::vector<GLuint>().swap(m_elementBufferData);
+	}
+}
 
-	// index 0 = position
-	shaderProgramm->enableAttributeArray(0); // array with index/id 0
-	shaderProgramm->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(VertexVNC));
-	// index 1 = normal
-	shaderProgramm->enableAttributeArray(1); // array with index/id 1
-	shaderProgramm->setAttributeBuffer(1, GL_FLOAT, offsetof(VertexVNC, m), 3, sizeof(VertexVNC));
-	// index 2 = color
-	shaderProgramm->enableAttributeArray(2); // array with index/id 2
-	shaderProgramm->setAttributeBuffer(2, GL_FLOAT, offsetof(VertexVNC, r), 3, sizeof(VertexVNC));
 
-	// Release (unbind) all
-	m_vao.release();
-	m_vbo.release();
-	m_ebo.release();
+void BoxObject::makeResident() {
+	m_arena->synchronize(m_allocation.m_format);
+	m_resident = true;
 }
 
 
 void BoxObject::destroy() {
-	m_vao.destroy();
-	m_vbo.destroy();
-	m_ebo.destroy();
+	if (m_arena != nullptr)
+		m_arena->free(m_allocation);
+	m_resident = false;
+}
+
+
+unsigned int BoxObject::cull(const Frustum & frustum, const OcclusionCuller * occlusion) {
+	m_drawRanges.clear();
+	m_visibleChunkCount = 0;
+	unsigned int elementCount = 0;
+	for (unsigned int i=0; i<m_chunks.size(); ++i) {
+		const GeometryCache::Chunk & c = m_chunks[i];
+		if (occlusion != nullptr && occlusion->isOccluded(i))
+			continue;
+		// chunks may extend beyond the last live box (or the allocated slots), which are not drawn
+		const unsigned int first = c.m_firstElement;
+		const unsigned int last = std::min(c.m_firstElement + c.m_elementCount, m_indexCount);
+		if (last <= first || !frustum.intersectsBox(c.m_min, c.m_max))
+			continue;
+		++m_visibleChunkCount;
+		elementCount += last - first;
+		if (!m_drawRanges.empty() && m_drawRanges.back().m_firstElement + m_drawRanges.back().m_elementCount == first) {
+			m_drawRanges.back().m_elementCount += last - first;
+		}
+		else {
+			BufferArena::ElementRange r;
+			r.m_firstElement = first;
+			r.m_elementCount = last - first;
+			m_drawRanges.push_back(r);
+		}
+	}
+	return elementCount;
 }
 
 
 void BoxObject::render() {
-	// set the geometry ("position", "normal" and "color" arrays)
-	m_vao.bind();
+	// draw the triangles of all visible chunks with one call
+	m_arena->multiDrawElements(m_allocation, GL_TRIANGLES, m_drawRanges);
+}
+
 
-	// now draw the cube by drawing individual triangles
-	// - GL_TRIANGLES - draw individual triangles via elements
-	glDrawElements(GL_TRIANGLES, m_elementBufferData.size(), GL_UNSIGNED_INT, nullptr);
-	// release vertices again
-	m_vao.release();
+unsigned int BoxObject::addBox(const QVector3D & center, const QVector3D & halfExtents,
+							   const QQuaternion & orientation, unsigned int paletteIdx)
+{
+	QMutexLocker lock(&m_editMutex);
+	unsigned int boxIdx;
+	if (!m_freeSlots.empty()) {
+		std::pop_heap(m_freeSlots.begin(), m_freeSlots.end(), std::greater<unsigned int>());
+		boxIdx = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		m_boxes.setBox(boxIdx, center, halfExtents, orientation, paletteIdx);
+		m_basePaletteIdx.remove(boxIdx); // highlight of the removed box
+	}
+	else {
+		boxIdx = m_boxes.addBox(center, halfExtents, orientation, paletteIdx);
+	}
+	m_liveBoxCount = std::max(m_liveBoxCount, boxIdx + 1);
+	m_changedBoxes.push_back(boxIdx);
+	return boxIdx;
 }
 
 
-void BoxObject::pick(const QVector3D & p1, const QVector3D & d, PickObject & po) const {
-	// now process all box objects
-	for (unsigned int i=0; i<m_boxes.size(); ++i) {
-		const BoxMesh & bm = m_boxes[i];
-		for (unsigned int j=0; j<6; ++j) {
-			float dist;
-			// is intersection point closes to viewer than previous intersection points?
-			if (bm.intersects(j, p1, d, dist)) {
-				qDebug() << QString("Plane %1 of box %2 intersects line at normalized distance = %3").arg(j).arg(i).arg(dist);
-				// keep objects that is closer to near plane
-				if (dist < po.m_dist) {
-					po.m_dist = dist;
-					po.m_objectId = i;
-					po.m_faceId = j;
-				}
-			}
+void BoxObject::removeBox(unsigned int boxIdx) {
+	QMutexLocker lock(&m_editMutex);
+	Q_ASSERT(boxIdx < m_boxes.size());
+	if (m_boxes.isEmpty(boxIdx))
+		return; // already removed
+	// the box collapses into its center point, so its triangles have zero area
+	m_boxes.m_hx[boxIdx] = 0.f;
+	m_boxes.m_hy[boxIdx] = 0.f;
+	m_boxes.m_hz[boxIdx] = 0.f;
+	m_basePaletteIdx.remove(boxIdx);
+	m_freeSlots.push_back(boxIdx);
+	std::push_heap(m_freeSlots.begin(), m_freeSlots.end(), std::greater<unsigned int>());
+	m_changedBoxes.push_back(boxIdx);
+	if (boxIdx + 1 == m_liveBoxCount)
+		trimRemovedBoxes();
+}
+
+
+void BoxObject::moveBox(unsigned int boxIdx, const QVector3D & center, const QQuaternion & orientation) {
+	QMutexLocker lock(&m_editMutex);
+	Q_ASSERT(boxIdx < m_boxes.size());
+	if (m_boxes.isEmpty(boxIdx))
+		return; // removed boxes cannot be moved
+	m_boxes.setBox(boxIdx, center, m_boxes.halfExtents(boxIdx), orientation, m_boxes.m_paletteIdx[boxIdx]);
+	m_changedBoxes.push_back(boxIdx);
+}
+
+
+void BoxObject::uploadChanges() {
+	QMutexLocker lock(&m_editMutex);
+	if (m_changedBoxes.empty())
+		return;
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// grow ranges by 50% (at least to the current box count), so that adding boxes one by one has amortized constant cost
+	const unsigned int boxCount = m_boxes.size();
+	if (boxCount > m_slotCapacity) {
+		unsigned int newCapacity = std::max(boxCount, m_slotCapacity + m_slotCapacity/2);
+		m_arena->reallocate(m_allocation, newCapacity*BoxStore::VertexCount, newCapacity*BoxStore::IndexCount);
+		writeElements(m_slotCapacity, newCapacity);
+		qDebug() << "BoxObject - allocation grown from" << m_slotCapacity << "to" << newCapacity << "boxes";
+		m_slotCapacity = newCapacity;
+	}
+
+	// keep CPU-side copy in sync, if still present
+	if (!m_vertexBufferData.empty()) {
+		m_vertexBufferData.resize(boxCount*BoxStore::VertexCount);
+		m_elementBufferData.resize(boxCount*BoxStore::IndexCount);
+	}
+
+	// regenerate the vertexes of changed boxes, adjacent boxes are uploaded with a single call
+	std::sort(m_changedBoxes.begin(), m_changedBoxes.end());
+	m_changedBoxes.erase(std::unique(m_changedBoxes.begin(), m_changedBoxes.end()), m_changedBoxes.end());
+	std::vector<VertexVNC> vertexes;
+	std::vector<GLuint> elements;
+	for (unsigned int i=0; i<m_changedBoxes.size(); ) {
+		unsigned int j = i + 1;
+		while (j < m_changedBoxes.size() && m_changedBoxes[j] == m_changedBoxes[j-1] + 1)
+			++j;
+		const unsigned int firstBox = m_changedBoxes[i];
+		const unsigned int count = j - i;
+		vertexes.resize(count*BoxStore::VertexCount);
+		elements.resize(count*BoxStore::IndexCount);
+		VertexVNC * vertexBuffer = vertexes.data();
+		GLuint * elementBuffer = elements.data();
+		unsigned int vertexCount = firstBox*BoxStore::VertexCount;
+		for (unsigned int boxIdx = firstBox; boxIdx < firstBox + count; ++boxIdx) {
+			const VertexVNC * boxVertexes = vertexBuffer;
+			m_boxes.copy2Buffer(boxIdx, vertexBuffer, elementBuffer, vertexCount);
+			updateChunk(boxIdx, boxVertexes);
+		}
+		m_arena->writeVertexes(m_allocation, firstBox*BoxStore::VertexCount, (unsigned int)vertexes.size(), vertexes.data());
+		if (!m_vertexBufferData.empty()) {
+			std::copy(vertexes.begin(), vertexes.end(), m_vertexBufferData.begin() + firstBox*BoxStore::VertexCount);
+			std::copy(elements.begin(), elements.end(), m_elementBufferData.begin() + firstBox*BoxStore::IndexCount);
 		}
+		i = j;
 	}
+
+	qDebug() << "BoxObject - uploaded" << m_changedBoxes.size() << "changed boxes in" << timer.nsecsElapsed()*1e-6 << "ms";
+	m_changedBoxes.clear();
+	m_indexCount = m_liveBoxCount*BoxStore::IndexCount;
+	++m_geometryRevision;
+}
+
+
+void BoxObject::pick(const QVector3D & p1, const QVector3D & d, PickObject & po) const {
+	// now process all box objects
+	m_boxes.pick(p1, d, po);
 }
 
 
 void BoxObject::highlight(unsigned int boxId, unsigned int faceId) {
+	QMutexLocker lock(&m_editMutex);
 	// we change the color of all vertexes of the selected box to lightgray
-	// and the vertex colors of the selected plane/face to light blue
-
-	std::vector<QColor> faceCols(6);
-	for (unsigned int i=0; i<6; ++i) {
-		if (i == faceId)
-			faceCols[i] = QColor("#b40808");
-		else
-			faceCols[i] = QColor("#f3f3f3");
-	}
-	m_boxes[boxId].setFaceColors(faceCols);
-
-	// advance the pointers and vertex numbers to the respected box position/numbering
-	VertexVNC * vertexBuffer = m_vertexBufferData.data() + boxId*6*4; // 6 planes, with 4 vertexes each
-	unsigned int vertexCount = boxId*6*4;
-	GLuint * elementBuffer = m_elementBufferData.data() + boxId*6*6; // 6 planes, with 2 triangles with 3 indexes each
-	// then we update the respective portion of the vertexbuffer memory
-	m_boxes[boxId].copy2Buffer(vertexBuffer, elementBuffer, vertexCount);
+	// and the vertex colors of the selected plane/face to red
+	if (!m_basePaletteIdx.contains(boxId))
+		m_basePaletteIdx.insert(boxId, m_boxes.m_paletteIdx[boxId]);
+	m_boxes.m_paletteIdx[boxId] = (quint16)(m_highlightPaletteIdx + faceId);
+
+	// regenerate the vertexes of the box (elements do not change)
+	VertexVNC boxVertexes[BoxStore::VertexCount];
+	GLuint boxElements[BoxStore::IndexCount];
+	VertexVNC * vertexBuffer = boxVertexes;
+	unsigned int vertexCount = boxId*6*4; // 6 planes, with 4 vertexes each
+	GLuint * elementBuffer = boxElements;
+	m_boxes.copy2Buffer(boxId, vertexBuffer, elementBuffer, vertexCount);
+
+	// keep CPU-side copy in sync, if still present
+	if (!m_vertexBufferData.empty())
+		std::copy(boxVertexes, boxVertexes + BoxStore::VertexCount, m_vertexBufferData.begin() + boxId*6*4);
 
 	QElapsedTimer t;
 	t.start();
-	// and now update the entire vertex buffer
-	m_vbo.bind();
-	// only update the modified portion of the data
-	m_vbo.write(boxId*6*4*sizeof(VertexVNC), m_vertexBufferData.data() + boxId*6*4, 6*4*sizeof(VertexVNC));
-	// alternatively use the call below, which (re-) copies the entire buffer, which can be slow
-	// m_vbo.allocate(m_vertexBufferData.data(), m_vertexBufferData.size()*sizeof(Vertex));
-	m_vbo.release();
+	// only update the modified portion of the vertex range
+	m_arena->writeVertexes(m_allocation, boxId*6*4, 6*4, boxVertexes);
 	qDebug() << t.elapsed();
 }
+
+
+unsigned int BoxObject::basePaletteIdx(unsigned int boxIdx) {
+	QMutexLocker lock(&m_editMutex);
+	Q_ASSERT(boxIdx < m_boxes.size());
+	return m_basePaletteIdx.value(boxIdx, m_boxes.m_paletteIdx[boxIdx]);
+}
+
+
+BoxStore BoxObject::exportBoxes() {
+	QMutexLocker lock(&m_editMutex);
+	BoxStore boxes = m_boxes;
+	// the highlight palettes are not necessarily the last ones (the generated boxes add palettes after them)
+	boxes.m_palettes.erase(boxes.m_palettes.begin() + m_highlightPaletteIdx,
+						   boxes.m_palettes.begin() + m_highlightPaletteIdx + HighlightPaletteCount);
+	for (QHash<unsigned int, quint16>::const_iterator it = m_basePaletteIdx.constBegin(); it != m_basePaletteIdx.constEnd(); ++it)
+		boxes.m_paletteIdx[it.key()] = it.value();
+	for (quint16 & idx : boxes.m_paletteIdx) {
+		Q_ASSERT(idx < m_highlightPaletteIdx || idx >= m_highlightPaletteIdx + HighlightPaletteCount);
+		if (idx >= m_highlightPaletteIdx)
+			idx = (quint16)(idx - HighlightPaletteCount);
+	}
+	return boxes;
+}
+
+
+void BoxObject::addHighlightPalettes() {
+	// palettes for highlighted boxes, one for each selected face
+	m_highlightPaletteIdx = m_boxes.m_palettes.size();
+	for (unsigned int j=0; j<HighlightPaletteCount; ++j) {
+		QColor faceCols[6];
+		for (unsigned int i=0; i<6; ++i) {
+			if (i == j)
+				faceCols[i] = QColor("#b40808");
+			else
+				faceCols[i] = QColor("#f3f3f3");
+		}
+		m_boxes.addPalette(faceCols);
+	}
+}
+
+
+void BoxObject::writeElements(unsigned int firstSlot, unsigned int lastSlot) {
+	if (lastSlot <= firstSlot)
+		return;
+	// element indexes of a box only depend on its slot, take the pattern from a unit box
+	BoxStore unitBox;
+	unitBox.addPalette(Qt::white);
+	unitBox.addBox(QVector3D(0,0,0), QVector3D(1,1,1));
+	VertexVNC boxVertexes[BoxStore::VertexCount];
+	GLuint pattern[BoxStore::IndexCount];
+	VertexVNC * vertexBuffer = boxVertexes;
+	GLuint * elementBuffer = pattern;
+	unsigned int vertexCount = 0;
+	unitBox.copy2Buffer(0, vertexBuffer, elementBuffer, vertexCount);
+
+	std::vector<GLuint> elements(size_t(lastSlot - firstSlot)*BoxStore::IndexCount);
+	for (unsigned int slot = firstSlot; slot < lastSlot; ++slot)
+		for (unsigned int k=0; k<BoxStore::IndexCount; ++k)
+			elements[(slot - firstSlot)*BoxStore::IndexCount + k] = pattern[k] + slot*BoxStore::VertexCount;
+	m_arena->writeElements(m_allocation, firstSlot*BoxStore::IndexCount, (unsigned int)elements.size(), elements.data());
+}
+
+
+void BoxObject::updateChunk(unsigned int boxIdx, const VertexVNC * boxVertexes) {
+	const unsigned int chunkIdx = boxIdx/BoxesPerChunk;
+	while (m_chunks.size() <= chunkIdx) {
+		GeometryCache::Chunk c;
+		c.m_firstElement = (unsigned int)m_chunks.size()*BoxesPerChunk*BoxStore::IndexCount;
+		c.m_elementCount = 0;
+		std::fill(c.m_min, c.m_min + 3, std::numeric_limits<float>::max());
+		std::fill(c.m_max, c.m_max + 3, -std::numeric_limits<float>::max());
+		m_chunks.push_back(c);
+	}
+	GeometryCache::Chunk & c = m_chunks[chunkIdx];
+	c.m_elementCount = std::max(c.m_elementCount, (boxIdx - chunkIdx*BoxesPerChunk + 1)*BoxStore::IndexCount);
+	if (m_boxes.isEmpty(boxIdx))
+		return; // removed boxes do not enlarge the bounding box
+	for (const VertexVNC * v = boxVertexes; v != boxVertexes + BoxStore::VertexCount; ++v) {
+		c.m_min[0] = std::min(c.m_min[0], v->x);
+		c.m_min[1] = std::min(c.m_min[1], v->y);
+		c.m_min[2] = std::min(c.m_min[2], v->z);
+		c.m_max[0] = std::max(c.m_max[0], v->x);
+		c.m_max[1] = std::max(c.m_max[1], v->y);
+		c.m_max[2] = std::max(c.m_max[2], v->z);
+	}
+}
+
+
+void BoxObject::trimRemovedBoxes() {
+	while (m_liveBoxCount > 0 && m_boxes.isEmpty(m_liveBoxCount - 1))
+		--m_liveBoxCount;
+}
@@ -12,51 +12,170 @@ License    : BSD License,
 #ifndef BOXOBJECT_H
 #define BOXOBJECT_H
 
-#include <QOpenGLBuffer>
-#include <QOpenGLVertexArrayObject>
+#include <QHash>
+#include <QMutex>
 
-QT_BEGIN_NAMESPACE
-class QOpenGLShaderProgram;
-QT_END_NAMESPACE
-
-#include "BoxMesh.h"
+#include "BoxSceneBuilder.h"
+#include "BufferArena.h"
 
 struct PickObject;
+class SceneFile;
+class Frustum;
+class OcclusionCuller;
 
 /*! A container for all the boxes.
 	Basically creates the geometry of the individual boxes and populates the buffers.
+
+	The vertexes and elements are stored in an allocation of the shared buffer arena (see BufferArena).
+
+	Boxes can be added, removed and moved at runtime. Box index i always occupies vertex slot i in the
+	vertex range (BoxStore::VertexCount vertexes) and element slot i in the element range, so a box
+	keeps its index (also used for picking and highlighting) for its whole life time. The ranges are
+	allocated with spare slots, which are grown by 50% when exhausted (the old contents are copied on the GPU).
+	Removed boxes become degenerate (all half-extents zero) and their slots are kept in a free list,
+	addBox() reuses the lowest free slot first. Trailing removed boxes are no longer drawn.
+
+	Edit functions only update the CPU-side data and can be called from the GUI thread, the vertexes
+	of changed boxes are uploaded in uploadChanges(), called from paintGL().
+
+	The boxes are drawn chunk-wise: cull() selects the chunks whose bounding box intersects the view
+	frustum, and render() draws them with a single multi-draw call (see BufferArena::multiDrawElements()).
 */
 class BoxObject {
 public:
-	BoxObject();
+	/*! Creates the coordinate system boxes and the random boxes as defined by params (see BoxSceneBuilder). */
+	BoxObject(const BoxSceneBuilder::Parameters & params = BoxSceneBuilder::Parameters());
+
+	/*! Replaces all boxes with those of a scene file, must be called before upload(). */
+	void loadScene(const SceneFile & scene);
 
-	/*! The function is called during OpenGL initialization, where the OpenGL context is current. */
-	void create(QOpenGLShaderProgram * shaderProgramm);
+	/*! The function is called during OpenGL initialization, where the OpenGL context is current.
+		Same as calling createBuffers(), upload() and makeResident().
+	*/
+	void create(BufferArena & arena);
+	/*! Allocates the vertex and element ranges (including spare slots) in the arena, rendering context must be current. */
+	void createBuffers(BufferArena & arena);
+	/*! Uploads the buffer data. If no buffer data is present (not yet generated or released), it is
+		taken from the geometry cache (see GeometryCache) or generated and then stored in the cache.
+		Only needs a context of the same share group, so this can be called in the asset loader thread.
+	*/
+	void upload();
+	/*! Makes the uploaded data visible in the rendering context and sets m_resident, called after the upload
+		has completed with the rendering context current.
+	*/
+	void makeResident();
+	/*! Returns the ranges to the arena. */
 	void destroy();
 
+	/*! Selects the chunks intersecting the frustum for the following render() calls, adjacent visible
+		chunks are merged into one draw range. If occlusion is given, chunks found occluded are skipped as well.
+		Returns the number of elements to be drawn.
+	*/
+	unsigned int cull(const Frustum & frustum, const OcclusionCuller * occlusion = nullptr);
+	/*! Draws the chunks selected in the last call to cull(). */
 	void render();
 
+	/*! Adds a box and returns its index, reuses the slot of a removed box if possible. */
+	unsigned int addBox(const QVector3D & center, const QVector3D & halfExtents,
+						const QQuaternion & orientation = QQuaternion(), unsigned int paletteIdx = 0);
+	/*! Removes the box, its index may be reused by a later call to addBox(). */
+	void removeBox(unsigned int boxIdx);
+	/*! Changes position and orientation of a box. */
+	void moveBox(unsigned int boxIdx, const QVector3D & center, const QQuaternion & orientation);
+
+	/*! Uploads the vertexes of all boxes changed by addBox(), removeBox() and moveBox() since the last call,
+		combining adjacent boxes into one buffer update, and grows the allocation if needed.
+		Rendering context must be current, and no upload into the arena must be running in another thread.
+	*/
+	void uploadChanges();
+
 	/*! Thread-save pick function.
 		Checks if any of the box object surfaces is hit by the ray defined by "p1 + d [0..1]" and
 		stores data in po (pick object).
 	*/
 	void pick(const QVector3D & p1, const QVector3D & d, PickObject & po) const;
 
-	/*! Changes color of box and face to show that the box was clicked on. */
+	/*! Changes color of box and face to show that the box was clicked on.
+		The vertexes of the box are regenerated from m_boxes, so this works also when the
+		buffer data has been released.
+	*/
 	void highlight(unsigned int boxId, unsigned int faceId);
+	/*! Returns the palette of the box as it was before highlight(), thread-safe. */
+	unsigned int basePaletteIdx(unsigned int boxIdx);
+
+	/*! Returns a copy of the boxes to be written to a scene file (see SceneFile::write()): the highlight palettes
+		are removed and highlighted boxes get their original palette, so that the palette table does not grow
+		when a scene is loaded (loadScene() appends the highlight palettes) and exported again. Thread-safe.
+	*/
+	BoxStore exportBoxes();
 
-	std::vector<BoxMesh>		m_boxes;
+	/*! If true, m_vertexBufferData and m_elementBufferData are released after upload in create(),
+		so that the geometry is only held in GPU memory.
+	*/
+	bool						m_releaseBufferData;
+	/*! Number of indexes to draw, kept when buffer data is released. */
+	unsigned int				m_indexCount;
+	/*! True, once the buffer data has been uploaded and can be drawn. */
+	bool						m_resident;
+	/*! Element ranges and bounding boxes of groups of BoxesPerChunk boxes, updated in upload().
+		Bounding boxes of edited chunks are only enlarged, never shrunk.
+	*/
+	std::vector<GeometryCache::Chunk>	m_chunks;
+	/*! Number of chunks selected in the last call to cull(). */
+	unsigned int				m_visibleChunkCount;
+	/*! Incremented whenever vertexes are uploaded (upload(), uploadChanges()), so that data derived from the
+		box geometry on the GPU (see BoxCuller) can be updated.
+	*/
+	unsigned int				m_geometryRevision;
+
+	/*! Number of consecutive boxes combined into one chunk, small enough that chunks of spatially ordered
+		boxes (see BoxSceneBuilder::generate()) can be culled individually.
+	*/
+	static const unsigned int	BoxesPerChunk = 512;
+	/*! Version of the generated vertex data, increase whenever VertexVNC, BoxStore::copy2Buffer() or
+		BoxesPerChunk (the chunks are cached, too) change, so that cached geometry is regenerated.
+	*/
+	static const quint32		VertexFormatVersion = 2;
+	/*! Number of highlight palettes starting at m_highlightPaletteIdx. */
+	static const unsigned int	HighlightPaletteCount = 6;
+
+	/*! Compact description of all boxes, vertex data is generated from this. */
+	BoxStore					m_boxes;
+	/*! Index of first of the 6 highlight palettes (one for each selected face), see HighlightPaletteCount. */
+	unsigned int				m_highlightPaletteIdx;
 
 	std::vector<VertexVNC>		m_vertexBufferData;
 	std::vector<GLuint>			m_elementBufferData;
 
-	/*! Wraps an OpenGL VertexArrayObject, that references the vertex coordinates and color buffers. */
-	QOpenGLVertexArrayObject	m_vao;
-
-	/*! Holds position and colors in a single buffer. */
-	QOpenGLBuffer				m_vbo;
-	/*! Holds elements. */
-	QOpenGLBuffer				m_ebo;
+	/*! The arena holding the buffers, set in createBuffers(). */
+	BufferArena					*m_arena;
+	/*! Vertex range (position, normal and color) and element range of all box slots. */
+	BufferArena::Allocation		m_allocation;
+
+private:
+	/*! Appends the palettes for highlighted boxes and stores the index of the first in m_highlightPaletteIdx. */
+	void addHighlightPalettes();
+	/*! Writes the elements of the box slots [firstSlot, lastSlot[ into the element range. */
+	void writeElements(unsigned int firstSlot, unsigned int lastSlot);
+	/*! Enlarges the bounding box of the chunk holding the box, appends chunks if needed. */
+	void updateChunk(unsigned int boxIdx, const VertexVNC * boxVertexes);
+	/*! Updates m_liveBoxCount after boxes at the end were removed. */
+	void trimRemovedBoxes();
+
+	/*! Element ranges of the visible chunks, set in cull(). */
+	std::vector<BufferArena::ElementRange>	m_drawRanges;
+	/*! Free slots (indexes of removed boxes), kept as min-heap so that the lowest slot is reused first. */
+	std::vector<unsigned int>	m_freeSlots;
+	/*! Original palette index of all highlighted boxes (box index -> palette index). */
+	QHash<unsigned int, quint16>	m_basePaletteIdx;
+	/*! Boxes changed since the last call to uploadChanges(), may contain duplicates. */
+	std::vector<unsigned int>	m_changedBoxes;
+	/*! Number of box slots allocated in vertex and element range. */
+	unsigned int				m_slotCapacity;
+	/*! Index of last box that is not removed + 1, only these boxes are drawn. */
+	unsigned int				m_liveBoxCount;
+	/*! Protects the box data in edit functions (GUI thread) against uploadChanges() and highlight() (render thread). */
+	QMutex						m_editMutex;
 };
 
 #endif // BOXOBJECT_H
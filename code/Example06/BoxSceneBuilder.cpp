@@ -0,0 +1,177 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BoxSceneBuilder.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <limits>
+
+/*! A range of boxes [m_begin, m_end[ processed by a single task. */
+struct BoxRange {
+	unsigned int m_begin;
+	unsigned int m_end;
+};
+
+/*! Splits n items into ranges for parallel processing, a few more than there are threads so that
+	the load is balanced.
+*/
+static std::vector<BoxRange> splitRanges(unsigned int n) {
+	unsigned int chunkCount = (unsigned int)qMax(1, QThreadPool::globalInstance()->maxThreadCount()*4);
+	unsigned int chunkSize = qMax(1024u, (n + chunkCount - 1)/chunkCount);
+	std::vector<BoxRange> ranges;
+	for (unsigned int i=0; i<n; i += chunkSize) {
+		BoxRange r;
+		r.m_begin = i;
+		r.m_end = qMin(n, i + chunkSize);
+		ranges.push_back(r);
+	}
+	return ranges;
+}
+
+
+/*! Spreads the lower 16 bits of v to the even bits of the result. */
+static quint32 spreadBits(quint32 v) {
+	v &= 0xffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+
+void BoxSceneBuilder::build(const Parameters & params, BoxStore & boxes,
+							std::vector<VertexVNC> & vertexBufferData, std::vector<GLuint> & elementBufferData)
+{
+	generate(params, boxes);
+	fillBuffers(boxes, vertexBufferData, elementBufferData);
+}
+
+
+void BoxSceneBuilder::generate(const Parameters & params, BoxStore & boxes) {
+	QElapsedTimer timer;
+	timer.start();
+
+	const unsigned int GridDim = params.m_gridDim;
+	const float BoxGridSize = params.m_gridSpacing;
+	const float boxHeight = 4.5f;
+	const quint64 seed = params.m_seed;
+
+	// face colors are parsed only once: front, right, back, left, bottom, top
+	const QColor wallColor("#ffffe6");
+	const QColor faceColors[6] = { wallColor, wallColor, wallColor, wallColor, QColor("#000040"), QColor("#800000") };
+
+	// *** serial pass: stacking level of each box ***
+
+	// The level of a box is the number of boxes generated before in the same grid cell, this
+	// depends on the generation order and is therefore computed serially (this is just a counter increment
+	// per box). The cell coordinates are pure functions of the box index and are recomputed in the parallel pass.
+	// The boxes are stored in Morton order of their grid cells (boxes of the same cell in generation order),
+	// so that boxes with consecutive indexes are close to each other and the chunks of BoxObject
+	// (consecutive boxes) have small bounding boxes, which can be culled.
+	std::vector<unsigned int> boxPerCells(GridDim*GridDim, 0);
+	std::vector<unsigned int> levels(params.m_boxCount);
+	std::vector<std::pair<quint32, unsigned int> > order(params.m_boxCount);
+	for (unsigned int i=0; i<params.m_boxCount; ++i) {
+		unsigned int xGrid = randomInt(seed, 2*quint64(i), GridDim);
+		unsigned int zGrid = randomInt(seed, 2*quint64(i)+1, GridDim);
+		levels[i] = boxPerCells[xGrid*GridDim + zGrid]++;
+		order[i] = std::make_pair(spreadBits(xGrid) | (spreadBits(zGrid) << 1), i);
+	}
+	std::sort(order.begin(), order.end());
+
+	// *** parallel pass: store boxes ***
+
+	const unsigned int paletteIdx = boxes.addPalette(faceColors);
+	const unsigned int firstBox = boxes.size();
+	boxes.resize(firstBox + params.m_boxCount);
+	const unsigned int * boxLevels = levels.data();
+	const std::pair<quint32, unsigned int> * boxOrder = order.data();
+	std::vector<BoxRange> ranges = splitRanges(params.m_boxCount);
+	QtConcurrent::blockingMap(ranges, [&](const BoxRange & r) {
+		for (unsigned int j=r.m_begin; j<r.m_end; ++j) {
+			// i = index in generation order, j = position in the box store
+			const unsigned int i = boxOrder[j].second;
+			// x and z translation in a grid that has dimension 'GridDim' with 'BoxGridSize' space units as grid (line) spacing
+			int xGrid = (int)randomInt(seed, 2*quint64(i), GridDim);
+			int zGrid = (int)randomInt(seed, 2*quint64(i)+1, GridDim);
+			// resize() already initialized orientation to identity
+			unsigned int boxIdx = firstBox + j;
+			boxes.m_cx[boxIdx] = (-int(GridDim)/2 + xGrid)*BoxGridSize;
+			boxes.m_cy[boxIdx] = boxLevels[i]*BoxGridSize + 0.5f*boxHeight;
+			boxes.m_cz[boxIdx] = (-int(GridDim)/2 + zGrid)*BoxGridSize;
+			boxes.m_hx[boxIdx] = 0.5f*4;
+			boxes.m_hy[boxIdx] = 0.5f*boxHeight;
+			boxes.m_hz[boxIdx] = 0.5f*3;
+			boxes.m_paletteIdx[boxIdx] = (quint16)paletteIdx;
+		}
+	});
+
+	qDebug() << "BoxSceneBuilder - generated" << params.m_boxCount << "boxes in" << timer.nsecsElapsed()*1e-6 << "ms";
+}
+
+
+void BoxSceneBuilder::fillBuffers(const BoxStore & boxes,
+								  std::vector<VertexVNC> & vertexBufferData, std::vector<GLuint> & elementBufferData)
+{
+	const unsigned int NBoxes = boxes.size();
+	vertexBufferData.resize(NBoxes*BoxStore::VertexCount);
+	elementBufferData.resize(NBoxes*BoxStore::IndexCount);
+
+	VertexVNC * vertexData = vertexBufferData.data();
+	GLuint * elementData = elementBufferData.data();
+	std::vector<BoxRange> ranges = splitRanges(NBoxes);
+	QtConcurrent::blockingMap(ranges, [&](const BoxRange & r) {
+		// all boxes have the same number of vertices and elements, so we know where to start
+		VertexVNC * vertexBuffer = vertexData + r.m_begin*BoxStore::VertexCount;
+		GLuint * elementBuffer = elementData + r.m_begin*BoxStore::IndexCount;
+		unsigned int vertexCount = r.m_begin*BoxStore::VertexCount;
+		for (unsigned int i=r.m_begin; i<r.m_end; ++i)
+			boxes.copy2Buffer(i, vertexBuffer, elementBuffer, vertexCount);
+	});
+}
+
+
+void BoxSceneBuilder::computeChunks(unsigned int boxCount, unsigned int boxesPerChunk,
+									const std::vector<VertexVNC> & vertexBufferData, std::vector<GeometryCache::Chunk> & chunks)
+{
+	Q_ASSERT(vertexBufferData.size() == boxCount*BoxStore::VertexCount);
+	chunks.resize((boxCount + boxesPerChunk - 1)/boxesPerChunk);
+	std::vector<BoxRange> ranges(chunks.size());
+	for (unsigned int i=0; i<ranges.size(); ++i) {
+		ranges[i].m_begin = i*boxesPerChunk;
+		ranges[i].m_end = qMin(boxCount, (i+1)*boxesPerChunk);
+	}
+	const VertexVNC * vertexData = vertexBufferData.data();
+	GeometryCache::Chunk * chunkData = chunks.data();
+	QtConcurrent::blockingMap(ranges, [&](const BoxRange & r) {
+		GeometryCache::Chunk & c = chunkData[r.m_begin/boxesPerChunk];
+		c.m_firstElement = r.m_begin*BoxStore::IndexCount;
+		c.m_elementCount = (r.m_end - r.m_begin)*BoxStore::IndexCount;
+		float minCoords[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float maxCoords[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+		for (const VertexVNC * v = vertexData + r.m_begin*BoxStore::VertexCount; v != vertexData + r.m_end*BoxStore::VertexCount; ++v) {
+			minCoords[0] = std::min(minCoords[0], v->x);
+			minCoords[1] = std::min(minCoords[1], v->y);
+			minCoords[2] = std::min(minCoords[2], v->z);
+			maxCoords[0] = std::max(maxCoords[0], v->x);
+			maxCoords[1] = std::max(maxCoords[1], v->y);
+			maxCoords[2] = std::max(maxCoords[2], v->z);
+		}
+		std::copy(minCoords, minCoords + 3, c.m_min);
+		std::copy(maxCoords, maxCoords + 3, c.m_max);
+	});
+}
@@ -0,0 +1,89 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BOXSCENEBUILDER_H
+#define BOXSCENEBUILDER_H
+
+#include <vector>
+
+#include <QtGlobal>
+
+#include "BoxStore.h"
+#include "GeometryCache.h"
+
+/*! Generates the "city" of randomly stacked boxes and fills the vertex and element buffer arrays.
+
+	Generation is split into a short serial pass, that determines the grid cell and stacking level
+	of each box, and parallel passes (using the global thread pool), that store the boxes and write
+	their vertices/elements. Since all boxes have the same number of vertices and elements, the output offset
+	of each box is known up front and threads write into disjoint parts of the buffers.
+
+	Random numbers are produced by a counter-based generator, i.e. the n-th random number is a pure function
+	of seed and n. Hence the generated scene only depends on the parameters and not on the number of threads
+	or qrand() state.
+*/
+class BoxSceneBuilder {
+public:
+	/*! Parameters of the generated scene. */
+	struct Parameters {
+		Parameters() :
+			m_boxCount(10000),
+			m_gridDim(100),
+			m_gridSpacing(5),
+			m_seed(0x2545F4914F6CDD1Dull)
+		{}
+
+		/*! Number of random boxes to generate. */
+		unsigned int	m_boxCount;
+		/*! Number of grid cells in x and z direction. */
+		unsigned int	m_gridDim;
+		/*! Distance between grid cells (and stacking height of boxes). */
+		float			m_gridSpacing;
+		/*! Seed of the random number generator, same seed gives same scene. */
+		quint64			m_seed;
+	};
+
+	/*! Appends the random boxes (and their palette) to 'boxes'. */
+	static void generate(const Parameters & params, BoxStore & boxes);
+
+	/*! Appends the random boxes (and their palette) to 'boxes' and then (re-)populates the vertex and element
+		buffer arrays with the data of all boxes (including those already present in 'boxes' before the call).
+	*/
+	static void build(const Parameters & params, BoxStore & boxes,
+					  std::vector<VertexVNC> & vertexBufferData, std::vector<GLuint> & elementBufferData);
+
+	/*! (Re-)populates the vertex and element buffer arrays with the data of all boxes (in parallel). */
+	static void fillBuffers(const BoxStore & boxes,
+							std::vector<VertexVNC> & vertexBufferData, std::vector<GLuint> & elementBufferData);
+
+	/*! Splits the boxes into chunks of boxesPerChunk consecutive boxes and computes element range and
+		bounding box of each chunk from the vertex buffer data (in parallel).
+	*/
+	static void computeChunks(unsigned int boxCount, unsigned int boxesPerChunk,
+							  const std::vector<VertexVNC> & vertexBufferData, std::vector<GeometryCache::Chunk> & chunks);
+
+	/*! Counter-based random number generator: returns the 64-bit random number with index 'counter' for the
+		given seed (SplitMix64 finalizer applied to the counter).
+	*/
+	static quint64 random(quint64 seed, quint64 counter) {
+		quint64 z = seed + (counter + 1)*0x9E3779B97F4A7C15ull;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	/*! Returns a random integer in the range [0, n[ for the given counter. */
+	static unsigned int randomInt(quint64 seed, quint64 counter, unsigned int n) {
+		return (unsigned int)(((random(seed, counter) >> 32) * n) >> 32);
+	}
+};
+
+#endif // BOXSCENEBUILDER_H
@@ -0,0 +1,288 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BoxStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "PickObject.h"
+
+/*! Rotates vector v by the unit quaternion (qx,qy,qz,qw), result is stored in r.
+	Uses r = v + 2w (q x v) + 2 q x (q x v).
+*/
+static inline void rotate(float qx, float qy, float qz, float qw, const float v[3], float r[3]) {
+	float tx = 2*(qy*v[2] - qz*v[1]);
+	float ty = 2*(qz*v[0] - qx*v[2]);
+	float tz = 2*(qx*v[1] - qy*v[0]);
+	r[0] = v[0] + qw*tx + (qy*tz - qz*ty);
+	r[1] = v[1] + qw*ty + (qz*tx - qx*tz);
+	r[2] = v[2] + qw*tz + (qx*ty - qy*tx);
+}
+
+
+/*! Stores the vertexes of a face (a,b,c,d in counter-clockwise order) and the elements of the two triangles. */
+static inline void copyPlane2Buffer(VertexVNC * & vertexBuffer, GLuint * & elementBuffer, unsigned int & elementStartIndex,
+									const float points[8][3], unsigned int a, unsigned int b, unsigned int c, unsigned int d,
+									const float normal[3], const float rgb[3])
+{
+	const unsigned int idx[4] = {a, b, c, d};
+	for (unsigned int i=0; i<4; ++i) {
+		VertexVNC & v = vertexBuffer[i];
+		v.x = points[idx[i]][0];
+		v.y = points[idx[i]][1];
+		v.z = points[idx[i]][2];
+		v.m = normal[0];
+		v.n = normal[1];
+		v.o = normal[2];
+		v.r = rgb[0];
+		v.g = rgb[1];
+		v.b = rgb[2];
+	}
+	// advance vertexBuffer
+	vertexBuffer += 4;
+
+	// we generate data for two triangles: a, b, d  and b, c, d
+	elementBuffer[0] = elementStartIndex;
+	elementBuffer[1] = elementStartIndex+1;
+	elementBuffer[2] = elementStartIndex+3;
+	elementBuffer[3] = elementStartIndex+1;
+	elementBuffer[4] = elementStartIndex+2;
+	elementBuffer[5] = elementStartIndex+3;
+
+	// advance elementBuffer
+	elementBuffer += 6;
+	// 4 vertices have been added, so increase start number for next plane
+	elementStartIndex += 4;
+}
+
+
+void BoxStore::clear() {
+	resize(0);
+}
+
+
+void BoxStore::reserve(unsigned int n) {
+	m_cx.reserve(n); m_cy.reserve(n); m_cz.reserve(n);
+	m_hx.reserve(n); m_hy.reserve(n); m_hz.reserve(n);
+	m_qx.reserve(n); m_qy.reserve(n); m_qz.reserve(n); m_qw.reserve(n);
+	m_paletteIdx.reserve(n);
+}
+
+
+void BoxStore::resize(unsigned int n) {
+	m_cx.resize(n, 0.f); m_cy.resize(n, 0.f); m_cz.resize(n, 0.f);
+	m_hx.resize(n, 0.5f); m_hy.resize(n, 0.5f); m_hz.resize(n, 0.5f);
+	m_qx.resize(n, 0.f); m_qy.resize(n, 0.f); m_qz.resize(n, 0.f); m_qw.resize(n, 1.f);
+	m_paletteIdx.resize(n, 0);
+}
+
+
+unsigned int BoxStore::addBox(const QVector3D & center, const QVector3D & halfExtents,
+							  const QQuaternion & orientation, unsigned int paletteIdx)
+{
+	unsigned int boxIdx = size();
+	resize(boxIdx+1);
+	setBox(boxIdx, center, halfExtents, orientation, paletteIdx);
+	return boxIdx;
+}
+
+
+void BoxStore::setBox(unsigned int boxIdx, const QVector3D & center, const QVector3D & halfExtents,
+					  const QQuaternion & orientation, unsigned int paletteIdx)
+{
+	Q_ASSERT(boxIdx < size());
+	Q_ASSERT(paletteIdx < m_palettes.size());
+	m_cx[boxIdx] = center.x();
+	m_cy[boxIdx] = center.y();
+	m_cz[boxIdx] = center.z();
+	m_hx[boxIdx] = halfExtents.x();
+	m_hy[boxIdx] = halfExtents.y();
+	m_hz[boxIdx] = halfExtents.z();
+	QQuaternion q = orientation.normalized();
+	m_qx[boxIdx] = q.x();
+	m_qy[boxIdx] = q.y();
+	m_qz[boxIdx] = q.z();
+	m_qw[boxIdx] = q.scalar();
+	m_paletteIdx[boxIdx] = (quint16)paletteIdx;
+}
+
+
+unsigned int BoxStore::addPalette(const QColor & c) {
+	QColor faceColors[6] = {c, c, c, c, c, c};
+	return addPalette(faceColors);
+}
+
+
+unsigned int BoxStore::addPalette(const QColor * faceColors) {
+	Q_ASSERT(m_palettes.size() < std::numeric_limits<quint16>::max());
+	Palette p;
+	for (unsigned int i=0; i<6; ++i) {
+		p.m_rgb[i][0] = float(faceColors[i].redF());
+		p.m_rgb[i][1] = float(faceColors[i].greenF());
+		p.m_rgb[i][2] = float(faceColors[i].blueF());
+	}
+	m_palettes.push_back(p);
+	return (unsigned int)m_palettes.size()-1;
+}
+
+
+void BoxStore::corners(unsigned int boxIdx, QVector3D points[8]) const {
+	float qx = m_qx[boxIdx], qy = m_qy[boxIdx], qz = m_qz[boxIdx], qw = m_qw[boxIdx];
+	float hx = m_hx[boxIdx], hy = m_hy[boxIdx], hz = m_hz[boxIdx];
+	const float local[8][3] = {
+		{-hx, -hy,  hz}, // a = 0
+		{ hx, -hy,  hz}, // b = 1
+		{ hx,  hy,  hz}, // c = 2
+		{-hx,  hy,  hz}, // d = 3
+		{-hx, -hy, -hz}, // e = 4
+		{ hx, -hy, -hz}, // f = 5
+		{ hx,  hy, -hz}, // g = 6
+		{-hx,  hy, -hz}  // h = 7
+	};
+	for (unsigned int i=0; i<8; ++i) {
+		float r[3];
+		rotate(qx, qy, qz, qw, local[i], r);
+		points[i] = QVector3D(r[0] + m_cx[boxIdx], r[1] + m_cy[boxIdx], r[2] + m_cz[boxIdx]);
+	}
+}
+
+
+void BoxStore::copy2Buffer(unsigned int boxIdx, VertexVNC *& vertexBuffer, GLuint *& elementBuffer,
+						   unsigned int & elementStartIndex) const
+{
+	QVector3D cornerPoints[8];
+	corners(boxIdx, cornerPoints);
+	float points[8][3];
+	for (unsigned int i=0; i<8; ++i) {
+		points[i][0] = cornerPoints[i].x();
+		points[i][1] = cornerPoints[i].y();
+		points[i][2] = cornerPoints[i].z();
+	}
+
+	// face normals in local coordinates: front, right, back, left, bottom, top
+	static const float LOCAL_NORMALS[6][3] = {
+		{0,0,1}, {1,0,0}, {0,0,-1}, {-1,0,0}, {0,-1,0}, {0,1,0}
+	};
+	float normals[6][3];
+	for (unsigned int i=0; i<6; ++i)
+		rotate(m_qx[boxIdx], m_qy[boxIdx], m_qz[boxIdx], m_qw[boxIdx], LOCAL_NORMALS[i], normals[i]);
+
+	const Palette & p = m_palettes[m_paletteIdx[boxIdx]];
+
+	// front plane: a, b, c, d, vertexes (0, 1, 2, 3)
+	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex, points, 0, 1, 2, 3, normals[0], p.m_rgb[0]);
+	// right plane: b=1, f=5, g=6, c=2, vertexes
+	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex, points, 1, 5, 6, 2, normals[1], p.m_rgb[1]);
+	// back plane: g=5, e=4, h=7, g=6
+	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex, points, 5, 4, 7, 6, normals[2], p.m_rgb[2]);
+	// left plane: 4,0,3,7
+	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex, points, 4, 0, 3, 7, normals[3], p.m_rgb[3]);
+	// bottom plane: 4,5,1,0
+	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex, points, 4, 5, 1, 0, normals[4], p.m_rgb[4]);
+	// top plane: 3,2,6,7
+	copyPlane2Buffer(vertexBuffer, elementBuffer, elementStartIndex, points, 3, 2, 6, 7, normals[5], p.m_rgb[5]);
+}
+
+
+bool BoxStore::intersects(unsigned int boxIdx, const QVector3D & p1, const QVector3D & d, float & dist, unsigned int & faceId) const {
+	if (isEmpty(boxIdx))
+		return false; // removed box
+	// transform line into local coordinate system of the box (rotation with conjugated quaternion)
+	float qx = -m_qx[boxIdx], qy = -m_qy[boxIdx], qz = -m_qz[boxIdx], qw = m_qw[boxIdx];
+	const float offset[3] = {p1.x() - m_cx[boxIdx], p1.y() - m_cy[boxIdx], p1.z() - m_cz[boxIdx]};
+	const float dir[3] = {d.x(), d.y(), d.z()};
+	float o[3], dl[3];
+	rotate(qx, qy, qz, qw, offset, o);
+	rotate(qx, qy, qz, qw, dir, dl);
+	const float h[3] = {m_hx[boxIdx], m_hy[boxIdx], m_hz[boxIdx]};
+
+	// slab test: intersect the line with the three pairs of parallel planes
+	float tEnter = -std::numeric_limits<float>::max();
+	float tExit = std::numeric_limits<float>::max();
+	int enterAxis = -1;
+	for (int a=0; a<3; ++a) {
+		if (qAbs(dl[a]) < 1e-12f) {
+			// line parallel to slab, must be inside
+			if (qAbs(o[a]) > h[a])
+				return false;
+			continue;
+		}
+		float t1 = (-h[a] - o[a])/dl[a];
+		float t2 = ( h[a] - o[a])/dl[a];
+		if (t1 > t2)
+			std::swap(t1, t2);
+		if (t1 > tEnter) {
+			tEnter = t1;
+			enterAxis = a;
+		}
+		if (t2 < tExit)
+			tExit = t2;
+		if (tEnter > tExit)
+			return false;
+	}
+	// Only faces pointing towards the starting point can be hit, so the entry point must be within [0,1].
+	if (enterAxis == -1 || tEnter < 0 || tEnter > 1)
+		return false;
+
+	// the face entered is opposite to the line direction: front, right, back, left, bottom, top
+	static const unsigned int POSITIVE_FACE[3] = {1, 5, 0};
+	static const unsigned int NEGATIVE_FACE[3] = {3, 4, 2};
+	faceId = dl[enterAxis] > 0 ? NEGATIVE_FACE[enterAxis] : POSITIVE_FACE[enterAxis];
+	dist = tEnter;
+	return true;
+}
+
+
+void BoxStore::pick(const QVector3D & p1, const QVector3D & d, PickObject & po) const {
+	const unsigned int n = size();
+	for (unsigned int i=0; i<n; ++i) {
+		float dist;
+		unsigned int faceId;
+		// is intersection point closes to viewer than previous intersection points?
+		if (intersects(i, p1, d, dist, faceId) && dist < po.m_dist) {
+			po.m_dist = dist;
+			po.m_objectId = i;
+			po.m_faceId = faceId;
+		}
+	}
+}
+
+
+/*! Mixes 'size' bytes into the hash h, processing 8 bytes per step. */
+static quint64 hashBytes(quint64 h, const void * data, size_t size) {
+	const quint64 K = 0x9E3779B97F4A7C15ull;
+	const uchar * p = static_cast<const uchar*>(data);
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		quint64 w;
+		std::memcpy(&w, p + i, 8);
+		h = (h ^ w) * K;
+		h ^= h >> 29;
+	}
+	// remaining bytes and size, so that arrays with trailing zeros give different hashes
+	quint64 w = 0;
+	std::memcpy(&w, p + i, size - i);
+	h = (h ^ w ^ size) * K;
+	return h ^ (h >> 32);
+}
+
+
+quint64 BoxStore::contentHash() const {
+	quint64 h = size();
+	const std::vector<float> * columns[10] = { &m_cx, &m_cy, &m_cz, &m_hx, &m_hy, &m_hz, &m_qx, &m_qy, &m_qz, &m_qw };
+	for (const std::vector<float> * c : columns)
+		h = hashBytes(h, c->data(), c->size()*sizeof(float));
+	h = hashBytes(h, m_paletteIdx.data(), m_paletteIdx.size()*sizeof(quint16));
+	h = hashBytes(h, m_palettes.data(), m_palettes.size()*sizeof(Palette));
+	return h;
+}
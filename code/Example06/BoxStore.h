@@ -0,0 +1,129 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BOXSTORE_H
+#define BOXSTORE_H
+
+#include <QtGui/QOpenGLFunctions>
+
+#include <QColor>
+#include <QQuaternion>
+#include <vector>
+
+#include "Vertex.h"
+
+struct PickObject;
+
+/*! A compact store for boxes (quader), using a structure-of-arrays memory layout.
+
+	A box is defined through its center point, half-extents in local x, y and z direction,
+	an orientation (quaternion) and a palette index. The palette holds the colors of the 6 faces
+	(front, right, back, left, bottom, top). Per box, only 42 Bytes are stored.
+
+	All derived geometry (corner points, faces, vertexes) is computed on demand, see
+	corners() and copy2Buffer(). Picking is done with a ray/box slab test in the local coordinate
+	system of the box, which does not require any stored plane data.
+
+	Since each quantity is stored in its own contiguous array, loops over all boxes (picking, rebuilding
+	buffers) only touch the data they need and can be vectorized by the compiler.
+*/
+class BoxStore {
+public:
+	/*! Face colors of a box, stored as floats so that they can be copied directly into vertexes. */
+	struct Palette {
+		float	m_rgb[6][3];
+	};
+
+	/*! Number of boxes. */
+	unsigned int size() const { return (unsigned int)m_cx.size(); }
+	/*! Removes all boxes (palettes are kept). */
+	void clear();
+	/*! Reserves memory for n boxes. */
+	void reserve(unsigned int n);
+	/*! Resizes the store to hold n boxes, new boxes are unit cubes at the origin with palette 0. */
+	void resize(unsigned int n);
+
+	/*! Appends a box and returns its index. */
+	unsigned int addBox(const QVector3D & center, const QVector3D & halfExtents,
+						const QQuaternion & orientation = QQuaternion(), unsigned int paletteIdx = 0);
+	/*! Sets the data of box with index boxIdx. */
+	void setBox(unsigned int boxIdx, const QVector3D & center, const QVector3D & halfExtents,
+				const QQuaternion & orientation = QQuaternion(), unsigned int paletteIdx = 0);
+
+	/*! Adds a palette with a uniform color for all faces and returns the palette index. */
+	unsigned int addPalette(const QColor & c);
+	/*! Adds a palette with 6 face colors (front, right, back, left, bottom, top) and returns the palette index. */
+	unsigned int addPalette(const QColor * faceColors);
+
+	QVector3D center(unsigned int boxIdx) const { return QVector3D(m_cx[boxIdx], m_cy[boxIdx], m_cz[boxIdx]); }
+	QVector3D halfExtents(unsigned int boxIdx) const { return QVector3D(m_hx[boxIdx], m_hy[boxIdx], m_hz[boxIdx]); }
+	QQuaternion orientation(unsigned int boxIdx) const {
+		return QQuaternion(m_qw[boxIdx], m_qx[boxIdx], m_qy[boxIdx], m_qz[boxIdx]);
+	}
+
+	/*! Returns true, if all half-extents of the box are zero. Such degenerate boxes mark removed boxes
+		(see BoxObject::removeBox()), they produce zero-area triangles and are never hit when picking.
+	*/
+	bool isEmpty(unsigned int boxIdx) const { return m_hx[boxIdx] == 0.f && m_hy[boxIdx] == 0.f && m_hz[boxIdx] == 0.f; }
+
+	/*! Computes the 8 corner points of the box.
+		Numbering: a..d = 0..3 are the front points (+z) and e..h = 4..7 the back points (-z), each
+		counter-clockwise starting at the lower left corner when looking at the front.
+	*/
+	void corners(unsigned int boxIdx, QVector3D points[8]) const;
+
+	/*! Fills in vertex data of a box in a buffer, provided by the caller.
+		The vertex data is stored interleaved, "coordinates(vec3)-normal(vec3)-color(vec3)-coordinates(vec3)-...".
+
+		\param boxIdx Index of box to generate vertexes for.
+		\param vertexBuffer Pointer to vertex memory array to write into. Will be moved forward to point to the next
+			position after the inserted vertices.
+		\param elementBuffer Pointer to element memory array to write into. Will be moved forward to point to the next
+			index position after the inserted vertices.
+
+		elementStartIndex is the start index, that we should start indexing our newly added vertexes with.
+	*/
+	void copy2Buffer(unsigned int boxIdx,
+					 VertexVNC * & vertexBuffer,
+					 GLuint * & elementBuffer,
+					 unsigned int & elementStartIndex) const;
+
+	/*! Tests if the line p = p1 + t*d with t in [0,1] enters the box with index boxIdx.
+		Returns true if an intersection was found and stores the normalized distance t and the
+		index of the face hit.
+	*/
+	bool intersects(unsigned int boxIdx, const QVector3D & p1, const QVector3D & d, float & dist, unsigned int & faceId) const;
+
+	/*! Checks all boxes for intersection with the line p = p1 + t*d and updates po, if a closer hit was found. */
+	void pick(const QVector3D & p1, const QVector3D & d, PickObject & po) const;
+
+	/*! Returns a 64-bit hash of all boxes and palettes, used to identify cached geometry (see GeometryCache).
+		Not a cryptographic hash, but fast enough to be computed on every start (several GB/s).
+	*/
+	quint64 contentHash() const;
+
+	static const unsigned int VertexCount = 6*4;  // 6 faces, 4 vertexes each (because each may have different number of colors)
+	static const unsigned int IndexCount = 6*2*3; // 6 faces, 2 triangles each, 3 indexes per triangle
+
+	/*! Center point coordinates. */
+	std::vector<float>		m_cx, m_cy, m_cz;
+	/*! Half-extents in local coordinates. */
+	std::vector<float>		m_hx, m_hy, m_hz;
+	/*! Orientation (normalized quaternion components). */
+	std::vector<float>		m_qx, m_qy, m_qz, m_qw;
+	/*! Palette index. */
+	std::vector<quint16>	m_paletteIdx;
+
+	/*! All palettes. */
+	std::vector<Palette>	m_palettes;
+};
+
+#endif // BOXSTORE_H
@@ -0,0 +1,519 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BufferArena.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstddef>
+
+#include "Vertex.h"
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+typedef void (QOPENGLF_APIENTRYP MultiDrawElementsIndirect)(GLenum mode, GLenum type, const void * indirect,
+															 GLsizei drawcount, GLsizei stride);
+typedef void (QOPENGLF_APIENTRYP DrawElementsBaseVertex)(GLenum mode, GLsizei count, GLenum type,
+														  const void * indices, GLint basevertex);
+typedef void (QOPENGLF_APIENTRYP MultiDrawElementsBaseVertex)(GLenum mode, const GLsizei * count, GLenum type,
+															   const void * const * indices, GLsizei drawcount,
+															   const GLint * basevertex);
+
+bool BufferArena::m_indirectDrawEnabled = true;
+const unsigned int BufferArena::MinVertexCapacity;
+const unsigned int BufferArena::MinElementCapacity;
+
+static const char * const FORMAT_NAMES[BufferArena::NUM_VF] = { "VNC", "VCA", "VC", "VT", "V2" };
+
+/*! Reallocates the buffer with newSize bytes and keeps the first oldSize bytes. The buffer keeps its name,
+	so that vertex array objects referencing it remain valid. The data is copied on the GPU via a temporary buffer.
+*/
+static void growBuffer(QOpenGLExtraFunctions * f, GLuint buffer, GLsizeiptr oldSize, GLsizeiptr newSize) {
+	if (oldSize == 0) {
+		f->glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		f->glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+		f->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return;
+	}
+	GLuint tmp;
+	f->glGenBuffers(1, &tmp);
+	f->glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	f->glBindBuffer(GL_COPY_WRITE_BUFFER, tmp);
+	f->glBufferData(GL_COPY_WRITE_BUFFER, oldSize, nullptr, GL_STREAM_COPY);
+	f->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+
+	f->glBufferData(GL_COPY_READ_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+	f->glBindBuffer(GL_COPY_READ_BUFFER, tmp);
+	f->glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	f->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+
+	f->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	f->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	f->glDeleteBuffers(1, &tmp);
+}
+
+
+/*! Copies size bytes within a buffer, source and target ranges must not overlap. */
+static void copyRange(QOpenGLExtraFunctions * f, GLuint buffer, GLintptr from, GLintptr to, GLsizeiptr size) {
+	if (size == 0)
+		return;
+	f->glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	f->glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	f->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, to, size);
+	f->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	f->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+
+/*! Enables the vertex attribute at location and sets its float layout in the bound vertex buffer. */
+static void setAttribute(QOpenGLFunctions * f, GLuint location, GLint size, GLsizei stride, size_t offset) {
+	f->glEnableVertexAttribArray(location);
+	f->glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void *>(offset));
+}
+
+
+BufferArena::BufferArena() :
+	m_boundFormat(NUM_VF),
+	m_drawFunctionsInitialized(false),
+	m_drawElementsBaseVertex(nullptr),
+	m_multiDrawElementsIndirect(nullptr),
+	m_multiDrawElementsBaseVertex(nullptr),
+	m_indirectBuffer(0)
+{
+}
+
+
+BufferArena::Allocation BufferArena::allocate(const QString & owner, VertexFormat format,
+											  unsigned int vertexCount, unsigned int elementCount)
+{
+	Q_ASSERT(format < NUM_VF);
+	Pool & p = m_pools[format];
+	if (p.m_vao == 0)
+		createPool(format);
+
+	Allocation a;
+	a.m_format = format;
+	a.m_firstVertex = p.m_vertexes.allocate(vertexCount);
+	a.m_vertexCount = vertexCount;
+	a.m_firstElement = p.m_elements.allocate(elementCount);
+	a.m_elementCount = elementCount;
+	growPool(format);
+
+	// reuse a free entry of the usage table
+	unsigned int id = 0;
+	while (id < m_usage.size() && m_usage[id].second.isValid())
+		++id;
+	a.m_id = (int)id;
+	if (id == m_usage.size())
+		m_usage.push_back(std::make_pair(owner, a));
+	else
+		m_usage[id] = std::make_pair(owner, a);
+	return a;
+}
+
+
+void BufferArena::reallocate(Allocation & a, unsigned int vertexCount, unsigned int elementCount) {
+	Q_ASSERT(a.isValid());
+	Pool & p = m_pools[a.m_format];
+	Allocation old = a;
+
+	// try to extend the ranges in place first, otherwise move them
+	bool moveVertexes = !p.m_vertexes.extend(a.m_firstVertex, a.m_vertexCount, vertexCount);
+	if (moveVertexes)
+		a.m_firstVertex = p.m_vertexes.allocate(vertexCount);
+	a.m_vertexCount = vertexCount;
+	bool moveElements = !p.m_elements.extend(a.m_firstElement, a.m_elementCount, elementCount);
+	if (moveElements)
+		a.m_firstElement = p.m_elements.allocate(elementCount);
+	a.m_elementCount = elementCount;
+	// grow buffers first, so that the copy targets exist
+	growPool(a.m_format);
+
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	const unsigned int vSize = vertexSize(a.m_format);
+	if (moveVertexes) {
+		copyRange(f, p.m_vbo, GLintptr(old.m_firstVertex)*vSize, GLintptr(a.m_firstVertex)*vSize,
+				  GLsizeiptr(std::min(old.m_vertexCount, vertexCount))*vSize);
+		p.m_vertexes.free(old.m_firstVertex, old.m_vertexCount);
+	}
+	else if (vertexCount < old.m_vertexCount) {
+		p.m_vertexes.free(old.m_firstVertex + vertexCount, old.m_vertexCount - vertexCount);
+	}
+	if (moveElements) {
+		copyRange(f, p.m_ebo, GLintptr(old.m_firstElement)*sizeof(GLuint), GLintptr(a.m_firstElement)*sizeof(GLuint),
+				  GLsizeiptr(std::min(old.m_elementCount, elementCount))*sizeof(GLuint));
+		p.m_elements.free(old.m_firstElement, old.m_elementCount);
+	}
+	else if (elementCount < old.m_elementCount) {
+		p.m_elements.free(old.m_firstElement + elementCount, old.m_elementCount - elementCount);
+	}
+	m_usage[a.m_id].second = a;
+}
+
+
+void BufferArena::free(Allocation & a) {
+	if (!a.isValid())
+		return;
+	Pool & p = m_pools[a.m_format];
+	p.m_vertexes.free(a.m_firstVertex, a.m_vertexCount);
+	p.m_elements.free(a.m_firstElement, a.m_elementCount);
+	m_usage[a.m_id] = std::make_pair(QString(), Allocation());
+	a = Allocation();
+}
+
+
+void BufferArena::writeVertexes(const Allocation & a, unsigned int firstVertex, unsigned int count, const void * data) const {
+	Q_ASSERT(a.isValid() && firstVertex + count <= a.m_vertexCount);
+	if (count == 0)
+		return;
+	const unsigned int vSize = vertexSize(a.m_format);
+	// use the functions of the current context, which may be the shared context of the asset loader
+	QOpenGLFunctions * f = QOpenGLContext::currentContext()->functions();
+	f->glBindBuffer(GL_COPY_WRITE_BUFFER, m_pools[a.m_format].m_vbo);
+	f->glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(a.m_firstVertex + firstVertex)*vSize, GLsizeiptr(count)*vSize, data);
+	f->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+
+void BufferArena::writeElements(const Allocation & a, unsigned int firstElement, unsigned int count, const GLuint * data) const {
+	Q_ASSERT(a.isValid() && firstElement + count <= a.m_elementCount);
+	if (count == 0)
+		return;
+	// the buffer-type agnostic copy target is used, since element buffer bindings are part of the vertex array object state
+	QOpenGLFunctions * f = QOpenGLContext::currentContext()->functions();
+	f->glBindBuffer(GL_COPY_WRITE_BUFFER, m_pools[a.m_format].m_ebo);
+	f->glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(a.m_firstElement + firstElement)*sizeof(GLuint),
+					   GLsizeiptr(count)*sizeof(GLuint), data);
+	f->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+
+void BufferArena::bind(VertexFormat format) {
+	if (m_boundFormat == format)
+		return;
+	QOpenGLContext::currentContext()->extraFunctions()->glBindVertexArray(m_pools[format].m_vao);
+	m_boundFormat = format;
+}
+
+
+void BufferArena::release() {
+	QOpenGLContext::currentContext()->extraFunctions()->glBindVertexArray(0);
+	m_boundFormat = NUM_VF;
+}
+
+
+void BufferArena::synchronize(VertexFormat format) {
+	const Pool & p = m_pools[format];
+	QOpenGLFunctions * f = QOpenGLContext::currentContext()->functions();
+	f->glBindBuffer(GL_ARRAY_BUFFER, p.m_vbo);
+	f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// the element buffer binding is vertex array object state
+	bind(format);
+	f->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p.m_ebo);
+	release();
+}
+
+
+void BufferArena::drawElements(const Allocation & a, GLenum mode, unsigned int elementCount, unsigned int firstElement) {
+	Q_ASSERT(a.isValid() && firstElement + elementCount <= a.m_elementCount);
+	if (!m_drawFunctionsInitialized)
+		initDrawFunctions();
+	bind(a.m_format);
+	reinterpret_cast<DrawElementsBaseVertex>(m_drawElementsBaseVertex)(mode, GLsizei(elementCount), GL_UNSIGNED_INT,
+		reinterpret_cast<const void *>(size_t(a.m_firstElement + firstElement)*sizeof(GLuint)), GLint(a.m_firstVertex));
+}
+
+
+void BufferArena::drawArrays(const Allocation & a, GLenum mode) {
+	Q_ASSERT(a.isValid());
+	bind(a.m_format);
+	QOpenGLContext::currentContext()->functions()->glDrawArrays(mode, GLint(a.m_firstVertex), GLsizei(a.m_vertexCount));
+}
+
+
+void BufferArena::multiDrawElements(const Allocation & a, GLenum mode, const std::vector<ElementRange> & ranges) {
+	Q_ASSERT(a.isValid());
+	if (ranges.empty())
+		return;
+	if (!m_drawFunctionsInitialized)
+		initDrawFunctions();
+	bind(a.m_format);
+
+	if (m_multiDrawElementsIndirect != nullptr) {
+		m_commands.resize(ranges.size());
+		for (unsigned int i=0; i<ranges.size(); ++i) {
+			const ElementRange & r = ranges[i];
+			Q_ASSERT(r.m_firstElement + r.m_elementCount <= a.m_elementCount);
+			DrawElementsIndirectCommand & c = m_commands[i];
+			c.m_count = r.m_elementCount;
+			c.m_instanceCount = 1;
+			c.m_firstIndex = a.m_firstElement + r.m_firstElement;
+			c.m_baseVertex = GLint(a.m_firstVertex);
+			c.m_baseInstance = 0;
+		}
+		QOpenGLFunctions * f = QOpenGLContext::currentContext()->functions();
+		f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+		// re-specifying the storage orphans the commands of the previous call, so the driver need not wait
+		// until the GPU has read them
+		f->glBufferData(GL_DRAW_INDIRECT_BUFFER, GLsizeiptr(m_commands.size()*sizeof(DrawElementsIndirectCommand)),
+						m_commands.data(), GL_STREAM_DRAW);
+		reinterpret_cast<MultiDrawElementsIndirect>(m_multiDrawElementsIndirect)(
+					mode, GL_UNSIGNED_INT, nullptr, GLsizei(m_commands.size()), 0);
+		f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	else {
+		m_counts.resize(ranges.size());
+		m_offsets.resize(ranges.size());
+		m_baseVertexes.assign(ranges.size(), GLint(a.m_firstVertex));
+		for (unsigned int i=0; i<ranges.size(); ++i) {
+			const ElementRange & r = ranges[i];
+			Q_ASSERT(r.m_firstElement + r.m_elementCount <= a.m_elementCount);
+			m_counts[i] = GLsizei(r.m_elementCount);
+			m_offsets[i] = reinterpret_cast<const void *>(size_t(a.m_firstElement + r.m_firstElement)*sizeof(GLuint));
+		}
+		reinterpret_cast<MultiDrawElementsBaseVertex>(m_multiDrawElementsBaseVertex)(
+					mode, m_counts.data(), GL_UNSIGNED_INT, m_offsets.data(), GLsizei(ranges.size()), m_baseVertexes.data());
+	}
+}
+
+
+void BufferArena::reportUsage() const {
+	for (unsigned int i=0; i<NUM_VF; ++i) {
+		const Pool & p = m_pools[i];
+		if (p.m_vao == 0)
+			continue;
+		const unsigned int vSize = vertexSize(VertexFormat(i));
+		qDebug() << "BufferArena -" << FORMAT_NAMES[i] << "buffers:"
+				 << p.m_vertexes.usedCount() << "of" << p.m_vertexCapacity << "vertexes used ("
+				 << p.m_vertexCapacity*double(vSize)/1024.0 << "kByte),"
+				 << p.m_elements.usedCount() << "of" << p.m_elementCapacity << "elements used ("
+				 << p.m_elementCapacity*double(sizeof(GLuint))/1024.0 << "kByte)";
+		for (const std::pair<QString, Allocation> & u : m_usage) {
+			const Allocation & a = u.second;
+			if (!a.isValid() || a.m_format != VertexFormat(i))
+				continue;
+			qDebug() << "  " << u.first << ":" << a.m_vertexCount << "vertexes at" << a.m_firstVertex << ","
+					 << a.m_elementCount << "elements at" << a.m_firstElement << ","
+					 << (a.m_vertexCount*double(vSize) + a.m_elementCount*double(sizeof(GLuint)))/1024.0 << "kByte";
+		}
+	}
+}
+
+
+void BufferArena::destroy() {
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	for (Pool & p : m_pools) {
+		if (p.m_vao == 0)
+			continue;
+		f->glDeleteVertexArrays(1, &p.m_vao);
+		f->glDeleteBuffers(1, &p.m_vbo);
+		f->glDeleteBuffers(1, &p.m_ebo);
+		p = Pool();
+	}
+	if (m_indirectBuffer != 0)
+		f->glDeleteBuffers(1, &m_indirectBuffer);
+	m_indirectBuffer = 0;
+	m_drawFunctionsInitialized = false;
+	m_drawElementsBaseVertex = nullptr;
+	m_multiDrawElementsIndirect = nullptr;
+	m_multiDrawElementsBaseVertex = nullptr;
+	m_usage.clear();
+	m_boundFormat = NUM_VF;
+}
+
+
+unsigned int BufferArena::vertexSize(VertexFormat format) {
+	switch (format) {
+		case VNC	: return sizeof(VertexVNC);
+		case VCA	: return sizeof(VertexVCA);
+		case VC		: return sizeof(Vertex);
+		case VT		: return sizeof(VertexTex);
+		case V2		: return 2*sizeof(float);
+		default		: return 0;
+	}
+}
+
+
+void BufferArena::createPool(VertexFormat format) {
+	Pool & p = m_pools[format];
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	f->glGenBuffers(1, &p.m_vbo);
+	f->glGenBuffers(1, &p.m_ebo);
+	f->glGenVertexArrays(1, &p.m_vao);
+
+	// the attribute layouts match those of the vertex shaders, attribute i is bound to location i
+	f->glBindVertexArray(p.m_vao);
+	f->glBindBuffer(GL_ARRAY_BUFFER, p.m_vbo);
+	f->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p.m_ebo);
+	switch (format) {
+		case VNC :
+			setAttribute(f, 0, 3, sizeof(VertexVNC), 0);
+			setAttribute(f, 1, 3, sizeof(VertexVNC), offsetof(VertexVNC, m));
+			setAttribute(f, 2, 3, sizeof(VertexVNC), offsetof(VertexVNC, r));
+			break;
+		case VCA :
+			setAttribute(f, 0, 4, sizeof(VertexVCA), 0);
+			setAttribute(f, 1, 4, sizeof(VertexVCA), offsetof(VertexVCA, r));
+			break;
+		case VC :
+			setAttribute(f, 0, 3, sizeof(Vertex), 0);
+			setAttribute(f, 1, 3, sizeof(Vertex), offsetof(Vertex, r));
+			break;
+		case VT :
+			setAttribute(f, 0, 3, sizeof(VertexTex), 0);
+			setAttribute(f, 1, 2, sizeof(VertexTex), offsetof(VertexTex, texi));
+			break;
+		case V2 :
+			setAttribute(f, 0, 2, 0, 0);
+			break;
+		default : ;
+	}
+	f->glBindVertexArray(0);
+	f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+	f->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	m_boundFormat = NUM_VF;
+}
+
+
+void BufferArena::growPool(VertexFormat format) {
+	Pool & p = m_pools[format];
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	// grow by at least 50%, so that repeated reallocations have amortized constant cost
+	if (p.m_vertexes.m_end > p.m_vertexCapacity) {
+		unsigned int newCapacity = std::max(std::max(p.m_vertexes.m_end, p.m_vertexCapacity + p.m_vertexCapacity/2),
+											MinVertexCapacity);
+		const unsigned int vSize = vertexSize(format);
+		growBuffer(f, p.m_vbo, GLsizeiptr(p.m_vertexCapacity)*vSize, GLsizeiptr(newCapacity)*vSize);
+		if (p.m_vertexCapacity != 0)
+			qDebug() << "BufferArena -" << FORMAT_NAMES[format] << "vertex buffer grown from"
+					 << p.m_vertexCapacity << "to" << newCapacity << "vertexes";
+		p.m_vertexCapacity = newCapacity;
+	}
+	if (p.m_elements.m_end > p.m_elementCapacity) {
+		unsigned int newCapacity = std::max(std::max(p.m_elements.m_end, p.m_elementCapacity + p.m_elementCapacity/2),
+											MinElementCapacity);
+		growBuffer(f, p.m_ebo, GLsizeiptr(p.m_elementCapacity)*sizeof(GLuint), GLsizeiptr(newCapacity)*sizeof(GLuint));
+		if (p.m_elementCapacity != 0)
+			qDebug() << "BufferArena -" << FORMAT_NAMES[format] << "element buffer grown from"
+					 << p.m_elementCapacity << "to" << newCapacity << "elements";
+		p.m_elementCapacity = newCapacity;
+	}
+}
+
+
+unsigned int BufferArena::RangeList::allocate(unsigned int count) {
+	if (count == 0)
+		return 0;
+	for (unsigned int i=0; i<m_free.size(); ++i) {
+		Range & r = m_free[i];
+		if (r.m_count < count)
+			continue;
+		unsigned int first = r.m_first;
+		r.m_first += count;
+		r.m_count -= count;
+		if (r.m_count == 0)
+			m_free.erase(m_free.begin() + i);
+		return first;
+	}
+	unsigned int first = m_end;
+	m_end += count;
+	return first;
+}
+
+
+bool BufferArena::RangeList::extend(unsigned int first, unsigned int count, unsigned int newCount) {
+	if (newCount <= count)
+		return true;
+	if (count == 0)
+		return false; // an empty range has no position yet
+	const unsigned int end = first + count;
+	if (end == m_end) {
+		m_end = first + newCount;
+		return true;
+	}
+	// free range directly behind?
+	for (unsigned int i=0; i<m_free.size(); ++i) {
+		Range & r = m_free[i];
+		if (r.m_first != end)
+			continue;
+		const unsigned int extra = newCount - count;
+		if (r.m_count < extra)
+			return false;
+		r.m_first += extra;
+		r.m_count -= extra;
+		if (r.m_count == 0)
+			m_free.erase(m_free.begin() + i);
+		return true;
+	}
+	return false;
+}
+
+
+void BufferArena::RangeList::free(unsigned int first, unsigned int count) {
+	if (count == 0)
+		return;
+	Range range;
+	range.m_first = first;
+	range.m_count = count;
+	std::vector<Range>::iterator it = std::lower_bound(m_free.begin(), m_free.end(), range,
+		[](const Range & lhs, const Range & rhs) { return lhs.m_first < rhs.m_first; });
+	it = m_free.insert(it, range);
+	// merge with following and preceding free range
+	if (it + 1 != m_free.end() && it->m_first + it->m_count == (it + 1)->m_first) {
+		it->m_count += (it + 1)->m_count;
+		m_free.erase(it + 1);
+	}
+	if (it != m_free.begin() && (it - 1)->m_first + (it - 1)->m_count == it->m_first) {
+		(it - 1)->m_count += it->m_count;
+		it = m_free.erase(it) - 1;
+	}
+	// a free range at the end is returned to the unused space
+	if (it->m_first + it->m_count == m_end) {
+		m_end = it->m_first;
+		m_free.erase(it);
+	}
+}
+
+
+unsigned int BufferArena::RangeList::usedCount() const {
+	unsigned int freeCount = 0;
+	for (const Range & r : m_free)
+		freeCount += r.m_count;
+	return m_end - freeCount;
+}
+
+
+void BufferArena::initDrawFunctions() {
+	QOpenGLContext * ctx = QOpenGLContext::currentContext();
+	// the base vertex draw functions are core since OpenGL 3.2, so always available in our 3.3 core context
+	m_drawElementsBaseVertex = ctx->getProcAddress("glDrawElementsBaseVertex");
+	Q_ASSERT(m_drawElementsBaseVertex != nullptr);
+	m_multiDrawElementsBaseVertex = ctx->getProcAddress("glMultiDrawElementsBaseVertex");
+	Q_ASSERT(m_multiDrawElementsBaseVertex != nullptr);
+	if (m_indirectDrawEnabled &&
+		(ctx->format().version() >= qMakePair(4,3) || ctx->hasExtension("GL_ARB_multi_draw_indirect")))
+	{
+		m_multiDrawElementsIndirect = ctx->getProcAddress("glMultiDrawElementsIndirect");
+	}
+	if (m_multiDrawElementsIndirect != nullptr) {
+		ctx->functions()->glGenBuffers(1, &m_indirectBuffer);
+		qDebug() << "BufferArena - multi draws use glMultiDrawElementsIndirect()";
+	}
+	else
+		qDebug() << "BufferArena - multi draws use glMultiDrawElementsBaseVertex() (no indirect draw support)";
+	m_drawFunctionsInitialized = true;
+}
@@ -0,0 +1,228 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BUFFERARENA_H
+#define BUFFERARENA_H
+
+#include <QString>
+#include <QtGui/qopengl.h>
+
+#include <vector>
+
+/*! Shared vertex and element buffers for all drawable objects.
+
+	Instead of creating own buffers and a vertex array object, each object allocates a range of vertexes and
+	a range of elements in the buffers of its vertex format. There is one vertex buffer, one element buffer and
+	one vertex array object per vertex format, so objects with the same format (e.g. boxes and meshes, or the
+	two grids) are drawn without switching vertex array objects, and the driver only manages a few large buffers.
+
+	Element indexes are stored relative to the first vertex of the allocation, the offset is added when
+	drawing (glDrawElementsBaseVertex()). Hence an allocation can be moved within the buffer without
+	touching its elements.
+
+	Ranges are handed out first-fit from a free list per buffer. When a buffer is exhausted, it is grown by
+	at least 50% and the old contents are copied on the GPU. The buffer names are kept, so that the vertex
+	array objects remain valid.
+
+	allocate(), reallocate() and free() must be called with the rendering context current. Buffer data is
+	written with writeVertexes() and writeElements(), which only need a context of the same share group
+	and can be called in the asset loader thread. Since growing a buffer re-specifies its storage,
+	no allocations must be made while an upload into the same buffers is running in another thread.
+
+	\code
+	// in initializeGL()
+	m_allocation = arena.allocate("PickLineObject", BufferArena::VC, 2, 0);
+	arena.writeVertexes(m_allocation, 0, 2, vertexes);
+
+	// in paintGL(), binds the vertex array object of the format only if not yet bound
+	arena.drawArrays(m_allocation, GL_LINES);
+	\endcode
+*/
+class BufferArena {
+public:
+	/*! Vertex formats, each format has its own buffers and vertex array object.
+		Attribute i of a format is bound to location i.
+	*/
+	enum VertexFormat {
+		/*! VertexVNC: position, normal and color (boxes, meshes). */
+		VNC,
+		/*! VertexVCA: position and color with alpha, vec4 each (transparent planes). */
+		VCA,
+		/*! Vertex: position and color (pick line). */
+		VC,
+		/*! VertexTex: position and texture coordinates (texts). */
+		VT,
+		/*! Tightly packed vec2 x-z coordinates (grid lines). */
+		V2,
+		NUM_VF
+	};
+
+	/*! A range of vertexes and a range of elements in the buffers of one vertex format. */
+	struct Allocation {
+		/*! Returns true, if the ranges have been allocated. */
+		bool isValid() const { return m_id != -1; }
+
+		VertexFormat	m_format = NUM_VF;
+		unsigned int	m_firstVertex = 0;
+		unsigned int	m_vertexCount = 0;
+		unsigned int	m_firstElement = 0;
+		unsigned int	m_elementCount = 0;
+		/*! Index in the usage table, -1 if not allocated. */
+		int				m_id = -1;
+	};
+
+	/*! A range of elements of an allocation (relative to the allocation), see multiDrawElements(). */
+	struct ElementRange {
+		unsigned int	m_firstElement;
+		unsigned int	m_elementCount;
+	};
+
+	BufferArena();
+
+	/*! Allocates vertexCount vertexes and elementCount elements in the buffers of the vertex format.
+		The buffers (and the vertex array object) are created on first use and grown as needed.
+		owner is only used for the usage report.
+	*/
+	Allocation allocate(const QString & owner, VertexFormat format, unsigned int vertexCount, unsigned int elementCount);
+	/*! Resizes the ranges of the allocation, the contents of the old ranges are kept (copied on the GPU, if
+		the ranges cannot be extended in place).
+	*/
+	void reallocate(Allocation & a, unsigned int vertexCount, unsigned int elementCount);
+	/*! Releases the ranges of the allocation, a is reset. */
+	void free(Allocation & a);
+
+	/*! Writes count vertexes to the allocation, starting at vertex firstVertex (relative to the allocation). */
+	void writeVertexes(const Allocation & a, unsigned int firstVertex, unsigned int count, const void * data) const;
+	/*! Writes count elements to the allocation, starting at element firstElement (relative to the allocation). */
+	void writeElements(const Allocation & a, unsigned int firstElement, unsigned int count, const GLuint * data) const;
+
+	/*! Binds the vertex array object of the format, unless already bound. Rendering context must be current. */
+	void bind(VertexFormat format);
+	/*! Unbinds the vertex array object, must be called at the end of each frame, since bind() relies on
+		no other code changing the vertex array binding.
+	*/
+	void release();
+	/*! Binds the buffers of the format again in the rendering context, so that data uploaded in a shared
+		context becomes visible (call in the resident function of an asset loader job).
+	*/
+	void synchronize(VertexFormat format);
+
+	/*! Draws elementCount elements of the allocation as triangles/lines (mode), starting at firstElement
+		(relative to the allocation).
+	*/
+	void drawElements(const Allocation & a, GLenum mode, unsigned int elementCount, unsigned int firstElement = 0);
+	/*! Draws all vertexes of the allocation without elements. */
+	void drawArrays(const Allocation & a, GLenum mode);
+	/*! Draws several element ranges of the allocation with a single call.
+		With OpenGL 4.3 (or GL_ARB_multi_draw_indirect) one draw command per range is written into an indirect
+		buffer and submitted with glMultiDrawElementsIndirect(), otherwise the ranges are passed to
+		glMultiDrawElementsBaseVertex() (OpenGL 3.2).
+	*/
+	void multiDrawElements(const Allocation & a, GLenum mode, const std::vector<ElementRange> & ranges);
+
+	/*! Prints buffer sizes and usage per vertex format and the ranges allocated by each object. */
+	void reportUsage() const;
+
+	/*! Deletes all buffers and vertex array objects, rendering context must be current. */
+	void destroy();
+
+	/*! The vertex buffer of the format, e.g. for binding it as shader storage buffer (0 if not yet created). */
+	GLuint vertexBuffer(VertexFormat format) const { return m_pools[format].m_vbo; }
+
+	/*! Number of vertexes the vertex buffer of the format can hold (the buffer size is vertexCapacity()*vertexSize()). */
+	unsigned int vertexCapacity(VertexFormat format) const { return m_pools[format].m_vertexCapacity; }
+
+	/*! Size of a vertex of the given format in bytes. */
+	static unsigned int vertexSize(VertexFormat format);
+
+	/*! If false, multiDrawElements() does not use indirect draws even if supported (for comparison). */
+	static bool					m_indirectDrawEnabled;
+
+	/*! Minimum number of vertexes allocated for a vertex buffer. */
+	static const unsigned int	MinVertexCapacity = 1 << 16;
+	/*! Minimum number of elements allocated for an element buffer. */
+	static const unsigned int	MinElementCapacity = 3 << 16;
+
+private:
+	/*! Hands out ranges of a buffer (in units of vertexes or elements). */
+	struct RangeList {
+		struct Range {
+			unsigned int	m_first;
+			unsigned int	m_count;
+		};
+
+		/*! Returns the first index of a range of count units, first-fit in the free ranges, else appended. */
+		unsigned int allocate(unsigned int count);
+		/*! Grows the range [first, first+count[ to newCount in place, if possible. */
+		bool extend(unsigned int first, unsigned int count, unsigned int newCount);
+		/*! Returns the range to the free list, adjacent free ranges are merged. */
+		void free(unsigned int first, unsigned int count);
+
+		/*! Number of units in use (excluding free ranges). */
+		unsigned int usedCount() const;
+
+		/*! End of the last allocated range, everything behind is free. */
+		unsigned int		m_end = 0;
+		/*! Free ranges before m_end, sorted by m_first. */
+		std::vector<Range>	m_free;
+	};
+
+	/*! Buffers and vertex array object of a vertex format. */
+	struct Pool {
+		GLuint			m_vao = 0;
+		GLuint			m_vbo = 0;
+		GLuint			m_ebo = 0;
+		unsigned int	m_vertexCapacity = 0;
+		unsigned int	m_elementCapacity = 0;
+		RangeList		m_vertexes;
+		RangeList		m_elements;
+	};
+
+	/*! Layout of a draw command in the indirect buffer, as expected by glMultiDrawElementsIndirect(). */
+	struct DrawElementsIndirectCommand {
+		GLuint			m_count;
+		GLuint			m_instanceCount;
+		GLuint			m_firstIndex;
+		GLint			m_baseVertex;
+		GLuint			m_baseInstance;
+	};
+
+	/*! Creates buffers and vertex array object of the format. */
+	void createPool(VertexFormat format);
+	/*! Resolves the base vertex draw functions of the current context and creates the indirect buffer. */
+	void initDrawFunctions();
+	/*! Grows the buffers of the pool, if the allocated ranges exceed the capacity. */
+	void growPool(VertexFormat format);
+
+	Pool						m_pools[NUM_VF];
+	/*! Owner and ranges of each allocation, freed entries have an invalid allocation. */
+	std::vector<std::pair<QString, Allocation> >	m_usage;
+	/*! Format whose vertex array object is currently bound, NUM_VF if none. */
+	VertexFormat				m_boundFormat;
+
+	/*! True, once initDrawFunctions() has been called. */
+	bool						m_drawFunctionsInitialized;
+	/*! glDrawElementsBaseVertex() (OpenGL 3.2), not part of QOpenGLExtraFunctions in older Qt versions. */
+	QFunctionPointer			m_drawElementsBaseVertex;
+	/*! glMultiDrawElementsIndirect(), nullptr if not supported or disabled. */
+	QFunctionPointer			m_multiDrawElementsIndirect;
+	/*! glMultiDrawElementsBaseVertex(), the fallback. */
+	QFunctionPointer			m_multiDrawElementsBaseVertex;
+	/*! Buffer holding the draw commands of the last multiDrawElements() call (indirect path only). */
+	GLuint						m_indirectBuffer;
+	// scratch buffers of multiDrawElements(), kept to avoid allocations per frame
+	std::vector<DrawElementsIndirectCommand>	m_commands;
+	std::vector<GLsizei>		m_counts;
+	std::vector<const void *>	m_offsets;
+	std::vector<GLint>			m_baseVertexes;
+};
+
+#endif // BUFFERARENA_H
@@ -0,0 +1,201 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "CpuBenchmark.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QFile>
+#include <QDebug>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <limits>
+
+#include "BoxObject.h"
+#include "BoxSceneBuilder.h"
+#include "GridObject.h"
+#include "TextObject.h"
+#include "PickObject.h"
+
+/*! Accumulates results of benchmarked functions, so that the compiler cannot optimize the work away. */
+static volatile double benchmarkSink = 0;
+
+static QtMessageHandler previousMsgHandler = nullptr;
+
+/*! Drops debug messages (e.g. timings printed by BoxSceneBuilder), which would otherwise be printed in every iteration. */
+static void quietMsgHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
+	if (type != QtDebugMsg && previousMsgHandler != nullptr)
+		previousMsgHandler(type, context, msg);
+}
+
+
+/*! Runs f repeatedly until minTimeMs have passed (at least 3 times) and appends an entry with
+	min, median and mean time per iteration to results.
+*/
+static void measure(const QString & name, unsigned int boxCount, double minTimeMs,
+					const std::function<void()> & f, QJsonArray & results)
+{
+	std::vector<double> times;
+	double totalMs = 0;
+	while (times.size() < 3 || totalMs < minTimeMs) {
+		QElapsedTimer timer;
+		timer.start();
+		f();
+		double ms = timer.nsecsElapsed()*1e-6;
+		times.push_back(ms);
+		totalMs += ms;
+	}
+	std::sort(times.begin(), times.end());
+
+	QJsonObject entry;
+	entry["name"] = name;
+	if (boxCount != 0)
+		entry["boxes"] = int(boxCount);
+	entry["iterations"] = int(times.size());
+	entry["minMs"] = times.front();
+	entry["medianMs"] = times[times.size()/2];
+	entry["meanMs"] = totalMs/times.size();
+	results.append(entry);
+
+	std::cerr << qPrintable(name) << " (" << boxCount << " boxes): " << times[times.size()/2] << " ms" << std::endl;
+}
+
+
+void CpuBenchmark::Parameters::parseArguments(const QStringList & args) {
+	for (const QString & arg : args) {
+		if (arg.startsWith("--box-counts=")) {
+			m_boxCounts.clear();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+			for (const QString & n : arg.mid(13).split(',', Qt::SkipEmptyParts))
+#else
+			for (const QString & n : arg.mid(13).split(',', QString::SkipEmptyParts))
+#endif
+				m_boxCounts.push_back(n.toUInt());
+		}
+		else if (arg.startsWith("--min-time="))
+			m_minTimeMs = arg.mid(11).toDouble();
+		else if (arg.startsWith("--benchmark-output="))
+			m_outputFile = arg.mid(19);
+	}
+}
+
+
+int CpuBenchmark::run(const Parameters & params) {
+	previousMsgHandler = qInstallMessageHandler(quietMsgHandler);
+
+	QJsonArray results;
+
+	// *** scene dependent benchmarks ***
+
+	for (unsigned int boxCount : params.m_boxCounts) {
+		BoxSceneBuilder::Parameters sceneParams;
+		sceneParams.m_boxCount = boxCount;
+
+		measure("BoxObject::BoxObject", boxCount, params.m_minTimeMs, [&sceneParams]() {
+			BoxObject boxObject(sceneParams);
+			benchmarkSink = benchmarkSink + boxObject.m_boxes.size();
+		}, results);
+
+		// buffer data is generated on upload, so allocate it here
+		BoxObject boxObject(sceneParams);
+		const BoxStore & boxes = boxObject.m_boxes;
+		BoxSceneBuilder::fillBuffers(boxes, boxObject.m_vertexBufferData, boxObject.m_elementBufferData);
+
+		measure("BoxStore::copy2Buffer", boxCount, params.m_minTimeMs, [&boxObject, &boxes]() {
+			VertexVNC * vertexBuffer = boxObject.m_vertexBufferData.data();
+			GLuint * elementBuffer = boxObject.m_elementBufferData.data();
+			unsigned int elementStartIndex = 0;
+			for (unsigned int i=0; i<boxes.size(); ++i)
+				boxes.copy2Buffer(i, vertexBuffer, elementBuffer, elementStartIndex);
+			benchmarkSink = benchmarkSink + elementStartIndex;
+		}, results);
+
+		measure("BoxSceneBuilder::fillBuffers", boxCount, params.m_minTimeMs, [&boxObject, &boxes]() {
+			BoxSceneBuilder::fillBuffers(boxes, boxObject.m_vertexBufferData, boxObject.m_elementBufferData);
+			benchmarkSink = benchmarkSink + boxObject.m_elementBufferData.size();
+		}, results);
+
+		measure("BoxStore::contentHash", boxCount, params.m_minTimeMs, [&boxes]() {
+			benchmarkSink = benchmarkSink + boxes.contentHash();
+		}, results);
+
+		// 64 pick rays (each tests all boxes with BoxStore::intersects()) from an elevated view point into the scene, the same for all box counts
+		const unsigned int RayCount = 64;
+		std::vector<QVector3D> rayStart(RayCount), rayDir(RayCount);
+		for (unsigned int i=0; i<RayCount; ++i) {
+			rayStart[i] = QVector3D(0, 150, 400);
+			QVector3D target(BoxSceneBuilder::randomInt(sceneParams.m_seed, 2*i, 500) - 250.f, 0,
+							 BoxSceneBuilder::randomInt(sceneParams.m_seed, 2*i+1, 500) - 250.f);
+			// pick line extends beyond target (like a pick line from near to far plane)
+			rayDir[i] = 2*(target - rayStart[i]);
+		}
+		measure("BoxObject::pick", boxCount, params.m_minTimeMs, [&]() {
+			for (unsigned int i=0; i<RayCount; ++i) {
+				PickObject po(2.f, std::numeric_limits<unsigned int>::max());
+				boxObject.pick(rayStart[i], rayDir[i], po);
+				benchmarkSink = benchmarkSink + po.m_dist;
+			}
+		}, results);
+	}
+
+	// *** scene independent benchmarks ***
+
+	GridObject grid;
+	std::vector<float> gridVertexBufferData;
+	measure("GridObject::fillBuffer (minor)", 0, params.m_minTimeMs, [&]() {
+		grid.fillBuffer(false, gridVertexBufferData);
+		benchmarkSink = benchmarkSink + gridVertexBufferData.size();
+	}, results);
+	measure("GridObject::fillBuffer (major)", 0, params.m_minTimeMs, [&]() {
+		grid.fillBuffer(true, gridVertexBufferData);
+		benchmarkSink = benchmarkSink + gridVertexBufferData.size();
+	}, results);
+
+	TextObject textObject;
+	for (unsigned int i=0; i<100; ++i) {
+		QVector3D a(i*10.f, 30, 0);
+		textObject.addText(QString("Label %1").arg(i), a, a + QVector3D(10,0,0), a + QVector3D(0,15,0));
+	}
+	measure("TextObject::layoutTexts", 0, params.m_minTimeMs, [&textObject]() {
+		QImage img = textObject.layoutTexts();
+		benchmarkSink = benchmarkSink + img.width();
+	}, results);
+	measure("TextObject::fillBuffers", 0, params.m_minTimeMs, [&textObject]() {
+		textObject.fillBuffers();
+		benchmarkSink = benchmarkSink + textObject.m_texts.size();
+	}, results);
+
+	qInstallMessageHandler(previousMsgHandler);
+
+	QJsonObject result;
+	result["threads"] = QThread::idealThreadCount();
+	result["minTimeMs"] = params.m_minTimeMs;
+	result["benchmarks"] = results;
+
+	QByteArray json = QJsonDocument(result).toJson();
+	if (params.m_outputFile.isEmpty()) {
+		std::cout << json.constData() << std::endl;
+	}
+	else {
+		QFile file(params.m_outputFile);
+		if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+			std::cerr << "Cannot write benchmark results to " << params.m_outputFile.toStdString() << std::endl;
+			return 1;
+		}
+		qDebug() << "Benchmark results written to" << params.m_outputFile;
+	}
+	return 0;
+}
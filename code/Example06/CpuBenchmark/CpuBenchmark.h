@@ -0,0 +1,63 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef CPUBENCHMARK_H
+#define CPUBENCHMARK_H
+
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+/*! Microbenchmarks for the CPU-side hot paths of Example06, built as separate executable (CpuBenchmark.pro)
+	and run without OpenGL context:
+
+	- scene generation (BoxObject constructor)
+	- vertex/element generation (BoxStore::copy2Buffer serial, BoxSceneBuilder::fillBuffers parallel)
+	- picking (BoxObject::pick, i.e. BoxStore::intersects() for all boxes)
+	- grid buffer generation (GridObject::fillBuffer)
+	- text layout (TextObject::layoutTexts, TextObject::fillBuffers)
+
+	Scene dependent benchmarks are run for each box count. Each benchmark is repeated until at least
+	m_minTimeMs have passed (but at least 3 times), results are written as JSON (one entry per benchmark
+	and box count with min, median and mean time per iteration), so that results of different versions can be diffed.
+
+	\code
+	QT_QPA_PLATFORM=offscreen ./CpuBenchmark --box-counts=1000,10000,100000,1000000 --benchmark-output=cpu.json
+	\endcode
+*/
+class CpuBenchmark {
+public:
+	/*! Benchmark settings. */
+	struct Parameters {
+		Parameters() :
+			m_boxCounts({1000, 10000, 100000, 1000000}),
+			m_minTimeMs(200)
+		{}
+
+		/*! Scene sizes (number of random boxes) to run the scene dependent benchmarks for. */
+		std::vector<unsigned int>	m_boxCounts;
+		/*! Minimum time to spend in each benchmark. */
+		double						m_minTimeMs;
+		/*! File to write JSON results to, if empty results are printed to stdout. */
+		QString						m_outputFile;
+
+		/*! Reads --box-counts=N1,N2,..., --min-time=ms and --benchmark-output=file from command line arguments. */
+		void parseArguments(const QStringList & args);
+	};
+
+	/*! Runs all benchmarks and writes the results.
+		Returns 0 on success, 1 on error (suitable as application exit code).
+	*/
+	static int run(const Parameters & params);
+};
+
+#endif // CPUBENCHMARK_H
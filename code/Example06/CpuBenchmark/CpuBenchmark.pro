@@ -0,0 +1,45 @@
+#------------------------------------------------------------------
+#
+# CPU microbenchmarks for Example06 (no OpenGL context needed)
+#
+#------------------------------------------------------------------
+
+QT       += core gui concurrent
+
+TARGET = CpuBenchmark
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CONFIG += c++11
+
+win32 {
+	LIBS += -lopengl32
+}
+
+# the benchmarked classes are compiled from the Example06 sources
+INCLUDEPATH += ..
+
+SOURCES += \
+		CpuBenchmark.cpp \
+		main.cpp \
+		../BoxObject.cpp \
+		../BoxSceneBuilder.cpp \
+		../BoxStore.cpp \
+		../BufferArena.cpp \
+		../Frustum.cpp \
+		../GeometryCache.cpp \
+		../GLStateCache.cpp \
+		../GridObject.cpp \
+		../OcclusionCuller.cpp \
+		../OpenGLException.cpp \
+		../PickObject.cpp \
+		../PlaneMesh.cpp \
+		../SceneFile.cpp \
+		../ShaderProgram.cpp \
+		../TextObject.cpp
+
+HEADERS += \
+	CpuBenchmark.h
@@ -0,0 +1,24 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include <QGuiApplication>
+
+#include "CpuBenchmark.h"
+
+int main(int argc, char **argv) {
+	// no window and no OpenGL context is created, the application object is only needed
+	// for the fonts used in the text layout
+	QGuiApplication app(argc, argv);
+
+	CpuBenchmark::Parameters params;
+	params.parseArguments(app.arguments());
+	return CpuBenchmark::run(params);
+}
@@ -2,6 +2,7 @@
 #define DEBUGAPPLICATION_H
 
 #include <QApplication>
+#include <atomic>
 #include <iostream>
 
 #include "OpenGLException.h"
@@ -23,8 +24,8 @@ public:
 		return false;
 	}
 
-	// Flag to check for program abort
-	bool m_aboutToTerminate;
+	// Flag to check for program abort, set in the GUI thread and also read in the render thread
+	std::atomic<bool> m_aboutToTerminate;
 };
 
 #endif // DEBUGAPPLICATION_H
@@ -4,7 +4,7 @@
 #
 #------------------------------------------------------------------
 
-QT       += core gui widgets
+QT       += core gui widgets concurrent
 
 TARGET = Example06
 TEMPLATE = app
@@ -41,16 +41,31 @@ win32 {
 }
 
 SOURCES += \
-		BoxMesh.cpp \
+		AssetLoader.cpp \
+		AsyncLogger.cpp \
+		BenchmarkRunner.cpp \
+		BoxCuller.cpp \
 		BoxObject.cpp \
+		BoxSceneBuilder.cpp \
+		BoxStore.cpp \
+		BufferArena.cpp \
+		Frustum.cpp \
+		GeometryCache.cpp \
+		GLStateCache.cpp \
 		GridObject.cpp \
+		InputRecorder.cpp \
 		KeyboardMouseHandler.cpp \
+		MeshImporter.cpp \
+		MeshObject.cpp \
+		OcclusionCuller.cpp \
 		OpenGLException.cpp \
 		OpenGLWindow.cpp \
 		PickLineObject.cpp \
 		PickObject.cpp \
 		PlaneMesh.cpp \
 		PlaneObject.cpp \
+		RenderQueue.cpp \
+		SceneFile.cpp \
 		SceneView.cpp \
 		ShaderProgram.cpp \
 		TestDialog.cpp \
@@ -59,18 +74,33 @@ SOURCES += \
 		main.cpp
 
 HEADERS += \
-	BoxMesh.h \
+	AssetLoader.h \
+	AsyncLogger.h \
+	BenchmarkRunner.h \
+	BoxCuller.h \
 	BoxObject.h \
+	BoxSceneBuilder.h \
+	BoxStore.h \
+	BufferArena.h \
 	Camera.h \
 	DebugApplication.h \
+	Frustum.h \
+	GeometryCache.h \
+	GLStateCache.h \
 	GridObject.h \
+	InputRecorder.h \
 	KeyboardMouseHandler.h \
+	MeshImporter.h \
+	MeshObject.h \
+	OcclusionCuller.h \
 	OpenGLException.h \
 	OpenGLWindow.h \
 	PickLineObject.h \
 	PickObject.h \
 	PlaneMesh.h \
 	PlaneObject.h \
+	RenderQueue.h \
+	SceneFile.h \
 	SceneView.h \
 	ShaderProgram.h \
 	TestDialog.h \
@@ -0,0 +1,49 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "Frustum.h"
+
+#include <QMatrix4x4>
+
+Frustum::Frustum() {
+	// all points satisfy 0*x + 0*y + 0*z + 1 >= 0
+	for (QVector4D & p : m_planes)
+		p = QVector4D(0, 0, 0, 1);
+}
+
+
+Frustum::Frustum(const QMatrix4x4 & worldToView) {
+	// a point is inside the clip volume if -w <= x,y,z <= w, so each plane is the sum or difference of
+	// the last row and one of the other rows of the matrix (Gribb/Hartmann)
+	const QVector4D r0 = worldToView.row(0);
+	const QVector4D r1 = worldToView.row(1);
+	const QVector4D r2 = worldToView.row(2);
+	const QVector4D r3 = worldToView.row(3);
+	m_planes[0] = r3 + r0;
+	m_planes[1] = r3 - r0;
+	m_planes[2] = r3 + r1;
+	m_planes[3] = r3 - r1;
+	m_planes[4] = r3 + r2;
+	m_planes[5] = r3 - r2;
+}
+
+
+bool Frustum::intersectsBox(const float min[3], const float max[3]) const {
+	for (const QVector4D & p : m_planes) {
+		// test the corner farthest along the plane normal, if that is outside, the whole box is
+		const float x = p.x() >= 0 ? max[0] : min[0];
+		const float y = p.y() >= 0 ? max[1] : min[1];
+		const float z = p.z() >= 0 ? max[2] : min[2];
+		if (p.x()*x + p.y()*y + p.z()*z + p.w() < 0)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,42 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <QVector4D>
+
+QT_BEGIN_NAMESPACE
+class QMatrix4x4;
+QT_END_NAMESPACE
+
+/*! The view frustum as six planes in world coordinates, used to skip geometry outside the view.
+
+	The planes are extracted from the combined world to view matrix (projection * camera * transform),
+	their normals point into the frustum.
+*/
+class Frustum {
+public:
+	/*! Creates a frustum that contains everything. */
+	Frustum();
+	/*! Extracts the planes of the frustum of the given world to view matrix. */
+	explicit Frustum(const QMatrix4x4 & worldToView);
+
+	/*! Returns false, if the axis-aligned box [min, max] is completely outside the frustum.
+		The test is conservative, boxes near a corner of the frustum may be reported as intersecting.
+	*/
+	bool intersectsBox(const float min[3], const float max[3]) const;
+
+	/*! Left, right, bottom, top, near and far plane (a,b,c,d with a*x + b*y + c*z + d >= 0 inside). */
+	QVector4D	m_planes[6];
+};
+
+#endif // FRUSTUM_H
@@ -0,0 +1,157 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "GLStateCache.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+bool GLStateCache::m_debugMode = false;
+const unsigned int GLStateCache::MaxTextureUnits;
+
+GLStateCache::GLStateCache() :
+	m_functions(nullptr)
+{
+	invalidate();
+}
+
+
+void GLStateCache::invalidate() {
+	if (QOpenGLContext::currentContext() != nullptr)
+		m_functions = QOpenGLContext::currentContext()->functions();
+	for (unsigned int i=0; i<NUM_CAPS; ++i)
+		m_capKnown[i] = false;
+	m_blendFuncKnown = false;
+	m_clearColorKnown = false;
+	m_depthMaskKnown = false;
+	m_depthFuncKnown = false;
+	m_colorMaskKnown = false;
+	m_programKnown = false;
+	m_activeUnitKnown = false;
+	for (unsigned int i=0; i<MaxTextureUnits; ++i)
+		m_textureKnown[i] = false;
+}
+
+
+void GLStateCache::enable(GLenum cap) {
+	setCapability(cap, true);
+}
+
+
+void GLStateCache::disable(GLenum cap) {
+	setCapability(cap, false);
+}
+
+
+void GLStateCache::blendFunc(GLenum sfactor, GLenum dfactor) {
+	if (elide(m_blendFuncKnown && m_blendSrc == sfactor && m_blendDst == dfactor))
+		return;
+	m_functions->glBlendFunc(sfactor, dfactor);
+	m_blendFuncKnown = true;
+	m_blendSrc = sfactor;
+	m_blendDst = dfactor;
+}
+
+
+void GLStateCache::clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+	if (elide(m_clearColorKnown && m_clearColor[0] == red && m_clearColor[1] == green &&
+			  m_clearColor[2] == blue && m_clearColor[3] == alpha))
+	{
+		return;
+	}
+	m_functions->glClearColor(red, green, blue, alpha);
+	m_clearColorKnown = true;
+	m_clearColor[0] = red;
+	m_clearColor[1] = green;
+	m_clearColor[2] = blue;
+	m_clearColor[3] = alpha;
+}
+
+
+void GLStateCache::depthMask(GLboolean flag) {
+	if (elide(m_depthMaskKnown && m_depthMask == flag))
+		return;
+	m_functions->glDepthMask(flag);
+	m_depthMaskKnown = true;
+	m_depthMask = flag;
+}
+
+
+void GLStateCache::depthFunc(GLenum func) {
+	if (elide(m_depthFuncKnown && m_depthFunc == func))
+		return;
+	m_functions->glDepthFunc(func);
+	m_depthFuncKnown = true;
+	m_depthFunc = func;
+}
+
+
+void GLStateCache::colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+	if (elide(m_colorMaskKnown && m_colorMask[0] == red && m_colorMask[1] == green &&
+			  m_colorMask[2] == blue && m_colorMask[3] == alpha))
+	{
+		return;
+	}
+	m_functions->glColorMask(red, green, blue, alpha);
+	m_colorMaskKnown = true;
+	m_colorMask[0] = red;
+	m_colorMask[1] = green;
+	m_colorMask[2] = blue;
+	m_colorMask[3] = alpha;
+}
+
+
+void GLStateCache::useProgram(GLuint program) {
+	if (elide(m_programKnown && m_program == program))
+		return;
+	m_functions->glUseProgram(program);
+	m_programKnown = true;
+	m_program = program;
+}
+
+
+void GLStateCache::bindTexture2D(unsigned int unit, GLuint texture) {
+	Q_ASSERT(unit < MaxTextureUnits);
+	if (elide(m_textureKnown[unit] && m_textures[unit] == texture))
+		return;
+	// switching the active texture unit is only needed (and counted) when it changes
+	if (!elide(m_activeUnitKnown && m_activeUnit == unit)) {
+		m_functions->glActiveTexture(GL_TEXTURE0 + unit);
+		m_activeUnitKnown = true;
+		m_activeUnit = unit;
+	}
+	m_functions->glBindTexture(GL_TEXTURE_2D, texture);
+	m_textureKnown[unit] = true;
+	m_textures[unit] = texture;
+}
+
+
+void GLStateCache::setCapability(GLenum cap, bool enabled) {
+	int idx;
+	switch (cap) {
+		case GL_BLEND		: idx = CapBlend; break;
+		case GL_CULL_FACE	: idx = CapCullFace; break;
+		case GL_DEPTH_TEST	: idx = CapDepthTest; break;
+		default				: idx = -1;
+	}
+	if (idx != -1) {
+		if (elide(m_capKnown[idx] && m_capEnabled[idx] == enabled))
+			return;
+		m_capKnown[idx] = true;
+		m_capEnabled[idx] = enabled;
+	}
+	else
+		elide(false);
+	if (enabled)
+		m_functions->glEnable(cap);
+	else
+		m_functions->glDisable(cap);
+}
@@ -0,0 +1,123 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef GLSTATECACHE_H
+#define GLSTATECACHE_H
+
+#include <QtGui/qopengl.h>
+
+QT_BEGIN_NAMESPACE
+class QOpenGLFunctions;
+QT_END_NAMESPACE
+
+/*! Shadows the OpenGL state of the rendering context and drops calls that would not change it.
+
+	Wraps the state setting functions of QOpenGLFunctions that are called every frame (capabilities, blend
+	function, clear color, depth mask and function, color mask, program and texture bindings). A call is only
+	passed to OpenGL if the value differs from the shadowed value, so render code can simply set the
+	state it needs without tracking what previous code has left behind.
+
+	The shadowed state is only valid if all state changes go through the cache. Code that changes state
+	directly (e.g. QOpenGLShaderProgram::bind() or QOpenGLTexture::bind()) must be followed by a call to
+	invalidate(), after which the next call of each function is issued again.
+
+	If m_debugMode is set, issued and elided calls are counted (see counters()), reset once per frame
+	with resetCounters().
+*/
+class GLStateCache {
+public:
+	/*! Issued and elided calls since the last call to resetCounters(), only counted in debug mode. */
+	struct Counters {
+		unsigned int	m_issued = 0;
+		unsigned int	m_elided = 0;
+	};
+
+	GLStateCache();
+
+	/*! Forgets all shadowed state and takes the functions of the current context, which must be the
+		rendering context. Call after initialization and whenever OpenGL state was changed bypassing the cache.
+	*/
+	void invalidate();
+
+	/*! Only GL_BLEND, GL_CULL_FACE and GL_DEPTH_TEST are shadowed, other capabilities are always passed on. */
+	void enable(GLenum cap);
+	void disable(GLenum cap);
+	void blendFunc(GLenum sfactor, GLenum dfactor);
+	void clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+	void depthMask(GLboolean flag);
+	void depthFunc(GLenum func);
+	void colorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+	/*! Same as QOpenGLShaderProgram::bind() with program = programId(). */
+	void useProgram(GLuint program);
+	/*! Binds a 2D texture to a texture unit (0..MaxTextureUnits-1), same as QOpenGLTexture::bind(unit). */
+	void bindTexture2D(unsigned int unit, GLuint texture);
+
+	/*! Resets the counters, call at the beginning of each frame. */
+	void resetCounters() { m_counters = Counters(); }
+	/*! Counters of the current frame. */
+	const Counters & counters() const { return m_counters; }
+
+	/*! If true, issued and elided calls are counted and logged per frame
+		(must be set before the SceneView is created).
+	*/
+	static bool						m_debugMode;
+
+	/*! Number of texture units whose bindings are shadowed. */
+	static const unsigned int		MaxTextureUnits = 8;
+
+private:
+	enum Capability {
+		CapBlend,
+		CapCullFace,
+		CapDepthTest,
+		NUM_CAPS
+	};
+
+	/*! Returns true, if the call is redundant (value equals known shadowed value) and counts the call. */
+	bool elide(bool redundant) {
+		if (m_debugMode) {
+			if (redundant)
+				++m_counters.m_elided;
+			else
+				++m_counters.m_issued;
+		}
+		return redundant;
+	}
+	/*! Common implementation of enable() and disable(). */
+	void setCapability(GLenum cap, bool enabled);
+
+	QOpenGLFunctions	*m_functions;
+
+	// shadowed state, each value is only valid if the corresponding known flag is set
+	bool				m_capKnown[NUM_CAPS];
+	bool				m_capEnabled[NUM_CAPS];
+	bool				m_blendFuncKnown;
+	GLenum				m_blendSrc;
+	GLenum				m_blendDst;
+	bool				m_clearColorKnown;
+	GLfloat				m_clearColor[4];
+	bool				m_depthMaskKnown;
+	GLboolean			m_depthMask;
+	bool				m_depthFuncKnown;
+	GLenum				m_depthFunc;
+	bool				m_colorMaskKnown;
+	GLboolean			m_colorMask[4];
+	bool				m_programKnown;
+	GLuint				m_program;
+	bool				m_activeUnitKnown;
+	unsigned int		m_activeUnit;
+	bool				m_textureKnown[MaxTextureUnits];
+	GLuint				m_textures[MaxTextureUnits];
+
+	Counters			m_counters;
+};
+
+#endif // GLSTATECACHE_H
@@ -0,0 +1,205 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "GeometryCache.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+
+#include <cstring>
+
+bool GeometryCache::m_cacheEnabled = true;
+QString GeometryCache::m_cacheDir;
+quint64 GeometryCache::m_maxCacheSize = quint64(4) << 30; // 4 GB
+
+static const char GEOMETRY_MAGIC[8] = {'E', '0', '6', 'G', 'E', 'O', 'M', '\0'};
+/*! Increase, whenever the layout of the cache file changes. */
+static const quint32 CACHE_VERSION = 1;
+/*! Alignment of vertex and element data in the file. */
+static const quint64 DATA_ALIGNMENT = 64;
+
+namespace {
+
+struct Header {
+	char		m_magic[8];
+	quint32		m_version;
+	quint32		m_vertexFormatVersion;
+	quint64		m_contentHash;
+	quint32		m_vertexSize;
+	quint32		m_chunkCount;
+	quint64		m_vertexCount;
+	quint64		m_elementCount;
+	quint64		m_reserved;
+};
+
+} // namespace
+
+static_assert(sizeof(Header) == 56, "Unexpected padding in geometry cache header");
+static_assert(sizeof(GeometryCache::Chunk) == 32, "Unexpected padding in geometry cache chunk");
+
+
+/*! Rounds offset up to the next multiple of DATA_ALIGNMENT. */
+static inline quint64 aligned(quint64 offset) {
+	return (offset + DATA_ALIGNMENT - 1)/DATA_ALIGNMENT*DATA_ALIGNMENT;
+}
+
+
+GeometryCache::GeometryCache() :
+	m_data(nullptr),
+	m_vertexData(nullptr),
+	m_vertexCount(0),
+	m_elementData(nullptr),
+	m_elementCount(0),
+	m_chunks(nullptr),
+	m_chunkCount(0)
+{
+}
+
+
+GeometryCache::~GeometryCache() {
+	close();
+}
+
+
+bool GeometryCache::open(const QString & fileName, quint64 contentHash, quint32 vertexFormatVersion, quint32 vertexSize) {
+	close();
+	m_file.setFileName(fileName);
+	if (!m_file.open(QIODevice::ReadOnly))
+		return false; // not cached yet
+	quint64 fileSize = (quint64)m_file.size();
+	if (fileSize >= sizeof(Header))
+		m_data = m_file.map(0, (qint64)fileSize);
+	if (m_data == nullptr) {
+		close();
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, m_data, sizeof(Header));
+	quint64 chunkOffset = sizeof(Header);
+	quint64 vertexOffset = aligned(chunkOffset + quint64(header.m_chunkCount)*sizeof(Chunk));
+	bool valid = std::memcmp(header.m_magic, GEOMETRY_MAGIC, sizeof(GEOMETRY_MAGIC)) == 0 &&
+			header.m_version == CACHE_VERSION && header.m_vertexFormatVersion == vertexFormatVersion &&
+			header.m_contentHash == contentHash && header.m_vertexSize == vertexSize &&
+			// sizes are checked against the file size before multiplying, so that they cannot overflow
+			header.m_vertexCount <= fileSize/vertexSize && header.m_elementCount <= fileSize/sizeof(GLuint) &&
+			vertexOffset <= fileSize;
+	quint64 elementOffset = aligned(vertexOffset + header.m_vertexCount*vertexSize);
+	valid = valid && elementOffset + header.m_elementCount*sizeof(GLuint) <= fileSize;
+	if (!valid) {
+		qDebug() << "Discarding outdated or invalid geometry cache" << fileName;
+		close();
+		return false;
+	}
+
+	m_chunks = reinterpret_cast<const Chunk*>(m_data + chunkOffset);
+	m_chunkCount = header.m_chunkCount;
+	for (unsigned int i=0; i<m_chunkCount; ++i) {
+		if (quint64(m_chunks[i].m_firstElement) + m_chunks[i].m_elementCount > header.m_elementCount) {
+			qDebug() << "Discarding invalid geometry cache" << fileName;
+			close();
+			return false;
+		}
+	}
+	m_vertexData = m_data + vertexOffset;
+	m_vertexCount = header.m_vertexCount;
+	m_elementData = reinterpret_cast<const GLuint*>(m_data + elementOffset);
+	m_elementCount = header.m_elementCount;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+	// the modification time is the last use of the file, so that trimCacheDir() keeps files in use
+	m_file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+#endif
+	return true;
+}
+
+
+void GeometryCache::close() {
+	if (m_data != nullptr)
+		m_file.unmap(const_cast<uchar*>(m_data));
+	m_file.close();
+	m_data = nullptr;
+	m_vertexData = nullptr;
+	m_vertexCount = 0;
+	m_elementData = nullptr;
+	m_elementCount = 0;
+	m_chunks = nullptr;
+	m_chunkCount = 0;
+}
+
+
+bool GeometryCache::write(const QString & fileName, quint64 contentHash, quint32 vertexFormatVersion,
+						  const void * vertexData, quint32 vertexSize, quint64 vertexCount,
+						  const GLuint * elementData, quint64 elementCount,
+						  const std::vector<Chunk> & chunks)
+{
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.m_magic, GEOMETRY_MAGIC, sizeof(GEOMETRY_MAGIC));
+	header.m_version = CACHE_VERSION;
+	header.m_vertexFormatVersion = vertexFormatVersion;
+	header.m_contentHash = contentHash;
+	header.m_vertexSize = vertexSize;
+	header.m_chunkCount = (quint32)chunks.size();
+	header.m_vertexCount = vertexCount;
+	header.m_elementCount = elementCount;
+
+	QDir().mkpath(QFileInfo(fileName).absolutePath());
+	// write into temporary file and rename when done, so that a concurrent reader never sees a partial file
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly)) {
+		qWarning() << "Cannot write geometry cache" << fileName;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(chunks.data()), qint64(chunks.size()*sizeof(Chunk)));
+	file.write(QByteArray(int(aligned(file.pos()) - file.pos()), '\0'));
+	file.write(reinterpret_cast<const char*>(vertexData), qint64(vertexCount*vertexSize));
+	file.write(QByteArray(int(aligned(file.pos()) - file.pos()), '\0'));
+	file.write(reinterpret_cast<const char*>(elementData), qint64(elementCount*sizeof(GLuint)));
+	if (!file.commit()) {
+		qWarning() << "Cannot write geometry cache" << fileName;
+		return false;
+	}
+	trimCacheDir(QFileInfo(fileName).absolutePath(), fileName);
+	return true;
+}
+
+
+void GeometryCache::trimCacheDir(const QString & dir, const QString & keepFile) {
+	// most recently used first
+	QFileInfoList files = QDir(dir).entryInfoList(QStringList() << "*.geom", QDir::Files, QDir::Time);
+	const QFileInfo keepInfo(keepFile);
+	quint64 totalSize = (quint64)keepInfo.size();
+	for (const QFileInfo & f : files) {
+		if (f == keepInfo)
+			continue;
+		totalSize += (quint64)f.size();
+		if (totalSize <= m_maxCacheSize)
+			continue;
+		// fails for files still mapped on Windows, these are removed in a later call
+		if (QFile::remove(f.absoluteFilePath())) {
+			qDebug() << "Removed least recently used geometry cache" << f.fileName();
+			totalSize -= (quint64)f.size();
+		}
+	}
+}
+
+
+QString GeometryCache::cacheFilePath(const QString & name, quint64 contentHash) {
+	if (m_cacheDir.isEmpty())
+		m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/geometrycache";
+	return QString("%1/%2_%3.geom").arg(m_cacheDir, name).arg(contentHash, 16, 16, QChar('0'));
+}
@@ -0,0 +1,117 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef GEOMETRYCACHE_H
+#define GEOMETRYCACHE_H
+
+#include <QFile>
+#include <QString>
+#include <QtGui/qopengl.h>
+
+#include <vector>
+
+/*! On-disk cache of generated vertex and element buffer data.
+
+	Generating the vertexes of a large scene (e.g. BoxStore::copy2Buffer() for each box) takes much longer than
+	reading the result. The cache stores the final buffer contents together with the chunk table (ranges of
+	elements and their bounding boxes), keyed by a hash of the scene content and the version of the vertex format.
+	On a warm start, the cache file is memory-mapped and the buffers are allocated directly from the mapped
+	memory, without any CPU-side processing.
+
+	Cache files are stored in the "geometrycache" subdirectory of the application's cache location, the file name
+	is derived from name and content hash. A cache file is only used if content hash and vertex format version
+	match, so a changed scene or vertex layout simply results in a new cache file. The total size of the cache
+	directory is limited to m_maxCacheSize: opening a cache file marks it as used (modification time), and after
+	writing a cache file the least recently used files are removed.
+
+	\code
+	Header (56 bytes)
+		char[8]   magic "E06GEOM\0"
+		quint32   cache file version
+		quint32   vertex format version
+		quint64   content hash
+		quint32   vertex size in bytes
+		quint32   chunk count
+		quint64   vertex count
+		quint64   element count
+		quint64   reserved
+	Chunk table: chunk count x Chunk
+	Vertex data (64-byte aligned)
+	Element data (64-byte aligned)
+	\endcode
+*/
+class GeometryCache {
+public:
+	/*! A range of elements (drawn with one draw call) and its axis-aligned bounding box. */
+	struct Chunk {
+		quint32		m_firstElement;
+		quint32		m_elementCount;
+		float		m_min[3];
+		float		m_max[3];
+	};
+
+	GeometryCache();
+	~GeometryCache();
+
+	/*! Maps the cache file and checks whether it matches contentHash, vertexFormatVersion and vertexSize.
+		Returns false if the file does not exist, is outdated or invalid.
+	*/
+	bool open(const QString & fileName, quint64 contentHash, quint32 vertexFormatVersion, quint32 vertexSize);
+	/*! Unmaps the file. */
+	void close();
+
+	/*! Pointer to mapped vertex data. */
+	const void * vertexData() const { return m_vertexData; }
+	quint64 vertexCount() const { return m_vertexCount; }
+	/*! Pointer to mapped element data. */
+	const GLuint * elementData() const { return m_elementData; }
+	quint64 elementCount() const { return m_elementCount; }
+	/*! Pointer to the mapped chunk table. */
+	const Chunk * chunks() const { return m_chunks; }
+	unsigned int chunkCount() const { return m_chunkCount; }
+
+	/*! Writes a cache file, returns false (and prints a warning) if writing fails. */
+	static bool write(const QString & fileName, quint64 contentHash, quint32 vertexFormatVersion,
+					  const void * vertexData, quint32 vertexSize, quint64 vertexCount,
+					  const GLuint * elementData, quint64 elementCount,
+					  const std::vector<Chunk> & chunks);
+
+	/*! Returns the path of the cache file for the named geometry with the given content hash. */
+	static QString cacheFilePath(const QString & name, quint64 contentHash);
+
+	/*! If false, geometry is always generated and no cache files are written. */
+	static bool		m_cacheEnabled;
+	/*! Directory for cache files. If empty, a "geometrycache" subdirectory in the application's
+		cache location is used.
+	*/
+	static QString	m_cacheDir;
+	/*! Maximum total size of the cache files in bytes, a single larger file is still kept. */
+	static quint64	m_maxCacheSize;
+
+private:
+	/*! Removes the least recently used cache files in dir until the remaining ones fit into m_maxCacheSize,
+		keepFile (the file just written) is never removed.
+	*/
+	static void trimCacheDir(const QString & dir, const QString & keepFile);
+
+	QFile			m_file;
+	/*! Start of the mapped file, nullptr if not open. */
+	const uchar		*m_data;
+
+	const void		*m_vertexData;
+	quint64			m_vertexCount;
+	const GLuint	*m_elementData;
+	quint64			m_elementCount;
+	const Chunk		*m_chunks;
+	unsigned int	m_chunkCount;
+};
+
+#endif // GEOMETRYCACHE_H
@@ -11,15 +11,30 @@ License    : BSD License,
 
 #include "GridObject.h"
 
-#include <QOpenGLShaderProgram>
+#include <QDebug>
 #include <vector>
 
 
-void GridObject::create(QOpenGLShaderProgram * shaderProgramm, bool major) {
-	// grid is centered around origin, and expands to width/2 in -x, +x, -z and +z direction
-
+void GridObject::create(BufferArena & arena, bool major) {
 	// create a temporary buffer that will contain the x-z coordinates of all grid lines
 	std::vector<float>			gridVertexBufferData;
+	fillBuffer(major, gridVertexBufferData);
+
+	m_bufferSize = gridVertexBufferData.size();
+
+	// layout(location = 0) = vec2 position, two floats per vertex
+	int vertexMemSize = m_bufferSize*sizeof(float);
+	qDebug() << "GridObject - VertexBuffer size =" << vertexMemSize/1024.0 << "kByte";
+	m_arena = &arena;
+	m_allocation = arena.allocate(major ? "GridObject (major)" : "GridObject (minor)", BufferArena::V2, m_bufferSize/2, 0);
+	arena.writeVertexes(m_allocation, 0, m_bufferSize/2, gridVertexBufferData.data());
+}
+
+
+void GridObject::fillBuffer(bool major, std::vector<float> & gridVertexBufferData) const {
+	// grid is centered around origin, and expands to width/2 in -x, +x, -z and +z direction
+
+	gridVertexBufferData.clear();
 	// we have at max 2*N lines, each line requires two vertexes, with two floats (x and z coordinates) each.
 	// reserve memory, but actual buffer size depends on number of lines added
 	gridVertexBufferData.reserve(2*m_N*2*2);	// DISCUSS
@@ -54,42 +69,16 @@ void GridObject::create(QOpenGLShaderProgram * shaderProgramm, bool major) {
 		gridVertexBufferData.push_back(x);
 		gridVertexBufferData.push_back(z2);
 	}
-
-	m_bufferSize = gridVertexBufferData.size();
-
-	// Create Vertex Array Object
-	m_vao.create();		// create Vertex Array Object
-	m_vao.bind();		// and bind it
-
-	// Create Vertex Buffer Object
-	m_vbo.create();
-	m_vbo.bind();
-	m_vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	int vertexMemSize = m_bufferSize*sizeof(float);
-	qDebug() << "GridObject - VertexBuffer size =" << vertexMemSize/1024.0 << "kByte";
-	m_vbo.allocate(gridVertexBufferData.data(), vertexMemSize);
-
-	// layout(location = 0) = vec2 position
-	shaderProgramm->enableAttributeArray(0); // array with index/id 0
-	shaderProgramm->setAttributeBuffer(0, GL_FLOAT,
-								  0 /* position/vertex offset */,
-								  2 /* two floats per position = vec2 */,
-								  0 /* vertex after vertex, no interleaving */);
-
-	m_vao.release();
-	m_vbo.release();
 }
 
 
 void GridObject::destroy() {
-	m_vao.destroy();
-	m_vbo.destroy();
+	if (m_arena != nullptr)
+		m_arena->free(m_allocation);
 }
 
 
 void GridObject::render() {
-	m_vao.bind();
-	// draw the grid lines, m_NVertexes = number of floats in buffer
-	glDrawArrays(GL_LINES, 0, m_bufferSize);
-	m_vao.release();
+	// draw the grid lines, the vertex count is half the number of floats in buffer
+	m_arena->drawArrays(m_allocation, GL_LINES);
 }
@@ -12,12 +12,9 @@ License    : BSD License,
 #ifndef OPENGLGRIDOBJECT_H
 #define OPENGLGRIDOBJECT_H
 
-#include <QOpenGLBuffer>
-#include <QOpenGLVertexArrayObject>
+#include <vector>
 
-QT_BEGIN_NAMESPACE
-class QOpenGLShaderProgram;
-QT_END_NAMESPACE
+#include "BufferArena.h"
 
 
 /*! This class holds all data needed to draw a grid on the screen.
@@ -25,7 +22,8 @@ QT_END_NAMESPACE
 	with y=0 implied.
 	Grid color is a uniform, as is background color.
 
-	The grid is drawn with the grid shader program, which is passed to the create() function.
+	The grid is drawn with the grid shader program, the coordinates are stored in the V2 buffer of the arena
+	(see BufferArena).
 */
 class GridObject {
 public:
@@ -33,10 +31,14 @@ public:
 		major - if true, only the major grid lines are generated, if false, all the minor grid lines
 		except the major lines are createds
 	*/
-	void create(QOpenGLShaderProgram * shaderProgramm, bool major);
+	void create(BufferArena & arena, bool major);
+	/*! Populates the buffer with the x-z coordinates of the grid lines (start and end point of each line).
+		Does not need an OpenGL context, see create() for the meaning of major.
+	*/
+	void fillBuffer(bool major, std::vector<float> & gridVertexBufferData) const;
 	void destroy();
 
-	/*! Binds the buffer and paints. */
+	/*! Binds the vertex array object of the arena and paints. */
 	void render();
 
 	/*! Cached size of vertex buffer object. */
@@ -47,10 +49,10 @@ public:
 	// width is in "space units", whatever that means for you (meters, km, nanometers...)
 	const float					m_width = 5000;
 
-	/*! Wraps an OpenGL VertexArrayObject, that references the vertex coordinates. */
-	QOpenGLVertexArrayObject	m_vao;
-	/*! Holds positions of grid lines. */
-	QOpenGLBuffer				m_vbo;
+	/*! The arena holding the buffer, set in create(). */
+	BufferArena					*m_arena = nullptr;
+	/*! Vertex range holding the positions of grid lines. */
+	BufferArena::Allocation		m_allocation;
 
 };
 
@@ -0,0 +1,137 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "InputRecorder.h"
+
+#include <QFile>
+#include <QDataStream>
+#include <QDebug>
+
+#include "KeyboardMouseHandler.h"
+
+static const quint32 INPUT_LOG_MAGIC = 0x4B4D4952; // "KMIR"
+static const quint32 INPUT_LOG_VERSION = 1;
+
+
+InputRecorder::InputRecorder() :
+	m_mode(Idle),
+	m_frame(0),
+	m_replayIndex(0)
+{
+}
+
+
+void InputRecorder::startRecording(const QPoint & origin) {
+	m_mode = Recording;
+	m_frame = 0;
+	m_origin = origin;
+	m_events.clear();
+	m_timer.start();
+}
+
+
+bool InputRecorder::stopRecording(const QString & fileName) {
+	Q_ASSERT(m_mode == Recording);
+	m_mode = Idle;
+
+	QFile f(fileName);
+	if (!f.open(QIODevice::WriteOnly)) {
+		qWarning() << "Cannot write input log" << fileName;
+		return false;
+	}
+	QDataStream strm(&f);
+	strm << INPUT_LOG_MAGIC << INPUT_LOG_VERSION << qint32(m_origin.x()) << qint32(m_origin.y())
+		 << quint32(m_events.size());
+	for (const Event & e : m_events)
+		strm << e.m_frame << e.m_timeMs << e.m_type << e.m_value << e.m_x << e.m_y;
+	qDebug() << "Input log with" << m_events.size() << "events in" << m_frame << "frames written to" << fileName;
+	return strm.status() == QDataStream::Ok;
+}
+
+
+bool InputRecorder::startReplay(const QString & fileName, const QPoint & origin) {
+	QFile f(fileName);
+	if (!f.open(QIODevice::ReadOnly)) {
+		qWarning() << "Cannot read input log" << fileName;
+		return false;
+	}
+	QDataStream strm(&f);
+	quint32 magic, version, eventCount;
+	qint32 originX, originY;
+	strm >> magic >> version >> originX >> originY >> eventCount;
+	if (strm.status() != QDataStream::Ok || magic != INPUT_LOG_MAGIC || version != INPUT_LOG_VERSION) {
+		qWarning() << "Invalid input log" << fileName;
+		return false;
+	}
+	// header: 5 x 4 bytes, each event: 21 bytes; the count is checked before allocating, so that a corrupt
+	// or foreign file cannot request gigabytes of memory
+	if (quint64(eventCount)*21 > quint64(f.size()) - 20) {
+		qWarning() << "Truncated input log" << fileName;
+		return false;
+	}
+	m_events.resize(eventCount);
+	for (Event & e : m_events)
+		strm >> e.m_frame >> e.m_timeMs >> e.m_type >> e.m_value >> e.m_x >> e.m_y;
+	if (strm.status() != QDataStream::Ok) {
+		qWarning() << "Truncated input log" << fileName;
+		m_events.clear();
+		return false;
+	}
+
+	m_mode = Replaying;
+	m_frame = 0;
+	m_replayIndex = 0;
+	m_origin = QPoint(originX, originY);
+	m_replayOffset = origin - m_origin;
+	return true;
+}
+
+
+void InputRecorder::record(EventType type, int value, const QPoint & pos) {
+	if (m_mode != Recording)
+		return;
+	Event e;
+	e.m_frame = m_frame;
+	e.m_timeMs = quint32(m_timer.elapsed());
+	e.m_type = quint8(type);
+	e.m_value = value;
+	e.m_x = pos.x();
+	e.m_y = pos.y();
+	m_events.push_back(e);
+}
+
+
+bool InputRecorder::replayFrame(KeyboardMouseHandler & handler, QPoint & cursorPos) {
+	if (m_mode != Replaying)
+		return false;
+	if (m_replayIndex >= m_events.size()) {
+		m_mode = Idle;
+		return false;
+	}
+	bool processInput = false;
+	// apply events in recorded order, so that the handler state matches the recording exactly
+	for (; m_replayIndex < m_events.size() && m_events[m_replayIndex].m_frame == m_frame; ++m_replayIndex) {
+		const Event & e = m_events[m_replayIndex];
+		QPoint pos = QPoint(e.m_x, e.m_y) + m_replayOffset;
+		switch (e.m_type) {
+			case KeyPress		: handler.pressKey(static_cast<Qt::Key>(e.m_value)); break;
+			case KeyRelease		: handler.releaseKey(static_cast<Qt::Key>(e.m_value)); break;
+			case ButtonPress	: handler.pressButton(static_cast<Qt::MouseButton>(e.m_value), pos); break;
+			case ButtonRelease	: handler.releaseButton(static_cast<Qt::MouseButton>(e.m_value), pos); break;
+			case Wheel			: handler.addWheelDelta(e.m_value); break;
+			case ProcessInput	:
+				processInput = true;
+				cursorPos = pos;
+			break;
+		}
+	}
+	return processInput;
+}
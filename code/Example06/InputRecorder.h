@@ -0,0 +1,116 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef INPUTRECORDER_H
+#define INPUTRECORDER_H
+
+#include <QPoint>
+#include <QString>
+#include <QElapsedTimer>
+#include <vector>
+
+class KeyboardMouseHandler;
+
+/*! Records the input received by a KeyboardMouseHandler into a compact binary log and replays it frame-exactly.
+
+	Recording: the KeyboardMouseHandler reports all key, mouse button and wheel state changes via record().
+	The scene view calls recordProcessInput() whenever it evaluates the input state in a frame (with the
+	cursor position used to compute mouse deltas) and nextFrame() after each frame. Each event is stored
+	with the frame number it was applied in and a timestamp (ms since start of recording).
+
+	Replay: before processing input in a frame, the scene view calls replayFrame(), which feeds all events
+	of the current frame into the handler and returns whether input was processed in the recorded frame and
+	the cursor position to use instead of QCursor::pos(). Since camera movement is computed per frame, the
+	replayed camera path is identical to the recorded one.
+
+	Positions are stored as global coordinates together with the global position of the view's origin at
+	start of recording, so that a replay in a differently placed window yields the same local positions.
+
+	File format (all values big endian, written with QDataStream):
+	\code
+	header: quint32 magic "KMIR", quint32 version, qint32 originX, qint32 originY, quint32 eventCount
+	event : quint32 frame, quint32 timeMs, quint8 type, qint32 value, qint32 x, qint32 y   (21 Bytes)
+	\endcode
+*/
+class InputRecorder {
+public:
+	enum Mode {
+		Idle,
+		Recording,
+		Replaying
+	};
+
+	enum EventType {
+		KeyPress,			// value = key
+		KeyRelease,			// value = key
+		ButtonPress,		// value = button, x,y = global position
+		ButtonRelease,		// value = button, x,y = global position
+		Wheel,				// value = wheel delta
+		ProcessInput		// x,y = global cursor position used in processInput()
+	};
+
+	InputRecorder();
+
+	Mode mode() const { return m_mode; }
+
+	/*! Starts recording, origin is the global position of the view's top-left corner. */
+	void startRecording(const QPoint & origin);
+	/*! Stops recording and writes the log, returns false if file cannot be written. */
+	bool stopRecording(const QString & fileName);
+
+	/*! Reads the log and starts replay, origin is the global position of the view's top-left corner.
+		Returns false if the file cannot be read or is invalid.
+	*/
+	bool startReplay(const QString & fileName, const QPoint & origin);
+	/*! Records an event (only in recording mode). */
+	void record(EventType type, int value, const QPoint & pos = QPoint());
+	/*! Records that input was processed in the current frame with the given cursor position. */
+	void recordProcessInput(const QPoint & cursorPos) { record(ProcessInput, 0, cursorPos); }
+
+	/*! Feeds all events of the current frame to the handler (only in replay mode).
+		Returns true, if input was processed in the recorded frame and stores the cursor position in cursorPos.
+		When called after all events have been replayed, the recorder switches back to Idle mode.
+	*/
+	bool replayFrame(KeyboardMouseHandler & handler, QPoint & cursorPos);
+
+	/*! Advances frame counter, to be called after each rendered frame. */
+	void nextFrame() { ++m_frame; }
+
+	/*! Number of frames recorded or replayed so far. */
+	unsigned int frame() const { return m_frame; }
+
+private:
+	/*! A recorded event. */
+	struct Event {
+		quint32		m_frame;
+		quint32		m_timeMs;
+		quint8		m_type;
+		qint32		m_value;
+		qint32		m_x;
+		qint32		m_y;
+	};
+
+	Mode				m_mode;
+	/*! Current frame number. */
+	unsigned int		m_frame;
+	/*! Measures time since start of recording. */
+	QElapsedTimer		m_timer;
+	/*! Global position of view origin at start of recording. */
+	QPoint				m_origin;
+	/*! Offset to add to recorded positions in replay (current origin - recorded origin). */
+	QPoint				m_replayOffset;
+	/*! Index of next event to replay. */
+	unsigned int		m_replayIndex;
+	/*! All recorded events, sorted by frame. */
+	std::vector<Event>	m_events;
+};
+
+#endif // INPUTRECORDER_H
@@ -15,12 +15,15 @@ License    : BSD License,
 #include <QMouseEvent>
 #include <QWheelEvent>
 
+#include "InputRecorder.h"
+
 
 KeyboardMouseHandler::KeyboardMouseHandler() :
 	m_leftButtonDown(StateNotPressed),
 	m_middleButtonDown(StateNotPressed),
 	m_rightButtonDown(StateNotPressed),
-	m_wheelDelta(0)
+	m_wheelDelta(0),
+	m_recorder(nullptr)
 {
 }
 
@@ -65,10 +68,10 @@ void KeyboardMouseHandler::wheelEvent(QWheelEvent *event) {
 	QPoint numDegrees = event->angleDelta() / 8;
 
 	if (!numPixels.isNull()) {
-		m_wheelDelta += numPixels.y();
+		addWheelDelta(numPixels.y());
 	} else if (!numDegrees.isNull()) {
 		QPoint numSteps = numDegrees / 15;
-		m_wheelDelta += numSteps.y();
+		addWheelDelta(numSteps.y());
 	}
 
 	event->accept();
@@ -81,12 +84,14 @@ void KeyboardMouseHandler::addRecognizedKey(Qt::Key k) {
 	// remember key to be known and expected
 	m_keys.push_back(k);
 	m_keyStates.push_back(StateNotPressed);
+	m_keyPressed.push_back(false);
 }
 
 
 void KeyboardMouseHandler::clearRecognizedKeys() {
 	m_keys.clear();
 	m_keyStates.clear();
+	m_keyPressed.clear();
 }
 
 
@@ -97,6 +102,7 @@ void KeyboardMouseHandler::clearWasPressedKeyStates() {
 
 	for (unsigned int i=0; i<m_keyStates.size(); ++i)
 		m_keyStates[i] = static_cast<KeyStates>(m_keyStates[i] & 1); // toggle "WasPressed" bit -> NotPressed
+	std::fill(m_keyPressed.begin(), m_keyPressed.end(), false);
 }
 
 
@@ -105,6 +111,9 @@ bool KeyboardMouseHandler::pressKey(Qt::Key k) {
 	for (unsigned int i=0; i<m_keys.size(); ++i) {
 		if (m_keys[i] == k) {
 			m_keyStates[i] = StateHeld;
+			m_keyPressed[i] = true;
+			if (m_recorder != nullptr)
+				m_recorder->record(InputRecorder::KeyPress, k);
 			return true;
 		}
 	}
@@ -116,6 +125,8 @@ bool KeyboardMouseHandler::releaseKey(Qt::Key k) {
 	for (unsigned int i=0; i<m_keys.size(); ++i) {
 		if (m_keys[i] == k) {
 			m_keyStates[i] = StateWasPressed;
+			if (m_recorder != nullptr)
+				m_recorder->record(InputRecorder::KeyRelease, k);
 			return true;
 		}
 	}
@@ -131,6 +142,8 @@ bool KeyboardMouseHandler::pressButton(Qt::MouseButton btn, QPoint currentPos) {
 		default: return false;
 	}
 	m_mouseDownPos = currentPos;
+	if (m_recorder != nullptr)
+		m_recorder->record(InputRecorder::ButtonPress, btn, currentPos);
 	return true;
 }
 
@@ -143,10 +156,21 @@ bool KeyboardMouseHandler::releaseButton(Qt::MouseButton btn, QPoint currentPos)
 		default: return false;
 	}
 	m_mouseReleasePos = currentPos;
+	if (m_recorder != nullptr)
+		m_recorder->record(InputRecorder::ButtonRelease, btn, currentPos);
 	return true;
 }
 
 
+void KeyboardMouseHandler::addWheelDelta(int delta) {
+	if (delta == 0)
+		return;
+	m_wheelDelta += delta;
+	if (m_recorder != nullptr)
+		m_recorder->record(InputRecorder::Wheel, delta);
+}
+
+
 QPoint KeyboardMouseHandler::resetMouseDelta(const QPoint currentPos) {
 	QPoint dist = currentPos - m_mouseDownPos;
 	m_mouseDownPos = currentPos;
@@ -175,6 +199,15 @@ bool KeyboardMouseHandler::keyDown(Qt::Key k) const {
 }
 
 
+bool KeyboardMouseHandler::keyPressed(Qt::Key k) const {
+	for (unsigned int i=0; i<m_keys.size(); ++i) {
+		if (m_keys[i] == k)
+			return m_keyPressed[i] != 0;
+	}
+	return false;
+}
+
+
 bool KeyboardMouseHandler::buttonDown(Qt::MouseButton btn) const {
 	switch (btn) {
 		case Qt::LeftButton		: return m_leftButtonDown == StateHeld;
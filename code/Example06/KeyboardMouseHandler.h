@@ -19,6 +19,8 @@ class QKeyEvent;
 class QMouseEvent;
 class QWheelEvent;
 
+class InputRecorder;
+
 /*! An example keyboard/mouse handler implementation.
 	When a keyboard key has been pressed, the corresponding's key state is updated, same
 	when it is release (in this case the state will be "was pressed" until cleared). This
@@ -91,9 +93,20 @@ public:
 	bool pressButton(Qt::MouseButton btn, QPoint currentPos);
 	/*! Called when a mousebutton was released. */
 	bool releaseButton(Qt::MouseButton btn, QPoint currentPos);
+	/*! Called when the mouse wheel was turned (delta in steps or pixels). */
+	void addWheelDelta(int delta);
+
+	/*! Sets an input recorder, that gets notified of all key, button and wheel state changes.
+		Pass nullptr to disable recording.
+	*/
+	void setRecorder(InputRecorder * recorder) { m_recorder = recorder; }
 
 	/*! Returns, whether the key is pressed or was pressed in last query interval. */
 	bool keyDown(Qt::Key k) const;
+	/*! Returns, whether the key has been pressed since the last call to clearWasPressedKeyStates().
+		Unlike keyDown(), this is true only once per key press, also when the key is held for several frames.
+	*/
+	bool keyPressed(Qt::Key k) const;
 	/*! Returns, whether the mouse button is pressed or was pressed in last query interval. */
 	bool buttonDown(Qt::MouseButton btn) const;
 	/*! Returns, whether the mouse button was pressed and is now released. */
@@ -123,7 +136,7 @@ public:
 	*/
 	int resetWheelDelta();
 
-	/*! This resets all key states currently marked as "WasPressed". */
+	/*! This resets all key states currently marked as "WasPressed" and the key press flags (see keyPressed()). */
 	void clearWasPressedKeyStates();
 
 private:
@@ -135,6 +148,8 @@ private:
 
 	std::vector<Qt::Key>	m_keys;
 	std::vector<KeyStates>	m_keyStates;
+	/*! For each key, true if pressed since the last call to clearWasPressedKeyStates(). */
+	std::vector<char>		m_keyPressed;
 
 	KeyStates				m_leftButtonDown;
 	KeyStates				m_middleButtonDown;
@@ -144,6 +159,9 @@ private:
 	QPoint					m_mouseReleasePos;
 
 	int						m_wheelDelta;
+
+	/*! Optional recorder, not owned. */
+	InputRecorder			*m_recorder;
 };
 
 #endif // KeyboardMouseHandlerH
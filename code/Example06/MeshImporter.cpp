@@ -0,0 +1,1081 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "MeshImporter.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QThreadPool>
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+/*! A range of items [m_begin, m_end[ (bytes, corners, vertexes, ...) processed by a single task. */
+struct Range {
+	quint64 m_begin;
+	quint64 m_end;
+};
+
+/*! Marks an absent normal index and empty hash table slots. */
+const quint32 NoIndex = 0xFFFFFFFF;
+/*! Result of resolving an invalid OBJ index, always fails the range check. */
+const quint32 InvalidIndex = 0xFFFFFFFE;
+
+/*! Splits n items into ranges of at least minSize items, a few more ranges than there are threads so that
+	the load is balanced.
+*/
+std::vector<Range> splitRanges(quint64 n, quint64 minSize) {
+	quint64 taskCount = (quint64)qMax(1, QThreadPool::globalInstance()->maxThreadCount()*4);
+	quint64 chunkSize = qMax(minSize, (n + taskCount - 1)/taskCount);
+	std::vector<Range> ranges;
+	for (quint64 i=0; i<n; i += chunkSize) {
+		Range r;
+		r.m_begin = i;
+		r.m_end = qMin(n, i + chunkSize);
+		ranges.push_back(r);
+	}
+	return ranges;
+}
+
+
+// *** OBJ parsing ***
+
+inline bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char * skipBlanks(const char * p, const char * end) {
+	while (p != end && isBlank(*p))
+		++p;
+	return p;
+}
+
+/*! Returns pointer to the line break terminating the line starting at p, or end. */
+inline const char * lineEnd(const char * p, const char * end) {
+	const char * eol = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+	return eol == nullptr ? end : eol;
+}
+
+/*! Splits text into ranges of complete lines. */
+std::vector<Range> splitLines(const char * data, quint64 size) {
+	std::vector<Range> ranges;
+	quint64 begin = 0;
+	for (const Range & r : splitRanges(size, 1 << 20)) {
+		// move end of range behind the next line break
+		quint64 end = r.m_end;
+		if (end > begin && end < size)
+			end = quint64(lineEnd(data + end - 1, data + size) - data) + 1;
+		end = qMin(end, size);
+		if (end <= begin)
+			continue; // range is part of the previous line
+		Range l;
+		l.m_begin = begin;
+		l.m_end = end;
+		ranges.push_back(l);
+		begin = end;
+	}
+	return ranges;
+}
+
+const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+						 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+/*! Parses a decimal floating point number at p and moves p behind it.
+	Much faster than strtod(), which is locale-dependent and needs null-terminated strings.
+	Digits beyond the 18th are not significant for float results and are ignored.
+*/
+bool parseFloat(const char *& p, const char * end, float & value) {
+	const char * s = p;
+	bool negative = false;
+	if (s != end && (*s == '-' || *s == '+')) {
+		negative = *s == '-';
+		++s;
+	}
+	quint64 mantissa = 0;
+	int exponent = 0;
+	int digits = 0;
+	for (; s != end && *s >= '0' && *s <= '9'; ++s, ++digits) {
+		if (mantissa < 100000000000000000ull)
+			mantissa = mantissa*10 + quint64(*s - '0');
+		else
+			++exponent;
+	}
+	if (s != end && *s == '.') {
+		for (++s; s != end && *s >= '0' && *s <= '9'; ++s, ++digits) {
+			if (mantissa < 100000000000000000ull) {
+				mantissa = mantissa*10 + quint64(*s - '0');
+				--exponent;
+			}
+		}
+	}
+	if (digits == 0)
+		return false;
+	if (s != end && (*s == 'e' || *s == 'E')) {
+		const char * e = s + 1;
+		bool negativeExponent = false;
+		if (e != end && (*e == '-' || *e == '+')) {
+			negativeExponent = *e == '-';
+			++e;
+		}
+		if (e != end && *e >= '0' && *e <= '9') {
+			int exponentValue = 0;
+			for (; e != end && *e >= '0' && *e <= '9'; ++e) {
+				if (exponentValue < 10000)
+					exponentValue = exponentValue*10 + (*e - '0');
+			}
+			exponent += negativeExponent ? -exponentValue : exponentValue;
+			s = e;
+		}
+	}
+	double v = double(mantissa);
+	if (exponent < 0)
+		v = exponent >= -22 ? v/POW10[-exponent] : v*std::pow(10.0, exponent);
+	else if (exponent > 0)
+		v = exponent <= 22 ? v*POW10[exponent] : v*std::pow(10.0, exponent);
+	value = float(negative ? -v : v);
+	p = s;
+	return true;
+}
+
+/*! Parses a (signed) integer at p and moves p behind it. */
+bool parseInt(const char *& p, const char * end, qint64 & value) {
+	const char * s = p;
+	bool negative = false;
+	if (s != end && (*s == '-' || *s == '+')) {
+		negative = *s == '-';
+		++s;
+	}
+	if (s == end || *s < '0' || *s > '9')
+		return false;
+	qint64 v = 0;
+	for (; s != end && *s >= '0' && *s <= '9'; ++s) {
+		if (v < (qint64(1) << 40))
+			v = v*10 + (*s - '0');
+	}
+	value = negative ? -v : v;
+	p = s;
+	return true;
+}
+
+/*! Converts a 1-based or negative (relative to the count of items read so far) OBJ index to a 0-based index. */
+inline quint32 resolveIndex(qint64 idx, quint64 count) {
+	if (idx > 0)
+		return idx - 1 < InvalidIndex ? quint32(idx - 1) : InvalidIndex;
+	if (idx < 0 && qint64(count) + idx >= 0)
+		return quint32(qint64(count) + idx);
+	return InvalidIndex;
+}
+
+enum ObjStatement {
+	ObjOther,
+	ObjPosition,
+	ObjNormal,
+	ObjFace
+};
+
+/*! Determines the kind of statement starting at p and moves p behind the keyword. */
+inline ObjStatement objStatement(const char *& p, const char * end) {
+	if (end - p < 2)
+		return ObjOther;
+	if (p[0] == 'v') {
+		if (isBlank(p[1])) {
+			p += 2;
+			return ObjPosition;
+		}
+		if (p[1] == 'n' && end - p > 2 && isBlank(p[2])) {
+			p += 3;
+			return ObjNormal;
+		}
+	}
+	else if (p[0] == 'f' && isBlank(p[1])) {
+		p += 2;
+		return ObjFace;
+	}
+	return ObjOther;
+}
+
+/*! A range of lines of an OBJ file with the counts of its statements and where to store the results. */
+struct ObjChunk {
+	Range		m_range;
+	quint64		m_positionCount = 0;
+	quint64		m_normalCount = 0;
+	quint64		m_triangleCount = 0;
+	/*! Index of first position/normal/triangle of the chunk, computed from the counts of the previous chunks. */
+	quint64		m_firstPosition = 0;
+	quint64		m_firstNormal = 0;
+	quint64		m_firstTriangle = 0;
+	/*! Byte offset of the first invalid line, or size of the file if none. */
+	quint64		m_errorOffset = 0;
+};
+
+
+/*! Hash map from (position, normal) index pairs to vertex indexes, using open addressing with linear probing. */
+class VertexMap {
+public:
+	VertexMap() : m_mask(0) {}
+
+	/*! Allocates slots for at least n vertexes. */
+	void reserve(quint64 n) {
+		quint64 slotCount = 1024;
+		while (slotCount < 2*n)
+			slotCount *= 2;
+		if (slotCount > m_slots.size())
+			rehash(slotCount);
+	}
+
+	/*! Returns the index of the vertex with the given key, appends a new vertex if not yet present. */
+	quint32 insert(quint64 key) {
+		if (2*(m_keys.size() + 1) > m_slots.size())
+			rehash(qMax<quint64>(1024, 2*m_slots.size()));
+		quint64 i = hash(key) & m_mask;
+		while (m_slots[i].m_vertex != NoIndex) {
+			if (m_slots[i].m_key == key)
+				return m_slots[i].m_vertex;
+			i = (i + 1) & m_mask;
+		}
+		m_slots[i].m_key = key;
+		m_slots[i].m_vertex = quint32(m_keys.size());
+		m_keys.push_back(key);
+		return m_slots[i].m_vertex;
+	}
+
+	/*! Keys of all vertexes, in order of their indexes. */
+	std::vector<quint64>	m_keys;
+
+private:
+	struct Slot {
+		quint64		m_key;
+		quint32		m_vertex;
+	};
+
+	static quint64 hash(quint64 key) {
+		key ^= key >> 31;
+		key *= 0x7fb5d329728ea185ull;
+		key ^= key >> 27;
+		return key;
+	}
+
+	void rehash(quint64 slotCount) {
+		Slot empty;
+		empty.m_key = 0;
+		empty.m_vertex = NoIndex;
+		std::vector<Slot>(slotCount, empty).swap(m_slots);
+		m_mask = slotCount - 1;
+		for (quint32 v=0; v<m_keys.size(); ++v) {
+			quint64 i = hash(m_keys[v]) & m_mask;
+			while (m_slots[i].m_vertex != NoIndex)
+				i = (i + 1) & m_mask;
+			m_slots[i].m_key = m_keys[v];
+			m_slots[i].m_vertex = v;
+		}
+	}
+
+	std::vector<Slot>		m_slots;
+	quint64					m_mask;
+};
+
+
+// *** PLY parsing ***
+
+enum PlyType {
+	PlyInvalid,
+	PlyInt8,
+	PlyUInt8,
+	PlyInt16,
+	PlyUInt16,
+	PlyInt32,
+	PlyUInt32,
+	PlyFloat32,
+	PlyFloat64
+};
+
+PlyType plyType(const QByteArray & name) {
+	if (name == "char" || name == "int8")		return PlyInt8;
+	if (name == "uchar" || name == "uint8")		return PlyUInt8;
+	if (name == "short" || name == "int16")		return PlyInt16;
+	if (name == "ushort" || name == "uint16")	return PlyUInt16;
+	if (name == "int" || name == "int32")		return PlyInt32;
+	if (name == "uint" || name == "uint32")		return PlyUInt32;
+	if (name == "float" || name == "float32")	return PlyFloat32;
+	if (name == "double" || name == "float64")	return PlyFloat64;
+	return PlyInvalid;
+}
+
+unsigned int plySize(PlyType t) {
+	switch (t) {
+		case PlyInt8 : case PlyUInt8 : return 1;
+		case PlyInt16 : case PlyUInt16 : return 2;
+		case PlyInt32 : case PlyUInt32 : case PlyFloat32 : return 4;
+		case PlyFloat64 : return 8;
+		default : return 0;
+	}
+}
+
+template <typename T>
+inline T loadValue(const uchar * p, bool swap) {
+	T v;
+	if (swap) {
+		uchar b[sizeof(T)];
+		for (unsigned int i=0; i<sizeof(T); ++i)
+			b[i] = p[sizeof(T) - 1 - i];
+		std::memcpy(&v, b, sizeof(T));
+	}
+	else
+		std::memcpy(&v, p, sizeof(T));
+	return v;
+}
+
+inline double plyValue(const uchar * p, PlyType t, bool swap) {
+	switch (t) {
+		case PlyInt8 : return loadValue<qint8>(p, swap);
+		case PlyUInt8 : return loadValue<quint8>(p, swap);
+		case PlyInt16 : return loadValue<qint16>(p, swap);
+		case PlyUInt16 : return loadValue<quint16>(p, swap);
+		case PlyInt32 : return loadValue<qint32>(p, swap);
+		case PlyUInt32 : return loadValue<quint32>(p, swap);
+		case PlyFloat32 : return loadValue<float>(p, swap);
+		case PlyFloat64 : return loadValue<double>(p, swap);
+		default : return 0;
+	}
+}
+
+/*! Reads an integer value (list count or vertex index), list properties with float types are rejected when parsing the header. */
+inline qint64 plyInteger(const uchar * p, PlyType t, bool swap) {
+	switch (t) {
+		case PlyInt8 : return loadValue<qint8>(p, swap);
+		case PlyUInt8 : return loadValue<quint8>(p, swap);
+		case PlyInt16 : return loadValue<qint16>(p, swap);
+		case PlyUInt16 : return loadValue<quint16>(p, swap);
+		case PlyInt32 : return loadValue<qint32>(p, swap);
+		case PlyUInt32 : return loadValue<quint32>(p, swap);
+		default : return -1;
+	}
+}
+
+struct PlyProperty {
+	QByteArray	m_name;
+	PlyType		m_type;
+	/*! Type of the item count for list properties, PlyInvalid for scalar properties. */
+	PlyType		m_countType;
+	/*! Offset within the element entry (only for elements without list properties). */
+	unsigned int m_offset;
+};
+
+struct PlyElement {
+	QByteArray					m_name;
+	quint64						m_count;
+	std::vector<PlyProperty>	m_properties;
+	/*! True, if the element has list properties and entries have variable size. */
+	bool						m_hasList;
+	/*! Size of an entry in bytes, only for elements without list properties. */
+	unsigned int				m_stride;
+
+	/*! Returns index of the property with the given name, or -1. */
+	int property(const char * name) const {
+		for (unsigned int i=0; i<m_properties.size(); ++i)
+			if (m_properties[i].m_name == name)
+				return (int)i;
+		return -1;
+	}
+};
+
+/*! Determines size of the element entry at data[pos]. If listProperty is a valid index, listCount returns the
+	item count of this list property. Returns false if the entry exceeds the file.
+*/
+bool plyEntrySize(const PlyElement & e, const uchar * data, quint64 pos, quint64 size, bool swap,
+				  int listProperty, quint64 & entrySize, quint64 & listCount)
+{
+	quint64 s = pos;
+	for (unsigned int i=0; i<e.m_properties.size(); ++i) {
+		const PlyProperty & prop = e.m_properties[i];
+		if (prop.m_countType == PlyInvalid) {
+			s += plySize(prop.m_type);
+		}
+		else {
+			unsigned int countSize = plySize(prop.m_countType);
+			if (s + countSize > size)
+				return false;
+			qint64 n = plyInteger(data + s, prop.m_countType, swap);
+			if (n < 0)
+				return false;
+			if ((int)i == listProperty)
+				listCount = quint64(n);
+			s += countSize + quint64(n)*plySize(prop.m_type);
+		}
+		if (s > size)
+			return false;
+	}
+	entrySize = s - pos;
+	return true;
+}
+
+/*! A range of faces of a PLY file: offset of the first face and where to store the triangles. */
+struct PlyFaceChunk {
+	quint64		m_offset;
+	quint64		m_faceCount;
+	quint64		m_firstTriangle;
+	bool		m_invalidIndex;
+};
+
+} // namespace
+
+
+bool MeshImporter::import(const QString & fileName, const QColor & defaultColor,
+						  std::vector<VertexVNC> & vertexBufferData, std::vector<GLuint> & elementBufferData)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		qWarning() << "Cannot open mesh file" << fileName;
+		return false;
+	}
+	const quint64 size = (quint64)file.size();
+	const uchar * data = nullptr;
+	if (size > 0)
+		data = file.map(0, (qint64)size);
+	if (data == nullptr) {
+		qWarning() << "Cannot map mesh file" << fileName;
+		return false;
+	}
+
+	QString errorMsg;
+	bool success = false;
+	QString suffix = QFileInfo(fileName).suffix().toLower();
+	if (suffix == "obj")
+		success = importObj(reinterpret_cast<const char*>(data), size, defaultColor, vertexBufferData, elementBufferData, errorMsg);
+	else if (suffix == "ply")
+		success = importPly(data, size, defaultColor, vertexBufferData, elementBufferData, errorMsg);
+	else
+		errorMsg = "unknown file extension, expected .obj or .ply";
+	file.unmap(const_cast<uchar*>(data));
+
+	if (!success) {
+		std::vector<VertexVNC>().swap(vertexBufferData);
+		std::vector<GLuint>().swap(elementBufferData);
+		qWarning() << "Cannot import mesh file" << fileName << ":" << errorMsg;
+		return false;
+	}
+	qDebug() << "MeshImporter - imported" << vertexBufferData.size() << "vertexes and" << elementBufferData.size()/3
+			 << "triangles in" << timer.elapsed() << "ms";
+	return true;
+}
+
+
+bool MeshImporter::importObj(const char * data, quint64 size, const QColor & defaultColor,
+							 std::vector<VertexVNC> & vertexBufferData, std::vector<GLuint> & elementBufferData,
+							 QString & errorMsg)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	// *** count pass: number of positions, normals and triangles in each chunk of lines ***
+
+	std::vector<ObjChunk> chunks;
+	for (const Range & r : splitLines(data, size)) {
+		ObjChunk c;
+		c.m_range = r;
+		c.m_errorOffset = size;
+		chunks.push_back(c);
+	}
+	QtConcurrent::blockingMap(chunks, [data](ObjChunk & c) {
+		const char * p = data + c.m_range.m_begin;
+		const char * end = data + c.m_range.m_end;
+		while (p != end) {
+			const char * eol = lineEnd(p, end);
+			const char * s = skipBlanks(p, eol);
+			switch (objStatement(s, eol)) {
+				case ObjPosition : ++c.m_positionCount; break;
+				case ObjNormal : ++c.m_normalCount; break;
+				case ObjFace : {
+					quint64 corners = 0;
+					for (s = skipBlanks(s, eol); s != eol; s = skipBlanks(s, eol)) {
+						++corners;
+						while (s != eol && !isBlank(*s))
+							++s;
+					}
+					if (corners >= 3)
+						c.m_triangleCount += corners - 2;
+				} break;
+				default : ;
+			}
+			p = eol == end ? end : eol + 1;
+		}
+	});
+
+	quint64 positionCount = 0;
+	quint64 normalCount = 0;
+	quint64 triangleCount = 0;
+	for (ObjChunk & c : chunks) {
+		c.m_firstPosition = positionCount;
+		c.m_firstNormal = normalCount;
+		c.m_firstTriangle = triangleCount;
+		positionCount += c.m_positionCount;
+		normalCount += c.m_normalCount;
+		triangleCount += c.m_triangleCount;
+	}
+	if (positionCount >= InvalidIndex || normalCount >= InvalidIndex) {
+		errorMsg = "too many vertexes";
+		return false;
+	}
+	qint64 countTime = timer.elapsed();
+
+	// *** parse pass: each chunk writes its positions, normals and triangle corners into its own part of the arrays ***
+
+	std::vector<float> positions(3*positionCount);
+	std::vector<float> normals(3*normalCount);
+	std::vector<GLuint> cornerPositions(3*triangleCount);
+	std::vector<quint32> cornerNormals(3*triangleCount);
+	QtConcurrent::blockingMap(chunks, [&](ObjChunk & c) {
+		float * pos = positions.data() + 3*c.m_firstPosition;
+		float * norm = normals.data() + 3*c.m_firstNormal;
+		GLuint * triPos = cornerPositions.data() + 3*c.m_firstTriangle;
+		quint32 * triNorm = cornerNormals.data() + 3*c.m_firstTriangle;
+		// number of positions/normals read so far, needed to resolve relative indexes
+		quint64 posCount = c.m_firstPosition;
+		quint64 normCount = c.m_firstNormal;
+		std::vector<quint32> polyPos;
+		std::vector<quint32> polyNorm;
+
+		const char * p = data + c.m_range.m_begin;
+		const char * end = data + c.m_range.m_end;
+		while (p != end) {
+			const char * eol = lineEnd(p, end);
+			const char * s = skipBlanks(p, eol);
+			bool valid = true;
+			switch (objStatement(s, eol)) {
+				case ObjPosition :
+					for (unsigned int k=0; k<3 && valid; ++k) {
+						s = skipBlanks(s, eol);
+						valid = parseFloat(s, eol, pos[k]);
+					}
+					pos += 3;
+					++posCount;
+				break;
+
+				case ObjNormal :
+					for (unsigned int k=0; k<3 && valid; ++k) {
+						s = skipBlanks(s, eol);
+						valid = parseFloat(s, eol, norm[k]);
+					}
+					norm += 3;
+					++normCount;
+				break;
+
+				case ObjFace : {
+					polyPos.clear();
+					polyNorm.clear();
+					for (s = skipBlanks(s, eol); s != eol && valid; s = skipBlanks(s, eol)) {
+						// v, v/vt, v/vt/vn or v//vn
+						qint64 v = 0, vt = 0, vn = 0;
+						valid = parseInt(s, eol, v);
+						if (valid && s != eol && *s == '/') {
+							++s;
+							if (s != eol && *s != '/')
+								valid = parseInt(s, eol, vt);
+							if (valid && s != eol && *s == '/') {
+								++s;
+								valid = parseInt(s, eol, vn);
+							}
+						}
+						valid = valid && (s == eol || isBlank(*s));
+						polyPos.push_back(resolveIndex(v, posCount));
+						polyNorm.push_back(vn == 0 ? NoIndex : resolveIndex(vn, normCount));
+					}
+					// triangulate as fan
+					for (unsigned int k=1; valid && k+1<polyPos.size(); ++k) {
+						triPos[0] = polyPos[0];
+						triPos[1] = polyPos[k];
+						triPos[2] = polyPos[k+1];
+						triNorm[0] = polyNorm[0];
+						triNorm[1] = polyNorm[k];
+						triNorm[2] = polyNorm[k+1];
+						triPos += 3;
+						triNorm += 3;
+					}
+				} break;
+
+				default : ;
+			}
+			if (!valid) {
+				c.m_errorOffset = quint64(p - data);
+				return;
+			}
+			p = eol == end ? end : eol + 1;
+		}
+	});
+	for (const ObjChunk & c : chunks) {
+		if (c.m_errorOffset != size) {
+			errorMsg = QString("invalid statement in line %1").arg(std::count(data, data + c.m_errorOffset, '\n') + 1);
+			return false;
+		}
+	}
+	qint64 parseTime = timer.elapsed();
+
+	// *** check indexes, OBJ allows references to vertexes defined later in the file ***
+
+	const quint64 cornerCount = 3*triangleCount;
+	std::vector<Range> cornerRanges = splitRanges(cornerCount, 1 << 16);
+	std::vector<char> invalidIndexes(cornerRanges.size(), false);
+	std::vector<char> missingNormals(cornerRanges.size(), false);
+	QtConcurrent::blockingMap(cornerRanges, [&](const Range & r) {
+		bool invalid = false;
+		bool missing = false;
+		for (quint64 i=r.m_begin; i<r.m_end; ++i) {
+			invalid = invalid || cornerPositions[i] >= positionCount;
+			if (cornerNormals[i] == NoIndex)
+				missing = true;
+			else
+				invalid = invalid || cornerNormals[i] >= normalCount;
+		}
+		unsigned int rangeIdx = unsigned(&r - cornerRanges.data());
+		invalidIndexes[rangeIdx] = invalid;
+		missingNormals[rangeIdx] = missing;
+	});
+	if (std::find(invalidIndexes.begin(), invalidIndexes.end(), true) != invalidIndexes.end()) {
+		errorMsg = "face references undefined vertex or normal";
+		return false;
+	}
+	// normals are only used if given for all corners, otherwise they are generated
+	const bool hasNormals = normalCount > 0 &&
+			std::find(missingNormals.begin(), missingNormals.end(), true) == missingNormals.end();
+
+	const float r = float(defaultColor.redF());
+	const float g = float(defaultColor.greenF());
+	const float b = float(defaultColor.blueF());
+
+	if (!hasNormals) {
+		// positions are the vertexes, corners reference them directly
+		vertexBufferData.resize(positionCount);
+		VertexVNC * vertexData = vertexBufferData.data();
+		std::vector<Range> vertexRanges = splitRanges(positionCount, 1 << 14);
+		QtConcurrent::blockingMap(vertexRanges, [&](const Range & range) {
+			for (quint64 i=range.m_begin; i<range.m_end; ++i) {
+				VertexVNC & v = vertexData[i];
+				v.x = positions[3*i];
+				v.y = positions[3*i+1];
+				v.z = positions[3*i+2];
+				v.r = r;
+				v.g = g;
+				v.b = b;
+			}
+		});
+		elementBufferData.swap(cornerPositions);
+		generateNormals(vertexBufferData, elementBufferData);
+		qDebug() << "MeshImporter - OBJ counted in" << countTime << "ms, parsed in" << parseTime - countTime
+				 << "ms, normals generated in" << timer.elapsed() - parseTime << "ms";
+		return true;
+	}
+
+	// *** deduplication: each distinct (position, normal) pair becomes one vertex ***
+
+	// Corners are partitioned by position index, so that all corners sharing a vertex end up in the same partition
+	// and each partition can be deduplicated with its own hash map without synchronization.
+	const unsigned int partitionCount = (unsigned int)qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+	std::vector<unsigned int> partitions(partitionCount);
+	for (unsigned int i=0; i<partitionCount; ++i)
+		partitions[i] = i;
+	if (cornerCount > NoIndex) {
+		errorMsg = "too many faces";
+		return false;
+	}
+
+	// The corners are sorted into one bucket per partition (counting sort), so that each worker only visits the
+	// corners of its own partition: count per corner range and partition, then the exclusive prefix sum over
+	// (partition, corner range) is the position of the first corner of a range in its partition's bucket.
+	// Within a bucket, corners keep their order, so vertex numbering does not depend on the thread count.
+	std::vector<quint64> bucketOffsets(cornerRanges.size()*partitionCount, 0);
+	QtConcurrent::blockingMap(cornerRanges, [&](const Range & range) {
+		quint64 * counts = bucketOffsets.data() + unsigned(&range - cornerRanges.data())*partitionCount;
+		for (quint64 i=range.m_begin; i<range.m_end; ++i)
+			++counts[cornerPositions[i] % partitionCount];
+	});
+	std::vector<quint64> bucketBegin(partitionCount + 1, 0);
+	quint64 offset = 0;
+	for (unsigned int part=0; part<partitionCount; ++part) {
+		bucketBegin[part] = offset;
+		for (unsigned int rangeIdx=0; rangeIdx<cornerRanges.size(); ++rangeIdx) {
+			quint64 & o = bucketOffsets[rangeIdx*partitionCount + part];
+			const quint64 count = o;
+			o = offset;
+			offset += count;
+		}
+	}
+	bucketBegin[partitionCount] = offset;
+	std::vector<quint32> bucketedCorners(cornerCount);
+	QtConcurrent::blockingMap(cornerRanges, [&](const Range & range) {
+		quint64 * offsets = bucketOffsets.data() + unsigned(&range - cornerRanges.data())*partitionCount;
+		for (quint64 i=range.m_begin; i<range.m_end; ++i)
+			bucketedCorners[offsets[cornerPositions[i] % partitionCount]++] = quint32(i);
+	});
+
+	std::vector<VertexMap> maps(partitionCount);
+	// vertex index of each corner within its partition
+	std::vector<quint32> cornerVertexes(cornerCount);
+	QtConcurrent::blockingMap(partitions, [&](unsigned int part) {
+		VertexMap & map = maps[part];
+		map.reserve(positionCount/partitionCount + 1);
+		for (quint64 j=bucketBegin[part]; j<bucketBegin[part+1]; ++j) {
+			const quint32 i = bucketedCorners[j];
+			cornerVertexes[i] = map.insert((quint64(cornerPositions[i]) << 32) | cornerNormals[i]);
+		}
+	});
+
+	std::vector<quint64> firstVertex(partitionCount + 1, 0);
+	for (unsigned int i=0; i<partitionCount; ++i)
+		firstVertex[i+1] = firstVertex[i] + maps[i].m_keys.size();
+	if (firstVertex[partitionCount] >= NoIndex) {
+		errorMsg = "too many vertexes";
+		return false;
+	}
+
+	vertexBufferData.resize(firstVertex[partitionCount]);
+	VertexVNC * vertexData = vertexBufferData.data();
+	QtConcurrent::blockingMap(partitions, [&](unsigned int part) {
+		VertexVNC * v = vertexData + firstVertex[part];
+		for (quint64 key : maps[part].m_keys) {
+			const float * pos = positions.data() + 3*(key >> 32);
+			const float * norm = normals.data() + 3*(key & 0xFFFFFFFF);
+			v->x = pos[0];
+			v->y = pos[1];
+			v->z = pos[2];
+			v->m = norm[0];
+			v->n = norm[1];
+			v->o = norm[2];
+			v->r = r;
+			v->g = g;
+			v->b = b;
+			++v;
+		}
+	});
+
+	elementBufferData.resize(cornerCount);
+	GLuint * elementData = elementBufferData.data();
+	QtConcurrent::blockingMap(cornerRanges, [&](const Range & range) {
+		for (quint64 i=range.m_begin; i<range.m_end; ++i)
+			elementData[i] = GLuint(firstVertex[cornerPositions[i] % partitionCount] + cornerVertexes[i]);
+	});
+
+	qDebug() << "MeshImporter - OBJ counted in" << countTime << "ms, parsed in" << parseTime - countTime
+			 << "ms, vertexes deduplicated in" << timer.elapsed() - parseTime << "ms";
+	return true;
+}
+
+
+bool MeshImporter::importPly(const uchar * data, quint64 size, const QColor & defaultColor,
+							 std::vector<VertexVNC> & vertexBufferData, std::vector<GLuint> & elementBufferData,
+							 QString & errorMsg)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	// *** header ***
+
+	QByteArray text = QByteArray::fromRawData(reinterpret_cast<const char*>(data), int(qMin<quint64>(size, 1 << 20)));
+	int headerEnd = text.indexOf("end_header");
+	int dataOffset = headerEnd == -1 ? -1 : text.indexOf('\n', headerEnd);
+	if (!text.startsWith("ply") || dataOffset == -1) {
+		errorMsg = "missing PLY header";
+		return false;
+	}
+	++dataOffset;
+
+	bool littleEndian = true;
+	std::vector<PlyElement> elements;
+	QList<QByteArray> lines = text.left(headerEnd).split('\n');
+	for (int i=1; i<lines.count(); ++i) {
+		QList<QByteArray> tokens = lines[i].simplified().split(' ');
+		if (tokens[0] == "format" && tokens.count() >= 2) {
+			if (tokens[1] == "binary_big_endian")
+				littleEndian = false;
+			else if (tokens[1] != "binary_little_endian") {
+				errorMsg = "only binary PLY files are supported";
+				return false;
+			}
+		}
+		else if (tokens[0] == "element" && tokens.count() == 3) {
+			PlyElement e;
+			e.m_name = tokens[1];
+			e.m_count = tokens[2].toULongLong();
+			e.m_hasList = false;
+			e.m_stride = 0;
+			elements.push_back(e);
+		}
+		else if (tokens[0] == "property" && !elements.empty()) {
+			PlyElement & e = elements.back();
+			PlyProperty prop;
+			prop.m_offset = e.m_stride;
+			prop.m_countType = PlyInvalid;
+			if (tokens.count() == 5 && tokens[1] == "list") {
+				prop.m_countType = plyType(tokens[2]);
+				prop.m_type = plyType(tokens[3]);
+				prop.m_name = tokens[4];
+				if (prop.m_countType == PlyInvalid || prop.m_countType == PlyFloat32 || prop.m_countType == PlyFloat64)
+					prop.m_type = PlyInvalid;
+				e.m_hasList = true;
+			}
+			else if (tokens.count() == 3) {
+				prop.m_type = plyType(tokens[1]);
+				prop.m_name = tokens[2];
+				e.m_stride += plySize(prop.m_type);
+			}
+			else
+				prop.m_type = PlyInvalid;
+			if (prop.m_type == PlyInvalid) {
+				errorMsg = QString("invalid property '%1'").arg(QString::fromLatin1(lines[i].simplified()));
+				return false;
+			}
+			e.m_properties.push_back(prop);
+		}
+	}
+	const bool swap = littleEndian != (Q_BYTE_ORDER == Q_LITTLE_ENDIAN);
+
+	// *** locate vertex and face data, elements are stored one after another ***
+
+	const PlyElement * vertexElement = nullptr;
+	const PlyElement * faceElement = nullptr;
+	quint64 vertexOffset = 0;
+	int indexProperty = -1;
+	std::vector<PlyFaceChunk> faceChunks;
+	quint64 triangleCount = 0;
+	// faces per chunk for the parallel pass
+	const quint64 FacesPerChunk = 1 << 16;
+
+	quint64 pos = quint64(dataOffset);
+	for (const PlyElement & e : elements) {
+		if (e.m_name == "vertex") {
+			if (e.m_hasList) {
+				errorMsg = "vertex element must not have list properties";
+				return false;
+			}
+			vertexElement = &e;
+			vertexOffset = pos;
+		}
+		else if (e.m_name == "face") {
+			faceElement = &e;
+			indexProperty = e.property("vertex_indices");
+			if (indexProperty == -1)
+				indexProperty = e.property("vertex_index");
+			if (indexProperty == -1 || e.m_properties[indexProperty].m_countType == PlyInvalid) {
+				errorMsg = "face element without vertex index list";
+				return false;
+			}
+		}
+		if (!e.m_hasList) {
+			// fixed size entries
+			if (e.m_stride > 0 && e.m_count > (size - pos)/e.m_stride) {
+				errorMsg = QString("truncated element '%1'").arg(QString::fromLatin1(e.m_name));
+				return false;
+			}
+			pos += e.m_count*e.m_stride;
+			continue;
+		}
+		// variable size entries must be walked serially; for faces, chunk boundaries are recorded on the way
+		for (quint64 i=0; i<e.m_count; ++i) {
+			quint64 entrySize = 0;
+			quint64 cornerCount = 0;
+			if (!plyEntrySize(e, data, pos, size, swap, &e == faceElement ? indexProperty : -1, entrySize, cornerCount)) {
+				errorMsg = QString("truncated element '%1'").arg(QString::fromLatin1(e.m_name));
+				return false;
+			}
+			if (&e == faceElement) {
+				if (i % FacesPerChunk == 0) {
+					PlyFaceChunk c;
+					c.m_offset = pos;
+					c.m_faceCount = qMin(FacesPerChunk, e.m_count - i);
+					c.m_firstTriangle = triangleCount;
+					c.m_invalidIndex = false;
+					faceChunks.push_back(c);
+				}
+				if (cornerCount >= 3)
+					triangleCount += cornerCount - 2;
+			}
+			pos += entrySize;
+		}
+	}
+	if (vertexElement == nullptr || faceElement == nullptr) {
+		errorMsg = "missing vertex or face element";
+		return false;
+	}
+	if (vertexElement->m_count >= NoIndex) {
+		errorMsg = "too many vertexes";
+		return false;
+	}
+	qint64 headerTime = timer.elapsed();
+
+	// *** vertexes ***
+
+	const int px = vertexElement->property("x");
+	const int py = vertexElement->property("y");
+	const int pz = vertexElement->property("z");
+	if (px == -1 || py == -1 || pz == -1) {
+		errorMsg = "missing vertex coordinates";
+		return false;
+	}
+	const int pn[3] = { vertexElement->property("nx"), vertexElement->property("ny"), vertexElement->property("nz") };
+	const bool hasNormals = pn[0] != -1 && pn[1] != -1 && pn[2] != -1;
+	const int pc[3] = { vertexElement->property("red"), vertexElement->property("green"), vertexElement->property("blue") };
+	const bool hasColors = pc[0] != -1 && pc[1] != -1 && pc[2] != -1;
+	const std::vector<PlyProperty> & props = vertexElement->m_properties;
+	// integer colors are scaled to 0..1
+	float colorScale = 1;
+	if (hasColors) {
+		PlyType t = props[pc[0]].m_type;
+		if (t != PlyFloat32 && t != PlyFloat64)
+			colorScale = plySize(t) == 1 ? 1/255.f : 1/65535.f;
+	}
+	const float r = float(defaultColor.redF());
+	const float g = float(defaultColor.greenF());
+	const float b = float(defaultColor.blueF());
+
+	const quint64 vertexCount = vertexElement->m_count;
+	const unsigned int stride = vertexElement->m_stride;
+	vertexBufferData.resize(vertexCount);
+	VertexVNC * vertexData = vertexBufferData.data();
+	std::vector<Range> vertexRanges = splitRanges(vertexCount, 1 << 14);
+	QtConcurrent::blockingMap(vertexRanges, [&](const Range & range) {
+		for (quint64 i=range.m_begin; i<range.m_end; ++i) {
+			const uchar * entry = data + vertexOffset + i*stride;
+			VertexVNC & v = vertexData[i];
+			v.x = float(plyValue(entry + props[px].m_offset, props[px].m_type, swap));
+			v.y = float(plyValue(entry + props[py].m_offset, props[py].m_type, swap));
+			v.z = float(plyValue(entry + props[pz].m_offset, props[pz].m_type, swap));
+			if (hasNormals) {
+				v.m = float(plyValue(entry + props[pn[0]].m_offset, props[pn[0]].m_type, swap));
+				v.n = float(plyValue(entry + props[pn[1]].m_offset, props[pn[1]].m_type, swap));
+				v.o = float(plyValue(entry + props[pn[2]].m_offset, props[pn[2]].m_type, swap));
+			}
+			if (hasColors) {
+				v.r = colorScale*float(plyValue(entry + props[pc[0]].m_offset, props[pc[0]].m_type, swap));
+				v.g = colorScale*float(plyValue(entry + props[pc[1]].m_offset, props[pc[1]].m_type, swap));
+				v.b = colorScale*float(plyValue(entry + props[pc[2]].m_offset, props[pc[2]].m_type, swap));
+			}
+			else {
+				v.r = r;
+				v.g = g;
+				v.b = b;
+			}
+		}
+	});
+
+	// *** faces, sizes of all entries have been checked in the serial walk ***
+
+	elementBufferData.resize(3*triangleCount);
+	GLuint * elementData = elementBufferData.data();
+	const std::vector<PlyProperty> & faceProps = faceElement->m_properties;
+	QtConcurrent::blockingMap(faceChunks, [&](PlyFaceChunk & c) {
+		quint64 p = c.m_offset;
+		GLuint * tri = elementData + 3*c.m_firstTriangle;
+		bool invalid = false;
+		for (quint64 f=0; f<c.m_faceCount; ++f) {
+			for (unsigned int i=0; i<faceProps.size(); ++i) {
+				const PlyProperty & prop = faceProps[i];
+				if (prop.m_countType == PlyInvalid) {
+					p += plySize(prop.m_type);
+					continue;
+				}
+				const unsigned int countSize = plySize(prop.m_countType);
+				const unsigned int indexSize = plySize(prop.m_type);
+				const quint64 n = quint64(plyInteger(data + p, prop.m_countType, swap));
+				p += countSize;
+				if ((int)i == indexProperty && n >= 3) {
+					// triangulate as fan
+					const qint64 first = plyInteger(data + p, prop.m_type, swap);
+					qint64 prev = plyInteger(data + p + indexSize, prop.m_type, swap);
+					for (quint64 k=2; k<n; ++k) {
+						qint64 next = plyInteger(data + p + k*indexSize, prop.m_type, swap);
+						invalid = invalid || quint64(first) >= vertexCount || quint64(prev) >= vertexCount ||
+								quint64(next) >= vertexCount;
+						tri[0] = GLuint(first);
+						tri[1] = GLuint(prev);
+						tri[2] = GLuint(next);
+						tri += 3;
+						prev = next;
+					}
+				}
+				p += n*indexSize;
+			}
+		}
+		c.m_invalidIndex = invalid;
+	});
+	for (const PlyFaceChunk & c : faceChunks) {
+		if (c.m_invalidIndex) {
+			errorMsg = "face references undefined vertex";
+			return false;
+		}
+	}
+	qint64 parseTime = timer.elapsed();
+
+	if (!hasNormals)
+		generateNormals(vertexBufferData, elementBufferData);
+
+	qDebug() << "MeshImporter - PLY header and face offsets in" << headerTime << "ms, parsed in" << parseTime - headerTime
+			 << "ms, normals" << (hasNormals ? "read from file" : "generated") << "in" << timer.elapsed() - parseTime << "ms";
+	return true;
+}
+
+
+void MeshImporter::generateNormals(std::vector<VertexVNC> & vertexBufferData, const std::vector<GLuint> & elementBufferData) {
+	const quint64 vertexCount = vertexBufferData.size();
+	const quint64 triangleCount = elementBufferData.size()/3;
+	VertexVNC * vertexData = vertexBufferData.data();
+	const GLuint * elementData = elementBufferData.data();
+
+	// face normals are not normalized, so that larger triangles contribute more to the vertex normals
+	std::vector<QVector3D> faceNormals(triangleCount);
+	std::vector<Range> triangleRanges = splitRanges(triangleCount, 1 << 14);
+	QtConcurrent::blockingMap(triangleRanges, [&](const Range & range) {
+		for (quint64 t=range.m_begin; t<range.m_end; ++t) {
+			const VertexVNC & a = vertexData[elementData[3*t]];
+			const VertexVNC & b = vertexData[elementData[3*t+1]];
+			const VertexVNC & c = vertexData[elementData[3*t+2]];
+			faceNormals[t] = QVector3D::crossProduct(QVector3D(b.x - a.x, b.y - a.y, b.z - a.z),
+													 QVector3D(c.x - a.x, c.y - a.y, c.z - a.z));
+		}
+	});
+
+	// vertex to triangle adjacency in compressed row storage: the triangles of vertex i are
+	// adjacentTriangles[firstAdjacent[i]] ... adjacentTriangles[firstAdjacent[i+1]-1]
+	// (this is a sequential counting sort, but only touches integers)
+	std::vector<quint64> firstAdjacent(vertexCount + 1, 0);
+	for (quint64 i=0; i<3*triangleCount; ++i)
+		++firstAdjacent[elementData[i] + 1];
+	for (quint64 i=0; i<vertexCount; ++i)
+		firstAdjacent[i+1] += firstAdjacent[i];
+	std::vector<quint32> adjacentTriangles(3*triangleCount);
+	{
+		std::vector<quint64> next(firstAdjacent.begin(), firstAdjacent.end() - 1);
+		for (quint64 i=0; i<3*triangleCount; ++i)
+			adjacentTriangles[next[elementData[i]]++] = quint32(i/3);
+	}
+
+	// sum up in parallel, each vertex is written by exactly one task
+	std::vector<Range> vertexRanges = splitRanges(vertexCount, 1 << 14);
+	QtConcurrent::blockingMap(vertexRanges, [&](const Range & range) {
+		for (quint64 i=range.m_begin; i<range.m_end; ++i) {
+			QVector3D n;
+			for (quint64 j=firstAdjacent[i]; j<firstAdjacent[i+1]; ++j)
+				n += faceNormals[adjacentTriangles[j]];
+			n.normalize();
+			VertexVNC & v = vertexData[i];
+			v.m = n.x();
+			v.n = n.y();
+			v.o = n.z();
+		}
+	});
+}
@@ -0,0 +1,63 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef MESHIMPORTER_H
+#define MESHIMPORTER_H
+
+#include <QColor>
+#include <QString>
+#include <QtGui/qopengl.h>
+
+#include <vector>
+
+#include "Vertex.h"
+
+/*! Imports triangle meshes from Wavefront OBJ and binary PLY files.
+
+	The file is memory-mapped and parsed in parallel: the data is split into chunks (at line boundaries for OBJ,
+	at face boundaries for PLY), a first pass counts vertexes and triangles per chunk, so that each chunk knows
+	where to write its results, and a second pass parses all chunks concurrently directly into the
+	final arrays.
+
+	The result is an interleaved VertexVNC buffer plus triangle elements, that can be uploaded as is.
+	OBJ faces reference positions and normals independently, so each distinct (position, normal) pair becomes
+	one vertex. This deduplication uses hash tables, one per partition of the position indexes, so that
+	the partitions can be processed in parallel. Polygons are triangulated as fans.
+
+	If the file has no normals, smooth vertex normals are computed (see generateNormals()). Vertex colors are
+	read from PLY files (properties red, green, blue), all other vertexes get the default color.
+
+	Supported subset:
+	- OBJ: v, vn and f statements (v, v/vt, v/vt/vn, v//vn and negative indexes), everything else is ignored
+	- PLY: binary_little_endian and binary_big_endian, vertex properties x, y, z, nx, ny, nz, red, green, blue,
+	  face property list vertex_indices (or vertex_index); other elements and properties are skipped
+*/
+class MeshImporter {
+public:
+	/*! Imports the mesh, the format is selected by file extension (.obj or .ply).
+		Returns false (and prints a warning) if the file cannot be read or is invalid.
+	*/
+	static bool import(const QString & fileName, const QColor & defaultColor,
+					   std::vector<VertexVNC> & vertexBufferData, std::vector<GLuint> & elementBufferData);
+
+	/*! Computes smooth vertex normals as the sum of the (area weighted) normals of all adjacent triangles. */
+	static void generateNormals(std::vector<VertexVNC> & vertexBufferData, const std::vector<GLuint> & elementBufferData);
+
+private:
+	static bool importObj(const char * data, quint64 size, const QColor & defaultColor,
+						  std::vector<VertexVNC> & vertexBufferData, std::vector<GLuint> & elementBufferData,
+						  QString & errorMsg);
+	static bool importPly(const uchar * data, quint64 size, const QColor & defaultColor,
+						  std::vector<VertexVNC> & vertexBufferData, std::vector<GLuint> & elementBufferData,
+						  QString & errorMsg);
+};
+
+#endif // MESHIMPORTER_H
@@ -0,0 +1,180 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "MeshObject.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "MeshImporter.h"
+#include "PickObject.h"
+
+/*! Tests if the line p1 + t*d, t in [0..tMax] hits the axis-aligned box (slab test). */
+static bool intersectsBox(const float * bmin, const float * bmax, const QVector3D & p1, const QVector3D & d, float tMax) {
+	float tEnter = 0;
+	float tExit = tMax;
+	for (unsigned int i=0; i<3; ++i) {
+		if (d[i] == 0.f) {
+			if (p1[i] < bmin[i] || p1[i] > bmax[i])
+				return false;
+			continue;
+		}
+		float t1 = (bmin[i] - p1[i])/d[i];
+		float t2 = (bmax[i] - p1[i])/d[i];
+		tEnter = std::max(tEnter, std::min(t1, t2));
+		tExit = std::min(tExit, std::max(t1, t2));
+		if (tEnter > tExit)
+			return false;
+	}
+	return true;
+}
+
+
+/*! Tests if the line p1 + t*d hits the triangle a, b, c (Moeller-Trumbore), both sides count as hit.
+	Returns true if intersection is found, and returns the normalized distance t.
+*/
+static bool intersectsTriangle(const VertexVNC & a, const VertexVNC & b, const VertexVNC & c,
+							   const QVector3D & p1, const QVector3D & d, float & dist)
+{
+	QVector3D va(a.x, a.y, a.z);
+	QVector3D e1 = QVector3D(b.x, b.y, b.z) - va;
+	QVector3D e2 = QVector3D(c.x, c.y, c.z) - va;
+	QVector3D pvec = QVector3D::crossProduct(d, e2);
+	float det = QVector3D::dotProduct(e1, pvec);
+	if (std::fabs(det) < std::numeric_limits<float>::min())
+		return false; // line parallel to triangle
+	float invDet = 1/det;
+	QVector3D tvec = p1 - va;
+	float u = QVector3D::dotProduct(tvec, pvec)*invDet;
+	if (u < 0 || u > 1)
+		return false;
+	QVector3D qvec = QVector3D::crossProduct(tvec, e1);
+	float v = QVector3D::dotProduct(d, qvec)*invDet;
+	if (v < 0 || u + v > 1)
+		return false;
+	float t = QVector3D::dotProduct(e2, qvec)*invDet;
+	if (t < 0 || t > 1)
+		return false;
+	dist = t;
+	return true;
+}
+
+
+MeshObject::MeshObject() :
+	m_indexCount(0),
+	m_resident(false),
+	m_arena(nullptr)
+{
+}
+
+
+bool MeshObject::load(const QString & fileName) {
+	if (!MeshImporter::import(fileName, QColor("#c0c0c8"), m_vertexBufferData, m_elementBufferData))
+		return false;
+	m_indexCount = m_elementBufferData.size();
+
+	// bounding boxes of consecutive triangles, computed in parallel
+	const unsigned int triangleCount = m_indexCount/3;
+	m_chunks.resize((triangleCount + TrianglesPerChunk - 1)/TrianglesPerChunk);
+	const VertexVNC * vertexData = m_vertexBufferData.data();
+	const GLuint * elementData = m_elementBufferData.data();
+	QtConcurrent::blockingMap(m_chunks, [&](GeometryCache::Chunk & c) {
+		unsigned int firstTriangle = unsigned(&c - m_chunks.data())*TrianglesPerChunk;
+		c.m_firstElement = 3*firstTriangle;
+		c.m_elementCount = 3*std::min(TrianglesPerChunk, triangleCount - firstTriangle);
+		float minCoords[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		float maxCoords[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+		for (const GLuint * e = elementData + c.m_firstElement; e != elementData + c.m_firstElement + c.m_elementCount; ++e) {
+			const VertexVNC & v = vertexData[*e];
+			minCoords[0] = std::min(minCoords[0], v.x);
+			minCoords[1] = std::min(minCoords[1], v.y);
+			minCoords[2] = std::min(minCoords[2], v.z);
+			maxCoords[0] = std::max(maxCoords[0], v.x);
+			maxCoords[1] = std::max(maxCoords[1], v.y);
+			maxCoords[2] = std::max(maxCoords[2], v.z);
+		}
+		std::copy(minCoords, minCoords + 3, c.m_min);
+		std::copy(maxCoords, maxCoords + 3, c.m_max);
+	});
+	return true;
+}
+
+
+void MeshObject::create(BufferArena & arena) {
+	createBuffers(arena);
+	upload();
+	makeResident();
+}
+
+
+void MeshObject::createBuffers(BufferArena & arena) {
+	m_arena = &arena;
+	m_allocation = arena.allocate("MeshObject", BufferArena::VNC,
+								  (unsigned int)m_vertexBufferData.size(), (unsigned int)m_elementBufferData.size());
+}
+
+
+void MeshObject::upload() {
+	QElapsedTimer timer;
+	timer.start();
+
+	qDebug() << "MeshObject - VertexBuffer size =" << m_vertexBufferData.size()*sizeof(VertexVNC)/1024.0 << "kByte";
+	m_arena->writeVertexes(m_allocation, 0, (unsigned int)m_vertexBufferData.size(), m_vertexBufferData.data());
+
+	qDebug() << "MeshObject - ElementBuffer size =" << m_elementBufferData.size()*sizeof(GLuint)/1024.0 << "kByte";
+	m_arena->writeElements(m_allocation, 0, (unsigned int)m_elementBufferData.size(), m_elementBufferData.data());
+
+	qDebug() << "MeshObject - buffers uploaded in" << timer.elapsed() << "ms";
+}
+
+
+void MeshObject::makeResident() {
+	m_arena->synchronize(m_allocation.m_format);
+	m_resident = true;
+}
+
+
+void MeshObject::destroy() {
+	if (m_arena != nullptr)
+		m_arena->free(m_allocation);
+	m_resident = false;
+}
+
+
+void MeshObject::render() {
+	m_arena->drawElements(m_allocation, GL_TRIANGLES, m_indexCount);
+}
+
+
+void MeshObject::pick(const QVector3D & p1, const QVector3D & d, PickObject & po) const {
+	const VertexVNC * vertexData = m_vertexBufferData.data();
+	const GLuint * elementData = m_elementBufferData.data();
+	for (const GeometryCache::Chunk & c : m_chunks) {
+		// skip chunks that are missed or lie completely behind the closest hit so far
+		if (!intersectsBox(c.m_min, c.m_max, p1, d, std::min(po.m_dist, 1.f)))
+			continue;
+		for (unsigned int i=c.m_firstElement; i<c.m_firstElement + c.m_elementCount; i += 3) {
+			float dist;
+			if (intersectsTriangle(vertexData[elementData[i]], vertexData[elementData[i+1]], vertexData[elementData[i+2]], p1, d, dist) &&
+				dist < po.m_dist)
+			{
+				po.m_dist = dist;
+				po.m_objectId = i/3;
+				po.m_faceId = 0;
+			}
+		}
+	}
+}
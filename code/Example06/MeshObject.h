@@ -0,0 +1,79 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef MESHOBJECT_H
+#define MESHOBJECT_H
+
+#include "BufferArena.h"
+#include "GeometryCache.h"
+#include "Vertex.h"
+
+struct PickObject;
+
+/*! A triangle mesh imported from an OBJ or PLY file (see MeshImporter).
+	Rendered with the same shader program as the boxes (VertexVNC layout), the buffer data is stored
+	in the same buffers of the arena (see BufferArena).
+*/
+class MeshObject {
+public:
+	MeshObject();
+
+	/*! Imports the mesh and computes the chunk table for picking, must be called before upload().
+		Returns false if the file cannot be imported.
+	*/
+	bool load(const QString & fileName);
+
+	/*! Returns true, if no mesh has been loaded. */
+	bool isEmpty() const { return m_elementBufferData.empty(); }
+
+	/*! The function is called during OpenGL initialization, where the OpenGL context is current.
+		Same as calling createBuffers(), upload() and makeResident().
+	*/
+	void create(BufferArena & arena);
+	/*! Allocates the vertex and element ranges in the arena, rendering context must be current. */
+	void createBuffers(BufferArena & arena);
+	/*! Uploads the buffer data, can be called in the asset loader thread (see BoxObject::upload()). */
+	void upload();
+	/*! Called after the upload has completed with the rendering context current (see BoxObject::makeResident()). */
+	void makeResident();
+	/*! Returns the ranges to the arena. */
+	void destroy();
+
+	void render();
+
+	/*! Thread-save pick function.
+		Checks if any triangle is hit by the ray defined by "p1 + d [0..1]" and stores the distance and
+		the triangle index (as object id) in po, if closer than the current hit.
+		Chunks whose bounding box is missed by the ray (or only behind the current hit) are skipped.
+	*/
+	void pick(const QVector3D & p1, const QVector3D & d, PickObject & po) const;
+
+	/*! Number of indexes to draw. */
+	unsigned int				m_indexCount;
+	/*! True, once the buffer data has been uploaded and can be drawn. */
+	bool						m_resident;
+	/*! Element ranges and bounding boxes of groups of TrianglesPerChunk triangles, used to accelerate picking. */
+	std::vector<GeometryCache::Chunk>	m_chunks;
+
+	/*! Number of consecutive triangles combined into one chunk. */
+	static const unsigned int	TrianglesPerChunk = 4096;
+
+	/*! Vertex and element data, kept after upload since it is needed for picking. */
+	std::vector<VertexVNC>		m_vertexBufferData;
+	std::vector<GLuint>			m_elementBufferData;
+
+	/*! The arena holding the buffers, set in createBuffers(). */
+	BufferArena					*m_arena;
+	/*! Vertex range (position, normal and color) and element range of the mesh. */
+	BufferArena::Allocation		m_allocation;
+};
+
+#endif // MESHOBJECT_H
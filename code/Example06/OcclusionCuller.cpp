@@ -0,0 +1,147 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "OcclusionCuller.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QDebug>
+
+#include "BufferArena.h"
+#include "Frustum.h"
+#include "GLStateCache.h"
+#include "ShaderProgram.h"
+
+#ifndef GL_ANY_SAMPLES_PASSED
+#define GL_ANY_SAMPLES_PASSED 0x8C2F
+#endif
+#ifndef GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+#define GL_ANY_SAMPLES_PASSED_CONSERVATIVE 0x8D6A
+#endif
+
+bool OcclusionCuller::m_enabled = true;
+
+/*! Chunks whose bounding box, enlarged by this distance, contains the camera are never culled. Must be larger
+	than the distance of the corners of the near plane to the camera.
+*/
+static const float NEAR_MARGIN = 1.f;
+
+
+OcclusionCuller::OcclusionCuller() :
+	m_queryTarget(GL_ANY_SAMPLES_PASSED)
+{
+}
+
+
+void OcclusionCuller::create() {
+	QOpenGLContext * ctx = QOpenGLContext::currentContext();
+	// the conservative query may count samples that fail the depth test, but is faster on some hardware
+	if (ctx->format().version() >= qMakePair(4,3) || ctx->hasExtension("GL_ARB_ES3_compatibility")) {
+		m_queryTarget = GL_ANY_SAMPLES_PASSED_CONSERVATIVE;
+		qDebug() << "OcclusionCuller - using GL_ANY_SAMPLES_PASSED_CONSERVATIVE queries";
+	}
+	else {
+		m_queryTarget = GL_ANY_SAMPLES_PASSED;
+		qDebug() << "OcclusionCuller - using GL_ANY_SAMPLES_PASSED queries";
+	}
+}
+
+
+void OcclusionCuller::destroy() {
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	for (ChunkQuery & q : m_queries) {
+		if (q.m_query != 0)
+			f->glDeleteQueries(1, &q.m_query);
+	}
+	m_queries.clear();
+}
+
+
+void OcclusionCuller::collectResults() {
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	for (ChunkQuery & q : m_queries) {
+		if (!q.m_pending)
+			continue;
+		GLuint available = 0;
+		f->glGetQueryObjectuiv(q.m_query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue; // keep the previous result, try again next frame
+		GLuint anySamplesPassed = 0;
+		f->glGetQueryObjectuiv(q.m_query, GL_QUERY_RESULT, &anySamplesPassed);
+		q.m_occluded = (anySamplesPassed == 0);
+		q.m_pending = false;
+	}
+}
+
+
+unsigned int OcclusionCuller::occludedCount() const {
+	unsigned int count = 0;
+	for (const ChunkQuery & q : m_queries)
+		if (q.m_occluded)
+			++count;
+	return count;
+}
+
+
+void OcclusionCuller::issueQueries(const std::vector<GeometryCache::Chunk> & chunks, const Frustum & frustum,
+								   const QMatrix4x4 & worldToView, ShaderProgram & proxyProgram,
+								   GLStateCache & stateCache, BufferArena & arena)
+{
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	if (m_queries.size() < chunks.size())
+		m_queries.resize(chunks.size());
+
+	// center of the near plane, close enough to the camera position
+	QVector4D nearCenter = worldToView.inverted()*QVector4D(0, 0, -1, 1);
+	const QVector3D eye = nearCenter.toVector3D()/nearCenter.w();
+
+	// only the depth test matters, the proxies must not change the frame; all faces are drawn, so that the
+	// winding of the proxy triangles does not matter
+	stateCache.colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	stateCache.depthMask(GL_FALSE);
+	stateCache.disable(GL_CULL_FACE);
+	arena.bind(BufferArena::VNC); // the proxies do not use vertex attributes, but a vertex array object must be bound
+
+	QOpenGLShaderProgram * program = proxyProgram.shaderProgram();
+	for (unsigned int i=0; i<chunks.size(); ++i) {
+		const GeometryCache::Chunk & c = chunks[i];
+		ChunkQuery & q = m_queries[i];
+		// chunks outside the frustum are not drawn anyway, and their old result is outdated when they return
+		if (c.m_min[0] > c.m_max[0] || !frustum.intersectsBox(c.m_min, c.m_max)) {
+			q.m_occluded = false;
+			continue;
+		}
+		if (eye.x() > c.m_min[0] - NEAR_MARGIN && eye.x() < c.m_max[0] + NEAR_MARGIN &&
+			eye.y() > c.m_min[1] - NEAR_MARGIN && eye.y() < c.m_max[1] + NEAR_MARGIN &&
+			eye.z() > c.m_min[2] - NEAR_MARGIN && eye.z() < c.m_max[2] + NEAR_MARGIN)
+		{
+			q.m_occluded = false;
+			continue;
+		}
+		if (q.m_pending)
+			continue;
+		if (q.m_query == 0)
+			f->glGenQueries(1, &q.m_query);
+		program->setUniformValue(proxyProgram.m_uniformIDs[1], QVector3D(c.m_min[0], c.m_min[1], c.m_min[2]));
+		program->setUniformValue(proxyProgram.m_uniformIDs[2], QVector3D(c.m_max[0], c.m_max[1], c.m_max[2]));
+		f->glBeginQuery(m_queryTarget, q.m_query);
+		f->glDrawArrays(GL_TRIANGLES, 0, 36);
+		f->glEndQuery(m_queryTarget);
+		q.m_pending = true;
+	}
+
+	stateCache.colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	stateCache.depthMask(GL_TRUE);
+	stateCache.enable(GL_CULL_FACE);
+}
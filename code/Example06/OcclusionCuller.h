@@ -0,0 +1,94 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <QtGui/qopengl.h>
+
+#include <vector>
+
+#include "GeometryCache.h"
+
+QT_BEGIN_NAMESPACE
+class QMatrix4x4;
+QT_END_NAMESPACE
+
+class BufferArena;
+class Frustum;
+class GLStateCache;
+class ShaderProgram;
+
+/*! Occlusion culling of box chunks with hardware occlusion queries.
+
+	After the opaque geometry has been drawn, the depth buffer holds all occluders of the frame. Then the
+	bounding boxes of all chunks in the view frustum are drawn with color and depth writes disabled, each
+	within an occlusion query (GL_ANY_SAMPLES_PASSED_CONSERVATIVE, or GL_ANY_SAMPLES_PASSED without
+	OpenGL 4.3). The results are collected at the beginning of one of the next frames, only if already
+	available, so the CPU never waits for the GPU. Chunks whose query found no visible sample are skipped
+	when drawing the boxes, until a later query finds them visible again.
+
+	Since results are one frame late, a chunk becoming visible (e.g. when walking around a corner) appears
+	one frame late. Chunks near the camera are never culled, since the near plane would clip their bounding box.
+
+	\code
+	// at the beginning of paintGL()
+	m_occlusionCuller.collectResults();
+	unsigned int elementCount = m_boxObject.cull(frustum, &m_occlusionCuller);
+	...
+	// after drawing the opaque geometry, with the proxy program bound
+	m_occlusionCuller.issueQueries(m_boxObject.m_chunks, frustum, worldToView, proxyProgram, m_glState, m_bufferArena);
+	\endcode
+*/
+class OcclusionCuller {
+public:
+	OcclusionCuller();
+
+	/*! Selects the query type supported by the current context. */
+	void create();
+	/*! Deletes all query objects, rendering context must be current. */
+	void destroy();
+
+	/*! Fetches the results of all queries that have completed meanwhile, does not wait for pending queries. */
+	void collectResults();
+	/*! Returns true, if the last query result of the chunk found it occluded. */
+	bool isOccluded(unsigned int chunkIdx) const {
+		return chunkIdx < m_queries.size() && m_queries[chunkIdx].m_occluded;
+	}
+	/*! Number of chunks currently considered occluded. */
+	unsigned int occludedCount() const;
+
+	/*! Issues a query for each chunk within the frustum that has no pending query by drawing its bounding box
+		with the proxy program (boundingBox.vert, uniforms worldToView, boxMin and boxMax), which must be bound.
+		Color and depth writes are disabled while drawing and restored afterwards.
+	*/
+	void issueQueries(const std::vector<GeometryCache::Chunk> & chunks, const Frustum & frustum,
+					  const QMatrix4x4 & worldToView, ShaderProgram & proxyProgram,
+					  GLStateCache & stateCache, BufferArena & arena);
+
+	/*! If false, no occlusion queries are issued (for comparison). */
+	static bool				m_enabled;
+
+private:
+	struct ChunkQuery {
+		GLuint		m_query = 0;
+		/*! True, while the result of the query has not been fetched. */
+		bool		m_pending = false;
+		/*! Result of the last completed query. */
+		bool		m_occluded = false;
+	};
+
+	std::vector<ChunkQuery>	m_queries;
+	/*! GL_ANY_SAMPLES_PASSED_CONSERVATIVE or GL_ANY_SAMPLES_PASSED. */
+	GLenum					m_queryTarget;
+};
+
+#endif // OCCLUSIONCULLER_H
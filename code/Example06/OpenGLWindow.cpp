@@ -15,20 +15,160 @@ Source code is based on Qt Example OpenGLWindow, but has been simplified a lot.
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
 
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLPaintDevice>
+#include <QtGui/QOpenGLFramebufferObject>
+#include <QtGui/QOffscreenSurface>
 #include <QtGui/QPainter>
 
+#include <iostream>
+
+#include "OpenGLException.h"
+
+bool OpenGLWindow::m_threadedRendering = false;
+
+
+/*! Thread, that owns the OpenGL context in threaded rendering mode and renders a frame whenever requested. */
+class OpenGLRenderThread : public QThread {
+public:
+	explicit OpenGLRenderThread(OpenGLWindow * window) :
+		m_window(window),
+		m_frameRequested(false),
+		m_stop(false)
+	{}
+
+	/*! Requests a frame, never blocks (requests are combined, if a frame is being rendered). */
+	void requestFrame() {
+		QMutexLocker lock(&m_mutex);
+		m_frameRequested = true;
+		m_condition.wakeOne();
+	}
+
+	/*! Finishes the current frame and ends the thread. */
+	void stop() {
+		{
+			QMutexLocker lock(&m_mutex);
+			m_stop = true;
+			m_condition.wakeOne();
+		}
+		wait();
+	}
+
+protected:
+	void run() override {
+		for (;;) {
+			{
+				QMutexLocker lock(&m_mutex);
+				while (!m_frameRequested && !m_stop)
+					m_condition.wait(&m_mutex);
+				if (m_stop)
+					break;
+				m_frameRequested = false;
+			}
+			m_window->renderThreadFrame();
+		}
+		// hand the context back to the GUI thread, so that resources can be released there
+		m_window->m_context->doneCurrent();
+		m_window->m_context->moveToThread(QCoreApplication::instance()->thread());
+	}
+
+private:
+	OpenGLWindow	*m_window;
+	QMutex			m_mutex;
+	QWaitCondition	m_condition;
+	bool			m_frameRequested;
+	bool			m_stop;
+};
+
+
 OpenGLWindow::OpenGLWindow(QWindow *parent) :
 	QWindow(parent),
 	m_context(nullptr),
-	m_debugLogger(nullptr)
+	m_debugLogger(nullptr),
+	m_offscreenSurface(nullptr),
+	m_offscreenFbo(nullptr),
+	m_renderThread(nullptr),
+	m_renderThreadInitialized(false)
 {
 	setSurfaceType(QWindow::OpenGLSurface);
 }
 
 
+OpenGLWindow::~OpenGLWindow() {
+	stopRenderThread();
+	// the framebuffer object must be released while the context is still alive and current
+	if (m_offscreenFbo != nullptr) {
+		makeCurrent();
+		delete m_offscreenFbo;
+		m_context->doneCurrent();
+	}
+	delete m_offscreenSurface;
+	// in threaded mode the context has no parent (objects with parent cannot be moved to another thread)
+	if (m_renderThread != nullptr) {
+		delete m_renderThread;
+		delete m_context;
+	}
+}
+
+
+void OpenGLWindow::initOffscreen(const QSize & size) {
+	Q_ASSERT(m_context == nullptr);
+
+	m_context = new QOpenGLContext(this);
+	m_context->setFormat(requestedFormat());
+	m_context->create();
+
+	m_offscreenSurface = new QOffscreenSurface;
+	m_offscreenSurface->setFormat(m_context->format());
+	m_offscreenSurface->create();
+
+	m_context->makeCurrent(m_offscreenSurface);
+	Q_ASSERT(m_context->isValid());
+
+	// render target with same multisampling and depth buffer setup as the on-screen window
+	QOpenGLFramebufferObjectFormat fboFormat;
+	fboFormat.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	fboFormat.setSamples(requestedFormat().samples());
+	m_offscreenFbo = new QOpenGLFramebufferObject(size, fboFormat);
+	m_offscreenFbo->bind();
+
+	// the window is never shown, so we only store the geometry (needed in paintGL() for the viewport)
+	resize(size);
+
+	initializeContext();
+	resizeGL(size.width(), size.height());
+}
+
+
+void OpenGLWindow::renderOffscreen() {
+	Q_ASSERT(m_offscreenFbo != nullptr);
+	makeCurrent();
+	m_offscreenFbo->bind();
+
+	prepareFrame();
+	paintGL(); // call user code
+	frameSwapped();
+}
+
+
+GLuint OpenGLWindow::defaultFramebufferObject() const {
+	if (m_offscreenFbo != nullptr)
+		return m_offscreenFbo->handle();
+	return m_context->defaultFramebufferObject();
+}
+
+
+bool OpenGLWindow::makeCurrent() {
+	if (m_offscreenSurface != nullptr)
+		return m_context->makeCurrent(m_offscreenSurface);
+	return m_context->makeCurrent(this);
+}
+
+
 void OpenGLWindow::renderLater() {
 	// Schedule an UpdateRequest event in the event loop
 	// that will be send with the next VSync.
@@ -37,18 +177,34 @@ void OpenGLWindow::renderLater() {
 
 
 void OpenGLWindow::renderNow() {
-	if (!isExposed())
+	if (!isExposed() || m_offscreenSurface != nullptr)
 		return;
 
 	// initialize on first call
 	if (m_context == nullptr)
 		initOpenGL();
 
+	prepareFrame();
+
+	if (m_renderThread != nullptr) {
+		m_renderThread->requestFrame();
+		return;
+	}
+
 	m_context->makeCurrent(this);
 
 	paintGL(); // call user code
 
 	m_context->swapBuffers(this);
+
+	frameSwapped();
+}
+
+
+void OpenGLWindow::stopRenderThread() {
+	if (m_renderThread == nullptr || !m_renderThread->isRunning())
+		return;
+	m_renderThread->stop();
 }
 
 
@@ -85,6 +241,10 @@ void OpenGLWindow::resizeEvent(QResizeEvent * event) {
 	if (m_context == nullptr)
 		initOpenGL();
 
+	// in offscreen mode, the framebuffer size is fixed
+	if (m_offscreenSurface != nullptr)
+		return;
+
 	resizeGL(width(), height());
 }
 
@@ -148,16 +308,48 @@ void OpenGLWindow::onMessageLogged(const QOpenGLDebugMessage &msg) {
 }
 
 
+void OpenGLWindow::onFrameSwapped() {
+	frameSwapped();
+}
+
+
+void OpenGLWindow::onRenderError() {
+	QCoreApplication::exit(1);
+}
+
+
 void OpenGLWindow::initOpenGL() {
 	Q_ASSERT(m_context == nullptr);
 
+	if (m_threadedRendering) {
+		if (QOpenGLContext::supportsThreadedOpenGL()) {
+			// the context is created here, but made current only in the render thread,
+			// which also calls initializeGL() before rendering the first frame
+			m_context = new QOpenGLContext;
+			m_context->setFormat(requestedFormat());
+			m_context->create();
+			contextCreated();
+			m_renderThread = new OpenGLRenderThread(this);
+			m_context->moveToThread(m_renderThread);
+			m_renderThread->start();
+			return;
+		}
+		qWarning() << "Threaded OpenGL not supported by platform, rendering in GUI thread.";
+	}
+
 	m_context = new QOpenGLContext(this);
 	m_context->setFormat(requestedFormat());
 	m_context->create();
+	contextCreated();
 
 	m_context->makeCurrent(this);
 	Q_ASSERT(m_context->isValid());
 
+	initializeContext();
+}
+
+
+void OpenGLWindow::initializeContext() {
 	initializeOpenGLFunctions();
 
 #ifdef GL_DEBUG
@@ -165,10 +357,14 @@ void OpenGLWindow::initOpenGL() {
 		qDebug() << "GL_KHR_debug extension available";
 	else
 		qWarning() << "GL_KHR_debug extension *not* available";
-	m_debugLogger = new QOpenGLDebugLogger(this);
+	// parent is the context, so that the logger lives in the same thread as the context
+	m_debugLogger = new QOpenGLDebugLogger(m_context);
 	if (m_debugLogger->initialize()) {
 		qDebug() << "Debug Logger initialized\n";
-		connect(m_debugLogger, SIGNAL(messageLogged(QOpenGLDebugMessage)), this, SLOT(onMessageLogged(QOpenGLDebugMessage)));
+		// with threaded rendering, messages are emitted in the render thread; they are only formatted and logged,
+		// so handle them right there instead of queuing them to the GUI thread
+		connect(m_debugLogger, &QOpenGLDebugLogger::messageLogged, this, &OpenGLWindow::onMessageLogged,
+				Qt::DirectConnection);
 		m_debugLogger->startLogging();
 	}
 	qDebug() << "DepthBufferSize = " << m_context->format().depthBufferSize();
@@ -176,3 +372,25 @@ void OpenGLWindow::initOpenGL() {
 
 	initializeGL(); // call user code
 }
+
+
+void OpenGLWindow::renderThreadFrame() {
+	m_context->makeCurrent(this);
+	try {
+		if (!m_renderThreadInitialized) {
+			m_renderThreadInitialized = true;
+			initializeContext();
+		}
+		paintGL(); // call user code
+	}
+	catch (OpenGLException & ex) {
+		// same handling as in DebugApplication::notify(), but the application must be stopped from the GUI thread
+		ex.writeMsgStackToStream(std::cerr);
+		QMetaObject::invokeMethod(this, "onRenderError", Qt::QueuedConnection);
+		return;
+	}
+	// may block until vsync, but only this thread
+	m_context->swapBuffers(this);
+
+	QMetaObject::invokeMethod(this, "onFrameSwapped", Qt::QueuedConnection);
+}
@@ -21,18 +21,54 @@ Source code is based on Qt Example OpenGLWindow, but has been simplified a lot.
 
 QT_BEGIN_NAMESPACE
 class QOpenGLContext;
-class QOpenGLContext;
+class QOffscreenSurface;
+class QOpenGLFramebufferObject;
 QT_END_NAMESPACE
 
+class OpenGLRenderThread;
+
 /*! The OpenGLWindow is very similar to QOpenGLWindow, yet a little more light-weight.
 	Also, the functions initializeGL() and paintGL() are protected, as they are in
 	the QOpenGLWidget. Thus, you can easily switch to an QOpenGLWidget class later on,
 	if you need it.
+
+	For headless rendering (benchmarks), the window can be initialized with initOffscreen()
+	instead of being shown. Then, all rendering goes into a framebuffer object attached to an
+	offscreen surface and frames are rendered by calling renderOffscreen(). Apart from the calls to
+	prepareFrame() and frameSwapped(), the offscreen code is the same as in Tutorial_11/OpenGLWindow, keep both
+	copies in sync.
+
+	Threaded rendering (see m_threadedRendering): the OpenGL context is moved to a dedicated render
+	thread, which calls initializeGL(), paintGL() and swapBuffers(). For each frame, prepareFrame() is
+	called on the GUI thread first, where derived classes process input and hand over the state needed for
+	rendering. The GUI thread never waits for the render thread: frame requests arriving while a frame
+	is being rendered are combined into one. After a frame has been swapped, frameSwapped() is called on
+	the GUI thread. In non-threaded mode the same functions are called in the same order on the GUI thread.
+	resizeGL() is always called on the GUI thread, so it must not issue OpenGL calls in threaded mode.
 */
 class OpenGLWindow : public QWindow, protected QOpenGLFunctions {
 	Q_OBJECT
 public:
 	explicit OpenGLWindow(QWindow *parent = nullptr);
+	virtual ~OpenGLWindow() override;
+
+	/*! Initializes OpenGL for rendering into an offscreen framebuffer of the given size, without
+		showing the window. Works also with QT_QPA_PLATFORM=offscreen.
+	*/
+	void initOffscreen(const QSize & size);
+
+	/*! Renders a frame into the offscreen framebuffer (requires a previous call to initOffscreen()). */
+	void renderOffscreen();
+
+	/*! Returns the framebuffer object that paintGL() renders into, i.e. the offscreen framebuffer or
+		the window's default framebuffer. Use this instead of 0 when restoring the framebuffer binding.
+	*/
+	GLuint defaultFramebufferObject() const;
+
+	/*! If true, windows created afterwards render in a dedicated render thread, if supported by the
+		platform (QOpenGLContext::supportsThreadedOpenGL()).
+	*/
+	static bool m_threadedRendering;
 
 public slots:
 	/*! Redirects to slot requestUpdate(), which registers an UpdateRequest event in the event loop
@@ -66,6 +102,28 @@ protected:
 	*/
 	virtual void paintGL() = 0;
 
+	/*! Called on the GUI thread after the context of an on-screen window was created, but before initializeGL()
+		(the context is not current). Re-implement to create objects, that must be created in the GUI thread,
+		for example offscreen surfaces for shared contexts.
+	*/
+	virtual void contextCreated() {}
+
+	/*! Called on the GUI thread before each frame is rendered. Re-implement to process input
+		and to hand over the data needed in paintGL() (which may run in the render thread).
+	*/
+	virtual void prepareFrame() {}
+
+	/*! Called on the GUI thread after a frame was rendered and swapped. */
+	virtual void frameSwapped() {}
+
+	/*! Stops the render thread (if running) and moves the context back to the GUI thread.
+		Must be called in destructors of derived classes before releasing OpenGL resources.
+	*/
+	void stopRenderThread();
+
+	/*! Makes the context current on either the window or the offscreen surface. */
+	bool makeCurrent();
+
 	QOpenGLContext		*m_context;
 
 private slots:
@@ -73,12 +131,37 @@ private slots:
 	/*! Receives debug messages from QOpenGLDebugLogger */
 	void onMessageLogged(const QOpenGLDebugMessage &msg);
 
+	/*! Called via queued connection from the render thread after a frame was swapped. */
+	void onFrameSwapped();
+
+	/*! Called via queued connection from the render thread when rendering failed, exits the application. */
+	void onRenderError();
+
 
 private:
 	/*! Helper function to initialize the OpenGL context. */
 	void initOpenGL();
+	/*! Helper function to initialize OpenGL functions and debug logger and to call initializeGL(),
+		the context must be current.
+	*/
+	void initializeContext();
+
+	/*! Renders a frame in the render thread (initializes OpenGL on first call). */
+	void renderThreadFrame();
+
+	friend class OpenGLRenderThread;
 
 	QOpenGLDebugLogger	*m_debugLogger;
+
+	/*! Surface used for headless rendering, nullptr when rendering into the window. */
+	QOffscreenSurface			*m_offscreenSurface;
+	/*! Framebuffer object used as render target for headless rendering. */
+	QOpenGLFramebufferObject	*m_offscreenFbo;
+
+	/*! Render thread, nullptr when rendering on the GUI thread. */
+	OpenGLRenderThread			*m_renderThread;
+	/*! Set in render thread after initializeGL() has been called. */
+	bool						m_renderThreadInitialized;
 };
 
 #endif // OpenGLWindow_H
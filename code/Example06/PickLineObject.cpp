@@ -11,59 +11,45 @@ License    : BSD License,
 
 #include "PickLineObject.h"
 
-#include <QOpenGLShaderProgram>
 #include <vector>
 
-void PickLineObject::create(QOpenGLShaderProgram * shaderProgramm) {
+void PickLineObject::create(BufferArena & arena) {
 	// create a temporary buffer that will contain the x-z coordinates of all grid lines
 	// we have 1 line, with two vertexes, with 2xthree floats (position and color)
 	m_vertexBufferData.resize(2);
 	m_vertexBufferData[0] = Vertex(QVector3D(5,5,5), Qt::white);
 	m_vertexBufferData[1] = Vertex(QVector3D(-5,-5,-5), Qt::red);
 
-	// Create Vertex Array Object
-	m_vao.create();		// create Vertex Array Object
-	m_vao.bind();		// and bind it
-
-	// Create Vertex Buffer Object
-	m_vbo.create();
-	m_vbo.bind();
-	m_vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	int vertexMemSize = m_vertexBufferData.size()*sizeof(Vertex);
-	m_vbo.allocate(m_vertexBufferData.data(), vertexMemSize);
-
-	// index 0 = position
-	shaderProgramm->enableAttributeArray(0); // array with index/id 0
-	shaderProgramm->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(Vertex));
-	// index 1 = color
-	shaderProgramm->enableAttributeArray(1); // array with index/id 1
-	shaderProgramm->setAttributeBuffer(1, GL_FLOAT, offsetof(Vertex, r), 3, sizeof(Vertex));
-
-	m_vao.release();
-	m_vbo.release();
+	// index 0 = position, index 1 = color
+	m_arena = &arena;
+	m_allocation = arena.allocate("PickLineObject", BufferArena::VC, m_vertexBufferData.size(), 0);
+	arena.writeVertexes(m_allocation, 0, m_vertexBufferData.size(), m_vertexBufferData.data());
 }
 
 
 void PickLineObject::destroy() {
-	m_vao.destroy();
-	m_vbo.destroy();
+	if (m_arena != nullptr)
+		m_arena->free(m_allocation);
 }
 
 
 void PickLineObject::render() {
-	m_vao.bind();
-	glDrawArrays(GL_LINES, 0, m_vertexBufferData.size());
-	m_vao.release();
+	m_arena->drawArrays(m_allocation, GL_LINES);
 }
 
 
 void PickLineObject::setPoints(const QVector3D & a, const QVector3D & b) {
 	m_vertexBufferData[0] = Vertex(a, Qt::white);
 	m_vertexBufferData[1] = Vertex(b, QColor(64,0,0));
-	int vertexMemSize = m_vertexBufferData.size()*sizeof(Vertex);
-	m_vbo.bind();
-	m_vbo.allocate(m_vertexBufferData.data(), vertexMemSize);
-	m_vbo.release();
+	// the line keeps its range, only the data is replaced
+	m_arena->writeVertexes(m_allocation, 0, m_vertexBufferData.size(), m_vertexBufferData.data());
 	m_visible = true;
 }
 
+
+QVector3D PickLineObject::center() const {
+	const Vertex & a = m_vertexBufferData[0];
+	const Vertex & b = m_vertexBufferData[1];
+	return QVector3D(0.5f*(a.x + b.x), 0.5f*(a.y + b.y), 0.5f*(a.z + b.z));
+}
+
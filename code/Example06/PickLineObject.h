@@ -12,29 +12,24 @@ License    : BSD License,
 #ifndef PICKLINEOBJECT_H
 #define PICKLINEOBJECT_H
 
-#include <QOpenGLBuffer>
-#include <QOpenGLVertexArrayObject>
-
-QT_BEGIN_NAMESPACE
-class QOpenGLShaderProgram;
-QT_END_NAMESPACE
-
-
+#include "BufferArena.h"
 #include "Vertex.h"
 
-/*! For drawing a simple line. */
+/*! For drawing a simple line, stored in the VC buffer of the arena (see BufferArena). */
 class PickLineObject {
 public:
-	void create(QOpenGLShaderProgram * shaderProgramm);
+	void create(BufferArena & arena);
 	void destroy();
 	void render();
 
 	void setPoints(const QVector3D & a, const QVector3D & b);
+	/*! Center of the line, set in setPoints(). */
+	QVector3D center() const;
 
 	bool						m_visible = false;
 	std::vector<Vertex>			m_vertexBufferData;
-	QOpenGLVertexArrayObject	m_vao;
-	QOpenGLBuffer				m_vbo;
+	BufferArena					*m_arena = nullptr;
+	BufferArena::Allocation		m_allocation;
 };
 
 #endif // PICKLINEOBJECT_H
@@ -45,6 +45,13 @@ public:
 					GLuint * & elementBuffer,
 					unsigned int & elementStartIndex) const;
 
+	const QVector3D & a() const { return m_a; }
+	const QVector3D & b() const { return m_b; }
+	const QVector3D & d() const { return m_d; }
+	const QColor & color() const { return m_color; }
+	/*! Center of the plane (the fourth corner is b + d - a). */
+	QVector3D center() const { return 0.5f*(m_b + m_d); }
+
 	static const unsigned int VertexCount = 4;
 	static const unsigned int IndexCount = 6;
 
@@ -12,13 +12,16 @@ License    : BSD License,
 #include "PlaneObject.h"
 
 #include <QVector3D>
-#include <QOpenGLShaderProgram>
-#include <QElapsedTimer>
+#include <QDebug>
+
+#include "SceneFile.h"
 
 
 PlaneObject::PlaneObject() :
-	m_vbo(QOpenGLBuffer::VertexBuffer), // actually the default, so default constructor would have been enough
-	m_ebo(QOpenGLBuffer::IndexBuffer) // make this an Index Buffer
+	m_releaseBufferData(false),
+	m_indexCount(0),
+	m_resident(false),
+	m_arena(nullptr)
 {
 
 #if 0
@@ -59,7 +62,30 @@ PlaneObject::PlaneObject() :
 
 		m_planes.push_back( PlaneMesh(a,b,d, col));
 	}
+}
+
+
+void PlaneObject::loadScene(const SceneFile & scene) {
+	scene.readPlanes(m_planes);
+}
+
 
+void PlaneObject::create(BufferArena & arena) {
+	createBuffers(arena);
+	upload();
+	makeResident();
+}
+
+
+void PlaneObject::createBuffers(BufferArena & arena) {
+	unsigned int N = m_planes.size();
+	m_arena = &arena;
+	m_allocation = arena.allocate("PlaneObject", BufferArena::VCA, N*PlaneMesh::VertexCount, N*PlaneMesh::IndexCount);
+}
+
+
+void PlaneObject::upload() {
+	// buffer data is generated here and not in the constructor, since it may be released after upload
 	unsigned int N = m_planes.size();
 
 	// resize storage arrays
@@ -72,62 +98,44 @@ PlaneObject::PlaneObject() :
 	GLuint * elementBuffer = m_elementBufferData.data();
 	for (const PlaneMesh & p : m_planes)
 		p.copy2Buffer(vertexBuffer, elementBuffer, vertexCount);
-}
-
+	m_indexCount = m_elementBufferData.size();
 
-void PlaneObject::create(QOpenGLShaderProgram * shaderProgramm) {
-	// create and bind Vertex Array Object
-	m_vao.create();
-	m_vao.bind();
-
-	// create and bind vertex buffer
-	m_vbo.create();
-	m_vbo.bind();
-	m_vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+	// see BoxObject::upload()
 	int vertexMemSize = m_vertexBufferData.size()*sizeof(VertexVCA);
 	qDebug() << "PlaneObject - VertexBuffer size =" << vertexMemSize/1024.0 << "kByte";
-	m_vbo.allocate(m_vertexBufferData.data(), vertexMemSize);
+	m_arena->writeVertexes(m_allocation, 0, (unsigned int)m_vertexBufferData.size(), m_vertexBufferData.data());
 
-	// create and bind element buffer
-	m_ebo.create();
-	m_ebo.bind();
-	m_ebo.setUsagePattern(QOpenGLBuffer::StaticDraw);
 	int elementMemSize = m_elementBufferData.size()*sizeof(GLuint);
 	qDebug() << "PlaneObject - ElementBuffer size =" << elementMemSize/1024.0 << "kByte";
-	m_ebo.allocate(m_elementBufferData.data(), elementMemSize);
-
-	// set shader attributes
-	// tell shader program we have two data arrays to be used as input to the shaders
-
-	// index 0 = position
-	shaderProgramm->enableAttributeArray(0); // array with index/id 0
-	shaderProgramm->setAttributeBuffer(0, GL_FLOAT, 0, 4, sizeof(VertexVCA));
-	// index 1 = color
-	shaderProgramm->enableAttributeArray(1); // array with index/id 1
-	shaderProgramm->setAttributeBuffer(1, GL_FLOAT, offsetof(VertexVCA, r), 4, sizeof(VertexVCA));
-
-	// Release (unbind) all
-	m_vao.release();
-	m_vbo.release();
-	m_ebo.release();
+	m_arena->writeElements(m_allocation, 0, (unsigned int)m_elementBufferData.size(), m_elementBufferData.data());
+
+	if (m_releaseBufferData) {
+		// swap with empty vectors, since clear() would keep the memory allocated
+		std::vector<VertexVCA>().swap(m_vertexBufferData);
+		std::vector<GLuint>().swap(m_elementBufferData);
+	}
+}
+
+
+void PlaneObject::makeResident() {
+	m_arena->synchronize(m_allocation.m_format);
+	m_resident = true;
 }
 
 
 void PlaneObject::destroy() {
-	m_vao.destroy();
-	m_vbo.destroy();
-	m_ebo.destroy();
+	if (m_arena != nullptr)
+		m_arena->free(m_allocation);
+	m_resident = false;
 }
 
 
 void PlaneObject::render() {
-	// set the geometry ("position", "normal" and "color" arrays)
-	m_vao.bind();
-
-	// now draw the cube by drawing individual triangles
-	// - GL_TRIANGLES - draw individual triangles via elements
-	glDrawElements(GL_TRIANGLES, m_elementBufferData.size(), GL_UNSIGNED_INT, nullptr);
-	// release vertices again
-	m_vao.release();
+	// draw the planes by drawing individual triangles via elements
+	m_arena->drawElements(m_allocation, GL_TRIANGLES, m_indexCount);
 }
 
+
+void PlaneObject::renderPlane(unsigned int i) {
+	m_arena->drawElements(m_allocation, GL_TRIANGLES, PlaneMesh::IndexCount, i*PlaneMesh::IndexCount);
+}
@@ -12,39 +12,49 @@ License    : BSD License,
 #ifndef PlaneObjectH
 #define PlaneObjectH
 
-#include <QOpenGLBuffer>
-#include <QOpenGLVertexArrayObject>
-
-QT_BEGIN_NAMESPACE
-class QOpenGLShaderProgram;
-QT_END_NAMESPACE
-
+#include "BufferArena.h"
 #include "PlaneMesh.h"
 
-/*! A container for transparent planes.
+class SceneFile;
+
+/*! A container for transparent planes, stored in the VCA buffers of the arena (see BufferArena).
 */
 class PlaneObject {
 public:
 	PlaneObject();
 
-	/*! The function is called during OpenGL initialization, where the OpenGL context is current. */
-	void create(QOpenGLShaderProgram * shaderProgramm);
+	/*! Replaces all planes with those of a scene file, must be called before upload(). */
+	void loadScene(const SceneFile & scene);
+
+	/*! The function is called during OpenGL initialization, where the OpenGL context is current.
+		Same as calling createBuffers(), upload() and makeResident() (see BoxObject).
+	*/
+	void create(BufferArena & arena);
+	void createBuffers(BufferArena & arena);
+	void upload();
+	void makeResident();
 	void destroy();
 
 	void render();
+	/*! Draws only plane i, used to draw the transparent planes sorted back-to-front. */
+	void renderPlane(unsigned int i);
 
 	std::vector<PlaneMesh>		m_planes;
 
+	/*! If true, m_vertexBufferData and m_elementBufferData are released after upload in create(). */
+	bool						m_releaseBufferData;
+	/*! Number of indexes to draw, kept when buffer data is released. */
+	unsigned int				m_indexCount;
+	/*! True, once the buffer data has been uploaded and can be drawn. */
+	bool						m_resident;
+
 	std::vector<VertexVCA>		m_vertexBufferData;
 	std::vector<GLuint>			m_elementBufferData;
 
-	/*! Wraps an OpenGL VertexArrayObject, that references the vertex coordinates and color buffers. */
-	QOpenGLVertexArrayObject	m_vao;
-
-	/*! Holds position and colors in a single buffer. */
-	QOpenGLBuffer				m_vbo;
-	/*! Holds elements. */
-	QOpenGLBuffer				m_ebo;
+	/*! The arena holding the buffers, set in createBuffers(). */
+	BufferArena					*m_arena;
+	/*! Vertex range (position and colors) and element range of all planes. */
+	BufferArena::Allocation		m_allocation;
 };
 
 #endif // PlaneObjectH
@@ -0,0 +1,219 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "RenderQueue.h"
+
+#include <QMatrix4x4>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QVector3D>
+#include <QVector4D>
+
+#include <algorithm>
+
+#include "GLStateCache.h"
+
+const unsigned int RenderQueue::MaxShaders;
+const unsigned int RenderQueue::MaxTextures;
+
+/*! Sorts the (key, index) pairs by key with a stable LSD radix sort, one byte per pass.
+	Bytes that are equal in all keys are skipped, so typically only the few bytes holding pass, shader
+	and depth are processed. tmp is used as scratch buffer.
+*/
+static void radixSort(std::vector<std::pair<quint64, unsigned int> > & keys, std::vector<std::pair<quint64, unsigned int> > & tmp) {
+	if (keys.size() < 2)
+		return;
+	tmp.resize(keys.size());
+	for (unsigned int shift = 0; shift < 64; shift += 8) {
+		unsigned int counts[256] = {};
+		for (const std::pair<quint64, unsigned int> & k : keys)
+			++counts[(k.first >> shift) & 0xff];
+		// all keys in one bucket -> this byte does not change the order
+		if (counts[(keys[0].first >> shift) & 0xff] == keys.size())
+			continue;
+		unsigned int offset = 0;
+		for (unsigned int & c : counts) {
+			unsigned int n = c;
+			c = offset;
+			offset += n;
+		}
+		for (const std::pair<quint64, unsigned int> & k : keys)
+			tmp[counts[(k.first >> shift) & 0xff]++] = k;
+		keys.swap(tmp);
+	}
+}
+
+
+RenderQueue::RenderQueue(BufferArena & arena, GLStateCache & stateCache) :
+	m_arena(arena),
+	m_stateCache(stateCache),
+	m_shaders(MaxShaders),
+	m_textures(1, nullptr)
+{
+	clear();
+}
+
+
+quint64 RenderQueue::sortKey(Pass pass, unsigned int shaderId, unsigned int textureId,
+							 BufferArena::VertexFormat format, float depth)
+{
+	Q_ASSERT(shaderId < MaxShaders && textureId < MaxTextures);
+	depth = std::min(std::max(depth, 0.f), 1.f);
+	// opaque geometry is drawn front-to-back (early depth test), transparent geometry back-to-front
+	if (statePass(pass) == TransparentPass)
+		depth = 1.f - depth;
+	quint64 depthBits = quint64(depth*0xffffff);
+	return (quint64(pass) << 60) | (quint64(shaderId) << 54) | (quint64(textureId) << 44) |
+			(quint64(format) << 40) | (depthBits << 16);
+}
+
+
+float RenderQueue::viewDepth(const QMatrix4x4 & worldToView, const QVector3D & p) {
+	QVector4D clip = worldToView * QVector4D(p, 1.f);
+	if (clip.w() <= 0.f)
+		return 0.f;
+	// normalized device z [-1..1], monotonic in the distance to the camera
+	return 0.5f*clip.z()/clip.w() + 0.5f;
+}
+
+
+void RenderQueue::setShader(unsigned int shaderId, QOpenGLShaderProgram * program,
+							const std::function<void(QOpenGLShaderProgram*)> & setup)
+{
+	Q_ASSERT(shaderId < MaxShaders);
+	m_shaders[shaderId].m_program = program;
+	m_shaders[shaderId].m_setup = setup;
+}
+
+
+void RenderQueue::setTexture(unsigned int textureId, QOpenGLTexture * texture) {
+	Q_ASSERT(textureId > 0 && textureId < MaxTextures);
+	if (m_textures.size() <= textureId)
+		m_textures.resize(textureId + 1, nullptr);
+	m_textures[textureId] = texture;
+}
+
+
+void RenderQueue::clear() {
+	m_items.clear();
+	m_keys.clear();
+	m_counters = Counters();
+	m_currentPass = NUM_PASSES;
+	m_currentShader = MaxShaders;
+	m_currentTexture = MaxTextures;
+	m_currentFormat = BufferArena::NUM_VF;
+}
+
+
+void RenderQueue::submit(quint64 key, const std::function<void()> & draw, unsigned int triangles) {
+	m_keys.push_back(std::make_pair(key, (unsigned int)m_items.size()));
+	DrawItem item;
+	item.m_draw = draw;
+	item.m_triangles = triangles;
+	m_items.push_back(item);
+}
+
+
+void RenderQueue::sort() {
+	radixSort(m_keys, m_sortBuffer);
+}
+
+
+void RenderQueue::execute(Pass pass) {
+	for (const std::pair<quint64, unsigned int> & k : m_keys) {
+		if (Pass(k.first >> 60) != pass)
+			continue;
+		const unsigned int shaderId = (k.first >> 54) & 0x3f;
+		const unsigned int textureId = (k.first >> 44) & 0x3ff;
+		const unsigned int format = (k.first >> 40) & 0xf;
+
+		// the state is applied once per pass; transparent and overlay pass share the same render state
+		if (m_currentPass != pass) {
+			if (m_currentPass == NUM_PASSES || statePass(Pass(m_currentPass)) != statePass(pass)) {
+				applyPassState(pass);
+				++m_counters.m_stateChanges;
+			}
+			else
+				++m_counters.m_stateChangesAvoided;
+			m_currentPass = pass;
+		}
+
+		if (m_currentShader != shaderId) {
+			ShaderSlot & s = m_shaders[shaderId];
+			Q_ASSERT(s.m_program != nullptr);
+			// same as s.m_program->bind(), but not issued if still bound from the previous frame
+			m_stateCache.useProgram(s.m_program->programId());
+			if (s.m_setup)
+				s.m_setup(s.m_program);
+			m_currentShader = shaderId;
+			++m_counters.m_shaderBinds;
+		}
+		else
+			++m_counters.m_shaderBindsAvoided;
+
+		if (m_currentTexture != textureId) {
+			// items without texture leave the previous texture bound, it is simply not sampled
+			if (textureId != 0) {
+				m_stateCache.bindTexture2D(0, m_textures[textureId]->textureId());
+				++m_counters.m_textureBinds;
+				m_currentTexture = textureId;
+			}
+		}
+		else if (textureId != 0)
+			++m_counters.m_textureBindsAvoided;
+
+		if (m_currentFormat != format) {
+			m_arena.bind(BufferArena::VertexFormat(format));
+			m_currentFormat = format;
+			++m_counters.m_vertexArrayBinds;
+		}
+		else
+			++m_counters.m_vertexArrayBindsAvoided;
+
+		const DrawItem & item = m_items[k.second];
+		item.m_draw();
+		++m_counters.m_drawItems;
+		m_counters.m_triangles += item.m_triangles;
+	}
+}
+
+
+void RenderQueue::applyPassState(Pass pass) {
+	switch (statePass(pass)) {
+		case DepthPrepass :
+			// only update the z-buffer
+			m_stateCache.enable(GL_CULL_FACE);
+			m_stateCache.depthMask(GL_TRUE);
+			m_stateCache.depthFunc(GL_LESS);
+			m_stateCache.colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			break;
+		case DepthEqualPass :
+			// shade only fragments whose depth was written in the prepass, the z-buffer is already complete
+			m_stateCache.enable(GL_CULL_FACE);
+			m_stateCache.depthMask(GL_FALSE);
+			m_stateCache.depthFunc(GL_EQUAL);
+			m_stateCache.colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			break;
+		case OpaquePass :
+			// show only faces whose normal vector points towards us and update the z-buffer
+			m_stateCache.enable(GL_CULL_FACE);
+			m_stateCache.depthMask(GL_TRUE);
+			m_stateCache.depthFunc(GL_LESS);
+			m_stateCache.colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			break;
+		default :
+			// show all planes, and use the depth test without updating the z-buffer
+			m_stateCache.disable(GL_CULL_FACE);
+			m_stateCache.depthMask(GL_FALSE);
+			m_stateCache.depthFunc(GL_LESS);
+			m_stateCache.colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}
+}
@@ -0,0 +1,174 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <QtGlobal>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+class QMatrix4x4;
+class QOpenGLShaderProgram;
+class QOpenGLTexture;
+class QVector3D;
+QT_END_NAMESPACE
+
+#include "BufferArena.h"
+
+class GLStateCache;
+
+/*! Collects the draw items of a frame, sorts them by state and executes them with a minimum of state changes.
+
+	Each draw item has a 64-bit sort key, packed from (most significant first):
+
+	\code
+	bits 60..63  pass           render state (face culling, depth writes and test, color writes) and order of passes
+	bits 54..59  shader id      as registered with setShader(), defines the order within a pass
+	bits 44..53  texture id     as registered with setTexture(), 0 = no texture
+	bits 40..43  vertex format  selects the vertex array object of the buffer arena
+	bits 16..39  depth          front-to-back in opaque passes, back-to-front in transparent passes
+	bits  0..15  reserved
+	\endcode
+
+	Sorting by key groups all items sharing pass, shader, texture and vertex array object, so adding
+	object types does not multiply state switches. The keys are sorted with a (stable) LSD radix sort, byte
+	positions where all keys are equal are skipped. When executing, a state is only changed if it differs
+	from the state of the previous item; issued and avoided changes are counted per frame. State changes
+	go through the GLStateCache, so state left over from the previous frame is not set again.
+
+	Uniforms that are the same for all items of a shader (e.g. the world to view matrix) are set in the
+	setup function passed to setShader(), which is called right after the program was bound. Per-item
+	uniforms are set in the draw function of the item.
+
+	\code
+	m_renderQueue.clear();
+	m_renderQueue.setShader(0, SHADER(2), [&](QOpenGLShaderProgram * p){ p->setUniformValue(...); });
+	m_renderQueue.submit(RenderQueue::sortKey(RenderQueue::OpaquePass, 0, 0, BufferArena::VNC,
+											  RenderQueue::viewDepth(worldToView, boxCenter)),
+						 [this](){ m_boxObject.render(); }, m_boxObject.m_indexCount/3);
+	m_renderQueue.sort();
+	m_renderQueue.execute(RenderQueue::OpaquePass);
+	\endcode
+*/
+class RenderQueue {
+public:
+	/*! Render passes, executed in this order. */
+	enum Pass {
+		/*! Depth-only prepass: back faces culled, depth writes enabled, color writes disabled. */
+		DepthPrepass,
+		/*! Opaque geometry already drawn in the DepthPrepass: back faces culled, depth test GL_EQUAL without
+			depth writes, so that only the visible fragments are shaded.
+		*/
+		DepthEqualPass,
+		/*! Opaque geometry and lines: back faces culled, depth writes enabled. */
+		OpaquePass,
+		/*! Transparent geometry: all faces drawn, depth test without depth writes, sorted back-to-front. */
+		TransparentPass,
+		/*! Like TransparentPass, but drawn on top of all transparent geometry (texts). */
+		OverlayPass,
+		NUM_PASSES
+	};
+
+	/*! Per-frame counters, reset in clear(). */
+	struct Counters {
+		unsigned int	m_drawItems = 0;
+		unsigned int	m_triangles = 0;
+		unsigned int	m_shaderBinds = 0;
+		unsigned int	m_shaderBindsAvoided = 0;
+		unsigned int	m_textureBinds = 0;
+		unsigned int	m_textureBindsAvoided = 0;
+		unsigned int	m_vertexArrayBinds = 0;
+		unsigned int	m_vertexArrayBindsAvoided = 0;
+		/*! Changes of the pass render state. */
+		unsigned int	m_stateChanges = 0;
+		/*! Pass changes that did not need a state change (passes sharing the render state). */
+		unsigned int	m_stateChangesAvoided = 0;
+	};
+
+	/*! Maximum number of shader ids (6 bits). */
+	static const unsigned int	MaxShaders = 64;
+	/*! Maximum number of texture ids (10 bits), id 0 means no texture. */
+	static const unsigned int	MaxTextures = 1024;
+
+	RenderQueue(BufferArena & arena, GLStateCache & stateCache);
+
+	/*! Packs a sort key. depth is the normalized distance to the camera [0..1], values outside are clamped.
+		Items of the transparent and overlay passes are sorted back-to-front, all others front-to-back.
+	*/
+	static quint64 sortKey(Pass pass, unsigned int shaderId, unsigned int textureId,
+						   BufferArena::VertexFormat format, float depth);
+	/*! Returns the normalized depth [0..1] of a point (usually the center of the bounds of an item) for sortKey(),
+		points behind the camera get depth 0.
+	*/
+	static float viewDepth(const QMatrix4x4 & worldToView, const QVector3D & p);
+
+	/*! Registers the shader program for shaderId. setup is called whenever the program has been bound. */
+	void setShader(unsigned int shaderId, QOpenGLShaderProgram * program,
+				   const std::function<void(QOpenGLShaderProgram*)> & setup = std::function<void(QOpenGLShaderProgram*)>());
+	/*! Registers a texture for textureId (> 0), which is bound to texture unit 0. */
+	void setTexture(unsigned int textureId, QOpenGLTexture * texture);
+
+	/*! Removes all draw items, resets the counters and forgets the current OpenGL state. Call at the
+		beginning of each frame (registered shaders and textures are kept).
+	*/
+	void clear();
+	/*! Adds a draw item, draw issues the draw call (and sets per-item uniforms). triangles is only counted. */
+	void submit(quint64 key, const std::function<void()> & draw, unsigned int triangles = 0);
+	/*! Sorts all submitted items by key. */
+	void sort();
+	/*! Executes all items of the pass (call sort() first). Shader program and texture of the last item
+		stay bound, so the next frame need not bind them again if unchanged.
+	*/
+	void execute(Pass pass);
+
+	/*! Counters of the current frame. */
+	const Counters & counters() const { return m_counters; }
+
+private:
+	struct DrawItem {
+		std::function<void()>	m_draw;
+		unsigned int			m_triangles;
+	};
+	struct ShaderSlot {
+		QOpenGLShaderProgram							*m_program = nullptr;
+		std::function<void(QOpenGLShaderProgram*)>		m_setup;
+	};
+
+	/*! Applies face culling, depth and color writes and depth function of the pass. */
+	void applyPassState(Pass pass);
+	/*! Returns the pass whose render state is used by the pass (transparent and overlay pass share the state). */
+	static Pass statePass(Pass pass) { return pass == OverlayPass ? TransparentPass : pass; }
+
+	BufferArena							&m_arena;
+	GLStateCache						&m_stateCache;
+	std::vector<DrawItem>				m_items;
+	/*! (key, item index) pairs, sorted in sort(). */
+	std::vector<std::pair<quint64, unsigned int> >	m_keys;
+	/*! Scratch buffer for the radix sort. */
+	std::vector<std::pair<quint64, unsigned int> >	m_sortBuffer;
+
+	std::vector<ShaderSlot>				m_shaders;
+	std::vector<QOpenGLTexture*>		m_textures;
+
+	/*! Currently applied state, values out of range mean unknown. */
+	unsigned int						m_currentPass;
+	unsigned int						m_currentShader;
+	unsigned int						m_currentTexture;
+	unsigned int						m_currentFormat;
+
+	Counters							m_counters;
+};
+
+#endif // RENDERQUEUE_H
@@ -0,0 +1,301 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "SceneFile.h"
+
+#include <QByteArray>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+#include "BoxStore.h"
+#include "PlaneMesh.h"
+
+static const char SCENE_MAGIC[8] = {'E', '0', '6', 'S', 'C', 'E', 'N', 'E'};
+
+/*! Alignment of section data in the file. */
+static const quint64 SECTION_ALIGNMENT = 64;
+
+namespace {
+
+struct Header {
+	char		m_magic[8];
+	quint32		m_version;
+	quint32		m_sectionCount;
+	quint64		m_boxCount;
+	quint64		m_paletteCount;
+	quint64		m_planeCount;
+	quint64		m_reserved[3];
+};
+
+struct SectionEntry {
+	quint32		m_id;
+	quint32		m_elementSize;
+	quint64		m_offset;
+	quint64		m_size;
+};
+
+} // namespace
+
+static_assert(sizeof(Header) == 64, "Unexpected padding in scene file header");
+static_assert(sizeof(SectionEntry) == 24, "Unexpected padding in scene file section entry");
+static_assert(sizeof(SceneFile::PlaneRecord) == 40, "Unexpected padding in scene file plane record");
+static_assert(sizeof(BoxStore::Palette) == 72, "Unexpected padding in box palette");
+
+
+/*! Element size of each section. */
+static quint32 elementSize(unsigned int sectionId) {
+	switch (sectionId) {
+		case SceneFile::SectionPaletteIndex	: return sizeof(quint16);
+		case SceneFile::SectionPalettes		: return sizeof(BoxStore::Palette);
+		case SceneFile::SectionPlanes		: return sizeof(SceneFile::PlaneRecord);
+		default								: return sizeof(float);
+	}
+}
+
+
+SceneFile::SceneFile() :
+	m_data(nullptr),
+	m_boxCount(0),
+	m_paletteCount(0),
+	m_planeCount(0)
+{
+	std::fill(m_sections, m_sections + NUM_SECTIONS, nullptr);
+}
+
+
+SceneFile::~SceneFile() {
+	close();
+}
+
+
+bool SceneFile::open(const QString & fileName) {
+	close();
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+	qWarning() << "Scene files cannot be read on big-endian hosts" << fileName;
+	return false;
+#else
+	QElapsedTimer timer;
+	timer.start();
+	m_file.setFileName(fileName);
+	if (!m_file.open(QIODevice::ReadOnly)) {
+		qWarning() << "Cannot open scene file" << fileName;
+		return false;
+	}
+	quint64 fileSize = (quint64)m_file.size();
+	if (fileSize >= sizeof(Header))
+		m_data = m_file.map(0, (qint64)fileSize);
+	if (m_data == nullptr) {
+		qWarning() << "Cannot map scene file" << fileName;
+		close();
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, m_data, sizeof(Header));
+	if (std::memcmp(header.m_magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0 || header.m_version != Version ||
+		fileSize < sizeof(Header) + quint64(header.m_sectionCount)*sizeof(SectionEntry))
+	{
+		qWarning() << "Invalid scene file or unsupported version" << fileName;
+		close();
+		return false;
+	}
+	// element indexes are 32 bit
+	if (header.m_boxCount > 0xFFFFFFFFull/BoxStore::VertexCount || header.m_planeCount > 0xFFFFFFFFull/PlaneMesh::VertexCount ||
+		header.m_paletteCount > 0xFFFF)
+	{
+		qWarning() << "Scene file exceeds supported number of boxes, palettes or planes" << fileName;
+		close();
+		return false;
+	}
+	m_boxCount = header.m_boxCount;
+	m_paletteCount = header.m_paletteCount;
+	m_planeCount = header.m_planeCount;
+
+	for (unsigned int i=0; i<header.m_sectionCount; ++i) {
+		SectionEntry entry;
+		std::memcpy(&entry, m_data + sizeof(Header) + i*sizeof(SectionEntry), sizeof(SectionEntry));
+		// skip sections added in later versions
+		if (entry.m_id >= NUM_SECTIONS)
+			continue;
+		quint64 count = m_boxCount;
+		if (entry.m_id == SectionPalettes)
+			count = m_paletteCount;
+		else if (entry.m_id == SectionPlanes)
+			count = m_planeCount;
+		if (entry.m_elementSize != elementSize(entry.m_id) ||
+			entry.m_size % entry.m_elementSize != 0 || entry.m_size/entry.m_elementSize != count ||
+			entry.m_offset % sizeof(float) != 0 || entry.m_offset > fileSize || entry.m_size > fileSize - entry.m_offset)
+		{
+			qWarning() << "Invalid section" << entry.m_id << "in scene file" << fileName;
+			close();
+			return false;
+		}
+		m_sections[entry.m_id] = m_data + entry.m_offset;
+	}
+
+	for (unsigned int i=0; i<NUM_SECTIONS; ++i) {
+		quint64 count = m_boxCount;
+		if (i == SectionPalettes)
+			count = m_paletteCount;
+		else if (i == SectionPlanes)
+			count = m_planeCount;
+		if (count != 0 && m_sections[i] == nullptr) {
+			qWarning() << "Missing section" << i << "in scene file" << fileName;
+			close();
+			return false;
+		}
+	}
+
+	// palette indexes are the only references within the file, check them once here
+	const quint16 * paletteIdx = reinterpret_cast<const quint16*>(m_sections[SectionPaletteIndex]);
+	if (m_boxCount != 0 && *std::max_element(paletteIdx, paletteIdx + m_boxCount) >= m_paletteCount) {
+		qWarning() << "Invalid palette index in scene file" << fileName;
+		close();
+		return false;
+	}
+
+	qDebug() << "SceneFile - mapped" << m_boxCount << "boxes and" << m_planeCount << "planes in"
+			 << timer.nsecsElapsed()*1e-6 << "ms";
+	return true;
+#endif
+}
+
+
+void SceneFile::close() {
+	if (m_data != nullptr)
+		m_file.unmap(const_cast<uchar*>(m_data));
+	m_file.close();
+	m_data = nullptr;
+	m_boxCount = m_paletteCount = m_planeCount = 0;
+	std::fill(m_sections, m_sections + NUM_SECTIONS, nullptr);
+}
+
+
+/*! Copies a section into a vector, the section must hold n elements of type T. */
+template <typename T>
+static void assignSection(std::vector<T> & v, const uchar * section, quint64 n) {
+	const T * first = reinterpret_cast<const T*>(section);
+	v.assign(first, first + n);
+}
+
+
+void SceneFile::readBoxes(BoxStore & boxes) const {
+	Q_ASSERT(m_data != nullptr);
+	// the file layout matches the memory layout of BoxStore, so each array is a single copy
+	assignSection(boxes.m_cx, m_sections[SectionCenterX], m_boxCount);
+	assignSection(boxes.m_cy, m_sections[SectionCenterY], m_boxCount);
+	assignSection(boxes.m_cz, m_sections[SectionCenterZ], m_boxCount);
+	assignSection(boxes.m_hx, m_sections[SectionHalfExtentX], m_boxCount);
+	assignSection(boxes.m_hy, m_sections[SectionHalfExtentY], m_boxCount);
+	assignSection(boxes.m_hz, m_sections[SectionHalfExtentZ], m_boxCount);
+	assignSection(boxes.m_qx, m_sections[SectionOrientationX], m_boxCount);
+	assignSection(boxes.m_qy, m_sections[SectionOrientationY], m_boxCount);
+	assignSection(boxes.m_qz, m_sections[SectionOrientationZ], m_boxCount);
+	assignSection(boxes.m_qw, m_sections[SectionOrientationW], m_boxCount);
+	assignSection(boxes.m_paletteIdx, m_sections[SectionPaletteIndex], m_boxCount);
+	assignSection(boxes.m_palettes, m_sections[SectionPalettes], m_paletteCount);
+}
+
+
+void SceneFile::readPlanes(std::vector<PlaneMesh> & planes) const {
+	Q_ASSERT(m_data != nullptr);
+	const PlaneRecord * records = reinterpret_cast<const PlaneRecord*>(m_sections[SectionPlanes]);
+	planes.resize(m_planeCount);
+	for (unsigned int i=0; i<m_planeCount; ++i) {
+		const PlaneRecord & r = records[i];
+		planes[i] = PlaneMesh(QVector3D(r.m_a[0], r.m_a[1], r.m_a[2]),
+							  QVector3D(r.m_b[0], r.m_b[1], r.m_b[2]),
+							  QVector3D(r.m_d[0], r.m_d[1], r.m_d[2]),
+							  QColor(r.m_rgba[0], r.m_rgba[1], r.m_rgba[2], r.m_rgba[3]));
+	}
+}
+
+
+bool SceneFile::write(const QString & fileName, const BoxStore & boxes, const std::vector<PlaneMesh> & planes) {
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+	qWarning() << "Scene files cannot be written on big-endian hosts" << fileName;
+	return false;
+#else
+	std::vector<PlaneRecord> planeRecords(planes.size());
+	for (unsigned int i=0; i<planes.size(); ++i) {
+		const PlaneMesh & p = planes[i];
+		PlaneRecord & r = planeRecords[i];
+		const QVector3D * points[3] = { &p.a(), &p.b(), &p.d() };
+		float * coords[3] = { r.m_a, r.m_b, r.m_d };
+		for (unsigned int j=0; j<3; ++j) {
+			coords[j][0] = points[j]->x();
+			coords[j][1] = points[j]->y();
+			coords[j][2] = points[j]->z();
+		}
+		r.m_rgba[0] = (quint8)p.color().red();
+		r.m_rgba[1] = (quint8)p.color().green();
+		r.m_rgba[2] = (quint8)p.color().blue();
+		r.m_rgba[3] = (quint8)p.color().alpha();
+	}
+
+	// data of all sections, in order of SectionId
+	const void * sectionData[NUM_SECTIONS] = {
+		boxes.m_cx.data(), boxes.m_cy.data(), boxes.m_cz.data(),
+		boxes.m_hx.data(), boxes.m_hy.data(), boxes.m_hz.data(),
+		boxes.m_qx.data(), boxes.m_qy.data(), boxes.m_qz.data(), boxes.m_qw.data(),
+		boxes.m_paletteIdx.data(), boxes.m_palettes.data(), planeRecords.data()
+	};
+
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.m_magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+	header.m_version = Version;
+	header.m_sectionCount = NUM_SECTIONS;
+	header.m_boxCount = boxes.size();
+	header.m_paletteCount = boxes.m_palettes.size();
+	header.m_planeCount = planes.size();
+
+	SectionEntry entries[NUM_SECTIONS];
+	quint64 offset = sizeof(Header) + sizeof(entries);
+	for (unsigned int i=0; i<NUM_SECTIONS; ++i) {
+		quint64 count = header.m_boxCount;
+		if (i == SectionPalettes)
+			count = header.m_paletteCount;
+		else if (i == SectionPlanes)
+			count = header.m_planeCount;
+		offset = (offset + SECTION_ALIGNMENT - 1)/SECTION_ALIGNMENT*SECTION_ALIGNMENT;
+		entries[i].m_id = i;
+		entries[i].m_elementSize = elementSize(i);
+		entries[i].m_offset = offset;
+		entries[i].m_size = count*entries[i].m_elementSize;
+		offset += entries[i].m_size;
+	}
+
+	// write into temporary file and rename when done, so that an interrupted export never leaves a truncated file
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly)) {
+		qWarning() << "Cannot write scene file" << fileName;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(entries), sizeof(entries));
+	for (unsigned int i=0; i<NUM_SECTIONS; ++i) {
+		// padding up to the aligned section start
+		file.write(QByteArray(int(entries[i].m_offset - (quint64)file.pos()), '\0'));
+		file.write(reinterpret_cast<const char*>(sectionData[i]), (qint64)entries[i].m_size);
+	}
+	if (!file.commit()) {
+		qWarning() << "Cannot write scene file" << fileName;
+		return false;
+	}
+	qDebug() << "SceneFile - wrote" << header.m_boxCount << "boxes and" << header.m_planeCount << "planes to" << fileName;
+	return true;
+#endif
+}
@@ -0,0 +1,127 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <QFile>
+#include <QString>
+
+#include <vector>
+
+class BoxStore;
+class PlaneMesh;
+
+/*! Binary scene file with boxes and planes, designed to be memory-mapped.
+
+	The file is little-endian and versioned. After a fixed-size header follows a table of sections,
+	each section holds one array of the scene in the same layout as used in memory: the structure-of-arrays
+	data of BoxStore (one section per array), the box palettes and the plane quads. Sections are aligned to
+	64 bytes, so that the mapped data can be accessed directly. Loading a scene thus means mapping the file,
+	checking the section table and copying each section with a single memcpy - there is no per-box parsing,
+	and the load time is dominated by paging in the file.
+
+	\code
+	Header (64 bytes)
+		char[8]   magic "E06SCENE"
+		quint32   version
+		quint32   section count
+		quint64   box count, palette count, plane count
+		quint64   reserved[3]
+	Section table: section count x
+		quint32   section id (see SectionId)
+		quint32   element size in bytes
+		quint64   offset (from file start)
+		quint64   size in bytes
+	Section data
+	\endcode
+
+	Big-endian hosts are not supported, since the data could not be used without conversion.
+
+	\code
+	SceneFile scene;
+	if (scene.open("city.scene")) {
+		m_boxObject.loadScene(scene);
+		m_planeObject.loadScene(scene);
+	}
+	\endcode
+*/
+class SceneFile {
+public:
+	/*! Identifies the sections, ids must not be changed once written. */
+	enum SectionId {
+		SectionCenterX,
+		SectionCenterY,
+		SectionCenterZ,
+		SectionHalfExtentX,
+		SectionHalfExtentY,
+		SectionHalfExtentZ,
+		SectionOrientationX,
+		SectionOrientationY,
+		SectionOrientationZ,
+		SectionOrientationW,
+		SectionPaletteIndex,
+		SectionPalettes,
+		SectionPlanes,
+		NUM_SECTIONS
+	};
+
+	/*! A plane quad as stored in the file: points a, b and d (c = b + d - a) and RGBA color. */
+	struct PlaneRecord {
+		float		m_a[3];
+		float		m_b[3];
+		float		m_d[3];
+		quint8		m_rgba[4];
+	};
+
+	SceneFile();
+	~SceneFile();
+
+	/*! Maps the file and checks header and section table.
+		Returns false (and prints a warning) if the file cannot be mapped or is invalid.
+	*/
+	bool open(const QString & fileName);
+	/*! Unmaps the file. */
+	void close();
+
+	quint64 boxCount() const { return m_boxCount; }
+	quint64 paletteCount() const { return m_paletteCount; }
+	quint64 planeCount() const { return m_planeCount; }
+
+	/*! Returns pointer to the mapped data of the section, or nullptr if not present. */
+	const uchar * section(SectionId id) const { return m_sections[id]; }
+
+	/*! Replaces all boxes and palettes in 'boxes' with the data from the file. */
+	void readBoxes(BoxStore & boxes) const;
+	/*! Replaces all planes with the data from the file. */
+	void readPlanes(std::vector<PlaneMesh> & planes) const;
+
+	/*! Writes boxes and planes into a scene file.
+		Returns false (and prints a warning), if the file cannot be written.
+	*/
+	static bool write(const QString & fileName, const BoxStore & boxes, const std::vector<PlaneMesh> & planes);
+
+	static const quint32 Version = 1;
+
+private:
+	QFile			m_file;
+	/*! Start of the mapped file, nullptr if not open. */
+	const uchar		*m_data;
+
+	quint64			m_boxCount;
+	quint64			m_paletteCount;
+	quint64			m_planeCount;
+
+	/*! Pointers to section data (within mapped memory). */
+	const uchar		*m_sections[NUM_SECTIONS];
+};
+
+#endif // SCENEFILE_H
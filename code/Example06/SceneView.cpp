@@ -15,14 +15,56 @@ License    : BSD License,
 #include <QOpenGLShaderProgram>
 #include <QDateTime>
 
+#include <algorithm>
+
 #include "DebugApplication.h"
 #include "PickObject.h"
+#include "AssetLoader.h"
+#include "SceneFile.h"
+#include "Frustum.h"
 
 #define SHADER(x) m_shaderPrograms[x].shaderProgram()
 
+bool SceneView::m_releaseBufferData = false;
+bool SceneView::m_backgroundLoading = false;
+QString SceneView::m_recordInputFile;
+QString SceneView::m_replayInputFile;
+QString SceneView::m_sceneFile;
+QString SceneView::m_meshFile;
+bool SceneView::m_depthPrepassEnabled = false;
+bool SceneView::m_gpuCullingSelfTest = false;
+
+/*! Parameters for the generated scene, no random boxes are generated if the scene is loaded from file. */
+static BoxSceneBuilder::Parameters sceneParameters() {
+	BoxSceneBuilder::Parameters params;
+	if (!SceneView::m_sceneFile.isEmpty())
+		params.m_boxCount = 0;
+	return params;
+}
+
+/*! Center of the bounding box of all chunks, used as sort depth of objects drawn with one item. */
+static QVector3D boundsCenter(const std::vector<GeometryCache::Chunk> & chunks) {
+	if (chunks.empty())
+		return QVector3D();
+	float bmin[3] = { chunks[0].m_min[0], chunks[0].m_min[1], chunks[0].m_min[2] };
+	float bmax[3] = { chunks[0].m_max[0], chunks[0].m_max[1], chunks[0].m_max[2] };
+	for (const GeometryCache::Chunk & c : chunks) {
+		for (int i=0; i<3; ++i) {
+			bmin[i] = std::min(bmin[i], c.m_min[i]);
+			bmax[i] = std::max(bmax[i], c.m_max[i]);
+		}
+	}
+	return 0.5f*QVector3D(bmin[0] + bmax[0], bmin[1] + bmax[1], bmin[2] + bmax[2]);
+}
+
 SceneView::SceneView() :
-	m_inputEventReceived(false)
+	m_logFrameTimes(true),
+	m_inputEventReceived(false),
+	m_renderQueue(m_bufferArena, m_glState),
+	m_boxObject(sceneParameters())
 {
+	m_nextFrame.m_depthPrepass = m_depthPrepassEnabled;
+
 	// tell keyboard handler to monitor certain keys
 	m_keyboardMouseHandler.addRecognizedKey(Qt::Key_W);
 	m_keyboardMouseHandler.addRecognizedKey(Qt::Key_A);
@@ -31,6 +73,23 @@ SceneView::SceneView() :
 	m_keyboardMouseHandler.addRecognizedKey(Qt::Key_Q);
 	m_keyboardMouseHandler.addRecognizedKey(Qt::Key_E);
 	m_keyboardMouseHandler.addRecognizedKey(Qt::Key_Shift);
+	m_keyboardMouseHandler.addRecognizedKey(Qt::Key_Delete);
+	m_keyboardMouseHandler.addRecognizedKey(Qt::Key_Insert);
+
+	m_boxObject.m_releaseBufferData = m_releaseBufferData;
+	m_planeObject.m_releaseBufferData = m_releaseBufferData;
+	m_textObject.m_releaseBufferData = m_releaseBufferData;
+
+	// replace generated boxes and planes with those of the scene file, keep the generated scene if the file is invalid
+	if (!m_sceneFile.isEmpty()) {
+		SceneFile scene;
+		if (scene.open(m_sceneFile)) {
+			m_boxObject.loadScene(scene);
+			m_planeObject.loadScene(scene);
+		}
+	}
+	if (!m_meshFile.isEmpty())
+		m_meshObject.load(m_meshFile);
 
 	// *** create scene (no OpenGL calls are being issued below, just the data structures are created.
 
@@ -64,6 +123,18 @@ SceneView::SceneView() :
 	texturedPlanes.m_uniformNames.append("text01"); // associate uniform index with texture name
 	m_shaderPrograms.append( texturedPlanes );
 
+	// Shaderprogram #5 : bounding boxes of box chunks, for occlusion queries
+	ShaderProgram occlusionProxies(":/shaders/boundingBox.vert",":/shaders/occlusionProxy.frag");
+	occlusionProxies.m_uniformNames.append("worldToView");
+	occlusionProxies.m_uniformNames.append("boxMin");
+	occlusionProxies.m_uniformNames.append("boxMax");
+	m_shaderPrograms.append( occlusionProxies );
+
+	// Shaderprogram #6 : depth-only, for the depth prepass of the boxes
+	ShaderProgram depthOnly(":/shaders/depthOnly.vert",":/shaders/depthOnly.frag");
+	depthOnly.m_uniformNames.append("worldToView");
+	m_shaderPrograms.append( depthOnly );
+
 	// *** initialize camera placement and model placement in the world
 
 	// move camera a little back (mind: positive z) and look straight ahead
@@ -76,18 +147,31 @@ SceneView::SceneView() :
 
 
 SceneView::~SceneView() {
+	// in threaded mode the context must be returned to this thread before releasing resources
+	stopRenderThread();
+
+	if (m_inputRecorder.mode() == InputRecorder::Recording)
+		m_inputRecorder.stopRecording(m_recordInputFile);
+
 	if (m_context) {
-		m_context->makeCurrent(this);
+		makeCurrent();
+
+		// stops the loader thread and releases pending fences
+		delete m_assetLoader;
 
 		for (ShaderProgram & p : m_shaderPrograms)
 			p.destroy();
 
 		m_boxObject.destroy();
+		m_boxCuller.destroy();
+		m_occlusionCuller.destroy();
+		m_meshObject.destroy();
 		m_minorGridObject.destroy();
 		m_majorGridObject.destroy();
 		m_pickLineObject.destroy();
 		m_planeObject.destroy();
 		m_textObject.destroy();
+		m_bufferArena.destroy();
 
 		m_gpuTimers.destroy();
 	}
@@ -98,26 +182,66 @@ void SceneView::initializeGL() {
 	FUNCID(SceneView::initializeGL);
 	try {
 		// initialize shader programs
-		for (ShaderProgram & p : m_shaderPrograms)
+		QElapsedTimer shaderTimer;
+		shaderTimer.start();
+		unsigned int cachedPrograms = 0;
+		for (ShaderProgram & p : m_shaderPrograms) {
 			p.create();
+			if (p.m_loadedFromCache)
+				++cachedPrograms;
+		}
+		qDebug() << "Shader programs created in" << shaderTimer.nsecsElapsed()*1e-6 << "ms ("
+				 << cachedPrograms << "of" << m_shaderPrograms.size() << "from program binary cache)";
 
-		// enable depth testing, important for the grid and for the drawing order of several objects
-		glEnable(GL_DEPTH_TEST);
-
-		// initialize drawable objects
-		m_boxObject.create(SHADER(2));
-		m_minorGridObject.create(SHADER(1), false);
-		m_majorGridObject.create(SHADER(1), true);
-		m_pickLineObject.create(SHADER(0));
-		m_planeObject.create(SHADER(3));
+		// initialize drawable objects, small objects first
+		m_minorGridObject.create(m_bufferArena, false);
+		m_majorGridObject.create(m_bufferArena, true);
+		m_pickLineObject.create(m_bufferArena);
 
 		m_textObject.addText("Osten", QVector3D(0,30,0), QVector3D(10,30,0), QVector3D(0,45,0));
 		m_textObject.addText("юго-запад", QVector3D(-70,30,70), QVector3D(0,30,0), QVector3D(-70,45,70));
 
-		m_textObject.create(m_shaderPrograms[4]);
+		m_textObject.create(m_shaderPrograms[4], m_bufferArena);
+
+		if (m_assetLoader != nullptr) {
+			// all ranges are allocated before the first upload is queued, since growing the arena buffers
+			// while the loader thread writes into them would lose data; data is uploaded in the loader thread
+			// and the objects are drawn once the upload has completed (see paintGL())
+			m_boxObject.createBuffers(m_bufferArena);
+			m_planeObject.createBuffers(m_bufferArena);
+			if (!m_meshObject.isEmpty())
+				m_meshObject.createBuffers(m_bufferArena);
+
+			m_assetLoader->enqueue([this](){ m_boxObject.upload(); },
+								   [this](){ m_boxObject.makeResident(); });
+			m_assetLoader->enqueue([this](){ m_planeObject.upload(); },
+								   [this](){ m_planeObject.makeResident(); });
+			if (!m_meshObject.isEmpty())
+				m_assetLoader->enqueue([this](){ m_meshObject.upload(); },
+									   [this](){ m_meshObject.makeResident(); });
+		}
+		else {
+			m_boxObject.create(m_bufferArena);
+			m_planeObject.create(m_bufferArena);
+			if (!m_meshObject.isEmpty())
+				m_meshObject.create(m_bufferArena);
+		}
+		m_bufferArena.reportUsage();
+
+		// with OpenGL 4.3, individual boxes are culled by a compute shader, otherwise chunks on the CPU
+		m_gpuCulling = BoxCuller::isSupported();
+		if (m_gpuCulling)
+			m_boxCuller.create();
+		if (OcclusionCuller::m_enabled)
+			m_occlusionCuller.create();
+
+		// creating shader programs and textures has changed bindings behind the back of the state cache
+		m_glState.invalidate();
+		// enable depth testing, important for the grid and for the drawing order of several objects
+		m_glState.enable(GL_DEPTH_TEST);
 
 		// Timer
-		m_gpuTimers.setSampleCount(5);
+		m_gpuTimers.setSampleCount(RenderQueue::NUM_PASSES + 1);
 		m_gpuTimers.create();
 	}
 	catch (OpenGLException & ex) {
@@ -143,32 +267,101 @@ void SceneView::resizeGL(int width, int height) {
 }
 
 
-void SceneView::paintGL() {
-	m_cpuTimer.start();
+void SceneView::contextCreated() {
+	if (m_backgroundLoading)
+		m_assetLoader = new AssetLoader(m_context);
+}
+
+
+void SceneView::prepareFrame() {
 	if (((DebugApplication *)qApp)->m_aboutToTerminate)
 		return;
 
+	initInputLog();
+
+	// during replay, the recorded input of this frame replaces live input
+	if (m_inputRecorder.mode() == InputRecorder::Replaying)
+		m_inputEventReceived = m_inputRecorder.replayFrame(m_keyboardMouseHandler, m_replayCursorPos);
+
 	// process input, i.e. check if any keys have been pressed
 	if (m_inputEventReceived)
 		processInput();
 
-	const qreal retinaScale = devicePixelRatio(); // needed for Macs with retina display
-	glViewport(0, 0, width() * retinaScale, height() * retinaScale);
-	qDebug() << "SceneView::paintGL(): Rendering to:" << width() << "x" << height();
+	m_inputRecorder.nextFrame();
+	publishFrame();
+}
 
-	// enable updating of z-buffer; NOTE: must be enabled before call to glClear(), because
-	// otherwise the depth buffer won't be modified.
-	glDepthMask(GL_TRUE);
 
-	// set the background color = clear color
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void SceneView::frameSwapped() {
+	// keep rendering while replaying or loading (to show geometry as soon as it is resident)
+	if (m_inputRecorder.mode() == InputRecorder::Replaying ||
+		(m_assetLoader != nullptr && m_assetLoader->pendingCount() != 0))
+	{
+		renderLater();
+	}
+	if (m_inputRecorder.mode() != InputRecorder::Replaying)
+		checkInput();
+}
+
+
+void SceneView::paintGL() {
+	m_cpuTimer.start();
+	if (((DebugApplication *)qApp)->m_aboutToTerminate)
+		return;
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// take over the state published in prepareFrame()
+	{
+		QMutexLocker lock(&m_frameMutex);
+		m_renderFrame.m_worldToView = m_publishedFrame.m_worldToView;
+		m_renderFrame.m_viewportSize = m_publishedFrame.m_viewportSize;
+		m_renderFrame.m_depthPrepass = m_publishedFrame.m_depthPrepass;
+		m_renderFrame.m_pickLineChanged = m_publishedFrame.m_pickLineChanged;
+		m_renderFrame.m_pickLineStart = m_publishedFrame.m_pickLineStart;
+		m_renderFrame.m_pickLineEnd = m_publishedFrame.m_pickLineEnd;
+		m_renderFrame.m_highlights.swap(m_publishedFrame.m_highlights);
+		m_publishedFrame.m_pickLineChanged = false;
+		m_publishedFrame.m_highlights.clear();
+	}
+	// mark geometry uploaded in the background as resident
+	if (m_assetLoader != nullptr)
+		m_assetLoader->processCompleted();
+	const bool boxesResident = m_boxObject.m_resident;
+
+	// upload boxes added, removed or moved since the last frame; this may grow the arena buffers,
+	// so wait until the loader thread has finished writing into them
+	if (boxesResident && (m_assetLoader == nullptr || m_assetLoader->pendingCount() == 0))
+		m_boxObject.uploadChanges();
+
+	// apply the results of picking operations, highlights need the box geometry to be resident
+	if (m_renderFrame.m_pickLineChanged)
+		m_pickLineObject.setPoints(m_renderFrame.m_pickLineStart, m_renderFrame.m_pickLineEnd);
+	m_deferredHighlights.insert(m_deferredHighlights.end(),
+								m_renderFrame.m_highlights.begin(), m_renderFrame.m_highlights.end());
+	if (boxesResident) {
+		for (const std::pair<unsigned int, unsigned int> & h : m_deferredHighlights)
+			m_boxObject.highlight(h.first, h.second);
+		m_deferredHighlights.clear();
+	}
+
+	const QSize & viewportSize = m_renderFrame.m_viewportSize;
+	glViewport(0, 0, viewportSize.width(), viewportSize.height());
+	if (m_logFrameTimes)
+		qDebug() << "SceneView::paintGL(): Rendering to:" << viewportSize.width() << "x" << viewportSize.height();
+
+	m_glState.resetCounters();
+
+	// enable updating of z-buffer; NOTE: must be enabled before call to glClear(), because
+	// otherwise the depth buffer won't be modified. Same for the color buffer (disabled in the depth prepass).
+	m_glState.depthMask(GL_TRUE);
+	m_glState.colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
 	// set the background color = clear color
 	QVector3D backColor(0.1f, 0.15f, 0.3f);
-	glClearColor(0.1f, 0.15f, 0.3f, 1.0f);
+	m_glState.clearColor(0.1f, 0.15f, 0.3f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	m_glState.enable(GL_BLEND);
+	m_glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	QVector3D minorGridColor(0.5f, 0.5f, 0.7f);
 	QVector3D majorGridColor(0.8f, 0.8f, 1.0f);
@@ -185,70 +378,158 @@ void SceneView::paintGL() {
 
 	m_gpuTimers.reset();
 
-	// tell OpenGL to show only faces whose normal vector points towards us
-	glEnable(GL_CULL_FACE);
-
-	// *** render boxes
-	m_gpuTimers.recordSample();
-
-	SHADER(2)->bind();
-	SHADER(2)->setUniformValue(m_shaderPrograms[2].m_uniformIDs[0], m_worldToView);
-	SHADER(2)->setUniformValue(m_shaderPrograms[2].m_uniformIDs[1], lightPos);
-	SHADER(2)->setUniformValue(m_shaderPrograms[2].m_uniformIDs[2], lightColor);
-
-	m_boxObject.render();
-
-	SHADER(2)->release();
-
-
-	// *** render lines
-	m_gpuTimers.recordSample();
-
-	SHADER(0)->bind();
-	SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[0], m_worldToView);
-
+	// *** submit draw items, the render queue sorts them by pass, shader, texture and vertex array object
+
+	m_renderQueue.clear();
+	// shader ids define the drawing order within a pass: lighted geometry, lines, grid, transparent planes, texts
+	const QMatrix4x4 worldToView = m_renderFrame.m_worldToView;
+	m_renderQueue.setShader(0, SHADER(2), [&](QOpenGLShaderProgram * p) {
+		p->setUniformValue(m_shaderPrograms[2].m_uniformIDs[0], worldToView);
+		p->setUniformValue(m_shaderPrograms[2].m_uniformIDs[1], lightPos);
+		p->setUniformValue(m_shaderPrograms[2].m_uniformIDs[2], lightColor);
+	});
+	m_renderQueue.setShader(1, SHADER(0), [&](QOpenGLShaderProgram * p) {
+		p->setUniformValue(m_shaderPrograms[0].m_uniformIDs[0], worldToView);
+	});
+	m_renderQueue.setShader(2, SHADER(1), [&](QOpenGLShaderProgram * p) {
+		p->setUniformValue(m_shaderPrograms[1].m_uniformIDs[0], worldToView);
+		p->setUniformValue(m_shaderPrograms[1].m_uniformIDs[2], backColor);
+	});
+	m_renderQueue.setShader(3, SHADER(3), [&](QOpenGLShaderProgram * p) {
+		p->setUniformValue(m_shaderPrograms[3].m_uniformIDs[0], worldToView);
+	});
+	m_renderQueue.setShader(4, SHADER(4), [&](QOpenGLShaderProgram * p) {
+		p->setUniformValue(m_shaderPrograms[4].m_uniformIDs[0], worldToView);
+	});
+	// boxes culled on the GPU
+	if (m_gpuCulling) {
+		m_renderQueue.setShader(5, m_boxCuller.m_drawProgram.shaderProgram(), [&](QOpenGLShaderProgram * p) {
+			p->setUniformValue(m_boxCuller.m_drawProgram.m_uniformIDs[0], worldToView);
+			p->setUniformValue(m_boxCuller.m_drawProgram.m_uniformIDs[1], lightPos);
+			p->setUniformValue(m_boxCuller.m_drawProgram.m_uniformIDs[2], lightColor);
+		});
+	}
+	// bounding boxes of the box chunks are drawn last in the opaque pass, when the depth buffer holds all occluders
+	if (OcclusionCuller::m_enabled) {
+		m_renderQueue.setShader(6, SHADER(5), [&](QOpenGLShaderProgram * p) {
+			p->setUniformValue(m_shaderPrograms[5].m_uniformIDs[0], worldToView);
+		});
+	}
+	// depth-only programs of the depth prepass
+	m_renderQueue.setShader(7, SHADER(6), [&](QOpenGLShaderProgram * p) {
+		p->setUniformValue(m_shaderPrograms[6].m_uniformIDs[0], worldToView);
+	});
+	if (m_gpuCulling) {
+		m_renderQueue.setShader(8, m_boxCuller.m_depthProgram.shaderProgram(), [&](QOpenGLShaderProgram * p) {
+			p->setUniformValue(m_boxCuller.m_depthProgram.m_uniformIDs[0], worldToView);
+		});
+	}
+	m_renderQueue.setTexture(1, m_textObject.texture());
+
+	// only boxes within the view frustum and not found occluded in one of the last frames are drawn: either
+	// individual boxes culled by a compute shader (the number of triangles is not known on the CPU), or chunks
+	// of boxes culled on the CPU
+	const Frustum frustum(worldToView);
+	const OcclusionCuller * occlusion = nullptr;
+	if (OcclusionCuller::m_enabled) {
+		m_occlusionCuller.collectResults();
+		occlusion = &m_occlusionCuller;
+	}
+	// with the depth prepass, the boxes are drawn depth-only first and then shaded only where their depth equals
+	// the prepass depth, so that overdrawn box faces are not shaded
+	const RenderQueue::Pass boxPass = m_renderFrame.m_depthPrepass ? RenderQueue::DepthEqualPass : RenderQueue::OpaquePass;
+	// falls back to culling on the CPU, if the boxes exceed the limits of the compute shaders
+	const bool gpuCulled = boxesResident && m_gpuCulling &&
+			m_boxCuller.cull(m_boxObject, frustum, occlusion, m_bufferArena, m_glState);
+	// opaque items are drawn front-to-back and transparent items back-to-front, sorted by the depth of their center
+	const float boxDepth = boxesResident ? RenderQueue::viewDepth(worldToView, boundsCenter(m_boxObject.m_chunks)) : 0.f;
+	if (gpuCulled && m_gpuCullingSelfTest && occlusion == nullptr) {
+		++m_gpuCullingChecks;
+		if (!m_boxCuller.verify(m_boxObject, frustum))
+			++m_gpuCullingMismatches;
+	}
+	if (gpuCulled) {
+		if (m_renderFrame.m_depthPrepass)
+			m_renderQueue.submit(RenderQueue::sortKey(RenderQueue::DepthPrepass, 8, 0, BufferArena::VNC, boxDepth),
+								 [this](){ m_boxCuller.render(m_bufferArena); });
+		m_renderQueue.submit(RenderQueue::sortKey(boxPass, 5, 0, BufferArena::VNC, boxDepth),
+							 [this](){ m_boxCuller.render(m_bufferArena); });
+	}
+	else if (boxesResident) {
+		const unsigned int boxElements = m_boxObject.cull(frustum, occlusion);
+		if (boxElements != 0) {
+			if (m_renderFrame.m_depthPrepass)
+				m_renderQueue.submit(RenderQueue::sortKey(RenderQueue::DepthPrepass, 7, 0, BufferArena::VNC, boxDepth),
+									 [this](){ m_boxObject.render(); }, boxElements/3);
+			m_renderQueue.submit(RenderQueue::sortKey(boxPass, 0, 0, BufferArena::VNC, boxDepth),
+								 [this](){ m_boxObject.render(); }, boxElements/3);
+		}
+	}
+	if (boxesResident && occlusion != nullptr)
+		m_renderQueue.submit(RenderQueue::sortKey(RenderQueue::OpaquePass, 6, 0, BufferArena::VNC, boxDepth),
+							 [&](){
+			m_occlusionCuller.issueQueries(m_boxObject.m_chunks, frustum, worldToView, m_shaderPrograms[5],
+										   m_glState, m_bufferArena);
+		});
+	if (m_meshObject.m_resident)
+		m_renderQueue.submit(RenderQueue::sortKey(RenderQueue::OpaquePass, 0, 0, BufferArena::VNC,
+												  RenderQueue::viewDepth(worldToView, boundsCenter(m_meshObject.m_chunks))),
+							 [this](){ m_meshObject.render(); }, m_meshObject.m_indexCount/3);
 	if (m_pickLineObject.m_visible)
-		m_pickLineObject.render();
-
-	SHADER(0)->release();
-
-
-	// *** render grid ***
-	m_gpuTimers.recordSample();
-
-	SHADER(1)->bind();
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[0], m_worldToView);
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[1], minorGridColor);
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[2], backColor);
-	m_minorGridObject.render();
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[1], majorGridColor);
-	m_majorGridObject.render();
-	SHADER(1)->release();
-
-	// tell OpenGL to show all planes
-	glDisable(GL_CULL_FACE);
-
-	// disable update of depth test but still use it
-	glDepthMask (GL_FALSE);
-
-	// *** render transparent planes
+		m_renderQueue.submit(RenderQueue::sortKey(RenderQueue::OpaquePass, 1, 0, BufferArena::VC,
+												  RenderQueue::viewDepth(worldToView, m_pickLineObject.center())),
+							 [this](){ m_pickLineObject.render(); });
+	// the grids are centered at the origin
+	const float gridDepth = RenderQueue::viewDepth(worldToView, QVector3D(0,0,0));
+	m_renderQueue.submit(RenderQueue::sortKey(RenderQueue::OpaquePass, 2, 0, BufferArena::V2, gridDepth),
+						 [&](){
+		SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[1], minorGridColor);
+		m_minorGridObject.render();
+	});
+	m_renderQueue.submit(RenderQueue::sortKey(RenderQueue::OpaquePass, 2, 0, BufferArena::V2, gridDepth),
+						 [&](){
+		SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[1], majorGridColor);
+		m_majorGridObject.render();
+	});
+	// each transparent plane is an item of its own, so that the planes are blended back-to-front
+	if (m_planeObject.m_resident) {
+		for (unsigned int i=0; i<m_planeObject.m_planes.size(); ++i)
+			m_renderQueue.submit(RenderQueue::sortKey(RenderQueue::TransparentPass, 3, 0, BufferArena::VCA,
+													  RenderQueue::viewDepth(worldToView, m_planeObject.m_planes[i].center())),
+								 [this, i](){ m_planeObject.renderPlane(i); }, PlaneMesh::IndexCount/3);
+	}
+	// texts are always in front of all transparent stuff
+	QVector3D textCenter;
+	for (const TextObject::TextData & t : m_textObject.m_texts)
+		textCenter += 0.5f*(t.m_b + t.m_d);
+	if (!m_textObject.m_texts.empty())
+		textCenter /= m_textObject.m_texts.size();
+	m_renderQueue.submit(RenderQueue::sortKey(RenderQueue::OverlayPass, 4, 1, BufferArena::VT,
+											  RenderQueue::viewDepth(worldToView, textCenter)),
+						 [this](){ m_textObject.render(); }, m_textObject.indexCount()/3);
+
+	// *** execute passes, with one GPU timer sample per pass
+	m_renderQueue.sort();
+	for (unsigned int pass = 0; pass < RenderQueue::NUM_PASSES; ++pass) {
+		m_gpuTimers.recordSample();
+		m_renderQueue.execute(RenderQueue::Pass(pass));
+	}
+	// program and texture stay bound for the next frame (tracked by the state cache), but the vertex array
+	// object must be unbound, see BufferArena::release()
+	m_bufferArena.release();
 	m_gpuTimers.recordSample(); // done painting
 
-	SHADER(3)->bind();
-	SHADER(3)->setUniformValue(m_shaderPrograms[3].m_uniformIDs[0], m_worldToView);
-
-	m_planeObject.render();
+	if (GLStateCache::m_debugMode)
+		qDebug() << "OpenGL state calls: " << m_glState.counters().m_issued << "issued,"
+				 << m_glState.counters().m_elided << "elided";
 
-	SHADER(3)->release();
-
-	// *** render text (always in front of all transparent stuff)
-
-	SHADER(4)->bind();
-	SHADER(4)->setUniformValue(m_shaderPrograms[4].m_uniformIDs[0], m_worldToView);
-	m_textObject.render();
-	SHADER(4)->release();
-
-	m_gpuTimers.recordSample(); // done painting
+	const RenderQueue::Counters & counters = m_renderQueue.counters();
+	m_frameStats.m_drawCalls = counters.m_drawItems;
+	m_frameStats.m_triangles = counters.m_triangles;
+	m_frameStats.m_stateChanges = counters.m_shaderBinds + counters.m_textureBinds +
+			counters.m_vertexArrayBinds + counters.m_stateChanges;
+	m_frameStats.m_stateChangesAvoided = counters.m_shaderBindsAvoided + counters.m_textureBindsAvoided +
+			counters.m_vertexArrayBindsAvoided + counters.m_stateChangesAvoided;
 
 
 #if 0
@@ -258,44 +539,82 @@ void SceneView::paintGL() {
 	renderLater();
 #endif
 
-	checkInput();
+	m_frameStats.m_cpuMs = m_cpuTimer.nsecsElapsed()*1e-6;
 
-	QVector<GLuint64> intervals = m_gpuTimers.waitForIntervals();
-	for (GLuint64 it : intervals)
-		qDebug() << "  " << it*1e-6 << "ms/frame";
 	QVector<GLuint64> samples = m_gpuTimers.waitForSamples();
-	qDebug() << "Total render time: " << (samples.back() - samples.front())*1e-6 << "ms/frame";
+	m_frameStats.m_gpuMs = (samples.back() - samples.front())*1e-6;
+	if (m_logFrameTimes) {
+		QVector<GLuint64> intervals = m_gpuTimers.waitForIntervals();
+		for (GLuint64 it : intervals)
+			qDebug() << "  " << it*1e-6 << "ms/frame";
+		qDebug() << "Total render time: " << m_frameStats.m_gpuMs << "ms/frame";
+		qDebug() << "State changes: " << m_frameStats.m_stateChanges << "(" << m_frameStats.m_stateChangesAvoided << "avoided)";
+		if (m_renderFrame.m_depthPrepass)
+			qDebug() << "Depth prepass enabled (pass timings: prepass, depth-equal, opaque, transparent, overlay)";
+		if (gpuCulled)
+			qDebug() << "Visible boxes: " << m_boxCuller.visibleCount() << "of" << m_boxObject.m_indexCount/BoxStore::IndexCount;
+		else if (boxesResident)
+			qDebug() << "Visible box chunks: " << m_boxObject.m_visibleChunkCount << "of" << m_boxObject.m_chunks.size();
+		if (boxesResident && OcclusionCuller::m_enabled)
+			qDebug() << "Occluded box chunks: " << m_occlusionCuller.occludedCount() << "of" << m_boxObject.m_chunks.size();
+
+		qint64 elapsedMs = m_cpuTimer.elapsed();
+		qDebug() << "Total paintGL time: " << elapsedMs << "ms";
+	}
+}
+
 
-	qint64 elapsedMs = m_cpuTimer.elapsed();
-	qDebug() << "Total paintGL time: " << elapsedMs << "ms";
+void SceneView::setCamera(const QVector3D & position, const QQuaternion & rotation) {
+	m_camera.setTranslation(position);
+	m_camera.setRotation(rotation);
+	updateWorld2ViewMatrix();
 }
 
 
 void SceneView::keyPressEvent(QKeyEvent *event) {
+	if (replayingInput())
+		return; // live input is ignored during replay
+	// toggle render options
+	if (event->key() == Qt::Key_F4) {
+		m_nextFrame.m_depthPrepass = !m_nextFrame.m_depthPrepass;
+		qDebug() << "Depth prepass" << (m_nextFrame.m_depthPrepass ? "enabled" : "disabled");
+		renderLater();
+		return;
+	}
 	m_keyboardMouseHandler.keyPressEvent(event);
 	checkInput();
 }
 
 void SceneView::keyReleaseEvent(QKeyEvent *event) {
+	if (replayingInput())
+		return; // live input is ignored during replay
 	m_keyboardMouseHandler.keyReleaseEvent(event);
 	checkInput();
 }
 
 void SceneView::mousePressEvent(QMouseEvent *event) {
+	if (replayingInput())
+		return; // live input is ignored during replay
 	m_keyboardMouseHandler.mousePressEvent(event);
 	checkInput();
 }
 
 void SceneView::mouseReleaseEvent(QMouseEvent *event) {
+	if (replayingInput())
+		return; // live input is ignored during replay
 	m_keyboardMouseHandler.mouseReleaseEvent(event);
 	checkInput();
 }
 
 void SceneView::mouseMoveEvent(QMouseEvent * /*event*/) {
+	if (replayingInput())
+		return; // live input is ignored during replay
 	checkInput();
 }
 
 void SceneView::wheelEvent(QWheelEvent *event) {
+	if (replayingInput())
+		return; // live input is ignored during replay
 	m_keyboardMouseHandler.wheelEvent(event);
 	checkInput();
 }
@@ -340,15 +659,61 @@ void SceneView::pick(const QPoint & globalMousePos) {
 	nearResult /= nearResult.w();
 	farResult /= farResult.w();
 
-	// update pick line vertices (visualize pick line)
-	m_context->makeCurrent(this);
-	m_pickLineObject.setPoints(nearResult.toVector3D(), farResult.toVector3D());
+	// update pick line vertices (visualize pick line), done in next paintGL() call
+	m_nextFrame.m_pickLineChanged = true;
+	m_nextFrame.m_pickLineStart = nearResult.toVector3D();
+	m_nextFrame.m_pickLineEnd = farResult.toVector3D();
 
 	// now do the actual picking - for now we implement a selection
 	selectNearestObject(nearResult.toVector3D(), farResult.toVector3D());
 }
 
 
+void SceneView::initInputLog() {
+	FUNCID(SceneView::initInputLog);
+	if (m_inputLogInitialized)
+		return;
+	m_inputLogInitialized = true;
+	// positions are stored relative to the view origin
+	if (!m_replayInputFile.isEmpty()) {
+		if (!m_inputRecorder.startReplay(m_replayInputFile, mapToGlobal(QPoint(0,0))))
+			throw OpenGLException(QString("Cannot replay input log '%1'.").arg(m_replayInputFile), FUNC_ID);
+	}
+	else if (!m_recordInputFile.isEmpty()) {
+		m_inputRecorder.startRecording(mapToGlobal(QPoint(0,0)));
+		m_keyboardMouseHandler.setRecorder(&m_inputRecorder);
+	}
+}
+
+
+void SceneView::publishFrame() {
+	const qreal retinaScale = devicePixelRatio(); // needed for Macs with retina display
+	m_nextFrame.m_worldToView = m_worldToView;
+	m_nextFrame.m_viewportSize = QSize(int(width() * retinaScale), int(height() * retinaScale));
+
+	QMutexLocker lock(&m_frameMutex);
+	m_publishedFrame.m_worldToView = m_nextFrame.m_worldToView;
+	m_publishedFrame.m_viewportSize = m_nextFrame.m_viewportSize;
+	m_publishedFrame.m_depthPrepass = m_nextFrame.m_depthPrepass;
+	if (m_nextFrame.m_pickLineChanged) {
+		m_publishedFrame.m_pickLineChanged = true;
+		m_publishedFrame.m_pickLineStart = m_nextFrame.m_pickLineStart;
+		m_publishedFrame.m_pickLineEnd = m_nextFrame.m_pickLineEnd;
+		m_nextFrame.m_pickLineChanged = false;
+	}
+	m_publishedFrame.m_highlights.insert(m_publishedFrame.m_highlights.end(),
+										 m_nextFrame.m_highlights.begin(), m_nextFrame.m_highlights.end());
+	m_nextFrame.m_highlights.clear();
+}
+
+
+QPoint SceneView::cursorPos() const {
+	if (replayingInput())
+		return m_replayCursorPos;
+	return QCursor::pos();
+}
+
+
 void SceneView::checkInput() {
 	// this function is called whenever _any_ key/mouse event was issued
 
@@ -373,13 +738,20 @@ void SceneView::checkInput() {
 		}
 
 		// has the mouse been moved?
-		if (m_keyboardMouseHandler.mouseDownPos() != QCursor::pos()) {
+		if (m_keyboardMouseHandler.mouseDownPos() != cursorPos()) {
 			m_inputEventReceived = true;
 //			qDebug() << "SceneView::checkInput() inputEventReceived: " << QCursor::pos() << m_keyboardMouseHandler.mouseDownPos();
 			renderLater();
 			return;
 		}
 	}
+	// box editing keys, only once per key press
+	if (m_keyboardMouseHandler.keyPressed(Qt::Key_Delete) || m_keyboardMouseHandler.keyPressed(Qt::Key_Insert)) {
+		m_inputEventReceived = true;
+		renderLater();
+		return;
+	}
+
 	// has the left mouse butten been release
 	if (m_keyboardMouseHandler.buttonReleased(Qt::LeftButton)) {
 		m_inputEventReceived = true;
@@ -402,6 +774,10 @@ void SceneView::processInput() {
 	m_inputEventReceived = false;
 //	qDebug() << "SceneView::processInput()";
 
+	// query cursor position only once, so that the recorded position is exactly the one used below
+	QPoint currentCursorPos = cursorPos();
+	m_inputRecorder.recordProcessInput(currentCursorPos);
+
 	// check for trigger key
 	if (m_keyboardMouseHandler.buttonDown(Qt::RightButton)) {
 
@@ -421,7 +797,7 @@ void SceneView::processInput() {
 
 		// Handle rotations
 		// get and reset mouse delta (pass current mouse cursor position)
-		QPoint mouseDelta = m_keyboardMouseHandler.resetMouseDelta(QCursor::pos()); // resets the internal position
+		QPoint mouseDelta = m_keyboardMouseHandler.resetMouseDelta(currentCursorPos); // resets the internal position
 		static const float rotatationSpeed  = 0.4f;
 		const QVector3D LocalUp(0.0f, 1.0f, 0.0f); // same as in Camera::up()
 		m_camera.rotate(-rotatationSpeed * mouseDelta.x(), LocalUp);
@@ -436,6 +812,25 @@ void SceneView::processInput() {
 		m_camera.translate(wheelDelta * transSpeed * m_camera.forward());
 	}
 
+	// edit the picked box: Delete removes it, Insert stacks a copy on top of it (and selects the copy),
+	// the buffers are updated in the next paintGL(); each key press edits once, also when the key is held
+	if (m_pickedBox != std::numeric_limits<unsigned int>::max()) {
+		if (m_keyboardMouseHandler.keyPressed(Qt::Key_Delete)) {
+			m_boxObject.removeBox(m_pickedBox);
+			m_pickedBox = std::numeric_limits<unsigned int>::max();
+		}
+		else if (m_keyboardMouseHandler.keyPressed(Qt::Key_Insert)) {
+			const BoxStore & boxes = m_boxObject.m_boxes;
+			QVector3D center = boxes.center(m_pickedBox);
+			QVector3D halfExtents = boxes.halfExtents(m_pickedBox);
+			center.setY(center.y() + 2*halfExtents.y());
+			// the copy gets the original colors, not the highlight palette of the picked box (the palette is
+			// read under the edit lock, since the render thread may be highlighting the box right now)
+			unsigned int paletteIdx = m_boxObject.basePaletteIdx(m_pickedBox);
+			m_pickedBox = m_boxObject.addBox(center, halfExtents, boxes.orientation(m_pickedBox), paletteIdx);
+		}
+	}
+
 	// check for picking operation
 	if (m_keyboardMouseHandler.buttonReleased(Qt::LeftButton)) {
 		pick(m_keyboardMouseHandler.mouseReleasePos());
@@ -472,6 +867,17 @@ void SceneView::selectNearestObject(const QVector3D & nearPoint, const QVector3D
 	m_boxObject.pick(nearPoint, d, p);
 	// ... other objects
 
+	// the mesh is picked separately, since its ids are triangle indexes; mesh triangles are not highlighted
+	PickObject meshPick(p.m_dist, std::numeric_limits<unsigned int>::max());
+	m_meshObject.pick(nearPoint, d, meshPick);
+	if (meshPick.m_objectId != std::numeric_limits<unsigned int>::max()) {
+		m_pickedBox = std::numeric_limits<unsigned int>::max();
+		qDebug().nospace() << "Pick successful (Mesh triangle #"
+						   << meshPick.m_objectId << ", t = " << meshPick.m_dist << ") after "
+						   << pickTimer.elapsed() << " ms";
+		return;
+	}
+
 	// any object accepted a pick?
 	if (p.m_objectId == std::numeric_limits<unsigned int>::max())
 		return; // nothing selected
@@ -480,6 +886,8 @@ void SceneView::selectNearestObject(const QVector3D & nearPoint, const QVector3D
 					   << p.m_objectId <<  ", Face #" << p.m_faceId << ", t = " << p.m_dist << ") after "
 					   << pickTimer.elapsed() << " ms";
 
-	// Mind: OpenGL-context must be current when we call this function!
-	m_boxObject.highlight(p.m_objectId, p.m_faceId);
+	m_pickedBox = p.m_objectId;
+
+	// the vertex buffer is updated in next paintGL() call, where the OpenGL-context is current
+	m_nextFrame.m_highlights.push_back(std::make_pair(p.m_objectId, p.m_faceId));
 }
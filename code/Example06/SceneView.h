@@ -15,17 +15,29 @@ License    : BSD License,
 #include <QMatrix4x4>
 #include <QOpenGLTimeMonitor>
 #include <QElapsedTimer>
+#include <QMutex>
+
+#include <limits>
 
 #include "OpenGLWindow.h"
+#include "BufferArena.h"
+#include "BoxCuller.h"
+#include "GLStateCache.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
 #include "ShaderProgram.h"
 #include "KeyboardMouseHandler.h"
+#include "InputRecorder.h"
 #include "GridObject.h"
 #include "BoxObject.h"
+#include "MeshObject.h"
 #include "PickLineObject.h"
 #include "Camera.h"
 #include "PlaneObject.h"
 #include "TextObject.h"
 
+class AssetLoader;
+
 /*! The class SceneView extends the primitive OpenGLWindow
 	by adding keyboard/mouse event handling, and rendering of different
 	objects (that encapsulate shader programs and buffer object).
@@ -35,10 +47,86 @@ public:
 	SceneView();
 	virtual ~SceneView() override;
 
+	/*! If true, the scene objects release their CPU-side copies of vertex and element buffer data
+		after upload to the GPU (must be set before the SceneView is created).
+	*/
+	static bool m_releaseBufferData;
+
+	/*! If true, box and plane geometry are uploaded in a background thread with a shared context, and the
+		scene is drawn progressively, starting with the grid (must be set before the SceneView is shown).
+		Off by default, so all geometry is resident after initializeGL(); enabled with --background-loading.
+	*/
+	static bool m_backgroundLoading;
+
+	/*! If not empty, all keyboard/mouse input is recorded from initialization on and written
+		to this file when the SceneView is destroyed (see InputRecorder).
+	*/
+	static QString m_recordInputFile;
+	/*! If not empty, the input log is replayed frame by frame from initialization on. Live input is
+		ignored until the replay has finished.
+	*/
+	static QString m_replayInputFile;
+
+	/*! If not empty, boxes and planes are loaded from this scene file (see SceneFile) instead of
+		being generated (must be set before the SceneView is created).
+	*/
+	static QString m_sceneFile;
+
+	/*! If not empty, a triangle mesh is imported from this OBJ or PLY file (see MeshImporter) and shown
+		together with the scene (must be set before the SceneView is created).
+	*/
+	static QString m_meshFile;
+
+	/*! If true, the boxes are drawn with a depth prepass from the first frame on (toggle with F4,
+		must be set before the SceneView is created).
+	*/
+	static bool m_depthPrepassEnabled;
+
+	/*! If true, the boxes culled on the GPU are checked against frustum culling on the CPU in every frame
+		(see BoxCuller::verify()), only meaningful without occlusion culling.
+	*/
+	static bool m_gpuCullingSelfTest;
+
+	/*! Returns true, while a recorded input log is being replayed. */
+	bool replayingInput() const { return m_inputRecorder.mode() == InputRecorder::Replaying; }
+
+	/*! Statistics of a rendered frame. */
+	struct FrameStats {
+		/*! CPU time spent in paintGL() in milliseconds (without waiting for GPU timer results). */
+		double			m_cpuMs = 0;
+		/*! GPU time for rendering the frame in milliseconds. */
+		double			m_gpuMs = 0;
+		/*! Number of draw calls issued. */
+		unsigned int	m_drawCalls = 0;
+		/*! Number of triangles drawn. */
+		unsigned int	m_triangles = 0;
+		/*! Number of shader, texture and vertex array object binds and render state changes issued. */
+		unsigned int	m_stateChanges = 0;
+		/*! Number of redundant binds and state changes filtered out by the render queue. */
+		unsigned int	m_stateChangesAvoided = 0;
+	};
+
+	/*! Statistics of the last frame rendered. */
+	const FrameStats & lastFrameStats() const { return m_frameStats; }
+
+	/*! Sets camera position and orientation, used for scripted camera paths (see BenchmarkRunner). */
+	void setCamera(const QVector3D & position, const QQuaternion & rotation);
+
+	/*! If true (the default), paintGL() prints render timings of each frame. */
+	bool m_logFrameTimes;
+
+	/*! Number of frames checked by the GPU culling self test (see m_gpuCullingSelfTest). */
+	unsigned int m_gpuCullingChecks = 0;
+	/*! Number of frames where the GPU culling self test found a mismatch. */
+	unsigned int m_gpuCullingMismatches = 0;
+
 protected:
 	void initializeGL() override;
 	void resizeGL(int width, int height) override;
 	void paintGL() override;
+	void contextCreated() override;
+	void prepareFrame() override;
+	void frameSwapped() override;
 
 	// Functions to handle key press and mouse press events, all the work is done in class KeyboardMouseHandler
 	void keyPressEvent(QKeyEvent *event) override;
@@ -51,6 +139,9 @@ protected:
 	void pick(const QPoint & globalMousePos);
 
 private:
+	/*! Returns the current mouse cursor position (global pos), during replay the recorded position. */
+	QPoint cursorPos() const;
+
 	/*! Tests, if any relevant input was received and registers a state change. */
 	void checkInput();
 
@@ -59,6 +150,12 @@ private:
 	*/
 	void processInput();
 
+	/*! Starts recording or replay of input, if requested (called before the first frame). */
+	void initInputLog();
+
+	/*! Copies the view state into m_nextFrame and publishes it for the next call to paintGL(). */
+	void publishFrame();
+
 	/*! Compines camera matrix and project matrix to form the world2view matrix. */
 	void updateWorld2ViewMatrix();
 
@@ -67,12 +164,34 @@ private:
 	*/
 	void selectNearestObject(const QVector3D & nearPoint, const QVector3D & farPoint);
 
+	/*! Scene state handed over from prepareFrame() (GUI thread) to paintGL() (possibly render thread).
+		Picking is done on the GUI thread, only the resulting OpenGL buffer updates are done in paintGL().
+	*/
+	struct FrameSnapshot {
+		QMatrix4x4			m_worldToView;
+		/*! Viewport size in pixels. */
+		QSize				m_viewportSize;
+		/*! True, if the pick line was changed. */
+		bool				m_pickLineChanged = false;
+		QVector3D			m_pickLineStart;
+		QVector3D			m_pickLineEnd;
+		/*! Picked (box, face) pairs to highlight. */
+		std::vector<std::pair<unsigned int, unsigned int> >	m_highlights;
+		/*! If true, boxes are drawn depth-only first and then shaded with GL_EQUAL depth test (toggle with F4). */
+		bool				m_depthPrepass = false;
+	};
+
 	/*! If set to true, an input event was received, which will be evaluated at next repaint. */
 	bool						m_inputEventReceived;
 
 	/*! The input handler, that encapsulates the event handling code. */
 	KeyboardMouseHandler		m_keyboardMouseHandler;
 
+	/*! Records or replays the input of the keyboard/mouse handler. */
+	InputRecorder				m_inputRecorder;
+	/*! Cursor position of the currently replayed frame. */
+	QPoint						m_replayCursorPos;
+
 	/*! The projection matrix, updated whenever the viewport geometry changes (in resizeGL() ). */
 	QMatrix4x4					m_projection;
 	Transform3D					m_transform;	// world transformation matrix generator
@@ -82,7 +201,21 @@ private:
 	/*! All shader programs used in the scene. */
 	QList<ShaderProgram>		m_shaderPrograms;
 
+	/*! Vertex and element buffers shared by all drawable objects. */
+	BufferArena					m_bufferArena;
+	/*! Shadows the OpenGL state set by paintGL() and the render queue, drops redundant calls. */
+	GLStateCache				m_glState;
+	/*! Sorts and submits the draw items of each frame. */
+	RenderQueue					m_renderQueue;
+
 	BoxObject					m_boxObject;
+	/*! Culls and draws the boxes on the GPU, only used if m_gpuCulling is true. */
+	BoxCuller					m_boxCuller;
+	/*! True, if the context supports compute shaders (see BoxCuller::isSupported()), set in initializeGL(). */
+	bool						m_gpuCulling = false;
+	/*! Skips box chunks hidden behind other geometry, only used if OcclusionCuller::m_enabled is set. */
+	OcclusionCuller				m_occlusionCuller;
+	MeshObject					m_meshObject;
 	GridObject					m_minorGridObject;
 	GridObject					m_majorGridObject;
 	PickLineObject				m_pickLineObject;
@@ -93,6 +226,31 @@ private:
 	QElapsedTimer				m_cpuTimer;
 
 	int							m_rotationCounter = 0;
+
+	/*! Updated in each call to paintGL(). */
+	FrameStats					m_frameStats;
+
+	/*! Box selected by the last pick (GUI thread), edited with the Delete/Insert keys. */
+	unsigned int				m_pickedBox = std::numeric_limits<unsigned int>::max();
+
+	/*! Uploads geometry in background, nullptr if m_backgroundLoading is false. */
+	AssetLoader					*m_assetLoader = nullptr;
+	/*! Highlights picked before the box geometry was resident (only accessed by the rendering thread). */
+	std::vector<std::pair<unsigned int, unsigned int> >	m_deferredHighlights;
+
+	/*! True, once initInputLog() was called. */
+	bool						m_inputLogInitialized = false;
+
+	/*! Snapshot being assembled on the GUI thread (only accessed by GUI thread). */
+	FrameSnapshot				m_nextFrame;
+	/*! Snapshot published for rendering, protected by m_frameMutex. If not yet rendered when the next snapshot
+		is published, pick line changes and highlights are accumulated, so that no pick gets lost.
+	*/
+	FrameSnapshot				m_publishedFrame;
+	/*! Snapshot used by paintGL() (only accessed by the rendering thread). */
+	FrameSnapshot				m_renderFrame;
+	/*! Protects m_publishedFrame, only held while copying. */
+	QMutex						m_frameMutex;
 };
 
 #endif // SCENEVIEW_H
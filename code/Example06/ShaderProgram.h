@@ -14,6 +14,7 @@ License    : BSD License,
 
 #include <QString>
 #include <QStringList>
+#include <QHash>
 
 QT_BEGIN_NAMESPACE
 class QOpenGLShaderProgram;
@@ -25,6 +26,17 @@ QT_END_NAMESPACE
 	It is meant to be used with shader programs in files, for example from
 	qrc files.
 
+	A shader program can be compiled in several variants (permutations), each defined by a list of
+	preprocessor defines that are injected into the GLSL sources right after the #version line.
+	Use setVariant() to switch variants at runtime - a variant is compiled lazily when it is selected for
+	the first time and is kept until destroy() is called. Variants with the same set of defines (regardless
+	of order and duplicates) share the same compiled program. The default variant has no defines.
+
+	Linked programs are stored as program binaries in an on-disk cache (see m_binaryCacheEnabled).
+	The cache key is built from the shader sources and the OpenGL vendor/renderer/version strings,
+	so that changed shaders or a driver update automatically invalidate cached binaries. If a cached
+	binary is rejected by the driver, the program is compiled from source as usual.
+
 	The embedded shader programm is not destroyed automatically upon destruction.
 	You must call destroy() to end the lifetime of the allocated OpenGL resources.
 */
@@ -40,6 +52,17 @@ public:
 
 	void bind();
 
+	/*! Selects the variant with the given preprocessor defines, either "NAME" or "NAME=VALUE".
+		If the variant has not been used before, it is compiled and linked now, hence the OpenGL context
+		must be current. Afterwards, shaderProgram() and m_uniformIDs refer to the selected variant.
+		Mind: the variant program must be bound (again) after switching.
+	*/
+	void setVariant(const QStringList & defines);
+	/*! The defines of the currently selected variant. */
+	const QStringList & variant() const { return m_defines; }
+	/*! Number of variants compiled so far. */
+	int variantCount() const { return m_variants.size(); }
+
 	/*! Access to the native shader program. */
 	QOpenGLShaderProgram * shaderProgram() { return m_program; }
 
@@ -57,9 +80,45 @@ public:
 	/*! Holds uniform Ids to be used in conjunction with setUniformValue(). */
 	QList<int>	m_uniformIDs;
 
+	/*! If false, the program binary cache is disabled and all programs are compiled from source. */
+	static bool		m_binaryCacheEnabled;
+	/*! Directory for cached program binaries, shared by all shader programs.
+		If empty, a "shadercache" subdirectory in the application's cache location is used.
+	*/
+	static QString	m_binaryCacheDir;
+
+	/*! Time needed for the last variant creation in milliseconds (either cache load or compilation and linking). */
+	double		m_createTimeMs;
+	/*! True, if the last variant created was restored from a cached program binary. */
+	bool		m_loadedFromCache;
+
 private:
-	/*! The wrapped native QOpenGLShaderProgram. */
+	/*! A compiled variant of the shader program. */
+	struct Variant {
+		QOpenGLShaderProgram	*m_program;
+		QList<int>				m_uniformIDs;
+	};
+
+	/*! Compiles and links the variant with the given defines (uses the program binary cache). */
+	Variant compileVariant(const QStringList & defines);
+	/*! Tries to restore the program from a cached program binary. Returns true on success. */
+	bool loadBinary(QOpenGLShaderProgram * program, const QString & cacheFile);
+	/*! Stores the linked program's binary in the cache file. */
+	void storeBinary(QOpenGLShaderProgram * program, const QString & cacheFile);
+
+	/*! Returns the key for a variant, i.e. a hash of the sorted list of unique defines. */
+	static QByteArray variantKey(const QStringList & defines);
+
+	/*! The wrapped native QOpenGLShaderProgram (of the currently selected variant). */
 	QOpenGLShaderProgram	*m_program;
+
+	/*! Defines of the currently selected variant. */
+	QStringList				m_defines;
+	/*! All variants compiled so far, key is computed with variantKey(). */
+	QHash<QByteArray, Variant>	m_variants;
+	/*! Cached shader sources (read in create()). */
+	QByteArray				m_vertexShaderSource;
+	QByteArray				m_fragmentShaderSource;
 };
 
 #endif // SHADERPROGRAM_H
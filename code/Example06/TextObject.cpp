@@ -13,16 +13,76 @@
 #define TEXTURE_ID 0
 
 TextObject::TextObject() :
-	m_vbo(QOpenGLBuffer::VertexBuffer), // actually the default, so default constructor would have been enough
-	m_ebo(QOpenGLBuffer::IndexBuffer) // make this an Index Buffer
+	m_releaseBufferData(false),
+	m_indexCount(0),
+	m_arena(nullptr)
 {
 }
 
 
-void TextObject::create(ShaderProgram & shaderProgram) {
+void TextObject::create(ShaderProgram & shaderProgram, BufferArena & arena) {
 
 	// first generate the image holding the individual texts
+	QImage textimg = layoutTexts();
 
+	shaderProgram.shaderProgram()->bind();
+	// create texture
+	m_texture = new QOpenGLTexture(QOpenGLTexture::Target2D);
+	m_texture->create();
+	// texture attributes
+	m_texture->setMinificationFilter(QOpenGLTexture::NearestMipMapLinear);
+	m_texture->setMagnificationFilter(QOpenGLTexture::Linear);
+	m_texture->setWrapMode(QOpenGLTexture::ClampToBorder);
+	m_texture->setData(textimg); // allocate() will be called internally
+	qDebug()<< "Texture mipmap levels: " << m_texture->mipLevels();
+	// tell shader to associate texture uniform 'text01' with a texture index
+	// Basically, this means that the texture uniform named 'text01' in the fragmentation shader,
+	// whose uniformIndex was stored in location m_shaderPrograms[0].m_uniformIDs[1], will
+	// now be associated with an OpenGL texture bound to index TEXTURE_ID (=0 here)
+	// later we bind our texted with index 0
+	shaderProgram.shaderProgram()->setUniformValue(shaderProgram.m_uniformIDs[1], TEXTURE_ID);
+
+	fillBuffers();
+
+	// store vertexes (index 0 = position, index 1 = texture coordinates) and elements in the arena
+	m_arena = &arena;
+	m_allocation = arena.allocate("TextObject", BufferArena::VT,
+								  (unsigned int)m_vertexBufferData.size(), (unsigned int)m_elementBufferData.size());
+	arena.writeVertexes(m_allocation, 0, (unsigned int)m_vertexBufferData.size(), m_vertexBufferData.data());
+	arena.writeElements(m_allocation, 0, (unsigned int)m_elementBufferData.size(), m_elementBufferData.data());
+
+	m_indexCount = m_elementBufferData.size();
+	if (m_releaseBufferData) {
+		// swap with empty vectors, since clear() would keep the memory allocated
+		std::vector<VertexTex>().swap(m_vertexBufferData);
+		std::vector<GLuint>().swap(m_elementBufferData);
+	}
+
+	shaderProgram.shaderProgram()->release();
+}
+
+
+void TextObject::destroy() {
+	if (m_arena != nullptr)
+		m_arena->free(m_allocation);
+	delete m_texture;
+}
+
+
+void TextObject::render() {
+	// the texture is bound with index TEXTURE_ID by the render queue (see texture())
+
+	// now draw the text planes by drawing individual triangles via elements
+	m_arena->drawElements(m_allocation, GL_TRIANGLES, m_indexCount);
+}
+
+
+void TextObject::addText(const QString & text, const QVector3D & a, const QVector3D & b, const QVector3D & d) {
+	m_texts.push_back(TextData(text, a, b, d));
+}
+
+
+QImage TextObject::layoutTexts() {
 	int fontSize = 22;
 	int textWidth=0;
 	int textHeight=0;
@@ -84,24 +144,11 @@ void TextObject::create(ShaderProgram & shaderProgram) {
 		}
 	}
 //	bool success = textimg.save("/home/ghorwin/bla.png");
+	return textimg;
+}
 
-	shaderProgram.shaderProgram()->bind();
-	// create texture
-	m_texture = new QOpenGLTexture(QOpenGLTexture::Target2D);
-	m_texture->create();
-	// texture attributes
-	m_texture->setMinificationFilter(QOpenGLTexture::NearestMipMapLinear);
-	m_texture->setMagnificationFilter(QOpenGLTexture::Linear);
-	m_texture->setWrapMode(QOpenGLTexture::ClampToBorder);
-	m_texture->setData(textimg); // allocate() will be called internally
-	qDebug()<< "Texture mipmap levels: " << m_texture->mipLevels();
-	// tell shader to associate texture uniform 'text01' with a texture index
-	// Basically, this means that the texture uniform named 'text01' in the fragmentation shader,
-	// whose uniformIndex was stored in location m_shaderPrograms[0].m_uniformIDs[1], will
-	// now be associated with an OpenGL texture bound to index TEXTURE_ID (=0 here)
-	// later we bind our texted with index 0
-	shaderProgram.shaderProgram()->setUniformValue(shaderProgram.m_uniformIDs[1], TEXTURE_ID);
 
+void TextObject::fillBuffers() {
 	// resize storage arrays
 	m_vertexBufferData.resize(m_texts.size()*PlaneMesh::VertexCount);
 	m_elementBufferData.resize(m_texts.size()*PlaneMesh::IndexCount);
@@ -120,68 +167,4 @@ void TextObject::create(ShaderProgram & shaderProgram) {
 		m.m_texj2 = t.m_texY2;
 		m.copy2Buffer(vertexBuffer, elementBuffer, vertexCount);
 	}
-
-
-	// create and bind Vertex Array Object
-	m_vao.create();
-	m_vao.bind();
-
-	// create and bind vertex buffer
-	m_vbo.create();
-	m_vbo.bind();
-	m_vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	int vertexMemSize = m_vertexBufferData.size()*sizeof(VertexTex);
-	m_vbo.allocate(m_vertexBufferData.data(), vertexMemSize);
-
-	// create and bind element buffer
-	m_ebo.create();
-	m_ebo.bind();
-	m_ebo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	int elementMemSize = m_elementBufferData.size()*sizeof(GLuint);
-	m_ebo.allocate(m_elementBufferData.data(), elementMemSize);
-
-	// set shader attributes
-	// tell shader program we have two data arrays to be used as input to the shaders
-
-	// index 0 = position
-	shaderProgram.shaderProgram()->enableAttributeArray(0); // array with index/id 0
-	shaderProgram.shaderProgram()->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(VertexTex));
-	// index 1 = texture coordinates
-	shaderProgram.shaderProgram()->enableAttributeArray(1); // array with index/id 1
-	shaderProgram.shaderProgram()->setAttributeBuffer(1, GL_FLOAT, offsetof(VertexTex, texi), 2, sizeof(VertexTex));
-
-	// Release (unbind) all
-	m_vao.release();
-	m_vbo.release();
-	m_ebo.release();
-
-	shaderProgram.shaderProgram()->release();
-}
-
-
-void TextObject::destroy() {
-	m_vao.destroy();
-	m_vbo.destroy();
-	m_ebo.destroy();
-	delete m_texture;
-}
-
-
-void TextObject::render() {
-	// then render all planes
-	// bind the texture as texture with index 0
-	m_texture->bind(TEXTURE_ID);
-
-	m_vao.bind();
-
-	// now draw the cube by drawing individual triangles
-	// - GL_TRIANGLES - draw individual triangles via elements
-	glDrawElements(GL_TRIANGLES, m_elementBufferData.size(), GL_UNSIGNED_INT, nullptr);
-	// release vertices again
-	m_vao.release();
-}
-
-
-void TextObject::addText(const QString & text, const QVector3D & a, const QVector3D & b, const QVector3D & d) {
-	m_texts.push_back(TextData(text, a, b, d));
 }
@@ -1,10 +1,10 @@
 #ifndef TEXTOBJECT_H
 #define TEXTOBJECT_H
 
-#include <QOpenGLBuffer>
-#include <QOpenGLVertexArrayObject>
 #include <QVector3D>
+#include <QImage>
 
+#include "BufferArena.h"
 #include "Vertex.h"
 
 QT_BEGIN_NAMESPACE
@@ -25,13 +25,28 @@ class ShaderProgram;
 class TextObject {
 public:
 	TextObject();
-	void create(ShaderProgram & shaderProgram);
+	/*! Creates the texture and stores vertexes and elements in the VT buffers of the arena (see BufferArena). */
+	void create(ShaderProgram & shaderProgram, BufferArena & arena);
 	void destroy();
 
+	/*! Draws the text planes, texture() must be bound to texture unit 0. */
 	void render();
 
+	/*! The texture holding all texts, created in create(). */
+	QOpenGLTexture * texture() const { return m_texture; }
+
 	void addText(const QString & text, const QVector3D & a, const QVector3D & b, const QVector3D & d);
 
+	/*! Renders all texts into the texture image, stores the texture coordinates of each text and adjusts
+		the text planes to the aspect ratio of the text. Does not need an OpenGL context.
+	*/
+	QImage layoutTexts();
+	/*! Populates vertex and element buffer data from the text planes, call after layoutTexts(). */
+	void fillBuffers();
+
+	/*! Number of indexes drawn in render(). */
+	unsigned int indexCount() const { return m_indexCount; }
+
 	struct TextData {
 		TextData() {}
 		TextData(const QString & text, const QVector3D & a, const QVector3D & b, const QVector3D & d) :
@@ -49,19 +64,20 @@ public:
 
 	std::vector<TextData>	m_texts;
 
+	/*! If true, vertex and element buffer data are released after upload in create(). */
+	bool					m_releaseBufferData;
+
 private:
 	unsigned int	m_lineSpacing; // determined in create(), used to set the texture coordinates
+	unsigned int	m_indexCount; // number of indexes to draw, determined in create()
 
 	std::vector<VertexTex>		m_vertexBufferData;
 	std::vector<GLuint>			m_elementBufferData;
 
-	/*! Wraps an OpenGL VertexArrayObject, that references the vertex coordinates and texture infos buffers. */
-	QOpenGLVertexArrayObject	m_vao;
-
-	/*! Holds position and texture infos in a single buffer. */
-	QOpenGLBuffer				m_vbo;
-	/*! Holds elements. */
-	QOpenGLBuffer				m_ebo;
+	/*! The arena holding the buffers, set in create(). */
+	BufferArena					*m_arena;
+	/*! Vertex range (position and texture infos) and element range of all texts. */
+	BufferArena::Allocation		m_allocation;
 
 	/*! The texture, that holds the text to render. */
 	QOpenGLTexture				*m_texture;
@@ -15,34 +15,118 @@ License    : BSD License,
 #include <ctime>
 
 #include <QApplication>
-#include <QDateTime>
 
+#include "AsyncLogger.h"
 #include "OpenGLException.h"
 #include "DebugApplication.h"
-
-void qDebugMsgHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
-	(void) context;
-	QString msgPrefix = "[" + QDateTime::currentDateTime().toString() + "] ";
-	switch (type) {
-		case QtDebugMsg		: msgPrefix += "Debug:    "; break;
-		case QtWarningMsg	: msgPrefix += "Warning:  "; break;
-		case QtCriticalMsg	: msgPrefix += "Critical: "; break;
-		case QtFatalMsg		: msgPrefix += "Fatal:    "; break;
-		case QtInfoMsg		: msgPrefix += "Info:     "; break;
-	}
-	QStringList lines = msg.split("\n");
-	for (const QString & l : lines)
-		std::cout << (msgPrefix + l).toStdString() << std::endl;
-}
-
+#include "ShaderProgram.h"
+#include "SceneView.h"
+#include "BenchmarkRunner.h"
+#include "SceneFile.h"
+#include "GeometryCache.h"
+#include "GLStateCache.h"
+#include "BufferArena.h"
+#include "BoxCuller.h"
+#include "OcclusionCuller.h"
 
 int main(int argc, char **argv) {
-	qInstallMessageHandler(qDebugMsgHandler);
+	// messages are written by a background thread, so logging in paintGL() does not stall frames
+	AsyncLogger logger;
 
 	DebugApplication app(argc, argv);
 
+	// for startup benchmarking: force compilation of all shader programs from source
+	if (app.arguments().contains("--no-shader-cache"))
+		ShaderProgram::m_binaryCacheEnabled = false;
+	// upload geometry in a background thread and show the scene progressively
+	if (app.arguments().contains("--background-loading"))
+		SceneView::m_backgroundLoading = true;
+	// always generate vertex/element data, do not use or write the geometry cache
+	if (app.arguments().contains("--no-geometry-cache"))
+		GeometryCache::m_cacheEnabled = false;
+	// keep vertex/element data only in GPU memory
+	if (app.arguments().contains("--release-buffer-data"))
+		SceneView::m_releaseBufferData = true;
+	// draw the boxes depth-only first, then shade them with GL_EQUAL depth test (toggle with F4)
+	if (app.arguments().contains("--depth-prepass"))
+		SceneView::m_depthPrepassEnabled = true;
+
+	// draw box chunks with glMultiDrawElementsBaseVertex() even if indirect draws are supported
+	if (app.arguments().contains("--no-indirect-draw"))
+		BufferArena::m_indirectDrawEnabled = false;
+	// cull boxes on the CPU even if compute shaders are supported
+	if (app.arguments().contains("--no-gpu-culling"))
+		BoxCuller::m_enabled = false;
+	// draw all box chunks in the view frustum, also those hidden behind other geometry
+	if (app.arguments().contains("--no-occlusion-culling"))
+		OcclusionCuller::m_enabled = false;
+	// check the boxes culled on the GPU against frustum culling on the CPU in every frame of an offscreen run,
+	// the exit code is 1 on a mismatch or if GPU culling is not available (occlusion culling is disabled)
+	const bool gpuCullingSelfTest = app.arguments().contains("--gpu-culling-selftest");
+	if (gpuCullingSelfTest) {
+		SceneView::m_gpuCullingSelfTest = true;
+		OcclusionCuller::m_enabled = false;
+	}
+	// count issued and elided OpenGL state calls (logged per frame together with the frame times)
+	if (app.arguments().contains("--gl-state-debug"))
+		GLStateCache::m_debugMode = true;
+
+	// render in a dedicated thread, so that event processing never waits for the GPU
+	if (app.arguments().contains("--render-thread"))
+		OpenGLWindow::m_threadedRendering = true;
+
+	// record keyboard/mouse input to a file, or replay a recorded session
+	// load the scene from a scene file, or export the generated scene (with --boxes=<count> random boxes)
+	// import a mesh (OBJ or binary PLY) shown together with the scene
+	QString exportSceneFile;
+	BoxSceneBuilder::Parameters exportParams;
+	for (const QString & arg : app.arguments()) {
+		if (arg.startsWith("--record="))
+			SceneView::m_recordInputFile = arg.mid(9);
+		else if (arg.startsWith("--replay="))
+			SceneView::m_replayInputFile = arg.mid(9);
+		else if (arg.startsWith("--scene="))
+			SceneView::m_sceneFile = arg.mid(8);
+		else if (arg.startsWith("--mesh="))
+			SceneView::m_meshFile = arg.mid(7);
+		else if (arg.startsWith("--export-scene="))
+			exportSceneFile = arg.mid(15);
+		else if (arg.startsWith("--boxes="))
+			exportParams.m_boxCount = arg.mid(8).toUInt();
+	}
+
 	qsrand(time(nullptr));
 
+	if (!exportSceneFile.isEmpty()) {
+		BoxObject boxObject(exportParams);
+		PlaneObject planeObject;
+		return SceneFile::write(exportSceneFile, boxObject.exportBoxes(), planeObject.m_planes) ? 0 : 1;
+	}
+
+	// headless benchmark mode: render scene offscreen along a camera path and write JSON results
+	if (app.arguments().contains("--benchmark") || gpuCullingSelfTest) {
+		// same format as in TestDialog
+		QSurfaceFormat format;
+		format.setRenderableType(QSurfaceFormat::OpenGL);
+		format.setProfile(QSurfaceFormat::CoreProfile);
+		format.setVersion(3,3);
+		format.setSamples(4);
+		format.setDepthBufferSize(24);
+
+		SceneView sceneView;
+		sceneView.setFormat(format);
+		BenchmarkRunner::Parameters params;
+		params.parseArguments(app.arguments());
+		int res = BenchmarkRunner::run(sceneView, "Example06", params);
+		if (res == 0 && gpuCullingSelfTest) {
+			qDebug() << "GPU culling self test:" << sceneView.m_gpuCullingChecks << "frames checked,"
+					 << sceneView.m_gpuCullingMismatches << "mismatches";
+			if (sceneView.m_gpuCullingChecks == 0 || sceneView.m_gpuCullingMismatches != 0)
+				res = 1;
+		}
+		return res;
+	}
+
 	TestDialog dlg;
 	dlg.show();
 	return app.exec();
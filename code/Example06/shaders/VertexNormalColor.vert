@@ -12,6 +12,9 @@ out vec3 fragPos;                      // output: fragment position in world coo
 
 uniform mat4 worldToView;              // parameter: the camera matrix
 
+// must match depthOnly.vert exactly, when drawn after a depth prepass
+invariant gl_Position;
+
 void main() {
   // Mind multiplication order for matrixes
   gl_Position = worldToView * vec4(position, 1.0);
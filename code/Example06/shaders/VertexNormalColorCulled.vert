@@ -0,0 +1,34 @@
+#version 430 core
+
+// GLSL version 4.3
+// vertex shader for boxes culled on the GPU (see cullBoxes.comp): one instance per visible box, the
+// vertexes are fetched from the vertex buffer instead of vertex attributes
+
+// the vertex buffer of the buffer arena, VertexVNC = 9 floats (position, normal, color)
+layout(std430, binding = 0) readonly buffer Vertexes {
+  float vertexes[];
+};
+// indexes of the visible boxes
+layout(std430, binding = 3) readonly buffer VisibleBoxes {
+  uint visibleBoxes[];
+};
+
+out vec3 fragColor;                    // output: fragment color
+out vec3 fragNormal;                   // output: fragment normal vector
+out vec3 fragPos;                      // output: fragment position in world coords
+
+uniform mat4 worldToView;              // parameter: the camera matrix
+
+// must match VertexPositionCulled.vert exactly, when drawn after a depth prepass
+invariant gl_Position;
+
+void main() {
+  // the elements are those of box slot 0, so gl_VertexID is the first vertex of the allocation plus the
+  // vertex within the box
+  uint v = (uint(gl_VertexID) + visibleBoxes[gl_InstanceID]*24u)*9u;
+  vec3 position = vec3(vertexes[v], vertexes[v + 1u], vertexes[v + 2u]);
+  gl_Position = worldToView * vec4(position, 1.0);
+  fragPos = position;
+  fragNormal = vec3(vertexes[v + 3u], vertexes[v + 4u], vertexes[v + 5u]);
+  fragColor = vec3(vertexes[v + 6u], vertexes[v + 7u], vertexes[v + 8u]);
+}
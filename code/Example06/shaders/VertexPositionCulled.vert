@@ -0,0 +1,25 @@
+#version 430 core
+
+// GLSL version 4.3
+// vertex shader for the depth prepass of boxes culled on the GPU: same vertex pulling as in
+// VertexNormalColorCulled.vert, but only the position is fetched; gl_Position is invariant in both shaders,
+// so that the depth values match exactly in the GL_EQUAL pass
+
+// the vertex buffer of the buffer arena, VertexVNC = 9 floats (position, normal, color)
+layout(std430, binding = 0) readonly buffer Vertexes {
+  float vertexes[];
+};
+// indexes of the visible boxes
+layout(std430, binding = 3) readonly buffer VisibleBoxes {
+  uint visibleBoxes[];
+};
+
+uniform mat4 worldToView;              // parameter: the camera matrix
+
+invariant gl_Position;
+
+void main() {
+  uint v = (uint(gl_VertexID) + visibleBoxes[gl_InstanceID]*24u)*9u;
+  vec3 position = vec3(vertexes[v], vertexes[v + 1u], vertexes[v + 2u]);
+  gl_Position = worldToView * vec4(position, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 330 core
+
+// GLSL version 3.3
+// vertex shader: draws the box [boxMin, boxMax] as 12 triangles (36 vertexes, no vertex attributes),
+// used as proxy geometry for occlusion queries
+
+uniform mat4 worldToView;              // parameter: the camera matrix
+uniform vec3 boxMin;                   // parameter: minimum corner of the box (world coords)
+uniform vec3 boxMax;                   // parameter: maximum corner of the box (world coords)
+
+// corners of the triangles, bit 0 selects x, bit 1 y and bit 2 z of boxMax instead of boxMin
+const int corners[36] = int[36](0,1,3, 0,3,2,  4,6,7, 4,7,5,  0,4,5, 0,5,1,
+                                2,3,7, 2,7,6,  0,2,6, 0,6,4,  1,5,7, 1,7,3);
+
+void main() {
+  int c = corners[gl_VertexID];
+  vec3 position = mix(boxMin, boxMax, vec3(c & 1, (c >> 1) & 1, (c >> 2) & 1));
+  gl_Position = worldToView * vec4(position, 1.0);
+}
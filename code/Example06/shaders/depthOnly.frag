@@ -0,0 +1,6 @@
+#version 330 core
+
+// fragment shader for the depth prepass: color writes are disabled, only the depth is written
+
+void main() {
+}
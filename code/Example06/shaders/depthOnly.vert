@@ -0,0 +1,15 @@
+#version 330
+
+// GLSL version 3.3
+// vertex shader for the depth prepass: only the position is needed, gl_Position is declared invariant
+// (as in VertexNormalColor.vert), so that the depth values match exactly in the GL_EQUAL pass
+
+layout(location = 0) in vec3 position; // input:  attribute with index '0' with 3 elements per vertex
+
+uniform mat4 worldToView;              // parameter: the camera matrix
+
+invariant gl_Position;
+
+void main() {
+  gl_Position = worldToView * vec4(position, 1.0);
+}
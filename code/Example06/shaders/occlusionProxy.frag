@@ -0,0 +1,7 @@
+#version 330 core
+
+// fragment shader for occlusion query proxies: color writes are disabled, only the samples passing the
+// depth test are counted
+
+void main() {
+}
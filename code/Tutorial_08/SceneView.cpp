@@ -21,6 +21,7 @@ License    : BSD License,
 
 SceneView::SceneView() :
 	m_inputEventReceived(false),
+	m_texturesResident(false),
 	m_gpuTimers(this)
 {
 	// tell keyboard handler to monitor certain keys
@@ -32,15 +33,16 @@ SceneView::SceneView() :
 	m_keyboardMouseHandler.addRecognizedKey(Qt::Key_E);
 	m_keyboardMouseHandler.addRecognizedKey(Qt::Key_Shift);
 
+	// repaint when a texture has been decoded, so that it is uploaded in paintGL()
+	connect(&m_textureManager, &TextureManager::textureDecoded, this, &SceneView::renderLater);
+
 	// *** create scene (no OpenGL calls are being issued below, just the data structures are created.
 
 	// Shaderprogram #0 : regular geometry (painting triangles via element index)
 	ShaderProgram blocks(":/shaders/withTexture.vert",":/shaders/texture.frag");
 	blocks.m_uniformNames.append("worldToView");
-	// we use three textures, which are identified by names "texture1", "texture2" etc.
-	blocks.m_uniformNames.append("brickTexture");
-	blocks.m_uniformNames.append("plasterTexture");
-	blocks.m_uniformNames.append("rooftiles");
+	// all textures are layers of a single texture array, the layer is selected by the vertex attribute 'texnr'
+	blocks.m_uniformNames.append("textures");
 	m_shaderPrograms.append( blocks );
 
 	// Shaderprogram #1 : grid (painting grid lines)
@@ -80,6 +82,12 @@ SceneView::~SceneView() {
 void SceneView::initializeGL() {
 	FUNCID(SceneView::initializeGL);
 	try {
+		// start decoding textures in the background, while shaders and buffers are being created
+		m_textureManager.load(QStringList()
+							  << ":/textures/brickwall.jpg"
+							  << ":/textures/plaster.jpg"
+							  << ":/textures/tiles.jpg");
+
 		// initialize shader programs
 		for (ShaderProgram & p : m_shaderPrograms)
 			p.create();
@@ -89,38 +97,15 @@ void SceneView::initializeGL() {
 		// enable depth testing, important for the grid and for the drawing order of several objects
 		glEnable(GL_DEPTH_TEST);
 
-		// textures
-		QStringList textureFiles = {
-			":/textures/brickwall.jpg",
-			":/textures/plaster.jpg",
-			":/textures/tiles.jpg"
-		};
-
 		// *** initialize textures
 
 		// bind shader, so that we can define texture association
 		SHADER(0)->bind();
 
-		// we have three textures
-		for (int i=0; i<3; ++i) {
-			const QString & t = textureFiles[i];
-			QOpenGLTexture * texture = new QOpenGLTexture(QOpenGLTexture::Target2D);
-			m_textures.append(texture);
-			texture->create();
-			// texture attributes
-			texture->setMinificationFilter(QOpenGLTexture::NearestMipMapLinear);
-			texture->setMagnificationFilter(QOpenGLTexture::Linear);
-//			texture->setWrapMode(QOpenGLTexture::ClampToBorder);
-//			texture->setBorderColor(Qt::red);
-			QImage img(t);
-			texture->setData(img); // allocate() will be called internally
-			qDebug()<< "Texture mipmap levels: " << texture->mipLevels();
-			// tell shader to associate 'textureX' with the current texture's index
-			// Basically, this means that the texture named 'texture1' in the fragmentation shader,
-			// whose uniformIndex was stored in location m_shaderPrograms[0].m_uniformIDs[1], will
-			// now be associated with an OpenGL texture bound to index 0
-			SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[1+i],i);
-		}
+		// tell shader to associate the texture array 'textures' with texture unit 0; since all materials are
+		// layers of this array, a single unit is enough regardless of the number of materials
+		SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[1], 0);
+		// the texture array itself is uploaded in paintGL(), once decoded
 
 		// initialize drawable objects
 		m_boxObject.create(SHADER(0), this);
@@ -179,14 +164,20 @@ void SceneView::paintGL() {
 
 	m_gpuTimers.recordSample(); // setup boxes
 
+	// upload textures decoded since last frame (never waits for the decoder)
+	if (!m_texturesResident)
+		m_texturesResident = m_textureManager.uploadDecoded();
+
 	// *** render boxes
 	SHADER(0)->bind();
 	SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[0], m_worldToView);
-	for (int i=0; i<3; ++i)
-		m_textures[i]->bind(i); // bind texture #i to texture index i -> accessible in fragment shader through "texture1"
+	if (m_texturesResident)
+		m_textureManager.texture()->bind(0); // bind texture array to texture unit 0 -> accessible in fragment shader through "textures"
 
 	m_gpuTimers.recordSample(); // render boxes
-	m_boxObject.render();
+	// boxes are only drawn with textures, all materials in one draw call
+	if (m_texturesResident)
+		m_boxObject.render();
 	SHADER(0)->release();
 
 	// *** render grid afterwards ***
@@ -257,9 +248,7 @@ bool SceneView::event(QEvent *e) {
 		if (m_context != nullptr) {
 			if (m_context->makeCurrent(this))
 				qDebug() << "Cannot make context current.";
-			for (QOpenGLTexture* t : m_textures)
-				t->destroy();
-			qDeleteAll(m_textures);
+			m_textureManager.destroy();
 		}
 	}
 	return OpenGLWindow::event(e);
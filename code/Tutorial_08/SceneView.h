@@ -15,7 +15,6 @@ License    : BSD License,
 #include <QMatrix4x4>
 #include <QOpenGLTimeMonitor>
 #include <QElapsedTimer>
-#include <QOpenGLTexture>
 
 #include "OpenGLWindow.h"
 #include "ShaderProgram.h"
@@ -23,6 +22,7 @@ License    : BSD License,
 #include "GridObject.h"
 #include "BoxObject.h"
 #include "Camera.h"
+#include "TextureManager.h"
 
 /*! The class SceneView extends the primitive OpenGLWindow
 	by adding keyboard/mouse event handling, and rendering of different
@@ -78,7 +78,10 @@ private:
 
 	BoxObject					m_boxObject;
 	GridObject					m_gridObject;
-	QList<QOpenGLTexture*>		m_textures;
+	/*! Decodes textures in the background and owns the OpenGL textures. */
+	TextureManager				m_textureManager;
+	/*! Set, once all textures have been uploaded. */
+	bool						m_texturesResident;
 
 	QOpenGLTimeMonitor			m_gpuTimers;
 	QElapsedTimer				m_cpuTimer;
@@ -0,0 +1,326 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "TextureManager.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QOpenGLTexture>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+bool TextureManager::m_cacheEnabled = true;
+
+/*! Increase, whenever the cache file layout or the mipmap filter changes. */
+static const quint32 CACHE_VERSION = 1;
+static const char CACHE_MAGIC[4] = {'T', '8', 'M', 'C'};
+
+/*! Size of cache file header without level table. */
+static const int HEADER_SIZE = 4 + 4*sizeof(quint32);
+
+
+class TextureManager::DecodeTask : public QRunnable {
+public:
+	DecodeTask(TextureManager * manager, Entry * e) : m_manager(manager), m_entry(e) {}
+	void run() override {
+		TextureManager::decode(*m_entry);
+		// the manager waits for all jobs in its destructor, so it is still alive here
+		emit m_manager->textureDecoded();
+	}
+
+	TextureManager * m_manager;
+	Entry * m_entry;
+};
+
+
+TextureManager::TextureManager() :
+	m_layerSize(512, 512),
+	m_textureArray(nullptr)
+{
+	// decoding is I/O and CPU bound, one thread per core
+	m_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+
+TextureManager::~TextureManager() {
+	m_pool.waitForDone();
+	for (Entry * e : m_entries)
+		releaseData(*e);
+	qDeleteAll(m_entries);
+	if (m_textureArray != nullptr)
+		qWarning() << "TextureManager: texture array not destroyed";
+}
+
+
+void TextureManager::load(const QStringList & fileNames) {
+	for (const QString & f : fileNames) {
+		Entry * e = new Entry;
+		e->m_fileName = f;
+		e->m_size = m_layerSize;
+		e->m_state.store(Pending);
+		m_entries.append(e);
+		m_pool.start(new DecodeTask(this, e));
+	}
+}
+
+
+bool TextureManager::uploadDecoded() {
+	if (m_textureArray == nullptr) {
+		// storage for all layers is allocated up front, layers are filled in as they are decoded
+		m_textureArray = new QOpenGLTexture(QOpenGLTexture::Target2DArray);
+		m_textureArray->setFormat(QOpenGLTexture::RGBA8_UNorm);
+		m_textureArray->setSize(m_layerSize.width(), m_layerSize.height());
+		m_textureArray->setLayers(m_entries.count());
+		m_textureArray->setMipLevels(mipLevelCount(m_layerSize.width(), m_layerSize.height()));
+		m_textureArray->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+		m_textureArray->setMinificationFilter(QOpenGLTexture::NearestMipMapLinear);
+		m_textureArray->setMagnificationFilter(QOpenGLTexture::Linear);
+		m_textureArray->setWrapMode(QOpenGLTexture::Repeat);
+	}
+
+	bool allResident = true;
+	for (int layer=0; layer<m_entries.count(); ++layer) {
+		Entry * e = m_entries[layer];
+		int state = e->m_state.load(std::memory_order_acquire);
+		if (state == Resident || state == Skipped)
+			continue;
+		if (state == Pending) {
+			allResident = false;
+			continue;
+		}
+		if (state == Failed) {
+			// a missing texture is not fatal, the layer is simply left empty
+			qWarning() << "TextureManager: cannot load texture" << e->m_fileName << ":" << e->m_error;
+			e->m_state.store(Skipped);
+			continue;
+		}
+
+		// all levels are provided, so no glGenerateMipmap() call is needed
+		for (unsigned int i=0; i<e->m_levels.size(); ++i)
+			m_textureArray->setData(i, layer, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8,
+									e->m_data + e->m_levels[i].m_offset);
+
+		e->m_state.store(Resident);
+		releaseData(*e);
+	}
+	return allResident;
+}
+
+
+void TextureManager::destroy() {
+	if (m_textureArray == nullptr)
+		return;
+	m_textureArray->destroy();
+	delete m_textureArray;
+	m_textureArray = nullptr;
+}
+
+
+QString TextureManager::cacheDirectory() {
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/textures";
+}
+
+
+void TextureManager::decode(Entry & e) {
+	QElapsedTimer timer;
+	timer.start();
+
+	QFile sourceFile(e.m_fileName);
+	if (!sourceFile.open(QIODevice::ReadOnly)) {
+		e.m_error = "Cannot open file.";
+		e.m_state.store(Failed, std::memory_order_release);
+		return;
+	}
+	QByteArray sourceData = sourceFile.readAll();
+
+	// the cache file is identified by the hash of the encoded image and the layer size, so modified images
+	// get a new cache file
+	QString cacheFilePath;
+	if (m_cacheEnabled) {
+		QByteArray hash = QCryptographicHash::hash(sourceData, QCryptographicHash::Sha1).toHex().left(16);
+		cacheFilePath = QString("%1/%2_%3_%4x%5.mips").arg(cacheDirectory(), QFileInfo(e.m_fileName).completeBaseName(),
+			QString::fromLatin1(hash)).arg(e.m_size.width()).arg(e.m_size.height());
+		if (mapCacheFile(cacheFilePath, e)) {
+			qDebug() << "TextureManager: mapped" << cacheFilePath << "in" << timer.elapsed() << "ms";
+			e.m_state.store(Decoded, std::memory_order_release);
+			return;
+		}
+	}
+
+	QImage img;
+	if (!img.loadFromData(sourceData)) {
+		e.m_error = "Invalid or unsupported image format.";
+		e.m_state.store(Failed, std::memory_order_release);
+		return;
+	}
+	// all layers of the texture array have the same size
+	if (img.size() != e.m_size)
+		img = img.scaled(e.m_size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	// same format as used by QOpenGLTexture::setData(QImage), no vertical mirroring
+	img = img.convertToFormat(QImage::Format_RGBA8888);
+	generateMipChain(img, e);
+	e.m_data = reinterpret_cast<const uchar*>(e.m_decodedData.constData());
+	qDebug() << "TextureManager: decoded" << e.m_fileName << "and generated" << e.m_levels.size() << "mip levels in"
+			 << timer.elapsed() << "ms";
+
+	if (m_cacheEnabled) {
+		QDir().mkpath(cacheDirectory());
+		// write to temporary file and rename, so that other instances never see partially written files
+		QSaveFile cacheFile(cacheFilePath);
+		if (cacheFile.open(QIODevice::WriteOnly)) {
+			cacheFile.write(e.m_decodedData);
+			if (!cacheFile.commit())
+				qWarning() << "TextureManager: cannot write cache file" << cacheFilePath;
+		}
+	}
+	e.m_state.store(Decoded, std::memory_order_release);
+}
+
+
+bool TextureManager::mapCacheFile(const QString & cacheFilePath, Entry & e) {
+	QFile * f = new QFile(cacheFilePath);
+	if (!f->open(QIODevice::ReadOnly)) {
+		delete f;
+		return false;
+	}
+	qint64 fileSize = f->size();
+	const uchar * data = fileSize > HEADER_SIZE ? f->map(0, fileSize) : nullptr;
+	if (data == nullptr) {
+		delete f;
+		return false;
+	}
+
+	quint32 header[4];
+	std::memcpy(header, data + 4, sizeof(header));
+	quint32 levelCount = header[3];
+	bool valid = std::memcmp(data, CACHE_MAGIC, 4) == 0 && header[0] == CACHE_VERSION &&
+			header[1] == quint32(e.m_size.width()) && header[2] == quint32(e.m_size.height()) &&
+			levelCount == quint32(mipLevelCount(e.m_size.width(), e.m_size.height())) &&
+			fileSize >= HEADER_SIZE + levelCount*sizeof(MipLevel);
+	if (valid) {
+		e.m_levels.resize(levelCount);
+		std::memcpy(e.m_levels.data(), data + HEADER_SIZE, levelCount*sizeof(MipLevel));
+		// setData() reads the level size implied by the texture, so each level must have exactly the dimensions
+		// of the mip chain (same sequence as in generateMipChain())
+		quint32 w = quint32(e.m_size.width());
+		quint32 h = quint32(e.m_size.height());
+		for (const MipLevel & l : e.m_levels) {
+			if (l.m_width != w || l.m_height != h || quint64(l.m_size) != quint64(w)*h*4 ||
+				qint64(l.m_offset) + l.m_size > fileSize)
+			{
+				valid = false;
+			}
+			w = std::max<quint32>(1, w/2);
+			h = std::max<quint32>(1, h/2);
+		}
+	}
+	if (!valid) {
+		qWarning() << "TextureManager: ignoring invalid cache file" << cacheFilePath;
+		e.m_levels.clear();
+		delete f; // also unmaps
+		return false;
+	}
+	e.m_cacheFile = f;
+	e.m_data = data;
+	return true;
+}
+
+
+void TextureManager::generateMipChain(const QImage & img, Entry & e) {
+	Q_ASSERT(img.format() == QImage::Format_RGBA8888);
+	// level dimensions, see mipLevelCount()
+	quint32 w = img.width();
+	quint32 h = img.height();
+	for (;;) {
+		MipLevel l;
+		l.m_width = w;
+		l.m_height = h;
+		l.m_offset = 0;
+		l.m_size = w*h*4;
+		e.m_levels.push_back(l);
+		if (w == 1 && h == 1)
+			break;
+		w = std::max<quint32>(1, w/2);
+		h = std::max<quint32>(1, h/2);
+	}
+	quint32 offset = HEADER_SIZE + e.m_levels.size()*sizeof(MipLevel);
+	for (MipLevel & l : e.m_levels) {
+		offset = (offset + 15) & ~15u; // align level data to 16 bytes
+		l.m_offset = offset;
+		offset += l.m_size;
+	}
+	e.m_decodedData = QByteArray(offset, 0);
+	uchar * data = reinterpret_cast<uchar*>(e.m_decodedData.data());
+
+	// header and level table
+	quint32 header[4] = { CACHE_VERSION, quint32(img.width()), quint32(img.height()), quint32(e.m_levels.size()) };
+	std::memcpy(data, CACHE_MAGIC, 4);
+	std::memcpy(data + 4, header, sizeof(header));
+	std::memcpy(data + HEADER_SIZE, e.m_levels.data(), e.m_levels.size()*sizeof(MipLevel));
+
+	// level 0: copy image lines (QImage lines may be padded)
+	const MipLevel & l0 = e.m_levels[0];
+	for (quint32 y=0; y<l0.m_height; ++y)
+		std::memcpy(data + l0.m_offset + y*l0.m_width*4, img.constScanLine(y), l0.m_width*4);
+
+	// further levels: average of 2x2 pixels of previous level, odd last row/column is folded into the
+	// previous pixels by clamping
+	for (unsigned int i=1; i<e.m_levels.size(); ++i) {
+		const MipLevel & src = e.m_levels[i-1];
+		const MipLevel & dst = e.m_levels[i];
+		const uchar * s = data + src.m_offset;
+		uchar * d = data + dst.m_offset;
+		for (quint32 y=0; y<dst.m_height; ++y) {
+			quint32 y0 = std::min(2*y, src.m_height-1);
+			quint32 y1 = std::min(2*y+1, src.m_height-1);
+			for (quint32 x=0; x<dst.m_width; ++x) {
+				quint32 x0 = std::min(2*x, src.m_width-1);
+				quint32 x1 = std::min(2*x+1, src.m_width-1);
+				const uchar * p00 = s + (y0*src.m_width + x0)*4;
+				const uchar * p01 = s + (y0*src.m_width + x1)*4;
+				const uchar * p10 = s + (y1*src.m_width + x0)*4;
+				const uchar * p11 = s + (y1*src.m_width + x1)*4;
+				for (int c=0; c<4; ++c)
+					d[c] = uchar((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+				d += 4;
+			}
+		}
+	}
+}
+
+
+void TextureManager::releaseData(Entry & e) {
+	delete e.m_cacheFile; // closing the file also unmaps it
+	e.m_cacheFile = nullptr;
+	e.m_decodedData.clear();
+	e.m_data = nullptr;
+}
+
+
+int TextureManager::mipLevelCount(int width, int height) {
+	int levels = 1;
+	while (width > 1 || height > 1) {
+		width = std::max(1, width/2);
+		height = std::max(1, height/2);
+		++levels;
+	}
+	return levels;
+}
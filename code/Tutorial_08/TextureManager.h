@@ -0,0 +1,167 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef TEXTUREMANAGER_H
+#define TEXTUREMANAGER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+class QFile;
+class QImage;
+class QOpenGLTexture;
+QT_END_NAMESPACE
+
+/*! Loads textures with pre-generated mip chains into a single texture array.
+
+	All textures are packed as layers of one GL_TEXTURE_2D_ARRAY, so that any number of materials can be
+	used with a single texture unit and a single draw call: geometry selects the layer through a per-vertex
+	texture index. All layers share the same size (see setLayerSize()), images of different size are
+	scaled when decoded.
+
+	Images are decoded in a pool of worker threads. The worker converts the image to RGBA8, computes the
+	complete mip chain (box filter) and writes it into a cache file. On subsequent launches, the worker
+	only hashes the source file, finds the cache file and memory-maps it, so neither image decoding nor
+	mipmap generation is done again.
+
+	Cache file layout (native byte order, the cache is never shared between machines):
+	\code
+	char[4]   magic "T8MC"
+	quint32   version
+	quint32   width, height (level 0)
+	quint32   level count
+	level count x { quint32 width, height, offset, size }
+	RGBA8 pixel data of all levels (offsets relative to file start, 16-byte aligned)
+	\endcode
+
+	The texture array is created in uploadDecoded(), which must be called with the context current.
+	Whenever a decode job has finished, the signal textureDecoded() is emitted (from the worker thread),
+	so the view can schedule a repaint and upload the new layer. Images that cannot be loaded are
+	reported with a warning and their layer stays empty.
+
+	\code
+	// in initializeGL()
+	m_textureManager.load(QStringList() << ":/textures/brickwall.jpg" << ":/textures/plaster.jpg");
+
+	// in the constructor of the view
+	connect(&m_textureManager, &TextureManager::textureDecoded, this, &SceneView::renderLater);
+
+	// in paintGL()
+	if (m_textureManager.uploadDecoded()) {
+		m_textureManager.texture()->bind(0);
+		...
+	}
+	\endcode
+*/
+class TextureManager : public QObject {
+	Q_OBJECT
+public:
+	TextureManager();
+	/*! Waits for running decode jobs and releases memory-mapped cache files. */
+	~TextureManager();
+
+	/*! Starts decoding the given image files in the worker pool, the textures get indexes in the order of the files.
+		Can be called before the OpenGL context exists.
+	*/
+	void load(const QStringList & fileNames);
+
+	/*! Creates the texture array (on first call) and uploads the mip levels of all images decoded so far.
+		Must be called with the context current, never waits for decode jobs.
+		Layers of images that could not be loaded are skipped (with a warning) and stay empty.
+		\return Returns true, if all layers are resident or skipped.
+	*/
+	bool uploadDecoded();
+
+	/*! Returns the texture array, or nullptr, if not yet created. */
+	QOpenGLTexture * texture() const { return m_textureArray; }
+
+	/*! Number of textures passed to load() (= layers of the texture array). */
+	int count() const { return m_entries.count(); }
+
+	/*! Sets the size of the texture array layers, must be called before load(). */
+	void setLayerSize(const QSize & layerSize) { m_layerSize = layerSize; }
+
+	/*! Destroys the texture array (context must be current). */
+	void destroy();
+
+	/*! Directory where cache files are stored. */
+	static QString cacheDirectory();
+
+	/*! If false, images are always decoded and no cache files are written. */
+	static bool m_cacheEnabled;
+
+signals:
+	/*! Emitted from the worker thread, whenever a decode job has finished (successfully or not). */
+	void textureDecoded();
+
+private:
+	/*! Dimensions and location of a mip level within the pixel data. */
+	struct MipLevel {
+		quint32		m_width;
+		quint32		m_height;
+		quint32		m_offset;
+		quint32		m_size;
+	};
+
+	enum State {
+		Pending,
+		Decoded,
+		Failed,
+		Resident,
+		/*! Failed and reported, the layer stays empty. */
+		Skipped
+	};
+
+	/*! Data of a single texture, written by the worker until state is Decoded/Failed, afterwards only by uploadDecoded(). */
+	struct Entry {
+		QString					m_fileName;
+		/*! Size the image is scaled to. */
+		QSize					m_size;
+		std::atomic<int>		m_state;
+		/*! Error message, if state is Failed. */
+		QString					m_error;
+		std::vector<MipLevel>	m_levels;
+		/*! Points to the start of the mapped cache file or to m_decodedData. */
+		const uchar				*m_data = nullptr;
+		/*! Memory-mapped cache file, nullptr if image was decoded. */
+		QFile					*m_cacheFile = nullptr;
+		/*! Mip chain data in cache file layout, if image was decoded. */
+		QByteArray				m_decodedData;
+	};
+
+	class DecodeTask;
+
+	/*! Decode job, run in worker thread. */
+	static void decode(Entry & e);
+	/*! Maps the cache file, returns false if missing or invalid. */
+	static bool mapCacheFile(const QString & cacheFilePath, Entry & e);
+	/*! Computes the mip chain of an RGBA8888 image and stores it in cache file layout in e.m_decodedData. */
+	static void generateMipChain(const QImage & img, Entry & e);
+	/*! Releases pixel data (unmaps the cache file). */
+	static void releaseData(Entry & e);
+	/*! Number of mip levels of a complete mip chain, same as created by glGenerateMipmap(). */
+	static int mipLevelCount(int width, int height);
+
+	QList<Entry*>				m_entries;
+	QThreadPool					m_pool;
+	QSize						m_layerSize;
+	QOpenGLTexture				*m_textureArray;
+};
+
+#endif // TEXTUREMANAGER_H
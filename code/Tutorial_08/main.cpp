@@ -19,6 +19,7 @@ License    : BSD License,
 
 #include "OpenGLException.h"
 #include "DebugApplication.h"
+#include "TextureManager.h"
 
 void qDebugMsgHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
 	(void) context;
@@ -43,6 +44,10 @@ int main(int argc, char **argv) {
 
 	qsrand(time(nullptr));
 
+	// --no-texture-cache : always decode images and generate mipmaps
+	if (app.arguments().contains("--no-texture-cache"))
+		TextureManager::m_cacheEnabled = false;
+
 	TestDialog dlg;
 	dlg.show();
 	return app.exec();
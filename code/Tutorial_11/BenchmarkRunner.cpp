@@ -0,0 +1,152 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "BenchmarkRunner.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QQuaternion>
+#include <QtMath>
+#include <QFile>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "SceneView.h"
+#include "SoftwareOcclusionCuller.h"
+#include "OpenGLException.h"
+
+/*! Returns an object with mean, min, max and the 50/90/95/99 percentiles of the given values. */
+static QJsonObject statistics(std::vector<double> values) {
+	QJsonObject stats;
+	if (values.empty())
+		return stats;
+	std::sort(values.begin(), values.end());
+	double sum = 0;
+	for (double v : values)
+		sum += v;
+	// nearest-rank percentile
+	auto percentile = [&values](double p) {
+		size_t rank = (size_t)std::ceil(p/100.*values.size());
+		return values[std::max<size_t>(rank, 1) - 1];
+	};
+	stats["mean"] = sum/values.size();
+	stats["min"] = values.front();
+	stats["p50"] = percentile(50);
+	stats["p90"] = percentile(90);
+	stats["p95"] = percentile(95);
+	stats["p99"] = percentile(99);
+	stats["max"] = values.back();
+	return stats;
+}
+
+
+void BenchmarkRunner::Parameters::parseArguments(const QStringList & args) {
+	for (const QString & arg : args) {
+		if (arg.startsWith("--frames="))
+			m_frameCount = arg.mid(9).toUInt();
+		else if (arg.startsWith("--warmup="))
+			m_warmupFrameCount = arg.mid(9).toUInt();
+		else if (arg.startsWith("--size=")) {
+			QStringList tokens = arg.mid(7).split('x');
+			if (tokens.size() == 2)
+				m_size = QSize(tokens[0].toInt(), tokens[1].toInt());
+		}
+		else if (arg.startsWith("--benchmark-output="))
+			m_outputFile = arg.mid(19);
+	}
+}
+
+
+int BenchmarkRunner::run(SceneView & view, const QString & sceneName, const Parameters & params) {
+	FUNCID(BenchmarkRunner::run);
+	try {
+		QElapsedTimer initTimer;
+		initTimer.start();
+		view.m_logFrameTimes = false;
+		view.initOffscreen(params.m_size);
+		double initMs = initTimer.nsecsElapsed()*1e-6;
+
+		std::vector<double> cpuTimes, gpuTimes, wallTimes, occlusionTimes, triangleCounts;
+		unsigned int drawCalls = 0;
+		unsigned int triangles = 0;
+		unsigned int totalFrames = params.m_warmupFrameCount + params.m_frameCount;
+		for (unsigned int i=0; i<totalFrames; ++i) {
+			// camera orbits once around the target during the measured frames
+			double angle = 2*M_PI*i/qMax(1u, params.m_frameCount);
+			QVector3D pos = params.m_target + QVector3D(float(params.m_radius*std::cos(angle)), params.m_height,
+														float(params.m_radius*std::sin(angle)));
+			// the camera looks along its local -z axis
+			QQuaternion rot = QQuaternion::fromDirection(pos - params.m_target, QVector3D(0,1,0));
+			view.setCamera(pos, rot);
+
+			QElapsedTimer frameTimer;
+			frameTimer.start();
+			view.renderOffscreen();
+			// waitForSamples() in paintGL() has already synchronized with the GPU
+			double wallMs = frameTimer.nsecsElapsed()*1e-6;
+			if (i < params.m_warmupFrameCount)
+				continue;
+
+			const SceneView::FrameStats & stats = view.lastFrameStats();
+			cpuTimes.push_back(stats.m_cpuMs);
+			gpuTimes.push_back(stats.m_gpuMs);
+			wallTimes.push_back(wallMs);
+			occlusionTimes.push_back(stats.m_occlusionMs);
+			triangleCounts.push_back(stats.m_triangles);
+			drawCalls = qMax(drawCalls, stats.m_drawCalls);
+			triangles = qMax(triangles, stats.m_triangles);
+		}
+
+		QOpenGLFunctions * f = QOpenGLContext::currentContext()->functions();
+		QJsonObject result;
+		result["scene"] = sceneName;
+		result["renderer"] = QString::fromLatin1(reinterpret_cast<const char*>(f->glGetString(GL_RENDERER)));
+		result["glVersion"] = QString::fromLatin1(reinterpret_cast<const char*>(f->glGetString(GL_VERSION)));
+		result["width"] = params.m_size.width();
+		result["height"] = params.m_size.height();
+		result["workload"] = QString("orbit");
+		result["frames"] = int(cpuTimes.size());
+		result["initMs"] = initMs;
+		result["drawCalls"] = int(drawCalls);
+		result["triangles"] = int(triangles);
+		// with occlusion culling, the number of triangles varies along the camera path
+		result["trianglesPerFrame"] = statistics(triangleCounts);
+		result["cpuFrameMs"] = statistics(cpuTimes);
+		result["gpuFrameMs"] = statistics(gpuTimes);
+		result["wallFrameMs"] = statistics(wallTimes);
+		result["occlusionCulling"] = SoftwareOcclusionCuller::m_enabled;
+		result["depthPrepass"] = view.m_depthPrepass;
+		result["occlusionMs"] = statistics(occlusionTimes);
+
+		QByteArray json = QJsonDocument(result).toJson();
+		if (params.m_outputFile.isEmpty()) {
+			std::cout << json.constData() << std::endl;
+		}
+		else {
+			QFile file(params.m_outputFile);
+			if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size())
+				throw OpenGLException(QString("Cannot write benchmark results to %1").arg(params.m_outputFile), FUNC_ID);
+			qDebug() << "Benchmark results written to" << params.m_outputFile;
+		}
+	}
+	catch (OpenGLException & ex) {
+		ex.writeMsgStackToStream(std::cerr);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,63 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef BENCHMARKRUNNER_H
+#define BENCHMARKRUNNER_H
+
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector3D>
+
+class SceneView;
+
+/*! Renders a scene headless (offscreen surface + framebuffer object) along a scripted camera path
+	and reports frame time percentiles, draw calls and triangle counts as JSON.
+
+	Works on machines without GPU, for example with Mesa llvmpipe and QT_QPA_PLATFORM=offscreen:
+
+	\code
+	QT_QPA_PLATFORM=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./Tutorial_11 --benchmark --frames=300 --benchmark-output=result.json
+	\endcode
+
+	Example06 contains a copy of this class, as every tutorial directory is a standalone project. Keep
+	Parameters, statistics() and the common JSON fields of both copies identical, so that results can be
+	compared; only the scene-specific counters differ.
+*/
+class BenchmarkRunner {
+public:
+	/*! Benchmark settings. */
+	struct Parameters {
+		/*! Number of frames to measure. */
+		unsigned int	m_frameCount = 300;
+		/*! Number of frames rendered before measurement starts (not included in statistics). */
+		unsigned int	m_warmupFrameCount = 10;
+		/*! Size of the offscreen framebuffer. */
+		QSize			m_size = QSize(1280, 720);
+		/*! Camera path: the camera orbits once around m_target at distance m_radius and height m_height. */
+		QVector3D		m_target = QVector3D(0, 0, 0);
+		float			m_radius = 300;
+		float			m_height = 120;
+		/*! File to write JSON results to, if empty results are printed to stdout. */
+		QString			m_outputFile;
+
+		/*! Reads --frames=N, --warmup=N, --size=WxH and --benchmark-output=file from command line arguments. */
+		void parseArguments(const QStringList & args);
+	};
+
+	/*! Initializes the scene view for offscreen rendering, runs the benchmark and writes the results.
+		The scene view must have its surface format set, but must not be shown.
+		Returns 0 on success, 1 on error (suitable as application exit code).
+	*/
+	static int run(SceneView & view, const QString & sceneName, const Parameters & params);
+};
+
+#endif // BENCHMARKRUNNER_H
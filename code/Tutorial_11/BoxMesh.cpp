@@ -37,6 +37,15 @@ void BoxMesh::transform(const QMatrix4x4 & transform) {
 }
 
 
+void BoxMesh::boundingBox(QVector3D & minCorner, QVector3D & maxCorner) const {
+	minCorner = maxCorner = m_vertices[0];
+	for (const QVector3D & v : m_vertices) {
+		minCorner = QVector3D(qMin(minCorner.x(), v.x()), qMin(minCorner.y(), v.y()), qMin(minCorner.z(), v.z()));
+		maxCorner = QVector3D(qMax(maxCorner.x(), v.x()), qMax(maxCorner.y(), v.y()), qMax(maxCorner.z(), v.z()));
+	}
+}
+
+
 void BoxMesh::copy2Buffer(Vertex *& vertexBuffer, GLuint *& elementBuffer, unsigned int & elementStartIndex) const {
 	std::vector<QColor> cols;
 	Q_ASSERT(!m_colors.empty());
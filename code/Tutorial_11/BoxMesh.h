@@ -43,6 +43,9 @@ public:
 	/*! Transforms the box (in-place operation, mind precision loss if used repetively). */
 	void transform(const QMatrix4x4 & transform);
 
+	/*! Computes the axis-aligned bounding box of the (transformed) box. */
+	void boundingBox(QVector3D & minCorner, QVector3D & maxCorner) const;
+
 	/*! Fills in vertex data in a buffer, provided by the caller.
 		The vertex data is stored interleaved, "coordinates(vec3)-color(vec3)-coordinates(vec3)-...".
 
@@ -12,11 +12,19 @@ License    : BSD License,
 #include "BoxObject.h"
 
 #include <QVector3D>
+#include <QOpenGLContext>
 #include <QOpenGLShaderProgram>
 
+#include <algorithm>
+
+typedef void (QOPENGLF_APIENTRYP MultiDrawElements)(GLenum mode, const GLsizei * count, GLenum type,
+													 const void * const * indices, GLsizei drawcount);
+
 BoxObject::BoxObject() :
+	m_visibleBoxCount(0),
 	m_vbo(QOpenGLBuffer::VertexBuffer), // actually the default, so default constructor would have been enough
-	m_ebo(QOpenGLBuffer::IndexBuffer) // make this an Index Buffer
+	m_ebo(QOpenGLBuffer::IndexBuffer), // make this an Index Buffer
+	m_multiDrawElements(nullptr)
 {
 
 	// create first box
@@ -66,6 +74,45 @@ BoxObject::BoxObject() :
 		m_boxes.push_back(b);
 	}
 
+	// sort the boxes by grid cell (the first box is centered on a cell, too), the order of the boxes on a
+	// cell is kept; this makes the boxes of a chunk a contiguous range of elements
+	std::vector<std::pair<int, unsigned int> > order; // (cell, box index)
+	std::vector<SoftwareOcclusionCuller::BoundingBox> bounds(m_boxes.size());
+	for (unsigned int i=0; i<m_boxes.size(); ++i) {
+		QVector3D minCorner, maxCorner;
+		m_boxes[i].boundingBox(minCorner, maxCorner);
+		SoftwareOcclusionCuller::BoundingBox & b = bounds[i];
+		for (int j=0; j<3; ++j) {
+			b.m_min[j] = minCorner[j];
+			b.m_max[j] = maxCorner[j];
+		}
+		int xCell = qRound(0.5f*(b.m_min[0] + b.m_max[0])/GRID_SPACING_XZ);
+		int zCell = qRound(0.5f*(b.m_min[2] + b.m_max[2])/GRID_SPACING_XZ);
+		order.push_back(std::make_pair((xCell + GridDim)*(3*GridDim) + zCell + GridDim, i));
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<BoxMesh> boxes;
+	for (unsigned int i=0; i<order.size(); ++i) {
+		const SoftwareOcclusionCuller::BoundingBox & b = bounds[order[i].second];
+		boxes.push_back(m_boxes[order[i].second]);
+		m_boxBounds.push_back(b);
+		if (i == 0 || order[i].first != order[i-1].first) {
+			Chunk c;
+			c.m_firstBox = i;
+			c.m_boxCount = 0;
+			c.m_bounds = b;
+			m_chunks.push_back(c);
+		}
+		Chunk & c = m_chunks.back();
+		++c.m_boxCount;
+		for (int j=0; j<3; ++j) {
+			c.m_bounds.m_min[j] = std::min(c.m_bounds.m_min[j], b.m_min[j]);
+			c.m_bounds.m_max[j] = std::max(c.m_bounds.m_max[j], b.m_max[j]);
+		}
+	}
+	m_boxes.swap(boxes);
+
 	unsigned int NBoxes = m_boxes.size();
 
 	// resize storage arrays
@@ -119,6 +166,10 @@ void BoxObject::create(QOpenGLShaderProgram * shaderProgramm) {
 	m_vao.release();
 	m_vbo.release();
 	m_ebo.release();
+
+	// core since OpenGL 1.4, but not part of QOpenGLFunctions
+	m_multiDrawElements = QOpenGLContext::currentContext()->getProcAddress("glMultiDrawElements");
+	Q_ASSERT(m_multiDrawElements != nullptr);
 }
 
 
@@ -139,3 +190,39 @@ void BoxObject::render() {
 	// release vertices again
 	m_vao.release();
 }
+
+
+void BoxObject::renderVisible() {
+	if (m_drawCounts.empty())
+		return;
+	m_vao.bind();
+	reinterpret_cast<MultiDrawElements>(m_multiDrawElements)(GL_TRIANGLES, m_drawCounts.data(), GL_UNSIGNED_INT,
+															   m_drawOffsets.data(), GLsizei(m_drawCounts.size()));
+	m_vao.release();
+}
+
+
+unsigned int BoxObject::cull(const SoftwareOcclusionCuller & culler) {
+	m_drawCounts.clear();
+	m_drawOffsets.clear();
+	m_visibleBoxCount = 0;
+	// index after the last box of the current range, ranges of consecutive visible boxes are merged
+	unsigned int rangeEnd = 0;
+	for (const Chunk & c : m_chunks) {
+		if (culler.isOccluded(c.m_bounds))
+			continue;
+		for (unsigned int i=c.m_firstBox; i<c.m_firstBox + c.m_boxCount; ++i) {
+			if (culler.isOccluded(m_boxBounds[i]))
+				continue;
+			++m_visibleBoxCount;
+			if (!m_drawCounts.empty() && rangeEnd == i)
+				m_drawCounts.back() += BoxMesh::IndexCount;
+			else {
+				m_drawCounts.push_back(BoxMesh::IndexCount);
+				m_drawOffsets.push_back(reinterpret_cast<const void*>(size_t(i)*BoxMesh::IndexCount*sizeof(GLuint)));
+			}
+			rangeEnd = i + 1;
+		}
+	}
+	return m_visibleBoxCount*BoxMesh::IndexCount;
+}
@@ -19,10 +19,18 @@ QT_BEGIN_NAMESPACE
 class QOpenGLShaderProgram;
 QT_END_NAMESPACE
 
+#include <vector>
+
 #include "BoxMesh.h"
+#include "SoftwareOcclusionCuller.h"
 
 /*! A container for all the boxes.
 	Basically creates the geometry of the individual boxes and populates the buffers.
+
+	The boxes are sorted by grid cell, so that the boxes stacked on one cell (a chunk) occupy a contiguous
+	range of the element buffer. cull() tests the chunks and then their boxes against the software occlusion
+	culler and collects the element ranges of the visible boxes, drawn by renderVisible() with a single
+	glMultiDrawElements() call.
 */
 class BoxObject {
 public:
@@ -32,9 +40,27 @@ public:
 	void create(QOpenGLShaderProgram * shaderProgramm);
 	void destroy();
 
+	/*! Draws all boxes. */
 	void render();
+	/*! Draws the boxes found visible in the last call to cull(). */
+	void renderVisible();
+
+	/*! Selects the boxes not hidden by the occluders of the culler, returns the number of elements to draw. */
+	unsigned int cull(const SoftwareOcclusionCuller & culler);
+
+	/*! Boxes stacked on the same grid cell, a contiguous range of m_boxes. */
+	struct Chunk {
+		unsigned int							m_firstBox;
+		unsigned int							m_boxCount;
+		SoftwareOcclusionCuller::BoundingBox	m_bounds;
+	};
 
 	std::vector<BoxMesh>		m_boxes;
+	/*! Bounding boxes of all boxes, also used as occluders. */
+	std::vector<SoftwareOcclusionCuller::BoundingBox>	m_boxBounds;
+	std::vector<Chunk>			m_chunks;
+	/*! Number of boxes selected in the last call to cull(). */
+	unsigned int				m_visibleBoxCount;
 
 	std::vector<Vertex>			m_vertexBufferData;
 	std::vector<GLuint>			m_elementBufferData;
@@ -46,6 +72,13 @@ public:
 	QOpenGLBuffer				m_vbo;
 	/*! Holds elements. */
 	QOpenGLBuffer				m_ebo;
+
+private:
+	/*! Element counts and byte offsets of the ranges to draw in renderVisible(), set in cull(). */
+	std::vector<GLsizei>		m_drawCounts;
+	std::vector<const void*>	m_drawOffsets;
+	/*! glMultiDrawElements(), resolved in create(). */
+	QFunctionPointer			m_multiDrawElements;
 };
 
 #endif // BOXOBJECT_H
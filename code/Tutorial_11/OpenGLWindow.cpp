@@ -18,17 +18,84 @@ Source code is based on Qt Example OpenGLWindow, but has been simplified a lot.
 
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLPaintDevice>
+#include <QtGui/QOpenGLFramebufferObject>
+#include <QtGui/QOffscreenSurface>
 #include <QtGui/QPainter>
 
 OpenGLWindow::OpenGLWindow(QWindow *parent) :
 	QWindow(parent),
 	m_context(nullptr),
-	m_debugLogger(nullptr)
+	m_debugLogger(nullptr),
+	m_offscreenSurface(nullptr),
+	m_offscreenFbo(nullptr)
 {
 	setSurfaceType(QWindow::OpenGLSurface);
 }
 
 
+OpenGLWindow::~OpenGLWindow() {
+	// the framebuffer object must be released while the context is still alive and current
+	if (m_offscreenFbo != nullptr) {
+		makeCurrent();
+		delete m_offscreenFbo;
+		m_context->doneCurrent();
+	}
+	delete m_offscreenSurface;
+}
+
+
+void OpenGLWindow::initOffscreen(const QSize & size) {
+	Q_ASSERT(m_context == nullptr);
+
+	m_context = new QOpenGLContext(this);
+	m_context->setFormat(requestedFormat());
+	m_context->create();
+
+	m_offscreenSurface = new QOffscreenSurface;
+	m_offscreenSurface->setFormat(m_context->format());
+	m_offscreenSurface->create();
+
+	m_context->makeCurrent(m_offscreenSurface);
+	Q_ASSERT(m_context->isValid());
+
+	// render target with same multisampling and depth buffer setup as the on-screen window
+	QOpenGLFramebufferObjectFormat fboFormat;
+	fboFormat.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	fboFormat.setSamples(requestedFormat().samples());
+	m_offscreenFbo = new QOpenGLFramebufferObject(size, fboFormat);
+	m_offscreenFbo->bind();
+
+	// the window is never shown, so we only store the geometry (needed in paintGL() for the viewport)
+	resize(size);
+
+	initializeContext();
+	resizeGL(size.width(), size.height());
+}
+
+
+void OpenGLWindow::renderOffscreen() {
+	Q_ASSERT(m_offscreenFbo != nullptr);
+	makeCurrent();
+	m_offscreenFbo->bind();
+
+	paintGL(); // call user code
+}
+
+
+GLuint OpenGLWindow::defaultFramebufferObject() const {
+	if (m_offscreenFbo != nullptr)
+		return m_offscreenFbo->handle();
+	return m_context->defaultFramebufferObject();
+}
+
+
+bool OpenGLWindow::makeCurrent() {
+	if (m_offscreenSurface != nullptr)
+		return m_context->makeCurrent(m_offscreenSurface);
+	return m_context->makeCurrent(this);
+}
+
+
 void OpenGLWindow::renderLater() {
 	// Schedule an UpdateRequest event in the event loop
 	// that will be send with the next VSync.
@@ -37,7 +104,7 @@ void OpenGLWindow::renderLater() {
 
 
 void OpenGLWindow::renderNow() {
-	if (!isExposed())
+	if (!isExposed() || m_offscreenSurface != nullptr)
 		return;
 
 	// initialize on first call
@@ -85,6 +152,10 @@ void OpenGLWindow::resizeEvent(QResizeEvent * event) {
 	if (m_context == nullptr)
 		initOpenGL();
 
+	// in offscreen mode, the framebuffer size is fixed
+	if (m_offscreenSurface != nullptr)
+		return;
+
 	resizeGL(width(), height());
 }
 
@@ -158,6 +229,11 @@ void OpenGLWindow::initOpenGL() {
 	m_context->makeCurrent(this);
 	Q_ASSERT(m_context->isValid());
 
+	initializeContext();
+}
+
+
+void OpenGLWindow::initializeContext() {
 	initializeOpenGLFunctions();
 
 #ifdef GL_DEBUG
@@ -21,18 +21,38 @@ Source code is based on Qt Example OpenGLWindow, but has been simplified a lot.
 
 QT_BEGIN_NAMESPACE
 class QOpenGLContext;
-class QOpenGLContext;
+class QOffscreenSurface;
+class QOpenGLFramebufferObject;
 QT_END_NAMESPACE
 
 /*! The OpenGLWindow is very similar to QOpenGLWindow, yet a little more light-weight.
 	Also, the functions initializeGL() and paintGL() are protected, as they are in
 	the QOpenGLWidget. Thus, you can easily switch to an QOpenGLWidget class later on,
 	if you need it.
+
+	For headless rendering (benchmarks), the window can be initialized with initOffscreen()
+	instead of being shown. Then, all rendering goes into a framebuffer object attached to an
+	offscreen surface and frames are rendered by calling renderOffscreen(). The offscreen code is the same as in
+	Example06/OpenGLWindow, keep both copies in sync.
 */
 class OpenGLWindow : public QWindow, protected QOpenGLFunctions {
 	Q_OBJECT
 public:
 	explicit OpenGLWindow(QWindow *parent = nullptr);
+	virtual ~OpenGLWindow() override;
+
+	/*! Initializes OpenGL for rendering into an offscreen framebuffer of the given size, without
+		showing the window. Works also with QT_QPA_PLATFORM=offscreen.
+	*/
+	void initOffscreen(const QSize & size);
+
+	/*! Renders a frame into the offscreen framebuffer (requires a previous call to initOffscreen()). */
+	void renderOffscreen();
+
+	/*! Returns the framebuffer object that paintGL() renders into, i.e. the offscreen framebuffer or
+		the window's default framebuffer. Use this instead of 0 when restoring the framebuffer binding.
+	*/
+	GLuint defaultFramebufferObject() const;
 
 public slots:
 	/*! Redirects to slot requestUpdate(), which registers an UpdateRequest event in the event loop
@@ -66,6 +86,8 @@ protected:
 	*/
 	virtual void paintGL() = 0;
 
+	/*! Makes the context current on either the window or the offscreen surface. */
+	bool makeCurrent();
 
 	QOpenGLContext		*m_context;
 
@@ -78,8 +100,17 @@ private slots:
 private:
 	/*! Helper function to initialize the OpenGL context. */
 	void initOpenGL();
+	/*! Helper function to initialize OpenGL functions and debug logger and to call initializeGL(),
+		the context must be current.
+	*/
+	void initializeContext();
 
 	QOpenGLDebugLogger	*m_debugLogger;
+
+	/*! Surface used for headless rendering, nullptr when rendering into the window. */
+	QOffscreenSurface			*m_offscreenSurface;
+	/*! Framebuffer object used as render target for headless rendering. */
+	QOpenGLFramebufferObject	*m_offscreenFbo;
 };
 
 #endif // OpenGLWindow_H
@@ -25,7 +25,11 @@ const unsigned int SHADOW_WIDTH = 4000, SHADOW_HEIGHT = 4000;
 QVector3D LIGHT_POS(500.0f, 1000.0f, -750.0f);
 
 SceneView::SceneView() :
+	m_logFrameTimes(true),
+	m_depthPrepass(false),
 	m_inputEventReceived(false),
+	m_renderDepthMap(false),
+	m_shadowsEnabled(true),
 	m_frameBufferObject(nullptr)
 {
 	// tell keyboard handler to monitor certain keys
@@ -55,7 +59,7 @@ SceneView::SceneView() :
 	grid.m_uniformNames.append("backColor"); // vec3
 	m_shaderPrograms.append( grid );
 
-	// Shaderprogram #2 : only for shadow/depth map
+	// Shaderprogram #2 : only for shadow/depth map and depth prepass
 	ShaderProgram shadow(":/shaders/depthMap.vert",":/shaders/depthMap.frag");
 	shadow.m_uniformNames.append("worldToView");
 	m_shaderPrograms.append( shadow );
@@ -77,7 +81,7 @@ SceneView::SceneView() :
 
 SceneView::~SceneView() {
 	if (m_context) {
-		m_context->makeCurrent(this);
+		makeCurrent();
 
 		for (ShaderProgram & p : m_shaderPrograms)
 			p.destroy();
@@ -97,8 +101,16 @@ void SceneView::initializeGL() {
 	FUNCID(SceneView::initializeGL);
 	try {
 		// initialize shader programs
-		for (ShaderProgram & p : m_shaderPrograms)
+		QElapsedTimer shaderTimer;
+		shaderTimer.start();
+		unsigned int cachedPrograms = 0;
+		for (ShaderProgram & p : m_shaderPrograms) {
 			p.create();
+			if (p.m_loadedFromCache)
+				++cachedPrograms;
+		}
+		qDebug() << "Shader programs created in" << shaderTimer.nsecsElapsed()*1e-6 << "ms ("
+				 << cachedPrograms << "of" << m_shaderPrograms.size() << "from program binary cache)";
 
 		// tell OpenGL to show only faces whose normal vector points towards us
 		glEnable(GL_CULL_FACE);
@@ -113,7 +125,7 @@ void SceneView::initializeGL() {
 		m_texture2ScreenObject.create(SHADER(3));
 
 		// Timer
-		m_gpuTimers.setSampleCount(7);
+		m_gpuTimers.setSampleCount(8);
 		m_gpuTimers.create();
 
 		// generate framebuffer for depth map
@@ -139,7 +151,7 @@ void SceneView::initializeGL() {
 		glReadBuffer(GL_NONE);
 		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
 			qDebug() << "Framebuffer complete";
-		glBindFramebuffer(GL_FRAMEBUFFER, 0); // unbind framebuffer
+		glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject()); // unbind framebuffer
 
 		QMatrix4x4 lightProjection;
 		float near_plane = 1.0f;
@@ -189,6 +201,10 @@ void SceneView::paintGL() {
 
 	m_gpuTimers.reset();
 
+	m_frameStats.m_drawCalls = 0;
+	m_frameStats.m_triangles = 0;
+	m_frameStats.m_occlusionMs = 0;
+
 	m_gpuTimers.recordSample(); // render shadow map
 
 	// *** render shadow map ***
@@ -200,14 +216,18 @@ void SceneView::paintGL() {
 
 		m_gpuTimers.recordSample(); // render main scene
 		m_boxObject.render();
+		++m_frameStats.m_drawCalls;
+		m_frameStats.m_triangles += m_boxObject.m_elementBufferData.size()/3;
 		SHADER(2)->release();
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// mind: when rendering offscreen, the default framebuffer is not 0
+	glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
 
 	m_gpuTimers.recordSample(); // render main scene
 
 	const qreal retinaScale = devicePixelRatio(); // needed for Macs with retina display
 	glViewport(0, 0, width() * retinaScale, height() * retinaScale);
-	qDebug() << "SceneView::paintGL(): Rendering to:" << width()* retinaScale << "x" << height()* retinaScale;
+	if (m_logFrameTimes)
+		qDebug() << "SceneView::paintGL(): Rendering to:" << width()* retinaScale << "x" << height()* retinaScale;
 
 	// set the background color = clear color
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -216,50 +236,96 @@ void SceneView::paintGL() {
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, depthMap);
 
-//#define RENDER_DEPTHMAP
-#ifdef RENDER_DEPTHMAP
-	glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
+	if (m_renderDepthMap) {
+		glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
 
-	//	// clear all relevant buffers
-	glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // set clear color to white (not really necessery actually, since we won't be able to see behind the quad anyways)
-	glClear(GL_COLOR_BUFFER_BIT);
+		//	// clear all relevant buffers
+		glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // set clear color to white (not really necessery actually, since we won't be able to see behind the quad anyways)
+		glClear(GL_COLOR_BUFFER_BIT);
+		glClearColor(0.1f, 0.15f, 0.3f, 1.0f); // restore background color for regular rendering
 
-	SHADER(3)->bind();
+		SHADER(3)->bind();
 
-//	m_gpuTimers.recordSample(); // render framebuffer
-	m_texture2ScreenObject.render();
-	glEnable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
+	//	m_gpuTimers.recordSample(); // render framebuffer
+		m_texture2ScreenObject.render();
+		++m_frameStats.m_drawCalls;
+		m_frameStats.m_triangles += 2;
+		glEnable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
+	}
+	else {
+		// *** render boxes ***
+
+		// the shadow map needs all boxes, the view only those not hidden behind other boxes
+		unsigned int elementCount = (unsigned int)m_boxObject.m_elementBufferData.size();
+		if (SoftwareOcclusionCuller::m_enabled) {
+			QElapsedTimer occlusionTimer;
+			occlusionTimer.start();
+			m_occlusionCuller.render(m_boxObject.m_boxBounds, m_worldToView);
+			elementCount = m_boxObject.cull(m_occlusionCuller);
+			m_frameStats.m_occlusionMs = occlusionTimer.nsecsElapsed()*1e-6;
+		}
+		// draws the selected boxes with the currently bound program
+		auto renderBoxes = [&]() {
+			if (SoftwareOcclusionCuller::m_enabled)
+				m_boxObject.renderVisible();
+			else
+				m_boxObject.render();
+			++m_frameStats.m_drawCalls;
+			m_frameStats.m_triangles += elementCount/3;
+		};
+
+		// optional depth prepass: only the depth of the boxes is written, the lit pass then shades only fragments
+		// with exactly this depth (gl_Position is invariant in both vertex shaders), i.e. each pixel once
+		m_gpuTimers.recordSample(); // depth prepass
+		if (m_depthPrepass) {
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			SHADER(2)->bind();
+			SHADER(2)->setUniformValue(m_shaderPrograms[2].m_uniformIDs[0], m_worldToView);
+			renderBoxes();
+			SHADER(2)->release();
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
 
-#else
-	// *** render boxes ***
+		// select shader variant - compiled on first use; only switched when shadows were toggled (F3), as
+		// setVariant() hashes the defines (the default variant has no defines)
+		if (m_shaderPrograms[0].variant().isEmpty() != m_shadowsEnabled)
+			m_shaderPrograms[0].setVariant(m_shadowsEnabled ? QStringList() : QStringList("NO_SHADOWS"));
 
-	SHADER(0)->bind();
-	SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[0], m_worldToView);
-	SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[1], m_lightSpaceMatrix);
-	SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[2], LIGHT_POS); // lightPos
-	SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[3], m_camera.translation()); // cameraPos
-	m_gpuTimers.recordSample(); // render main scene
-
-	m_boxObject.render();
-	SHADER(0)->release();
+		SHADER(0)->bind();
+		SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[0], m_worldToView);
+		SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[1], m_lightSpaceMatrix);
+		SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[2], LIGHT_POS); // lightPos
+		SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[3], m_camera.translation()); // cameraPos
+		SHADER(0)->setUniformValue(m_shaderPrograms[0].m_uniformIDs[4], 0); // uniform #4 = "shadowMap" -> bind to TEXTURE0
+		m_gpuTimers.recordSample(); // render main scene
 
+		renderBoxes();
+		SHADER(0)->release();
+		if (m_depthPrepass) {
+			// restore the default depth test for the grid
+			glDepthFunc(GL_LESS);
+			glDepthMask(GL_TRUE);
+		}
 
-	// *** render grid ***
 
-	QVector3D backColor(0.1f, 0.15f, 0.3f);
-	QVector3D gridColor(0.5f, 0.5f, 0.7f);
+		// *** render grid ***
 
-	m_gpuTimers.recordSample(); // render grid
-	SHADER(1)->bind();
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[0], m_worldToView);
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[1], gridColor);
-	SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[2], backColor);
+		QVector3D backColor(0.1f, 0.15f, 0.3f);
+		QVector3D gridColor(0.5f, 0.5f, 0.7f);
 
-	m_gpuTimers.recordSample(); // render main scene
-	m_gridObject.render();
-	SHADER(1)->release();
+		m_gpuTimers.recordSample(); // render grid
+		SHADER(1)->bind();
+		SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[0], m_worldToView);
+		SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[1], gridColor);
+		SHADER(1)->setUniformValue(m_shaderPrograms[1].m_uniformIDs[2], backColor);
 
-#endif // RENDER_DEPTHMAP
+		m_gpuTimers.recordSample(); // render main scene
+		m_gridObject.render();
+		++m_frameStats.m_drawCalls;
+		SHADER(1)->release();
+	}
 
 #if 0
 	// do some animation stuff
@@ -272,18 +338,52 @@ void SceneView::paintGL() {
 
 	checkInput();
 
-	QVector<GLuint64> intervals = m_gpuTimers.waitForIntervals();
-	for (GLuint64 it : intervals)
-		qDebug() << "  " << it*1e-6 << "ms/frame";
+	m_frameStats.m_cpuMs = m_cpuTimer.nsecsElapsed()*1e-6;
+
 	QVector<GLuint64> samples = m_gpuTimers.waitForSamples();
-	qDebug() << "Total render time: " << (samples.back() - samples.front())*1e-6 << "ms/frame";
+	m_frameStats.m_gpuMs = (samples.back() - samples.front())*1e-6;
+	if (m_logFrameTimes) {
+		QVector<GLuint64> intervals = m_gpuTimers.waitForIntervals();
+		for (GLuint64 it : intervals)
+			qDebug() << "  " << it*1e-6 << "ms/frame";
+		qDebug() << "Total render time: " << m_frameStats.m_gpuMs << "ms/frame";
+		if (m_depthPrepass && !m_renderDepthMap)
+			qDebug() << "Depth prepass enabled";
+		if (SoftwareOcclusionCuller::m_enabled && !m_renderDepthMap)
+			qDebug() << "Visible boxes: " << m_boxObject.m_visibleBoxCount << "of" << m_boxObject.m_boxes.size()
+					 << "(" << m_occlusionCuller.occluderCount() << "occluders," << m_frameStats.m_occlusionMs << "ms)";
+
+		qint64 elapsedMs = m_cpuTimer.elapsed();
+		qDebug() << "Total paintGL time: " << elapsedMs << "ms";
+	}
+}
 
-	qint64 elapsedMs = m_cpuTimer.elapsed();
-	qDebug() << "Total paintGL time: " << elapsedMs << "ms";
+
+void SceneView::setCamera(const QVector3D & position, const QQuaternion & rotation) {
+	m_camera.setTranslation(position);
+	m_camera.setRotation(rotation);
+	updateWorld2ViewMatrix();
 }
 
 
 void SceneView::keyPressEvent(QKeyEvent *event) {
+	// toggle render options
+	switch (event->key()) {
+		case Qt::Key_F2 :
+			m_renderDepthMap = !m_renderDepthMap;
+			renderLater();
+			return;
+		case Qt::Key_F3 :
+			m_shadowsEnabled = !m_shadowsEnabled;
+			renderLater();
+			return;
+		case Qt::Key_F4 :
+			m_depthPrepass = !m_depthPrepass;
+			qDebug() << "Depth prepass" << (m_depthPrepass ? "enabled" : "disabled");
+			renderLater();
+			return;
+		default:;
+	}
 	m_keyboardMouseHandler.keyPressEvent(event);
 	checkInput();
 }
@@ -24,6 +24,7 @@ License    : BSD License,
 #include "GridObject.h"
 #include "BoxObject.h"
 #include "Camera.h"
+#include "SoftwareOcclusionCuller.h"
 #include "Texture2ScreenObject.h"
 
 /*! The class SceneView extends the primitive OpenGLWindow
@@ -35,6 +36,33 @@ public:
 	SceneView();
 	virtual ~SceneView() override;
 
+	/*! Statistics of a rendered frame. */
+	struct FrameStats {
+		/*! CPU time spent in paintGL() in milliseconds (without waiting for GPU timer results). */
+		double			m_cpuMs = 0;
+		/*! GPU time for rendering the frame in milliseconds. */
+		double			m_gpuMs = 0;
+		/*! Number of draw calls issued. */
+		unsigned int	m_drawCalls = 0;
+		/*! Number of triangles drawn. */
+		unsigned int	m_triangles = 0;
+		/*! CPU time for rasterizing the occluders and culling the boxes in milliseconds. */
+		double			m_occlusionMs = 0;
+	};
+
+	/*! Statistics of the last frame rendered. */
+	const FrameStats & lastFrameStats() const { return m_frameStats; }
+
+	/*! Sets camera position and orientation, used for scripted camera paths (see BenchmarkRunner). */
+	void setCamera(const QVector3D & position, const QQuaternion & rotation);
+
+	/*! If true (the default), paintGL() prints render timings of each frame. */
+	bool m_logFrameTimes;
+	/*! If true, the boxes are drawn depth-only first and then shaded with GL_EQUAL depth test, so that
+		overdrawn fragments are not lit (toggle with F4).
+	*/
+	bool m_depthPrepass;
+
 protected:
 	void initializeGL() override;
 	void resizeGL(int width, int height) override;
@@ -63,6 +91,11 @@ private:
 	/*! If set to true, an input event was received, which will be evaluated at next repaint. */
 	bool						m_inputEventReceived;
 
+	/*! If true, the depth map is rendered to screen instead of the scene (toggle with F2). */
+	bool						m_renderDepthMap;
+	/*! If false, the scene is rendered with the shader variant without shadow map lookup (toggle with F3). */
+	bool						m_shadowsEnabled;
+
 	/*! The input handler, that encapsulates the event handling code. */
 	KeyboardMouseHandler		m_keyboardMouseHandler;
 
@@ -77,6 +110,8 @@ private:
 	QList<ShaderProgram>		m_shaderPrograms;
 
 	BoxObject					m_boxObject;
+	/*! Skips boxes hidden behind the nearest boxes, only used if SoftwareOcclusionCuller::m_enabled is set. */
+	SoftwareOcclusionCuller		m_occlusionCuller;
 	GridObject					m_gridObject;
 	Texture2ScreenObject		m_texture2ScreenObject;
 
@@ -89,6 +124,9 @@ private:
 
 	QOpenGLFramebufferObject	*m_frameBufferObject;
 
+	/*! Updated in each call to paintGL(). */
+	FrameStats					m_frameStats;
+
 };
 
 #endif // SCENEVIEW_H
@@ -12,13 +12,100 @@ License    : BSD License,
 #include "ShaderProgram.h"
 
 #include <QOpenGLShaderProgram>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
 #include <QDebug>
 
+#include <cstring>
+
 #include "OpenGLException.h"
 
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// Header of a cache file, followed by the program binary data.
+struct ProgramBinaryHeader {
+	quint32 m_magic;
+	quint32 m_version;
+	quint32 m_binaryFormat;
+	quint32 m_binaryLength;
+};
+
+static const quint32 PROGRAM_BINARY_MAGIC = 0x42505351; // "QSPB"
+static const quint32 PROGRAM_BINARY_VERSION = 1;
+
+bool ShaderProgram::m_binaryCacheEnabled = true;
+QString ShaderProgram::m_binaryCacheDir;
+
+
+/*! Returns true, if the current OpenGL context can retrieve and restore program binaries. */
+static bool programBinarySupported() {
+	QOpenGLContext * ctx = QOpenGLContext::currentContext();
+	if (ctx == nullptr)
+		return false;
+	if (ctx->format().version() < qMakePair(4,1) && !ctx->hasExtension(QByteArrayLiteral("GL_ARB_get_program_binary")))
+		return false;
+	GLint formatCount = 0;
+	ctx->functions()->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return formatCount > 0;
+}
+
+
+/*! Reads a shader source file (from file system or qrc) and throws an exception on error. */
+static QByteArray readShaderSource(const QString & filePath) {
+	FUNCID(readShaderSource);
+	QFile f(filePath);
+	if (!f.open(QIODevice::ReadOnly))
+		throw OpenGLException(QString("Cannot read shader source file %1").arg(filePath), FUNC_ID);
+	return f.readAll();
+}
+
+
+/*! Inserts preprocessor defines ("NAME" or "NAME=VALUE") into a shader source, right after the
+	#version line (which must remain the first statement).
+*/
+static QByteArray injectDefines(const QByteArray & source, const QStringList & defines) {
+	if (defines.isEmpty())
+		return source;
+	QByteArray defineLines;
+	for (const QString & d : defines) {
+		QStringList tokens = d.split('=');
+		defineLines += "#define " + tokens[0].trimmed().toLatin1();
+		if (tokens.size() > 1)
+			defineLines += " " + tokens[1].trimmed().toLatin1();
+		defineLines += "\n";
+	}
+	int pos = 0;
+	if (source.trimmed().startsWith("#version")) {
+		pos = source.indexOf('\n', source.indexOf("#version"));
+		if (pos == -1) // source consists only of the #version line
+			return source + "\n" + defineLines;
+		++pos;
+	}
+	QByteArray result = source;
+	result.insert(pos, defineLines);
+	return result;
+}
+
+
 ShaderProgram::ShaderProgram(const QString & vertexShaderFilePath, const QString & fragmentShaderFilePath) :
 	m_vertexShaderFilePath(vertexShaderFilePath),
 	m_fragmentShaderFilePath(fragmentShaderFilePath),
+	m_createTimeMs(0),
+	m_loadedFromCache(false),
 	m_program(nullptr)
 {
 }
@@ -28,28 +115,188 @@ void ShaderProgram::create() {
 	FUNCID(ShaderProgram::create);
 	Q_ASSERT(m_program == nullptr);
 
-	// build and compile our shader program
-	// ------------------------------------
+	// read the shader programs from the resource
+	m_vertexShaderSource = readShaderSource(m_vertexShaderFilePath);
+	m_fragmentShaderSource = readShaderSource(m_fragmentShaderFilePath);
 
-	m_program = new QOpenGLShaderProgram();
+	// build and compile the currently selected (usually the default) variant
+	try {
+		Variant v = compileVariant(m_defines);
+		m_variants[variantKey(m_defines)] = v;
+		m_program = v.m_program;
+		m_uniformIDs = v.m_uniformIDs;
+	}
+	catch (OpenGLException & ex) {
+		throw OpenGLException(ex, QString("Error creating shader program"), FUNC_ID);
+	}
+}
 
-	// read the shader programs from the resource
-	if (!m_program->addShaderFromSourceFile(QOpenGLShader::Vertex, m_vertexShaderFilePath))
-		throw OpenGLException(QString("Error compiling vertex shader %1:\n%2").arg(m_vertexShaderFilePath).arg(m_program->log()), FUNC_ID);
 
-	if (!m_program->addShaderFromSourceFile(QOpenGLShader::Fragment, m_fragmentShaderFilePath))
-		throw OpenGLException(QString("Error compiling fragment shader %1:\n%2").arg(m_fragmentShaderFilePath).arg(m_program->log()), FUNC_ID);
+void ShaderProgram::destroy() {
+	for (Variant & v : m_variants)
+		delete v.m_program;
+	m_variants.clear();
+	m_program = nullptr;
+}
+
+
+void ShaderProgram::bind() {
+	m_program->bind();
+}
+
 
-	if (!m_program->link())
-		throw OpenGLException(QString("Shader linker error:\n%2").arg(m_program->log()), FUNC_ID);
+void ShaderProgram::setVariant(const QStringList & defines) {
+	FUNCID(ShaderProgram::setVariant);
+	Q_ASSERT(m_program != nullptr); // create() must have been called before
+	QByteArray key = variantKey(defines);
+	QHash<QByteArray, Variant>::const_iterator it = m_variants.constFind(key);
+	if (it == m_variants.constEnd()) {
+		// compile on first use
+		try {
+			it = m_variants.insert(key, compileVariant(defines));
+		}
+		catch (OpenGLException & ex) {
+			throw OpenGLException(ex, QString("Error creating variant '%1'").arg(defines.join(",")), FUNC_ID);
+		}
+	}
+	m_defines = defines;
+	m_program = it->m_program;
+	m_uniformIDs = it->m_uniformIDs;
+}
+
+
+ShaderProgram::Variant ShaderProgram::compileVariant(const QStringList & defines) {
+	FUNCID(ShaderProgram::compileVariant);
+
+	QElapsedTimer timer;
+	timer.start();
+
+	QByteArray vertexShaderSource = injectDefines(m_vertexShaderSource, defines);
+	QByteArray fragmentShaderSource = injectDefines(m_fragmentShaderSource, defines);
+
+	Variant v;
+	v.m_program = new QOpenGLShaderProgram();
+
+	// the cache key is composed of the shader sources and the driver identification, so that
+	// any change in either automatically invalidates the cached binary
+	QString cacheFile;
+	if (m_binaryCacheEnabled && programBinarySupported()) {
+		// resolve default location only now, since it requires the application name to be set
+		if (m_binaryCacheDir.isEmpty())
+			m_binaryCacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shadercache";
+		QOpenGLFunctions * f = QOpenGLContext::currentContext()->functions();
+		QCryptographicHash hash(QCryptographicHash::Sha1);
+		hash.addData(vertexShaderSource);
+		hash.addData(fragmentShaderSource);
+		hash.addData(reinterpret_cast<const char*>(f->glGetString(GL_VENDOR)));
+		hash.addData(reinterpret_cast<const char*>(f->glGetString(GL_RENDERER)));
+		hash.addData(reinterpret_cast<const char*>(f->glGetString(GL_VERSION)));
+		cacheFile = m_binaryCacheDir + "/" + QString::fromLatin1(hash.result().toHex()) + ".bin";
+	}
+
+	try {
+		m_loadedFromCache = !cacheFile.isEmpty() && loadBinary(v.m_program, cacheFile);
+		if (!m_loadedFromCache) {
+			if (!v.m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource))
+				throw OpenGLException(QString("Error compiling vertex shader %1:\n%2").arg(m_vertexShaderFilePath).arg(v.m_program->log()), FUNC_ID);
+
+			if (!v.m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource))
+				throw OpenGLException(QString("Error compiling fragment shader %1:\n%2").arg(m_fragmentShaderFilePath).arg(v.m_program->log()), FUNC_ID);
+
+			// we want to retrieve the binary after linking
+			if (!cacheFile.isEmpty())
+				QOpenGLContext::currentContext()->extraFunctions()->glProgramParameteri(v.m_program->programId(),
+																						GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+			if (!v.m_program->link())
+				throw OpenGLException(QString("Shader linker error:\n%2").arg(v.m_program->log()), FUNC_ID);
+
+			if (!cacheFile.isEmpty())
+				storeBinary(v.m_program, cacheFile);
+		}
+	}
+	catch (...) {
+		delete v.m_program;
+		throw;
+	}
 
-	m_uniformIDs.clear();
 	for (const QString & uniformName : m_uniformNames)
-		m_uniformIDs.append( m_program->uniformLocation(uniformName));
+		v.m_uniformIDs.append( v.m_program->uniformLocation(uniformName));
+
+	m_createTimeMs = timer.nsecsElapsed()*1e-6;
+	qDebug().nospace() << "ShaderProgram " << m_vertexShaderFilePath << " + " << m_fragmentShaderFilePath
+					   << " [" << defines.join(",") << "]"
+					   << (m_loadedFromCache ? " loaded from cache in " : " compiled in ") << m_createTimeMs << " ms";
+	return v;
 }
 
 
-void ShaderProgram::destroy() {
-	delete m_program;
-	m_program = nullptr;
+QByteArray ShaderProgram::variantKey(const QStringList & defines) {
+	QStringList sortedDefines = defines;
+	sortedDefines.removeDuplicates();
+	sortedDefines.sort();
+	return QCryptographicHash::hash(sortedDefines.join("\n").toUtf8(), QCryptographicHash::Sha1);
+}
+
+
+bool ShaderProgram::loadBinary(QOpenGLShaderProgram * program, const QString & cacheFile) {
+	QFile f(cacheFile);
+	if (!f.open(QIODevice::ReadOnly))
+		return false; // no cached binary yet
+	QByteArray data = f.readAll();
+	f.close();
+
+	ProgramBinaryHeader header;
+	bool valid = data.size() >= int(sizeof(ProgramBinaryHeader));
+	if (valid) {
+		std::memcpy(&header, data.constData(), sizeof(ProgramBinaryHeader));
+		valid = header.m_magic == PROGRAM_BINARY_MAGIC &&
+				header.m_version == PROGRAM_BINARY_VERSION &&
+				header.m_binaryLength == quint32(data.size() - int(sizeof(ProgramBinaryHeader)));
+	}
+
+	if (valid) {
+		// create the (empty) program object and pass the binary to the driver
+		program->create();
+		QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+		f->glProgramBinary(program->programId(), header.m_binaryFormat,
+						   data.constData() + sizeof(ProgramBinaryHeader), GLsizei(header.m_binaryLength));
+		// link() detects the already linked program (no shaders attached) and only checks the link status
+		valid = program->link();
+	}
+
+	if (!valid) {
+		// the driver rejected the binary (or the file is corrupt), so remove it and compile from source
+		qDebug() << "Discarding stale program binary" << cacheFile;
+		QFile::remove(cacheFile);
+		program->removeAllShaders();
+	}
+	return valid;
+}
+
+
+void ShaderProgram::storeBinary(QOpenGLShaderProgram * program, const QString & cacheFile) {
+	QOpenGLExtraFunctions * f = QOpenGLContext::currentContext()->extraFunctions();
+	GLint length = 0;
+	f->glGetProgramiv(program->programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	QByteArray data(int(sizeof(ProgramBinaryHeader)) + length, Qt::Uninitialized);
+	ProgramBinaryHeader header;
+	header.m_magic = PROGRAM_BINARY_MAGIC;
+	header.m_version = PROGRAM_BINARY_VERSION;
+	GLenum binaryFormat = 0;
+	f->glGetProgramBinary(program->programId(), length, &length, &binaryFormat,
+						  data.data() + sizeof(ProgramBinaryHeader));
+	header.m_binaryFormat = binaryFormat;
+	header.m_binaryLength = quint32(length);
+	std::memcpy(data.data(), &header, sizeof(ProgramBinaryHeader));
+	data.resize(int(sizeof(ProgramBinaryHeader)) + length);
+
+	// write via QSaveFile, so that concurrently started applications never see half-written files
+	QDir().mkpath(m_binaryCacheDir);
+	QSaveFile file(cacheFile);
+	if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+		qWarning() << "Cannot write program binary cache file" << cacheFile;
 }
@@ -0,0 +1,436 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#include "SoftwareOcclusionCuller.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QThreadPool>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+bool SoftwareOcclusionCuller::m_enabled = true;
+bool SoftwareOcclusionCuller::m_sse2Enabled = true;
+const unsigned int SoftwareOcclusionCuller::Width;
+const unsigned int SoftwareOcclusionCuller::Height;
+const unsigned int SoftwareOcclusionCuller::BandHeight;
+
+/*! Corner indexes of the 6 faces of a box, counter-clockwise when seen from outside.
+	Bit 0 of a corner index selects max x, bit 1 max y and bit 2 max z.
+*/
+static const int BOX_FACES[6][4] = {
+	{0, 4, 6, 2},	// -x
+	{1, 3, 7, 5},	// +x
+	{0, 1, 5, 4},	// -y
+	{2, 6, 7, 3},	// +y
+	{0, 2, 3, 1},	// -z
+	{4, 5, 7, 6}	// +z
+};
+
+
+/*! Transforms the 8 corners of the box to window coordinates (x and y in pixels, depth 0..1).
+	m is the column-major world to view matrix. Returns false, if a corner is in front of the near plane.
+*/
+static bool projectBox(const float * m, const SoftwareOcclusionCuller::BoundingBox & box, float corners[8][3]) {
+	for (int i=0; i<8; ++i) {
+		const float x = (i & 1) ? box.m_max[0] : box.m_min[0];
+		const float y = (i & 2) ? box.m_max[1] : box.m_min[1];
+		const float z = (i & 4) ? box.m_max[2] : box.m_min[2];
+		const float cx = m[0]*x + m[4]*y + m[8]*z + m[12];
+		const float cy = m[1]*x + m[5]*y + m[9]*z + m[13];
+		const float cz = m[2]*x + m[6]*y + m[10]*z + m[14];
+		const float cw = m[3]*x + m[7]*y + m[11]*z + m[15];
+		if (cw <= 0 || cz < -cw)
+			return false;
+		corners[i][0] = (cx/cw*0.5f + 0.5f)*SoftwareOcclusionCuller::Width;
+		corners[i][1] = (cy/cw*0.5f + 0.5f)*SoftwareOcclusionCuller::Height;
+		corners[i][2] = cz/cw*0.5f + 0.5f;
+	}
+	return true;
+}
+
+
+SoftwareOcclusionCuller::SoftwareOcclusionCuller() :
+	m_maxOccluders(256),
+	m_occluderCount(0)
+{
+	for (unsigned int w = Width, h = Height; w > 0 && h > 0; w /= 2, h /= 2)
+		m_levels.push_back(std::vector<float>(w*h, 1.f));
+}
+
+
+void SoftwareOcclusionCuller::render(const std::vector<BoundingBox> & occluders, const QMatrix4x4 & worldToView) {
+	m_worldToView = worldToView;
+	const float * m = worldToView.constData();
+
+	// rank the boxes by projected size: squared diagonal over squared distance (clip w) of the center; ties are
+	// broken by index, so that the selection is deterministic
+	m_candidates.clear();
+	for (unsigned int i=0; i<occluders.size(); ++i) {
+		const BoundingBox & b = occluders[i];
+		float cx = 0.5f*(b.m_min[0] + b.m_max[0]);
+		float cy = 0.5f*(b.m_min[1] + b.m_max[1]);
+		float cz = 0.5f*(b.m_min[2] + b.m_max[2]);
+		float w = m[3]*cx + m[7]*cy + m[11]*cz + m[15];
+		if (w <= 0)
+			continue; // behind the camera
+		float dx = b.m_max[0] - b.m_min[0];
+		float dy = b.m_max[1] - b.m_min[1];
+		float dz = b.m_max[2] - b.m_min[2];
+		m_candidates.push_back(std::make_pair((dx*dx + dy*dy + dz*dz)/(w*w), i));
+	}
+	std::sort(m_candidates.begin(), m_candidates.end(),
+			  [](const std::pair<float, unsigned int> & a, const std::pair<float, unsigned int> & b) {
+		return a.first > b.first || (a.first == b.first && a.second < b.second);
+	});
+
+	m_occluders.clear();
+	m_occluderCount = 0;
+	for (const std::pair<float, unsigned int> & c : m_candidates) {
+		if (m_occluderCount == m_maxOccluders)
+			break;
+		float corners[8][3];
+		// boxes crossing the near plane would have to be clipped, they are simply not used as occluders
+		if (!projectBox(m, occluders[c.second], corners))
+			continue;
+		if (addOccluder(corners))
+			++m_occluderCount;
+	}
+
+	// rasterize in bands of rows, each band is written by one worker only
+	std::vector<int> bands;
+	for (unsigned int y=0; y<Height; y += BandHeight)
+		bands.push_back(int(y));
+	QtConcurrent::blockingMap(bands, [this](int yBegin) {
+		rasterizeBand(yBegin, std::min(yBegin + int(BandHeight), int(Height)));
+	});
+
+	buildHierarchy();
+}
+
+
+bool SoftwareOcclusionCuller::isOccluded(const BoundingBox & box) const {
+	float corners[8][3];
+	if (!projectBox(m_worldToView.constData(), box, corners))
+		return false;
+	float xMin = corners[0][0], xMax = corners[0][0];
+	float yMin = corners[0][1], yMax = corners[0][1];
+	float zMin = corners[0][2];
+	for (int i=1; i<8; ++i) {
+		xMin = std::min(xMin, corners[i][0]);
+		xMax = std::max(xMax, corners[i][0]);
+		yMin = std::min(yMin, corners[i][1]);
+		yMax = std::max(yMax, corners[i][1]);
+		zMin = std::min(zMin, corners[i][2]);
+	}
+	// outside the viewport: not our business, left to frustum culling
+	if (xMax < 0 || yMax < 0 || xMin > Width || yMin > Height)
+		return false;
+
+	// all pixels touched by the screen rectangle
+	int x0 = std::max(0, int(std::floor(xMin)));
+	int x1 = std::min(int(Width) - 1, int(std::floor(xMax)));
+	int y0 = std::max(0, int(std::floor(yMin)));
+	int y1 = std::min(int(Height) - 1, int(std::floor(yMax)));
+
+	// coarsest level, where the rectangle covers at most 2x2 texels
+	unsigned int level = 0;
+	while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+		++level;
+	const unsigned int w = Width >> level;
+	const float * depth = m_levels[level].data();
+	for (int y = y0 >> level; y <= y1 >> level; ++y)
+		for (int x = x0 >> level; x <= x1 >> level; ++x)
+			if (zMin <= depth[y*w + x])
+				return false;
+	return true;
+}
+
+
+bool SoftwareOcclusionCuller::addOccluder(const float corners[8][3]) {
+	Occluder o;
+
+	// pixels that can be fully inside the screen rectangle of the box (pixel x covers [x, x+1])
+	float xMin = corners[0][0], xMax = corners[0][0];
+	float yMin = corners[0][1], yMax = corners[0][1];
+	o.m_zMax = corners[0][2];
+	for (int i=1; i<8; ++i) {
+		xMin = std::min(xMin, corners[i][0]);
+		xMax = std::max(xMax, corners[i][0]);
+		yMin = std::min(yMin, corners[i][1]);
+		yMax = std::max(yMax, corners[i][1]);
+		o.m_zMax = std::max(o.m_zMax, corners[i][2]);
+	}
+	o.m_xMin = std::max(0, int(std::ceil(xMin)));
+	o.m_xMax = std::min(int(Width) - 1, int(std::floor(xMax)) - 1);
+	o.m_yMin = std::max(0, int(std::ceil(yMin)));
+	o.m_yMax = std::min(int(Height) - 1, int(std::floor(yMax)) - 1);
+	if (o.m_xMin > o.m_xMax || o.m_yMin > o.m_yMax)
+		return false;
+
+	// silhouette: convex hull of the projected corners (monotone chain), counter-clockwise
+	int order[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+	std::sort(order, order + 8, [&corners](int a, int b) {
+		return corners[a][0] < corners[b][0] || (corners[a][0] == corners[b][0] && corners[a][1] < corners[b][1]);
+	});
+	auto cross = [&corners](int o, int a, int b) {
+		return (corners[a][0] - corners[o][0])*(corners[b][1] - corners[o][1]) -
+				(corners[a][1] - corners[o][1])*(corners[b][0] - corners[o][0]);
+	};
+	int hull[16];
+	int n = 0;
+	for (int i=0; i<8; ++i) { // lower hull
+		while (n >= 2 && cross(hull[n-2], hull[n-1], order[i]) <= 0)
+			--n;
+		hull[n++] = order[i];
+	}
+	for (int i=6, lower=n+1; i>=0; --i) { // upper hull
+		while (n >= lower && cross(hull[n-2], hull[n-1], order[i]) <= 0)
+			--n;
+		hull[n++] = order[i];
+	}
+	--n; // last point is the first one
+	if (n < 3)
+		return false;
+
+	// edge function k is zero on the edge from hull point k to k+1 and positive inside, moved inwards by half
+	// a pixel, so that it is >= 0 only at centers of pixels entirely inside the silhouette
+	o.m_edgeCount = (unsigned int)n;
+	for (int k=0; k<n; ++k) {
+		const float * a = corners[hull[k]];
+		const float * b = corners[hull[k+1]];
+		o.m_edge[k][0] = a[1] - b[1];
+		o.m_edge[k][1] = b[0] - a[0];
+		o.m_edge[k][2] = -(o.m_edge[k][0]*a[0] + o.m_edge[k][1]*a[1]) -
+				0.5f*(std::fabs(o.m_edge[k][0]) + std::fabs(o.m_edge[k][1]));
+	}
+
+	// depth planes of the front faces; a view ray enters the (convex) box where it crosses the last of them,
+	// so the front surface depth is the maximum of all planes
+	o.m_depthCount = 0;
+	for (const int * face : BOX_FACES) {
+		const float * v[3] = { corners[face[0]], corners[face[1]], corners[face[2]] };
+		const float area = (v[1][0] - v[0][0])*(v[2][1] - v[0][1]) - (v[1][1] - v[0][1])*(v[2][0] - v[0][0]);
+		if (area <= 0)
+			continue; // back-facing or seen edge-on
+		// depth interpolated with the barycentric coordinates (edge function i / area)
+		float edge[3][3];
+		for (int i=0; i<3; ++i) {
+			const float * a = v[(i+1) % 3];
+			const float * b = v[(i+2) % 3];
+			edge[i][0] = a[1] - b[1];
+			edge[i][1] = b[0] - a[0];
+			edge[i][2] = -(edge[i][0]*a[0] + edge[i][1]*a[1]);
+		}
+		float * depth = o.m_depth[o.m_depthCount++];
+		for (int j=0; j<3; ++j)
+			depth[j] = (edge[0][j]*v[0][2] + edge[1][j]*v[1][2] + edge[2][j]*v[2][2])/area;
+		// farthest depth over the pixel around the center
+		depth[2] += 0.5f*(std::fabs(depth[0]) + std::fabs(depth[1]));
+	}
+	if (o.m_depthCount == 0)
+		return false;
+
+	m_occluders.push_back(o);
+	return true;
+}
+
+
+void SoftwareOcclusionCuller::rasterizeBand(int yBegin, int yEnd) {
+	float * depth = m_levels[0].data();
+	std::fill(depth + yBegin*Width, depth + yEnd*Width, 1.f);
+
+	// Both code paths perform the same float operations in the same order (min/max with the operand order of
+	// the SSE instructions), so that they give bit-identical results.
+	for (const Occluder & o : m_occluders) {
+		const int y0 = std::max(o.m_yMin, yBegin);
+		const int y1 = std::min(o.m_yMax, yEnd - 1);
+		// spans start at multiples of 4 (Width is a multiple of 4), pixels outside the occluder are masked out
+		const int x0 = o.m_xMin & ~3;
+		for (int y=y0; y<=y1; ++y) {
+			const float py = y + 0.5f;
+			float e[8];
+			for (unsigned int k=0; k<o.m_edgeCount; ++k)
+				e[k] = o.m_edge[k][1]*py + o.m_edge[k][2];
+			float z[6];
+			for (unsigned int k=0; k<o.m_depthCount; ++k)
+				z[k] = o.m_depth[k][1]*py + o.m_depth[k][2];
+			float * row = depth + y*Width;
+#ifdef OCCLUSION_USE_SSE2
+			if (m_sse2Enabled) {
+				const __m128 zero = _mm_setzero_ps();
+				const __m128 pixelOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+				const __m128 zMax = _mm_set1_ps(o.m_zMax);
+				for (int x=x0; x<=o.m_xMax; x += 4) {
+					const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), pixelOffsets);
+					__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(o.m_edge[0][0]), px), _mm_set1_ps(e[0])), zero);
+					for (unsigned int k=1; k<o.m_edgeCount; ++k)
+						inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(o.m_edge[k][0]), px),
+																			_mm_set1_ps(e[k])), zero));
+					__m128 pz = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(o.m_depth[0][0]), px), _mm_set1_ps(z[0]));
+					for (unsigned int k=1; k<o.m_depthCount; ++k)
+						pz = _mm_max_ps(pz, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(o.m_depth[k][0]), px), _mm_set1_ps(z[k])));
+					pz = _mm_min_ps(pz, zMax);
+					const __m128 old = _mm_loadu_ps(row + x);
+					const __m128 nearest = _mm_min_ps(old, pz);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+				}
+				continue;
+			}
+#endif
+			const int x1 = std::min(((o.m_xMax >> 2) << 2) + 3, int(Width) - 1);
+			for (int x=x0; x<=x1; ++x) {
+				const float px = x + 0.5f;
+				bool inside = true;
+				for (unsigned int k=0; inside && k<o.m_edgeCount; ++k)
+					inside = o.m_edge[k][0]*px + e[k] >= 0;
+				if (!inside)
+					continue;
+				float pz = o.m_depth[0][0]*px + z[0];
+				for (unsigned int k=1; k<o.m_depthCount; ++k) {
+					const float pk = o.m_depth[k][0]*px + z[k];
+					pz = pz > pk ? pz : pk;
+				}
+				pz = pz < o.m_zMax ? pz : o.m_zMax;
+				row[x] = row[x] < pz ? row[x] : pz;
+			}
+		}
+	}
+}
+
+
+void SoftwareOcclusionCuller::buildHierarchy() {
+	for (unsigned int l=1; l<m_levels.size(); ++l) {
+		const unsigned int w = Width >> l;
+		const unsigned int h = Height >> l;
+		const float * src = m_levels[l-1].data();
+		float * dst = m_levels[l].data();
+		for (unsigned int y=0; y<h; ++y) {
+			const float * r0 = src + 2*y*2*w;
+			const float * r1 = r0 + 2*w;
+			for (unsigned int x=0; x<w; ++x)
+				dst[y*w + x] = std::max(std::max(r0[2*x], r0[2*x+1]), std::max(r1[2*x], r1[2*x+1]));
+		}
+	}
+}
+
+
+/*! Returns a box with the given min and max coordinates. */
+static SoftwareOcclusionCuller::BoundingBox makeBox(float x0, float y0, float z0, float x1, float y1, float z1) {
+	SoftwareOcclusionCuller::BoundingBox b;
+	b.m_min[0] = x0; b.m_min[1] = y0; b.m_min[2] = z0;
+	b.m_max[0] = x1; b.m_max[1] = y1; b.m_max[2] = z1;
+	return b;
+}
+
+
+bool SoftwareOcclusionCuller::selfTest() {
+	// camera at z=20 looking along -z, the viewport has the aspect ratio of the depth buffer
+	QMatrix4x4 worldToView;
+	worldToView.perspective(60, float(Width)/Height, 0.1f, 100);
+	worldToView.lookAt(QVector3D(0, 0, 20), QVector3D(0, 0, 0), QVector3D(0, 1, 0));
+
+	bool ok = true;
+	SoftwareOcclusionCuller culler;
+
+	// *** a single occluder: wall of 4x4 units at z=0 ***
+
+	std::vector<BoundingBox> occluders(1, makeBox(-2, -2, -1, 2, 2, 0));
+	culler.render(occluders, worldToView);
+	if (culler.occluderCount() != 1) {
+		qWarning() << "Occlusion self test: occluder not rasterized";
+		ok = false;
+	}
+	if (!culler.isOccluded(makeBox(-0.5f, -0.5f, -6, 0.5f, 0.5f, -5))) {
+		qWarning() << "Occlusion self test: box behind the occluder is not occluded";
+		ok = false;
+	}
+	if (culler.isOccluded(makeBox(6, -0.5f, -6, 7, 0.5f, -5))) {
+		qWarning() << "Occlusion self test: box beside the occluder is occluded";
+		ok = false;
+	}
+	if (culler.isOccluded(makeBox(-0.5f, -0.5f, 1, 0.5f, 0.5f, 2))) {
+		qWarning() << "Occlusion self test: box in front of the occluder is occluded";
+		ok = false;
+	}
+
+	// *** two occluders with a gap of 0.1 units (about half a pixel) at the screen center x = Width/2 ***
+
+	occluders.clear();
+	occluders.push_back(makeBox(-3, -2, -1, -0.05f, 2, 0));
+	occluders.push_back(makeBox(0.05f, -2, -1, 3, 2, 0));
+	culler.render(occluders, worldToView);
+	if (culler.isOccluded(makeBox(-0.05f, -0.5f, -6, 0.05f, 0.5f, -5))) {
+		qWarning() << "Occlusion self test: box seen through a gap narrower than a pixel is occluded";
+		ok = false;
+	}
+	if (!culler.isOccluded(makeBox(-2.5f, -0.5f, -6, -1.5f, 0.5f, -5))) {
+		qWarning() << "Occlusion self test: box behind one of two occluders is not occluded";
+		ok = false;
+	}
+
+	// *** determinism: many overlapping occluders, rendered with different settings ***
+
+	// simple LCG, so that the scene is the same on all platforms
+	quint32 seed = 12345;
+	auto random = [&seed](float range) {
+		seed = seed*1664525u + 1013904223u;
+		return (seed >> 8)*(range/16777216.f);
+	};
+	occluders.clear();
+	for (unsigned int i=0; i<400; ++i) {
+		float x = random(40) - 20, y = random(20) - 10, z = random(30) - 25;
+		float dx = 0.5f + random(3), dy = 0.5f + random(3), dz = 0.5f + random(3);
+		occluders.push_back(makeBox(x, y, z, x + dx, y + dy, z + dz));
+	}
+	const size_t pixelCount = Width*Height;
+	culler.render(occluders, worldToView);
+	std::vector<float> reference(culler.depthBuffer(), culler.depthBuffer() + pixelCount);
+
+	culler.render(occluders, worldToView);
+	if (std::memcmp(reference.data(), culler.depthBuffer(), pixelCount*sizeof(float)) != 0) {
+		qWarning() << "Occlusion self test: depth buffer differs between two runs";
+		ok = false;
+	}
+
+	QThreadPool * pool = QThreadPool::globalInstance();
+	const int maxThreadCount = pool->maxThreadCount();
+	pool->setMaxThreadCount(1);
+	culler.render(occluders, worldToView);
+	pool->setMaxThreadCount(maxThreadCount);
+	if (std::memcmp(reference.data(), culler.depthBuffer(), pixelCount*sizeof(float)) != 0) {
+		qWarning() << "Occlusion self test: depth buffer differs between 1 and" << maxThreadCount << "threads";
+		ok = false;
+	}
+
+#ifdef OCCLUSION_USE_SSE2
+	const bool sse2Enabled = m_sse2Enabled;
+	m_sse2Enabled = !sse2Enabled;
+	culler.render(occluders, worldToView);
+	m_sse2Enabled = sse2Enabled;
+	if (std::memcmp(reference.data(), culler.depthBuffer(), pixelCount*sizeof(float)) != 0) {
+		qWarning() << "Occlusion self test: depth buffer differs between SSE2 and scalar rasterization";
+		ok = false;
+	}
+#else
+	qDebug() << "Occlusion self test: built without SSE2, scalar rasterization only";
+#endif
+
+	qDebug() << "Occlusion self test" << (ok ? "passed" : "FAILED");
+	return ok;
+}
@@ -0,0 +1,132 @@
+/************************************************************************************
+
+OpenGL with Qt - Tutorial
+-------------------------
+Autor      : Andreas Nicolai <andreas.nicolai@gmx.net>
+Repository : https://github.com/ghorwin/OpenGLWithQt-Tutorial
+License    : BSD License,
+			 see https://github.com/ghorwin/OpenGLWithQt-Tutorial/blob/master/LICENSE
+
+************************************************************************************/
+
+#ifndef SOFTWAREOCCLUSIONCULLER_H
+#define SOFTWAREOCCLUSIONCULLER_H
+
+#include <QMatrix4x4>
+
+#include <utility>
+#include <vector>
+
+/*! Occlusion culling on the CPU with a small software-rasterized depth buffer.
+
+	Each frame, render() selects the occluder boxes with the largest projected size and rasterizes them into a
+	depth buffer of Width x Height pixels. Occluders are rasterized conservatively: a pixel is only written if it
+	is completely inside the silhouette of the box (the convex hull of its projected corners), and it gets the
+	farthest depth of the box front surface over the whole pixel. So gaps between occluders remain empty, even
+	if they are narrower than a pixel. The buffer is split into horizontal bands, which
+	are rasterized in parallel by the worker threads of the global thread pool; each band writes only its own
+	rows, so the result does not depend on the number of threads. Spans of 4 pixels are processed with SSE2,
+	if available. Then a hierarchical depth buffer (max depth of 2x2 pixels per level) is built.
+
+	isOccluded() projects a bounding box, picks the level where its screen rectangle covers at most 2x2 texels
+	and compares the nearest depth of the box with the farthest depth of these texels. A box is only reported
+	as occluded, if it lies behind the occluders everywhere, so the test is conservative. Occluders crossing the
+	near plane are skipped, boxes crossing it are never occluded.
+
+	The class uses no OpenGL, so it can be tested and benchmarked without GPU (see selfTest()).
+
+	\code
+	m_occlusionCuller.render(occluderBoxes, worldToView);
+	if (!m_occlusionCuller.isOccluded(box))
+		draw(box);
+	\endcode
+*/
+class SoftwareOcclusionCuller {
+public:
+	/*! An axis-aligned bounding box in world coordinates. */
+	struct BoundingBox {
+		float	m_min[3];
+		float	m_max[3];
+	};
+
+	/*! Resolution of the depth buffer. */
+	static const unsigned int	Width = 256;
+	static const unsigned int	Height = 128;
+	/*! Height of the bands rasterized by one worker. */
+	static const unsigned int	BandHeight = 16;
+
+	SoftwareOcclusionCuller();
+
+	/*! Rasterizes (up to m_maxOccluders of) the boxes as occluders and builds the hierarchical depth buffer.
+		worldToView transforms world coordinates to clip space (projection included).
+	*/
+	void render(const std::vector<BoundingBox> & occluders, const QMatrix4x4 & worldToView);
+
+	/*! Returns true, if the box is hidden behind the occluders rasterized in the last call to render(). */
+	bool isOccluded(const BoundingBox & box) const;
+
+	/*! Depth buffer (normalized depth 0..1, 1 = empty), Width x Height values, row 0 at the bottom. */
+	const float * depthBuffer() const { return m_levels[0].data(); }
+	/*! Number of occluders rasterized in the last call to render(). */
+	unsigned int occluderCount() const { return m_occluderCount; }
+
+	/*! Renders a fixed scene without GPU and checks the results: a box behind a single occluder must be occluded,
+		boxes beside and in front of it must not, nor a box seen through a gap narrower than a pixel between two
+		occluders; the depth buffer of a larger scene must be identical when rendered
+		twice, with a single worker thread and with the scalar code path. Problems are logged, returns true if
+		all checks passed.
+
+		\code
+		QT_QPA_PLATFORM=offscreen ./Tutorial_11 --occlusion-selftest
+		\endcode
+	*/
+	static bool selfTest();
+
+	/*! Maximum number of occluders rasterized per frame. */
+	unsigned int				m_maxOccluders;
+
+	/*! If false, all boxes are drawn (for comparison). */
+	static bool					m_enabled;
+	/*! If false, spans are rasterized with the scalar code even if SSE2 is available (both give the same depth). */
+	static bool					m_sse2Enabled;
+
+private:
+	/*! An occluder box, prepared for rasterization (all functions of the form a*x + b*y + c in pixel coordinates
+		of the pixel center). A pixel is fully covered, if all edge functions are >= 0; the edges of the silhouette
+		are moved inwards by half a pixel for this. The depth of the front surface is the maximum of the depth
+		planes of the front faces (where a view ray enters the box), each moved back by the depth difference over
+		half a pixel, and limited to m_zMax.
+	*/
+	struct Occluder {
+		float			m_edge[8][3];
+		unsigned int	m_edgeCount;
+		float			m_depth[6][3];
+		unsigned int	m_depthCount;
+		/*! Largest depth of the corners, no point of the box is farther away. */
+		float			m_zMax;
+		int				m_xMin;
+		int				m_xMax;
+		int				m_yMin;
+		int				m_yMax;
+	};
+
+	/*! Sets up the silhouette and depth planes of a box from its 8 corners in window coordinates.
+		Returns false, if the box does not fully cover any pixel.
+	*/
+	bool addOccluder(const float corners[8][3]);
+	/*! Rasterizes all occluders into the rows [yBegin, yEnd) of the depth buffer. */
+	void rasterizeBand(int yBegin, int yEnd);
+	/*! Computes the max depth levels from level 0. */
+	void buildHierarchy();
+
+	/*! Level 0 is the depth buffer, level i has (Width >> i) x (Height >> i) texels, down to a single row or column. */
+	std::vector<std::vector<float> >	m_levels;
+	std::vector<Occluder>				m_occluders;
+	/*! Matrix of the last call to render(), used to project the tested boxes. */
+	QMatrix4x4							m_worldToView;
+	/*! (score, box index) of the occluder candidates, kept to avoid allocations per frame. */
+	std::vector<std::pair<float, unsigned int> >	m_candidates;
+	unsigned int						m_occluderCount;
+};
+
+#endif // SOFTWAREOCCLUSIONCULLER_H
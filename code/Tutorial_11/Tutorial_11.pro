@@ -4,7 +4,7 @@
 #
 #------------------------------------------------------------------
 
-QT       += core gui opengl widgets
+QT       += core gui opengl widgets concurrent
 
 TARGET = Tutorial_11
 TEMPLATE = app
@@ -41,6 +41,8 @@ win32 {
 }
 
 SOURCES += \
+		AsyncLogger.cpp \
+		BenchmarkRunner.cpp \
 		BoxMesh.cpp \
 		BoxObject.cpp \
 		GridObject.cpp \
@@ -49,12 +51,15 @@ SOURCES += \
 		OpenGLWindow.cpp \
 		SceneView.cpp \
 		ShaderProgram.cpp \
+		SoftwareOcclusionCuller.cpp \
 		TestDialog.cpp \
 		Texture2ScreenObject.cpp \
 		Transform3D.cpp \
 		main.cpp
 
 HEADERS += \
+	AsyncLogger.h \
+	BenchmarkRunner.h \
 	BoxMesh.h \
 	BoxObject.h \
 	Camera.h \
@@ -65,6 +70,7 @@ HEADERS += \
 	OpenGLWindow.h \
 	SceneView.h \
 	ShaderProgram.h \
+	SoftwareOcclusionCuller.h \
 	TestDialog.h \
 	Texture2ScreenObject.h \
 	Transform3D.h \
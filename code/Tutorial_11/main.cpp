@@ -11,38 +11,60 @@ License    : BSD License,
 
 #include "TestDialog.h"
 
-#include <iostream>
 #include <ctime>
 
 #include <QApplication>
-#include <QDateTime>
 
+#include "AsyncLogger.h"
 #include "OpenGLException.h"
 #include "DebugApplication.h"
-
-void qDebugMsgHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
-	(void) context;
-	QString msgPrefix = "[" + QDateTime::currentDateTime().toString() + "] ";
-	switch (type) {
-		case QtDebugMsg		: msgPrefix += "Debug:    "; break;
-		case QtWarningMsg	: msgPrefix += "Warning:  "; break;
-		case QtCriticalMsg	: msgPrefix += "Critical: "; break;
-		case QtFatalMsg		: msgPrefix += "Fatal:    "; break;
-		case QtInfoMsg		: msgPrefix += "Info:     "; break;
-	}
-	QStringList lines = msg.split("\n");
-	for (const QString & l : lines)
-		std::cout << (msgPrefix + l).toStdString() << std::endl;
-}
-
+#include "ShaderProgram.h"
+#include "SceneView.h"
+#include "BenchmarkRunner.h"
+#include "SoftwareOcclusionCuller.h"
 
 int main(int argc, char **argv) {
-	qInstallMessageHandler(qDebugMsgHandler);
+	// messages are written by a background thread, so the per-frame statistics and the occlusion culler
+	// workers in the thread pool never wait for console output
+	AsyncLogger logger;
 
 	DebugApplication app(argc, argv);
 
+	// for startup benchmarking: force compilation of all shader programs from source
+	if (app.arguments().contains("--no-shader-cache"))
+		ShaderProgram::m_binaryCacheEnabled = false;
+	// draw all boxes, also those hidden behind other boxes
+	if (app.arguments().contains("--no-occlusion-culling"))
+		SoftwareOcclusionCuller::m_enabled = false;
+
+	// check the software occlusion culler without GPU, the exit code is 1 if a check fails
+	if (app.arguments().contains("--occlusion-selftest"))
+		return SoftwareOcclusionCuller::selfTest() ? 0 : 1;
+
 	qsrand(time(nullptr));
 
+	// headless benchmark mode: render scene offscreen along a camera path and write JSON results
+	if (app.arguments().contains("--benchmark")) {
+		// same format as in TestDialog
+		QSurfaceFormat format;
+		format.setRenderableType(QSurfaceFormat::OpenGL);
+		format.setProfile(QSurfaceFormat::CoreProfile);
+		format.setVersion(3,3);
+		format.setSamples(4);
+		format.setDepthBufferSize(8);
+
+		SceneView sceneView;
+		sceneView.setFormat(format);
+		// measure with depth prepass (toggled with F4 in interactive mode)
+		sceneView.m_depthPrepass = app.arguments().contains("--depth-prepass");
+		BenchmarkRunner::Parameters params;
+		// the box city spans 150x150 units around the origin
+		params.m_radius = 120;
+		params.m_height = 60;
+		params.parseArguments(app.arguments());
+		return BenchmarkRunner::run(sceneView, "Tutorial_11", params);
+	}
+
 	TestDialog dlg;
 	dlg.show();
 	return app.exec();
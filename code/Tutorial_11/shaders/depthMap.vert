@@ -7,6 +7,9 @@ layout(location = 0) in vec3 position; // input:  attribute with index '0' with
 
 uniform mat4 worldToView;              // parameter: the camera matrix
 
+// also used for the depth prepass, must match sceneWithShadowMap.vert exactly
+invariant gl_Position;
+
 void main() {
   gl_Position = worldToView * vec4(position, 1.0);
 }
@@ -49,7 +49,11 @@ void main()
   spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
   vec3 specular = spec * lightColor;
   // calculate shadow: 1 - in light, 0 - dark
+#ifdef NO_SHADOWS
+  float shadow = 0.0;
+#else
   float shadow = ShadowCalculation(fs_in.FragPosLightSpace);
+#endif // NO_SHADOWS
   // compose final light value - mind that this can lead to a brighter color than the original color
   vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;
   FinalColor = vec4(lighting, 1.0);
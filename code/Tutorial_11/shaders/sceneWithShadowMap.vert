@@ -13,6 +13,9 @@ out VS_OUT {
 uniform mat4 worldToView;                     // parameter: the camera matrix
 uniform mat4 lightSpaceMatrix;                // parameter: the light space matrix
 
+// must match depthMap.vert exactly, when drawn after a depth prepass
+invariant gl_Position;
+
 void main()
 {
   vs_out.FragPos = position;